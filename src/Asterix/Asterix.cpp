@@ -1,15 +1,60 @@
 
 #include "app.hpp"
 #include <sdlxx/init.hpp>
+#include <string>
+#include <string_view>
 
 int main(int argc, char* argv[])
 {
+    // --stress spawns many boars and eaters, --benchmark [frames_count] moves
+    // them without window nor sound and prints the time spent in collisions,
+    // --benchmark-texts [draws_count] compares the ways to draw the scores,
+    // --benchmark-sprites [sprites_count] the ways to draw sprites,
+    // --benchmark-loading [loads_count] the ways to load the world
+    WorldSettings world_settings;
+    std::string_view benchmark;
+    std::size_t benchmark_count = 0;
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        const std::string_view arg{argv[arg_index]};
+        if (arg == "--stress" || arg == "--benchmark")
+        {
+            world_settings.boars_count = 100000;
+            world_settings.eaters_count = 8;
+        }
+        if (arg == "--benchmark" || arg == "--benchmark-texts" ||
+            arg == "--benchmark-sprites" || arg == "--benchmark-loading")
+        {
+            benchmark = arg;
+            benchmark_count = arg == "--benchmark"           ? 1000
+                              : arg == "--benchmark-loading" ? 20
+                                                             : 10000;
+            if (arg_index + 1 < argc && argv[arg_index + 1][0] != '-')
+                benchmark_count = std::stoul(argv[++arg_index]);
+        }
+    }
+
+    if (!benchmark.empty())
+    {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    }
+
     const sdlxx::Initializer initializer{sdlxx::MainLib{}, sdlxx::ImageLib{},
                                          sdlxx::MixerLib{}, sdlxx::TextLib{}};
     if (!initializer)
         return -1;
 
-    auto app_or_error = load_app();
+    if (benchmark == "--benchmark")
+        return run_benchmark(world_settings, benchmark_count);
+    if (benchmark == "--benchmark-texts")
+        return run_texts_benchmark(benchmark_count);
+    if (benchmark == "--benchmark-sprites")
+        return run_sprites_benchmark(benchmark_count);
+    if (benchmark == "--benchmark-loading")
+        return run_loading_benchmark(benchmark_count);
+
+    auto app_or_error = load_app(world_settings);
     if (!app_or_error)
         return -1;
     auto& app = app_or_error.value();
@@ -1,15 +1,56 @@
 
 #include "app.hpp"
 #include "world.hpp"
+#include <platform/format.hpp>
+#include <sdlxx/assets.hpp>
+#include <sdlxx/atlas.hpp>
+#include <sdlxx/batch.hpp>
 #include <sdlxx/events.hpp>
+#include <sdlxx/loader.hpp>
 #include <sdlxx/sounds.hpp>
+#include <sdlxx/texts.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+constexpr std::chrono::milliseconds LOADING_FRAME_BUDGET{8};
+constexpr std::chrono::microseconds FRAME_PERIOD{16667};
+
+// Progress bar of the assets loaded
+static void render_loading_screen(const sdlxx::Renderer& renderer,
+                                  const sdlxx::AssetLoader& loader) noexcept
+{
+    const sdlxx::Size bar_size{SCREEN_SIZE.w() / 2, FONT_SIZE / 2};
+    const sdlxx::Point bar_origin{(SCREEN_SIZE.w() - bar_size.w()) / 2,
+                                  (SCREEN_SIZE.h() - bar_size.h()) / 2};
+    const auto requested_count = loader.requested_count();
+    const auto loaded_w =
+        requested_count == 0
+            ? bar_size.w()
+            : static_cast<int>(bar_size.w() * loader.ready_count() /
+                               requested_count);
+    sdlxx::fill_rectangle(renderer,
+                          sdlxx::Rectangle{bar_origin,
+                                           sdlxx::Size{loaded_w, bar_size.h()}},
+                          sdlxx::ColorAlpha{255, 200, 0, 255});
+    sdlxx::draw_rectangle(renderer, sdlxx::Rectangle{bar_origin, bar_size},
+                          sdlxx::ColorAlpha{255, 255, 255, 255});
+}
 
 class App::Impl
 {
 public:
-    Impl(sdlxx::Window&& window, sdlxx::Renderer&& renderer, World&& world)
+    // Starts loading the world in the background
+    Impl(sdlxx::Window&& window, sdlxx::Renderer&& renderer,
+         const WorldSettings& world_settings)
         : m_window(std::move(window)), m_renderer(std::move(renderer)),
-          m_world(std::move(world))
+          m_world_settings(world_settings),
+          m_loader(std::make_unique<sdlxx::AssetLoader>()),
+          m_world_assets(request_world_assets(*m_loader))
     {
     }
 
@@ -18,38 +59,42 @@ public:
         const auto event_poller = sdlxx::make_event_poller(
             sdlxx::on<SDL_QUIT>([](const auto&) {}),
             sdlxx::on<SDL_KEYDOWN>([&](const SDL_KeyboardEvent& event) {
+                if (!m_world)
+                    return;
                 switch (event.keysym.scancode)
                 {
                 case SDL_SCANCODE_UP:
-                    m_world.set_key(Keys::Up);
+                    m_world->set_key(Keys::Up);
                     break;
                 case SDL_SCANCODE_DOWN:
-                    m_world.set_key(Keys::Down);
+                    m_world->set_key(Keys::Down);
                     break;
                 case SDL_SCANCODE_LEFT:
-                    m_world.set_key(Keys::Left);
+                    m_world->set_key(Keys::Left);
                     break;
                 case SDL_SCANCODE_RIGHT:
-                    m_world.set_key(Keys::Right);
+                    m_world->set_key(Keys::Right);
                     break;
                 default:
                     break;
                 }
             }),
             sdlxx::on<SDL_KEYUP>([&](const SDL_KeyboardEvent& event) {
+                if (!m_world)
+                    return;
                 switch (event.keysym.scancode)
                 {
                 case SDL_SCANCODE_UP:
-                    m_world.unset_key(Keys::Up);
+                    m_world->unset_key(Keys::Up);
                     break;
                 case SDL_SCANCODE_DOWN:
-                    m_world.unset_key(Keys::Down);
+                    m_world->unset_key(Keys::Down);
                     break;
                 case SDL_SCANCODE_LEFT:
-                    m_world.unset_key(Keys::Left);
+                    m_world->unset_key(Keys::Left);
                     break;
                 case SDL_SCANCODE_RIGHT:
-                    m_world.unset_key(Keys::Right);
+                    m_world->unset_key(Keys::Right);
                     break;
                 default:
                     break;
@@ -61,20 +106,46 @@ public:
             if (event_poller.poll_events() == sdlxx::PollResult::Quit)
                 break;
 
-            m_world.move(m_renderer);
+            if (!m_world && !load_world_step())
+                break;
+
+            if (m_world)
+                m_world->move();
 
             sdlxx::clear(m_renderer);
 
-            m_world.render(m_renderer);
+            if (m_world)
+                m_world->render(m_renderer);
+            else
+                render_loading_screen(m_renderer, *m_loader);
 
             sdlxx::present(m_renderer);
         }
     }
 
 private:
+    // Creates the textures of the assets already decoded, then the world once
+    // they are all there; false when the world cannot be created
+    bool load_world_step() noexcept
+    {
+        m_loader->update(m_renderer, LOADING_FRAME_BUDGET);
+        if (!m_loader->is_done())
+            return true;
+        auto world_or_error =
+            create_world(std::move(m_world_assets), m_world_settings);
+        if (!world_or_error)
+            return false;
+        m_world.emplace(std::move(world_or_error.value()));
+        m_loader.reset();
+        return true;
+    }
+
     sdlxx::Window m_window;
     sdlxx::Renderer m_renderer;
-    World m_world;
+    WorldSettings m_world_settings;
+    std::unique_ptr<sdlxx::AssetLoader> m_loader;
+    WorldAssets m_world_assets;
+    std::optional<World> m_world;
 };
 
 App::App(std::unique_ptr<Impl> impl) noexcept : m_impl(std::move(impl)) {}
@@ -87,17 +158,300 @@ App::~App() noexcept = default;
 
 void App::run() { m_impl->run(); }
 
-sdlxx::result<App> load_app()
+sdlxx::result<App> load_app(const WorldSettings& world_settings)
 {
     BOOST_OUTCOME_TRY(window,
                       sdlxx::create_window("Hello World!", SCREEN_SIZE));
 
     BOOST_OUTCOME_TRY(renderer, sdlxx::create_renderer(window));
 
-    BOOST_OUTCOME_TRY(world, load_world(renderer));
-
     auto app_impl = std::make_unique<App::Impl>(
-        std::move(window), std::move(renderer), std::move(world));
+        std::move(window), std::move(renderer), world_settings);
 
     return App{std::move(app_impl)};
 }
+
+int run_benchmark(const WorldSettings& world_settings,
+                  std::size_t frames_count)
+{
+    auto window_or_error =
+        sdlxx::create_window("Asterix benchmark", SCREEN_SIZE,
+                             sdlxx::CenteredWindow, SDL_WINDOW_HIDDEN);
+    if (!window_or_error)
+        return -1;
+
+    auto renderer_or_error = sdlxx::create_renderer(window_or_error.value(),
+                                                    SDL_RENDERER_SOFTWARE);
+    if (!renderer_or_error)
+        return -1;
+    const auto& renderer = renderer_or_error.value();
+
+    auto world_or_error = load_world(renderer, world_settings);
+    if (!world_or_error)
+        return -1;
+    auto& world = world_or_error.value();
+
+    for (std::size_t frame_index = 0; frame_index < frames_count; ++frame_index)
+        world.step();
+
+    using milliseconds = std::chrono::duration<double, std::milli>;
+    const auto& stats = world.collision_stats();
+    const auto total_ms = milliseconds(stats.total_duration).count();
+    std::cout << stdnext::format(
+        "{} boars, {} eaters, {} frames: {} queries in {:.3f} ms, {:.0f} "
+        "queries/s, {:.4f} ms/frame on average, {:.4f} ms/frame at most\n",
+        world_settings.boars_count, world_settings.eaters_count,
+        stats.frames_count, stats.queries_count, total_ms,
+        total_ms > 0 ? stats.queries_count * 1000.0 / total_ms : 0.0,
+        stats.frames_count > 0 ? total_ms / stats.frames_count : 0.0,
+        milliseconds(stats.max_frame_duration).count());
+    return 0;
+}
+
+int run_texts_benchmark(std::size_t draws_count)
+{
+    auto window_or_error =
+        sdlxx::create_window("Asterix benchmark", SCREEN_SIZE,
+                             sdlxx::CenteredWindow, SDL_WINDOW_HIDDEN);
+    if (!window_or_error)
+        return -1;
+
+    auto renderer_or_error = sdlxx::create_renderer(window_or_error.value(),
+                                                    SDL_RENDERER_SOFTWARE);
+    if (!renderer_or_error)
+        return -1;
+    const auto& renderer = renderer_or_error.value();
+
+    auto font_or_error =
+        sdlxx::load_font(sdlxx::get_asset_path("leadcoat.ttf"), FONT_SIZE);
+    if (!font_or_error)
+        return -1;
+    const auto& font = font_or_error.value();
+
+    auto glyph_atlas_or_error = sdlxx::create_glyph_atlas(renderer, font);
+    if (!glyph_atlas_or_error)
+        return -1;
+    const auto& glyph_atlas = glyph_atlas_or_error.value();
+
+    const auto measure_draws_per_second = [&](const auto& draw) {
+        const auto start_time = std::chrono::steady_clock::now();
+        for (std::size_t draw_index = 0; draw_index < draws_count;
+             ++draw_index)
+        {
+            draw(stdnext::format("Obelix {}", draw_index));
+            // Flushes the drawings as the end of a frame would
+            if (draw_index % 100 == 99)
+                sdlxx::present(renderer);
+        }
+        sdlxx::present(renderer);
+        const std::chrono::duration<double> duration =
+            std::chrono::steady_clock::now() - start_time;
+        return draws_count / duration.count();
+    };
+
+    const auto texture_draws_per_second =
+        measure_draws_per_second([&](const std::string& text) {
+            const auto texture = sdlxx::create_text_texture(
+                renderer, font, text.c_str(),
+                sdlxx::ColorAlpha{255, 255, 255, 255});
+            if (texture)
+                sdlxx::render_texture(renderer, texture.value(),
+                                      sdlxx::Point{FONT_SIZE, FONT_SIZE});
+        });
+    const auto atlas_draws_per_second =
+        measure_draws_per_second([&](const std::string& text) {
+            sdlxx::render_text(renderer, glyph_atlas, text,
+                               sdlxx::Point{FONT_SIZE, FONT_SIZE});
+        });
+
+    std::cout << stdnext::format(
+        "{} draws of a changing score: {:.0f} draws/s ({:.1f} per 60 Hz "
+        "frame) with a texture per text, {:.0f} draws/s ({:.1f} per 60 Hz "
+        "frame) with the glyph atlas\n",
+        draws_count, texture_draws_per_second, texture_draws_per_second / 60,
+        atlas_draws_per_second, atlas_draws_per_second / 60);
+    return 0;
+}
+
+int run_sprites_benchmark(std::size_t sprites_count)
+{
+    auto window_or_error =
+        sdlxx::create_window("Asterix benchmark", SCREEN_SIZE,
+                             sdlxx::CenteredWindow, SDL_WINDOW_HIDDEN);
+    if (!window_or_error)
+        return -1;
+
+    auto renderer_or_error = sdlxx::create_renderer(window_or_error.value(),
+                                                    SDL_RENDERER_SOFTWARE);
+    if (!renderer_or_error)
+        return -1;
+    const auto& renderer = renderer_or_error.value();
+
+    const sdlxx::Color boar_color_key{52, 80, 225};
+    const sdlxx::Color obelix_color_key{252, 254, 252};
+    auto boar_texture_or_error = sdlxx::load_texture(
+        renderer, sdlxx::get_asset_path("Boar.Sprite.bmp"), boar_color_key);
+    auto obelix_texture_or_error = sdlxx::load_texture(
+        renderer, sdlxx::get_asset_path("Obelix.Sprite.bmp"), obelix_color_key);
+    auto texture_atlas_or_error = sdlxx::load_texture_atlas(
+        renderer, sdlxx::get_assets_path(), ".bmp",
+        {{"Boar.Sprite", boar_color_key}, {"Obelix.Sprite", obelix_color_key}});
+    if (!boar_texture_or_error || !obelix_texture_or_error ||
+        !texture_atlas_or_error)
+        return -1;
+    const auto boar_region =
+        texture_atlas_or_error.value().find_region("Boar.Sprite");
+    const auto obelix_region =
+        texture_atlas_or_error.value().find_region("Obelix.Sprite");
+    if (!boar_region || !obelix_region)
+        return -1;
+
+    std::mt19937 random_generator;
+    std::uniform_int_distribution<> x_distrib(0, SCREEN_SIZE.w());
+    std::uniform_int_distribution<> y_distrib(0, SCREEN_SIZE.h());
+    std::vector<sdlxx::Point> locations;
+    for (std::size_t sprite_index = 0; sprite_index < sprites_count;
+         ++sprite_index)
+        locations.emplace_back(x_distrib(random_generator),
+                               y_distrib(random_generator));
+
+    constexpr int frames_count = 20;
+    const auto measure_frame_duration = [&](const auto& draw_frame) {
+        const auto start_time = std::chrono::steady_clock::now();
+        for (int frame_index = 0; frame_index < frames_count; ++frame_index)
+        {
+            sdlxx::clear(renderer);
+            draw_frame();
+            sdlxx::present(renderer);
+        }
+        return std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start_time)
+                   .count() /
+               frames_count;
+    };
+
+    const auto copies_frame_ms = measure_frame_duration([&] {
+        for (std::size_t sprite_index = 0; sprite_index < sprites_count;
+             ++sprite_index)
+            sdlxx::render_texture(renderer,
+                                  sprite_index % 2 == 0
+                                      ? boar_texture_or_error.value()
+                                      : obelix_texture_or_error.value(),
+                                  locations[sprite_index]);
+    });
+    sdlxx::SpriteBatch sprite_batch;
+    const auto batch_frame_ms = measure_frame_duration([&] {
+        for (std::size_t sprite_index = 0; sprite_index < sprites_count;
+             ++sprite_index)
+            sprite_batch.draw(sprite_index % 2 == 0 ? *boar_region
+                                                    : *obelix_region,
+                              locations[sprite_index]);
+        sprite_batch.submit(renderer);
+    });
+
+    const auto sprites_per_60hz_frame = [&](double frame_ms) {
+        return sprites_count * (1000.0 / 60) / frame_ms;
+    };
+    std::cout << stdnext::format(
+        "{} sprites per frame: {:.2f} ms/frame, {:.0f} sprites per 60 Hz "
+        "frame with a copy per sprite, {:.2f} ms/frame, {:.0f} sprites per "
+        "60 Hz frame with the sprite batch\n",
+        sprites_count, copies_frame_ms, sprites_per_60hz_frame(copies_frame_ms),
+        batch_frame_ms, sprites_per_60hz_frame(batch_frame_ms));
+    return 0;
+}
+
+int run_loading_benchmark(std::size_t loads_count)
+{
+    auto window_or_error =
+        sdlxx::create_window("Asterix benchmark", SCREEN_SIZE,
+                             sdlxx::CenteredWindow, SDL_WINDOW_HIDDEN);
+    if (!window_or_error)
+        return -1;
+
+    auto renderer_or_error = sdlxx::create_renderer(window_or_error.value(),
+                                                    SDL_RENDERER_SOFTWARE);
+    if (!renderer_or_error)
+        return -1;
+    const auto& renderer = renderer_or_error.value();
+
+    // Reads the files once, so that both ways find them in the cache
+    if (!load_world(renderer))
+        return -1;
+
+    using milliseconds = std::chrono::duration<double, std::milli>;
+    double serial_ms = 0;
+    double first_frame_ms = 0;
+    double background_ms = 0;
+    double longest_frame_ms = 0;
+    std::size_t loading_frames_count = 0;
+    std::size_t workers_count = 0;
+    for (std::size_t load_index = 0; load_index < loads_count; ++load_index)
+    {
+        {
+            const auto start_time = std::chrono::steady_clock::now();
+            auto world_or_error = load_world(renderer);
+            if (!world_or_error)
+                return -1;
+            sdlxx::clear(renderer);
+            world_or_error.value().render(renderer);
+            sdlxx::present(renderer);
+            serial_ms += milliseconds(std::chrono::steady_clock::now() -
+                                      start_time)
+                             .count();
+        }
+
+        const auto start_time = std::chrono::steady_clock::now();
+        sdlxx::AssetLoader loader;
+        workers_count = loader.workers_count();
+        auto assets = request_world_assets(loader);
+        auto first_frame_drawn = false;
+        auto frame_start_time = start_time;
+        for (;;)
+        {
+            loader.update(renderer, LOADING_FRAME_BUDGET);
+            if (loader.is_done())
+                break;
+            sdlxx::clear(renderer);
+            render_loading_screen(renderer, loader);
+            sdlxx::present(renderer);
+            const auto frame_end_time = std::chrono::steady_clock::now();
+            if (!first_frame_drawn)
+                first_frame_ms +=
+                    milliseconds(frame_end_time - start_time).count();
+            first_frame_drawn = true;
+            longest_frame_ms = std::max(
+                longest_frame_ms,
+                milliseconds(frame_end_time - frame_start_time).count());
+            ++loading_frames_count;
+            // Waits as the vertical synchronization of the game would, the
+            // software renderer having none
+            frame_start_time =
+                std::max(frame_start_time + FRAME_PERIOD, frame_end_time);
+            std::this_thread::sleep_until(frame_start_time);
+        }
+        auto world_or_error = create_world(std::move(assets));
+        if (!world_or_error)
+            return -1;
+        sdlxx::clear(renderer);
+        world_or_error.value().render(renderer);
+        sdlxx::present(renderer);
+        const auto load_ms =
+            milliseconds(std::chrono::steady_clock::now() - start_time).count();
+        // Loaded before the first frame of the loading screen
+        if (!first_frame_drawn)
+            first_frame_ms += load_ms;
+        background_ms += load_ms;
+    }
+
+    std::cout << stdnext::format(
+        "{} loads of the world: {:.2f} ms to the first frame, loaded one "
+        "asset after the other; {:.2f} ms to the first frame of the loading "
+        "screen, {:.2f} ms to the first frame of the world, {:.1f} loading "
+        "frames of {:.2f} ms at most at 60 Hz, with {} workers\n",
+        loads_count, serial_ms / loads_count, first_frame_ms / loads_count,
+        background_ms / loads_count,
+        static_cast<double>(loading_frames_count) / loads_count,
+        longest_frame_ms, workers_count);
+    return 0;
+}
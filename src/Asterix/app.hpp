@@ -1,7 +1,9 @@
 
 #pragma once
 
+#include "world.hpp"
 #include <sdlxx/error_handling.hpp>
+#include <cstddef>
 #include <memory>
 
 class App
@@ -24,4 +26,25 @@ private:
 };
 
 sdlxx::result<App>
-load_app();
+load_app(const WorldSettings& world_settings = WorldSettings{});
+
+// Moves the characters of a world frames_count times, without rendering, and
+// prints the time spent in the collisions; the SDL video and audio drivers can
+// be the dummy ones
+int run_benchmark(const WorldSettings& world_settings,
+                  std::size_t frames_count);
+
+// Draws a changing score draws_count times, rendering a texture for each
+// change as the forest did before, then from a glyph atlas, and prints the
+// draws per second of both
+int run_texts_benchmark(std::size_t draws_count);
+
+// Draws sprites_count sprites per frame, alternating between the boar and
+// Obelix, with a texture per image and a copy per sprite, then from an atlas
+// with a sprite batch, and prints how many sprites fit in a 60 Hz frame
+int run_sprites_benchmark(std::size_t sprites_count);
+
+// Loads the world loads_count times, one asset after the other, then in the
+// background while drawing the loading screen, and prints the time to the
+// first frame and to the loaded world
+int run_loading_benchmark(std::size_t loads_count);
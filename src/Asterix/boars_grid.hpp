@@ -0,0 +1,193 @@
+
+#pragma once
+
+#include <sdlxx/geometry.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Locations of the boars, bucketed by the cell of a uniform grid holding their
+// origin, so that a collision only looks at the boars of the few cells around
+// the colliding rectangle.
+// Boars are removed by moving the last one in place of the removed one, which
+// changes the indexes of the boars but takes a constant time.
+class BoarsGrid
+{
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    BoarsGrid(sdlxx::Size world_size, sdlxx::Size boar_size) noexcept
+        : m_boar_size{boar_size}, m_cell_size{std::max(1, boar_size.w()),
+                                              std::max(1, boar_size.h())},
+          m_columns_count{std::max(1, (world_size.w() + m_cell_size.w() - 1) /
+                                          m_cell_size.w())},
+          m_rows_count{std::max(1, (world_size.h() + m_cell_size.h() - 1) /
+                                       m_cell_size.h())},
+          m_cells(static_cast<std::size_t>(m_columns_count * m_rows_count))
+    {
+    }
+
+    std::size_t size() const noexcept { return m_locations.size(); }
+
+    const std::vector<sdlxx::Point>& locations() const noexcept
+    {
+        return m_locations;
+    }
+
+    void insert(sdlxx::Point location)
+    {
+        auto& cell = m_cells[cell_index(location)];
+        m_slots.push_back(static_cast<std::uint32_t>(cell.size()));
+        cell.push_back(
+            CellBoar{location, static_cast<std::uint32_t>(m_locations.size())});
+        m_locations.push_back(location);
+    }
+
+    // Index of a boar colliding with the rectangle, or npos
+    std::size_t find_colliding(const sdlxx::Rectangle& rectangle) const noexcept
+    {
+        // Origins of the boars touching the rectangle, as sdlxx::are_colliding
+        // counts touching edges as a collision
+        const auto first_column = column_index(rectangle.origin().x() -
+                                               m_boar_size.w());
+        const auto last_column = column_index(rectangle.origin().x() +
+                                              rectangle.size().w());
+        const auto first_row = row_index(rectangle.origin().y() -
+                                         m_boar_size.h());
+        const auto last_row = row_index(rectangle.origin().y() +
+                                        rectangle.size().h());
+        for (auto row = first_row; row <= last_row; ++row)
+        {
+            for (auto column = first_column; column <= last_column; ++column)
+            {
+                for (const auto& cell_boar :
+                     m_cells[static_cast<std::size_t>(row * m_columns_count +
+                                                      column)])
+                {
+                    if (sdlxx::are_colliding(
+                            sdlxx::Rectangle{cell_boar.location, m_boar_size},
+                            rectangle))
+                        return cell_boar.boar_index;
+                }
+            }
+        }
+        return npos;
+    }
+
+    // Index of the boar whose origin is the nearest to the point, or npos when
+    // there is no boar left, looking at rings of cells farther and farther
+    // until no closer boar can be found
+    std::size_t find_nearest(sdlxx::Point point) const noexcept
+    {
+        const auto center_column = column_index(point.x());
+        const auto center_row = row_index(point.y());
+        const auto max_radius = std::max(m_columns_count, m_rows_count);
+        const auto cell_side =
+            static_cast<std::int64_t>(std::min(m_cell_size.w(), m_cell_size.h()));
+        auto nearest_index = npos;
+        auto nearest_distance = std::numeric_limits<std::int64_t>::max();
+        for (int radius = 0; radius <= max_radius; ++radius)
+        {
+            // Boars of the farther rings are at least that far
+            const auto min_distance = (radius - 1) * cell_side;
+            if (nearest_index != npos && radius > 0 &&
+                nearest_distance <= min_distance * min_distance)
+                break;
+            for (int row = center_row - radius; row <= center_row + radius; ++row)
+            {
+                if (row < 0 || row >= m_rows_count)
+                    continue;
+                const auto on_ring_edge =
+                    row == center_row - radius || row == center_row + radius;
+                const auto column_step = on_ring_edge ? 1 : 2 * radius;
+                for (int column = center_column - radius;
+                     column <= center_column + radius; column += column_step)
+                {
+                    if (column >= 0 && column < m_columns_count)
+                        find_nearest_in_cell(
+                            point,
+                            m_cells[static_cast<std::size_t>(
+                                row * m_columns_count + column)],
+                            nearest_index, nearest_distance);
+                }
+            }
+        }
+        return nearest_index;
+    }
+
+    void erase(std::size_t boar_index) noexcept
+    {
+        // Removes the boar from its cell
+        auto& cell = m_cells[cell_index(m_locations[boar_index])];
+        const auto slot = m_slots[boar_index];
+        cell[slot] = cell.back();
+        m_slots[cell[slot].boar_index] = slot;
+        cell.pop_back();
+
+        // Moves the last boar in its place
+        const auto last_index = m_locations.size() - 1;
+        if (boar_index != last_index)
+        {
+            m_locations[boar_index] = m_locations[last_index];
+            m_slots[boar_index] = m_slots[last_index];
+            m_cells[cell_index(m_locations[boar_index])][m_slots[boar_index]]
+                .boar_index = static_cast<std::uint32_t>(boar_index);
+        }
+        m_locations.pop_back();
+        m_slots.pop_back();
+    }
+
+private:
+    // Copy of the location of the boar, so that looking at the boars of a cell
+    // reads contiguous memory
+    struct CellBoar
+    {
+        sdlxx::Point location;
+        std::uint32_t boar_index;
+    };
+
+    int column_index(int x) const noexcept
+    {
+        return std::clamp(x / m_cell_size.w(), 0, m_columns_count - 1);
+    }
+
+    int row_index(int y) const noexcept
+    {
+        return std::clamp(y / m_cell_size.h(), 0, m_rows_count - 1);
+    }
+
+    std::size_t cell_index(sdlxx::Point location) const noexcept
+    {
+        return static_cast<std::size_t>(row_index(location.y()) *
+                                            m_columns_count +
+                                        column_index(location.x()));
+    }
+
+    void find_nearest_in_cell(sdlxx::Point point,
+                              const std::vector<CellBoar>& cell,
+                              std::size_t& nearest_index,
+                              std::int64_t& nearest_distance) const noexcept
+    {
+        for (const auto& cell_boar : cell)
+        {
+            const std::int64_t dx = cell_boar.location.x() - point.x();
+            const std::int64_t dy = cell_boar.location.y() - point.y();
+            const auto distance = dx * dx + dy * dy;
+            if (distance < nearest_distance)
+            {
+                nearest_distance = distance;
+                nearest_index = cell_boar.boar_index;
+            }
+        }
+    }
+
+    sdlxx::Size m_boar_size;
+    sdlxx::Size m_cell_size;
+    int m_columns_count;
+    int m_rows_count;
+    std::vector<sdlxx::Point> m_locations;
+    std::vector<std::uint32_t> m_slots; // index of each boar in its cell
+    std::vector<std::vector<CellBoar>> m_cells;
+};
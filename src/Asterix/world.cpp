@@ -1,134 +1,155 @@
 
 #include "world.hpp"
+#include "boars_grid.hpp"
 #include <algorithm>
 #include <chrono>
 #include <platform/format.hpp>
 #include <optional>
 #include <random>
+#include <string>
 #include <sdlxx/assets.hpp>
+#include <sdlxx/atlas.hpp>
+#include <sdlxx/loader.hpp>
 #include <sdlxx/sounds.hpp>
 #include <sdlxx/sprites.hpp>
 #include <sdlxx/texts.hpp>
 
 constexpr std::chrono::milliseconds ANIMATION_DELAY{100};
 constexpr sdlxx::Size ANIMATION_STEP{10, 10};
-constexpr int FONT_SIZE = 40;
+constexpr int BACKGROUND_LAYER = 0;
+constexpr int CHARACTERS_LAYER = 1;
+constexpr int TEXTS_LAYER = 2;
 
 static std::random_device random_device;
 static std::mt19937 random_generator(random_device());
 
-static sdlxx::result<sdlxx::Texture>
-format_number_to_texture(const sdlxx::Renderer& renderer,
-                         const sdlxx::Font& font, const char* format,
-                         int number)
-{
-    const auto number_string = stdnext::format(format, number);
-    return sdlxx::create_text_texture(renderer, font, number_string.c_str(),
-                                      sdlxx::ColorAlpha{255, 255, 255, 255});
-}
-
 class Forest
 {
 public:
-    Forest(const sdlxx::Renderer& renderer, sdlxx::Texture&& texture,
-           sdlxx::Font&& font) noexcept
-        : m_texture{std::move(texture)}, m_font(std::move(font)),
-          m_miams_obelix_texture{format_number_to_texture(
-              renderer, m_font, "Obelix {}", m_miams_obelix)},
-          m_miams_asterix_texture{format_number_to_texture(
-              renderer, m_font, "Asterix {}", m_miams_asterix)}
+    Forest(const sdlxx::AtlasRegion& region, sdlxx::GlyphAtlas&& glyph_atlas)
+        : m_region{region}, m_glyph_atlas(std::move(glyph_atlas)),
+          m_miams_obelix_text{stdnext::format("Obelix {}", m_miams_obelix)},
+          m_miams_asterix_text{stdnext::format("Asterix {}", m_miams_asterix)}
     {
     }
 
-    void render(const sdlxx::Renderer& renderer) const noexcept
+    void render(sdlxx::SpriteBatch& sprite_batch) const noexcept
     {
-        sdlxx::render_texture(renderer, m_texture);
-        if (m_miams_obelix_texture)
-            sdlxx::render_texture(
-                renderer, m_miams_obelix_texture.value(),
-                sdlxx::Point{
-                    SCREEN_SIZE.w() -
-                        sdlxx::get_size(m_miams_obelix_texture.value()).w() -
-                        FONT_SIZE,
-                    FONT_SIZE});
-        if (m_miams_asterix_texture)
-            sdlxx::render_texture(renderer, m_miams_asterix_texture.value(),
-                                  sdlxx::Point{FONT_SIZE, FONT_SIZE});
+        sprite_batch.draw(m_region,
+                          sdlxx::Rectangle{sdlxx::Point{0, 0}, SCREEN_SIZE},
+                          BACKGROUND_LAYER);
+        sdlxx::draw_text(
+            sprite_batch, m_glyph_atlas, m_miams_obelix_text,
+            sdlxx::Point{
+                SCREEN_SIZE.w() -
+                    sdlxx::get_text_size(m_glyph_atlas, m_miams_obelix_text)
+                        .w() -
+                    FONT_SIZE,
+                FONT_SIZE},
+            TEXTS_LAYER);
+        sdlxx::draw_text(sprite_batch, m_glyph_atlas, m_miams_asterix_text,
+                         sdlxx::Point{FONT_SIZE, FONT_SIZE}, TEXTS_LAYER);
     }
 
-    void miam_obelix(const sdlxx::Renderer& renderer) noexcept
+    void miam_obelix() noexcept
     {
-        m_miams_obelix_texture = format_number_to_texture(
-            renderer, m_font, "Obelix {}", ++m_miams_obelix);
+        ++m_miams_obelix;
+        try
+        {
+            m_miams_obelix_text = stdnext::format("Obelix {}", m_miams_obelix);
+        }
+        catch (...)
+        {
+        }
     }
 
-    void miam_asterix(const sdlxx::Renderer& renderer) noexcept
+    void miam_asterix() noexcept
     {
-        m_miams_asterix_texture = format_number_to_texture(
-            renderer, m_font, "Asterix {}", ++m_miams_asterix);
+        ++m_miams_asterix;
+        try
+        {
+            m_miams_asterix_text =
+                stdnext::format("Asterix {}", m_miams_asterix);
+        }
+        catch (...)
+        {
+        }
     }
 
 private:
-    sdlxx::Texture m_texture;
-    sdlxx::Font m_font;
+    sdlxx::AtlasRegion m_region;
+    sdlxx::GlyphAtlas m_glyph_atlas;
     int m_miams_obelix{0};
-    sdlxx::result<sdlxx::Texture> m_miams_obelix_texture;
+    std::string m_miams_obelix_text;
     int m_miams_asterix{0};
-    sdlxx::result<sdlxx::Texture> m_miams_asterix_texture;
+    std::string m_miams_asterix_text;
 };
 
 class Boars
 {
 public:
-    Boars(sdlxx::Texture&& texture, std::size_t boars_count) noexcept
-        : m_texture{std::move(texture)}, m_size{sdlxx::get_size(m_texture)}
+    Boars(const sdlxx::AtlasRegion& region, std::size_t boars_count)
+        : m_region{region}, m_size{region.size()},
+          m_boars_grid{SCREEN_SIZE, m_size}
     {
         std::uniform_int_distribution<> x_distrib(0,
                                                   SCREEN_SIZE.w() - m_size.w());
         std::uniform_int_distribution<> y_distrib(0,
                                                   SCREEN_SIZE.h() - m_size.h());
         for (std::size_t boar_index = 0; boar_index < boars_count; ++boar_index)
-            m_boars_locations.push_back(sdlxx::Point{
-                x_distrib(random_generator), y_distrib(random_generator)});
+            m_boars_grid.insert(sdlxx::Point{x_distrib(random_generator),
+                                             y_distrib(random_generator)});
     }
 
-    void render(const sdlxx::Renderer& renderer) const noexcept
+    void render(sdlxx::SpriteBatch& sprite_batch) const noexcept
     {
-        for (const auto& boar_location : m_boars_locations)
-            sdlxx::render_texture(renderer, m_texture, boar_location);
+        for (const auto& boar_location : m_boars_grid.locations())
+            sprite_batch.draw(m_region, boar_location, CHARACTERS_LAYER);
     }
 
     bool are_colliding(const sdlxx::Rectangle& other) noexcept
     {
-        const auto collided_boar_iter =
-            std::find_if(begin(m_boars_locations), end(m_boars_locations),
-                         [&](const auto& location) {
-                             return sdlxx::are_colliding(
-                                 sdlxx::Rectangle{location, m_size}, other);
-                         });
-        if (collided_boar_iter == end(m_boars_locations))
+        ++m_queries_count;
+        const auto collided_boar_index = m_boars_grid.find_colliding(other);
+        if (collided_boar_index == BoarsGrid::npos)
             return false;
-        m_boars_locations.erase(collided_boar_iter);
+        m_boars_grid.erase(collided_boar_index);
         return true;
     }
 
-    std::size_t boars_count() const noexcept
+    // Location of the boar whose center is the nearest to the center of the
+    // rectangle
+    std::optional<sdlxx::Point>
+    nearest_boar(const sdlxx::Rectangle& other) const noexcept
     {
-        return m_boars_locations.size();
+        ++m_queries_count;
+        const auto nearest_boar_index = m_boars_grid.find_nearest(sdlxx::Point{
+            other.origin().x() + (other.size().w() - m_size.w()) / 2,
+            other.origin().y() + (other.size().h() - m_size.h()) / 2});
+        if (nearest_boar_index == BoarsGrid::npos)
+            return std::nullopt;
+        return m_boars_grid.locations()[nearest_boar_index];
     }
 
+    std::size_t boars_count() const noexcept { return m_boars_grid.size(); }
+
+    sdlxx::Size size() const noexcept { return m_size; }
+
+    std::size_t queries_count() const noexcept { return m_queries_count; }
+
 private:
-    sdlxx::Texture m_texture;
+    sdlxx::AtlasRegion m_region;
     sdlxx::Size m_size;
-    std::vector<sdlxx::Point> m_boars_locations;
+    BoarsGrid m_boars_grid;
+    mutable std::size_t m_queries_count{0};
 };
 
 class Obelix
 {
 public:
-    Obelix(sdlxx::Texture&& texture, sdlxx::Chunk&& miam_chunk) noexcept
-        : m_texture{std::move(texture)}, m_miam_chunk{std::move(miam_chunk)},
-          m_size{sdlxx::get_size(this->m_texture)}
+    Obelix(const sdlxx::AtlasRegion& region, sdlxx::Chunk&& miam_chunk) noexcept
+        : m_region{region}, m_miam_chunk{std::move(miam_chunk)},
+          m_size{region.size()}
     {
     }
 
@@ -156,9 +177,9 @@ public:
             m_location = next_location;
     }
 
-    void render(const sdlxx::Renderer& renderer) const noexcept
+    void render(sdlxx::SpriteBatch& sprite_batch) const noexcept
     {
-        sdlxx::render_texture(renderer, m_texture, m_location);
+        sprite_batch.draw(m_region, m_location, CHARACTERS_LAYER);
     }
 
     sdlxx::Rectangle rectangle() const noexcept
@@ -169,7 +190,7 @@ public:
     void miam() noexcept { sdlxx::play(m_miam_chunk); }
 
 private:
-    sdlxx::Texture m_texture;
+    sdlxx::AtlasRegion m_region;
     sdlxx::Chunk m_miam_chunk;
     sdlxx::Size m_size;
     sdlxx::Point m_location{3 * SCREEN_SIZE.w() / 4, 3 * SCREEN_SIZE.h() / 4};
@@ -179,9 +200,9 @@ private:
 class Asterix
 {
 public:
-    Asterix(sdlxx::SpriteSheet&& sprite_sheet, sdlxx::Chunk&& miam_chunk,
+    Asterix(const sdlxx::AtlasSpriteSheet& sprite_sheet, sdlxx::Chunk&& miam_chunk,
             sdlxx::Chunk&& aie_chunk) noexcept
-        : m_sprite_sheet{std::move(sprite_sheet)}, m_miam_chunk{std::move(
+        : m_sprite_sheet{sprite_sheet}, m_miam_chunk{std::move(
                                                        miam_chunk)},
           m_aie_chunk{std::move(aie_chunk)}, m_sprite_index{0, 0}
     {
@@ -217,9 +238,10 @@ public:
         m_sprite_index = sdlxx::next(m_sprite_sheet, m_sprite_index);
     }
 
-    void render(const sdlxx::Renderer& renderer) const noexcept
+    void render(sdlxx::SpriteBatch& sprite_batch) const noexcept
     {
-        sdlxx::render_sprite(renderer, m_sprite_sheet, m_sprite_index, m_location);
+        sdlxx::draw_sprite(sprite_batch, m_sprite_sheet, m_sprite_index,
+                           m_location, CHARACTERS_LAYER);
     }
 
     void set_key(Keys key) noexcept
@@ -244,7 +266,7 @@ public:
     void aie() noexcept { sdlxx::play(m_aie_chunk); }
 
 private:
-    sdlxx::SpriteSheet m_sprite_sheet;
+    sdlxx::AtlasSpriteSheet m_sprite_sheet;
     sdlxx::Chunk m_miam_chunk;
     sdlxx::Chunk m_aie_chunk;
     sdlxx::SpriteIndex m_sprite_index;
@@ -252,11 +274,75 @@ private:
     Keys m_keys{Keys::None};
 };
 
-World::World(std::unique_ptr<Forest>&& forest, std::unique_ptr<Boars>&& boars,
+// Characters moved by the computer, each one walking to the nearest boar
+class Eaters
+{
+public:
+    Eaters(const sdlxx::AtlasRegion& region, std::size_t eaters_count)
+        : m_region{region}, m_size{region.size()}
+    {
+        std::uniform_int_distribution<> x_distrib(0,
+                                                  SCREEN_SIZE.w() - m_size.w());
+        std::uniform_int_distribution<> y_distrib(0,
+                                                  SCREEN_SIZE.h() - m_size.h());
+        for (std::size_t eater_index = 0; eater_index < eaters_count;
+             ++eater_index)
+            m_locations.push_back(sdlxx::Point{x_distrib(random_generator),
+                                               y_distrib(random_generator)});
+    }
+
+    void move(const Boars& boars) noexcept
+    {
+        for (auto& location : m_locations)
+        {
+            const auto target =
+                boars.nearest_boar(sdlxx::Rectangle{location, m_size});
+            if (!target)
+                return;
+            // Centers the eater on the boar
+            const auto dx = target->x() + boars.size().w() / 2 -
+                            (location.x() + m_size.w() / 2);
+            const auto dy = target->y() + boars.size().h() / 2 -
+                            (location.y() + m_size.h() / 2);
+            location = sdlxx::Point{
+                std::clamp(location.x() + std::clamp(dx, -ANIMATION_STEP.w(),
+                                                     ANIMATION_STEP.w()),
+                           0, SCREEN_SIZE.w() - m_size.w()),
+                std::clamp(location.y() + std::clamp(dy, -ANIMATION_STEP.h(),
+                                                     ANIMATION_STEP.h()),
+                           0, SCREEN_SIZE.h() - m_size.h())};
+        }
+    }
+
+    // Eats the boars touched by the eaters, one per eater at most, like
+    // Obelix and Asterix
+    void eat(Boars& boars) noexcept
+    {
+        for (const auto& location : m_locations)
+            boars.are_colliding(sdlxx::Rectangle{location, m_size});
+    }
+
+    void render(sdlxx::SpriteBatch& sprite_batch) const noexcept
+    {
+        for (const auto& location : m_locations)
+            sprite_batch.draw(m_region, location, CHARACTERS_LAYER);
+    }
+
+private:
+    sdlxx::AtlasRegion m_region;
+    sdlxx::Size m_size;
+    std::vector<sdlxx::Point> m_locations;
+};
+
+World::World(std::unique_ptr<sdlxx::TextureAtlas>&& texture_atlas,
+             std::unique_ptr<Forest>&& forest, std::unique_ptr<Boars>&& boars,
+             std::unique_ptr<Eaters>&& eaters,
              std::unique_ptr<Obelix>&& obelix,
              std::unique_ptr<Asterix>&& asterix)
-    : m_forest(std::move(forest)), m_boars(std::move(boars)),
-      m_obelix(std::move(obelix)), m_asterix(std::move(asterix))
+    : m_texture_atlas(std::move(texture_atlas)), m_forest(std::move(forest)),
+      m_boars(std::move(boars)),
+      m_eaters(std::move(eaters)), m_obelix(std::move(obelix)),
+      m_asterix(std::move(asterix))
 {
 }
 
@@ -268,7 +354,7 @@ void World::set_key(Keys key) noexcept { m_asterix->set_key(key); }
 
 void World::unset_key(Keys key) noexcept { m_asterix->unset_key(key); }
 
-void World::move(const sdlxx::Renderer& renderer) noexcept
+void World::move() noexcept
 {
     if (m_end_of_game)
         return;
@@ -277,18 +363,39 @@ void World::move(const sdlxx::Renderer& renderer) noexcept
     if (current_frame_time < m_previous_frame_time + ANIMATION_DELAY)
         return;
 
+    step();
+
+    m_previous_frame_time = current_frame_time;
+}
+
+void World::step() noexcept
+{
     m_obelix->move();
     m_asterix->move();
 
-    if (m_boars->are_colliding(m_obelix->rectangle()))
+    const auto collisions_start_time = std::chrono::steady_clock::now();
+    const auto queries_count = m_boars->queries_count();
+    const auto obelix_miam = m_boars->are_colliding(m_obelix->rectangle());
+    const auto asterix_miam = m_boars->are_colliding(m_asterix->rectangle());
+    m_eaters->move(*m_boars);
+    m_eaters->eat(*m_boars);
+    const auto collisions_duration =
+        std::chrono::steady_clock::now() - collisions_start_time;
+    ++m_collision_stats.frames_count;
+    m_collision_stats.queries_count += m_boars->queries_count() - queries_count;
+    m_collision_stats.total_duration += collisions_duration;
+    m_collision_stats.max_frame_duration =
+        std::max(m_collision_stats.max_frame_duration, collisions_duration);
+
+    if (obelix_miam)
     {
         m_obelix->miam();
-        m_forest->miam_obelix(renderer);
+        m_forest->miam_obelix();
     }
-    if (m_boars->are_colliding(m_asterix->rectangle()))
+    if (asterix_miam)
     {
         m_asterix->miam();
-        m_forest->miam_asterix(renderer);
+        m_forest->miam_asterix();
     }
 
     const auto obelix_touched_asterix =
@@ -296,65 +403,88 @@ void World::move(const sdlxx::Renderer& renderer) noexcept
     if (obelix_touched_asterix)
         m_asterix->aie();
     m_end_of_game = obelix_touched_asterix || m_boars->boars_count() == 0;
+}
 
-    m_previous_frame_time = current_frame_time;
+const CollisionStats& World::collision_stats() const noexcept
+{
+    return m_collision_stats;
 }
 
-void World::render(const sdlxx::Renderer& renderer) const noexcept
+void World::render(const sdlxx::Renderer& renderer) noexcept
 {
-    m_forest->render(renderer);
-    m_boars->render(renderer);
-    m_obelix->render(renderer);
-    m_asterix->render(renderer);
+    m_forest->render(m_sprite_batch);
+    m_boars->render(m_sprite_batch);
+    m_eaters->render(m_sprite_batch);
+    m_obelix->render(m_sprite_batch);
+    m_asterix->render(m_sprite_batch);
+    m_sprite_batch.submit(renderer);
 }
 
-sdlxx::result<World> load_world(const sdlxx::Renderer& renderer) noexcept
+WorldAssets request_world_assets(sdlxx::AssetLoader& loader) noexcept
 {
-    BOOST_OUTCOME_TRY(
-        forest_texture,
-        sdlxx::load_texture(renderer, sdlxx::get_asset_path("Forest.bmp")));
+    return WorldAssets{
+        loader.load_texture_atlas(
+            sdlxx::get_assets_path(), ".bmp",
+            {{"Boar.Sprite", sdlxx::Color{52, 80, 225}},
+             {"Obelix.Sprite", sdlxx::Color{252, 254, 252}},
+             {"Asterix.Sprites", sdlxx::Color{255, 200, 0}}}),
+        loader.load_glyph_atlas(sdlxx::get_asset_path("leadcoat.ttf"),
+                                FONT_SIZE),
+        loader.load_wav(sdlxx::get_asset_path("Obelix.Miam.wav")),
+        loader.load_wav(sdlxx::get_asset_path("Asterix.Miam.wav")),
+        loader.load_wav(sdlxx::get_asset_path("Asterix.Aie.wav"))};
+}
 
-    BOOST_OUTCOME_TRY(
-        forest_font,
-        sdlxx::load_font(sdlxx::get_asset_path("leadcoat.ttf"), FONT_SIZE));
+sdlxx::result<World> create_world(WorldAssets&& assets,
+                                  const WorldSettings& settings) noexcept
+{
+    BOOST_OUTCOME_TRY(texture_atlas, assets.texture_atlas.take());
+    auto texture_atlas_ptr =
+        std::make_unique<sdlxx::TextureAtlas>(std::move(texture_atlas));
 
-    auto forest = std::make_unique<Forest>(renderer, std::move(forest_texture),
-                                           std::move(forest_font));
+    const auto forest_region = texture_atlas_ptr->find_region("Forest");
+    const auto boars_region = texture_atlas_ptr->find_region("Boar.Sprite");
+    const auto obelix_region = texture_atlas_ptr->find_region("Obelix.Sprite");
+    const auto asterix_region =
+        texture_atlas_ptr->find_region("Asterix.Sprites");
+    if (!forest_region || !boars_region || !obelix_region || !asterix_region)
+        return stdnext::make_error_code(
+            stdnext::errc::no_such_file_or_directory);
 
-    BOOST_OUTCOME_TRY(
-        boars_texture,
-        sdlxx::load_texture(renderer, sdlxx::get_asset_path("Boar.Sprite.bmp"),
-                            sdlxx::Color{52, 80, 225}));
+    BOOST_OUTCOME_TRY(forest_glyph_atlas, assets.glyph_atlas.take());
 
-    auto boars = std::make_unique<Boars>(std::move(boars_texture), 10);
+    auto forest = std::make_unique<Forest>(*forest_region,
+                                           std::move(forest_glyph_atlas));
 
-    BOOST_OUTCOME_TRY(obelix_texture,
-                      sdlxx::load_texture(
-                          renderer, sdlxx::get_asset_path("Obelix.Sprite.bmp"),
-                          sdlxx::Color{252, 254, 252}));
+    auto boars = std::make_unique<Boars>(*boars_region, settings.boars_count);
 
-    BOOST_OUTCOME_TRY(obelix_miam_chunk, sdlxx::load_wav(sdlxx::get_asset_path(
-                                             "Obelix.Miam.wav")));
+    BOOST_OUTCOME_TRY(obelix_miam_chunk, assets.obelix_miam_chunk.take());
 
-    auto obelix = std::make_unique<Obelix>(std::move(obelix_texture),
+    auto obelix = std::make_unique<Obelix>(*obelix_region,
                                            std::move(obelix_miam_chunk));
 
-    BOOST_OUTCOME_TRY(asterix_sprite_sheet,
-                      sdlxx::load_spritesheet(
-                          renderer,
-                          sdlxx::get_asset_path("Asterix.Sprites.bmp"),
-                          sdlxx::Color{255, 200, 0}, sdlxx::Size{48, 64}));
+    auto eaters =
+        std::make_unique<Eaters>(*obelix_region, settings.eaters_count);
 
-    BOOST_OUTCOME_TRY(asterix_miam_chunk, sdlxx::load_wav(sdlxx::get_asset_path(
-                                              "Asterix.Miam.wav")));
+    BOOST_OUTCOME_TRY(asterix_miam_chunk, assets.asterix_miam_chunk.take());
 
-    BOOST_OUTCOME_TRY(asterix_aie_chunk, sdlxx::load_wav(sdlxx::get_asset_path(
-                                             "Asterix.Aie.wav")));
+    BOOST_OUTCOME_TRY(asterix_aie_chunk, assets.asterix_aie_chunk.take());
 
-    auto asterix = std::make_unique<Asterix>(std::move(asterix_sprite_sheet),
-                                             std::move(asterix_miam_chunk),
-                                             std::move(asterix_aie_chunk));
+    auto asterix = std::make_unique<Asterix>(
+        sdlxx::AtlasSpriteSheet{*asterix_region, sdlxx::Size{48, 64}},
+        std::move(asterix_miam_chunk), std::move(asterix_aie_chunk));
 
-    return World(std::move(forest), std::move(boars), std::move(obelix),
+    return World(std::move(texture_atlas_ptr), std::move(forest),
+                 std::move(boars), std::move(eaters), std::move(obelix),
                  std::move(asterix));
 }
+
+sdlxx::result<World> load_world(const sdlxx::Renderer& renderer,
+                                const WorldSettings& settings) noexcept
+{
+    // Without workers, the assets are loaded as they are requested
+    sdlxx::AssetLoader loader{0};
+    auto assets = request_world_assets(loader);
+    loader.update(renderer, sdlxx::AssetLoader::Duration::max());
+    return create_world(std::move(assets), settings);
+}
@@ -1,14 +1,20 @@
 
 #pragma once
 
+#include <sdlxx/batch.hpp>
 #include <sdlxx/graphics.hpp>
+#include <sdlxx/loader.hpp>
 #include <platform/system_error.hpp>
+#include <chrono>
+#include <cstddef>
+#include <memory>
 
 namespace bout = BOOST_OUTCOME_V2_NAMESPACE;
 
 constexpr sdlxx::Point SCREEN_ORIGIN{SDL_WINDOWPOS_CENTERED,
                                      SDL_WINDOWPOS_CENTERED};
 constexpr sdlxx::Size SCREEN_SIZE{960, 600};
+constexpr int FONT_SIZE = 40;
 
 enum class Keys
 {
@@ -19,8 +25,26 @@ enum class Keys
     Right = 0x08,
 };
 
+// Number of characters, the stress mode spawning many boars and eaters
+struct WorldSettings
+{
+    std::size_t boars_count{10};
+    std::size_t eaters_count{0};
+};
+
+// Time spent looking for the boars touched by the characters, and by the
+// eaters for the nearest boars
+struct CollisionStats
+{
+    std::size_t frames_count{0};
+    std::size_t queries_count{0};
+    std::chrono::steady_clock::duration total_duration{};
+    std::chrono::steady_clock::duration max_frame_duration{};
+};
+
 class Forest;
 class Boars;
+class Eaters;
 class Obelix;
 class Asterix;
 
@@ -28,8 +52,9 @@ class World
 {
 public:
 
-    World(std::unique_ptr<Forest>&& forest, std::unique_ptr<Boars>&& boars,
-          std::unique_ptr<Obelix>&& obelix,
+    World(std::unique_ptr<sdlxx::TextureAtlas>&& texture_atlas,
+          std::unique_ptr<Forest>&& forest, std::unique_ptr<Boars>&& boars,
+          std::unique_ptr<Eaters>&& eaters, std::unique_ptr<Obelix>&& obelix,
           std::unique_ptr<Asterix>&& asterix);
 
     World(World&&) noexcept;
@@ -42,19 +67,48 @@ public:
 
     void unset_key(Keys key) noexcept;
 
-    void move(const sdlxx::Renderer& renderer) noexcept;
+    void move() noexcept;
+
+    // Moves the characters once, without waiting for the animation delay
+    void step() noexcept;
 
-    void render(const sdlxx::Renderer& renderer) const noexcept;
+    const CollisionStats& collision_stats() const noexcept;
+
+    // Draws the world with a sprite batch
+    void render(const sdlxx::Renderer& renderer) noexcept;
 
 private:
+    std::unique_ptr<sdlxx::TextureAtlas> m_texture_atlas; // outlives its users
     std::unique_ptr<Forest> m_forest;
     std::unique_ptr<Boars> m_boars;
+    std::unique_ptr<Eaters> m_eaters;
     std::unique_ptr<Obelix> m_obelix;
     std::unique_ptr<Asterix> m_asterix;
     std::chrono::system_clock::time_point m_previous_frame_time =
         std::chrono::system_clock::now();
     bool m_end_of_game{false};
+    CollisionStats m_collision_stats;
+    sdlxx::SpriteBatch m_sprite_batch;
+};
+
+// Assets of a world, loading in the background
+struct WorldAssets
+{
+    sdlxx::AssetHandle<sdlxx::TextureAtlas> texture_atlas;
+    sdlxx::AssetHandle<sdlxx::GlyphAtlas> glyph_atlas;
+    sdlxx::AssetHandle<sdlxx::Chunk> obelix_miam_chunk;
+    sdlxx::AssetHandle<sdlxx::Chunk> asterix_miam_chunk;
+    sdlxx::AssetHandle<sdlxx::Chunk> asterix_aie_chunk;
 };
 
+WorldAssets request_world_assets(sdlxx::AssetLoader& loader) noexcept;
+
+// Builds the world from its assets, once the loader is done with them
+sdlxx::result<World>
+create_world(WorldAssets&& assets,
+             const WorldSettings& settings = WorldSettings{}) noexcept;
+
+// Loads the assets one after the other, then builds the world
 sdlxx::result<World>
-load_world(const sdlxx::Renderer& renderer) noexcept;
+load_world(const sdlxx::Renderer& renderer,
+           const WorldSettings& settings = WorldSettings{}) noexcept;
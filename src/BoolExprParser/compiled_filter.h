@@ -0,0 +1,174 @@
+#pragma once
+
+
+#include "parser.manual.h"
+#include <cassert>
+#include <map>
+#include <string>
+#include <vector>
+
+
+// Integer ids of the field values found in the filters, shared by all the filters evaluated against the same messages
+class FieldValueDictionary
+{
+public:
+
+    enum
+    {
+        ValueId_Unknown = -1,
+    };
+
+    int intern(const std::string& a_fieldValue)
+    {
+        const std::map<std::string, int>::const_iterator l_iterValue = m_valueIds.find(a_fieldValue);
+        if (l_iterValue != m_valueIds.end())
+            return l_iterValue->second;
+        const int l_valueId = static_cast<int>(m_valueIds.size());
+        m_valueIds.insert(std::make_pair(a_fieldValue, l_valueId));
+        return l_valueId;
+    }
+
+    int find(const std::string& a_fieldValue) const
+    {
+        const std::map<std::string, int>::const_iterator l_iterValue = m_valueIds.find(a_fieldValue);
+        if (l_iterValue == m_valueIds.end())
+            return ValueId_Unknown;
+        return l_iterValue->second;
+    }
+
+    size_t getSize() const
+    {
+        return m_valueIds.size();
+    }
+
+private:
+
+    std::map<std::string, int> m_valueIds;
+};
+
+// Field values of a message, looked up once in the dictionary for all the filters
+class InternedEvalContext
+{
+public:
+
+    template< typename EvalContextT >
+    InternedEvalContext(const FieldValueDictionary& a_dictionary, const EvalContextT& a_context)
+    {
+        for (int l_fieldType = 0; l_fieldType < FieldType_Count; ++l_fieldType)
+        {
+            m_pValues[l_fieldType] = &a_context.getFieldValue(static_cast<FieldType>(l_fieldType));
+            m_valueIds[l_fieldType] = a_dictionary.find(*m_pValues[l_fieldType]);
+        }
+    }
+
+    int getFieldValueId(FieldType a_fieldType) const
+    {
+        return m_valueIds[a_fieldType];
+    }
+
+    // Only valid as long as the message
+    const std::string& getFieldValue(FieldType a_fieldType) const
+    {
+        return *m_pValues[a_fieldType];
+    }
+
+private:
+
+    int m_valueIds[FieldType_Count];
+    const std::string* m_pValues[FieldType_Count];
+};
+
+// Filter lowered to a flat array of comparisons, each jumping to the next comparison to evaluate or to the result,
+// so that "and", "or" and "not" cost nothing at evaluation
+class CompiledFilter
+{
+public:
+
+    enum
+    {
+        Target_False = -1,
+        Target_True = -2,
+    };
+
+    CompiledFilter()
+        : m_start(Target_False)
+        , m_pDictionary(0)
+    {
+    }
+
+    void compile(const Parser& a_parser, FieldValueDictionary& a_dictionary)
+    {
+        m_instructions.clear();
+        m_patterns.clear();
+        m_pDictionary = &a_dictionary;
+        m_start = a_parser.compile(*this, Target_True, Target_False);
+        m_pDictionary = 0;
+    }
+
+    bool eval(const InternedEvalContext& a_context) const
+    {
+        int l_current = m_start;
+        while (l_current >= 0)
+        {
+            const Instruction& l_instruction = m_instructions[l_current];
+            const bool l_isTrue = (l_instruction.m_opCode == OpCode_Equal)
+                ? a_context.getFieldValueId(l_instruction.m_fieldType) == l_instruction.m_valueId
+                : matchLikePattern(m_patterns[l_instruction.m_valueId], a_context.getFieldValue(l_instruction.m_fieldType));
+            l_current = l_isTrue ? l_instruction.m_onTrue : l_instruction.m_onFalse;
+        }
+        return l_current == Target_True;
+    }
+
+    size_t getInstructionsCount() const
+    {
+        return m_instructions.size();
+    }
+
+    // Called back by Parser::compile
+    int emitEqual(FieldType a_fieldType, const std::string& a_fieldValue, int a_onEqual, int a_onNotEqual)
+    {
+        assert(m_pDictionary);
+        return emit(OpCode_Equal, a_fieldType, m_pDictionary->intern(a_fieldValue), a_onEqual, a_onNotEqual);
+    }
+
+    // Called back by Parser::compile
+    int emitLike(FieldType a_fieldType, const std::string& a_pattern, int a_onMatch, int a_onMismatch)
+    {
+        m_patterns.push_back(a_pattern);
+        return emit(OpCode_Like, a_fieldType, static_cast<int>(m_patterns.size() - 1), a_onMatch, a_onMismatch);
+    }
+
+private:
+
+    enum OpCode
+    {
+        OpCode_Equal = 0,
+        OpCode_Like, // m_valueId is the index of the pattern
+    };
+
+    struct Instruction
+    {
+        OpCode m_opCode;
+        FieldType m_fieldType;
+        int m_valueId;
+        int m_onTrue;
+        int m_onFalse;
+    };
+
+    int emit(OpCode a_opCode, FieldType a_fieldType, int a_valueId, int a_onTrue, int a_onFalse)
+    {
+        Instruction l_instruction;
+        l_instruction.m_opCode = a_opCode;
+        l_instruction.m_fieldType = a_fieldType;
+        l_instruction.m_valueId = a_valueId;
+        l_instruction.m_onTrue = a_onTrue;
+        l_instruction.m_onFalse = a_onFalse;
+        m_instructions.push_back(l_instruction);
+        return static_cast<int>(m_instructions.size() - 1);
+    }
+
+    std::vector<Instruction> m_instructions;
+    std::vector<std::string> m_patterns;
+    int m_start;
+    FieldValueDictionary* m_pDictionary;
+};
@@ -0,0 +1,153 @@
+
+#include <catch2/catch.hpp>
+#include "compiled_filter.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+
+
+namespace ut {
+
+    namespace {
+
+        class EvalContext
+        {
+        public:
+
+            const std::string& getFieldValue(FieldType a_fieldType) const
+            {
+                static std::string l_empty;
+                const auto l_iterField = m_fields.find(a_fieldType);
+                if (l_iterField == m_fields.end())
+                    return l_empty;
+                return l_iterField->second;
+            }
+
+            EvalContext& operator()(FieldType a_fieldType, const std::string& a_fieldValue)
+            {
+                m_fields[a_fieldType] = a_fieldValue;
+                return *this;
+            }
+
+        private:
+
+            std::map<FieldType, std::string> m_fields;
+        };
+
+        const char* const gs_expressions[] = {
+            "CHANNEL == 1",
+            "UUID != 2",
+            "not (GUID == 3)",
+            "GUID != 2 and GUID != 3",
+            "GUID != 2 or UUID != 3",
+            "CHANNEL == 1 and (UUID != 2 or GUID == 3)",
+            "(   UUID = 1 or not (UUID != 2 and GUID =3))",
+            "not (CHANNEL == 1 or UUID == 1) and not (GUID == 2 and (CHANNEL != 3 or UUID == 3))",
+            "CHANNEL == 1 or CHANNEL == 2 or CHANNEL == 3 or UUID == X and GUID != X",
+            "CHANNEL in (1, 3,X) and not (UUID in (2))",
+            "GUID like * or UUID like ?",
+            "not (CHANNEL like X*) and (UUID like *1 or GUID in (Y,2))",
+        };
+
+        const char* const gs_values[] = { "", "1", "2", "3", "X", "Y", "X1", "Y2" };
+
+    }
+
+    SCENARIO("a compiled filter evaluates like the parsed expression", "[compiled_filter]")
+    {
+
+        GIVEN("the compiled filters of several expressions")
+        {
+            FieldValueDictionary l_dictionary;
+            std::vector<Parser> l_parsers(sizeof(gs_expressions) / sizeof(gs_expressions[0]));
+            std::vector<CompiledFilter> l_filters(l_parsers.size());
+            for (size_t l_index = 0; l_index < l_parsers.size(); ++l_index)
+            {
+                REQUIRE(l_parsers[l_index].parse(std::string(gs_expressions[l_index])));
+                l_filters[l_index].compile(l_parsers[l_index], l_dictionary);
+            }
+
+            WHEN("We evaluate them with every combination of field values, known or not by the dictionary")
+            {
+                THEN("They give the same results as the parsers")
+                {
+                    for (const auto* l_channel : gs_values)
+                        for (const auto* l_uuid : gs_values)
+                            for (const auto* l_guid : gs_values)
+                            {
+                                const auto l_context = EvalContext()(FieldType_Channel, l_channel)(FieldType_Uuid, l_uuid)(FieldType_Guid, l_guid);
+                                const InternedEvalContext l_internedContext(l_dictionary, l_context);
+                                for (size_t l_index = 0; l_index < l_parsers.size(); ++l_index)
+                                {
+                                    INFO(gs_expressions[l_index] << " with CHANNEL=" << l_channel << ", UUID=" << l_uuid << ", GUID=" << l_guid);
+                                    REQUIRE(l_filters[l_index].eval(l_internedContext) == l_parsers[l_index].eval(l_context));
+                                }
+                            }
+                }
+            }
+        }
+
+        GIVEN("the compiled filter of 'GUID != 2 and (UUID == 1 or not (CHANNEL == 3))'")
+        {
+            Parser l_parser;
+            REQUIRE(l_parser.parse("GUID != 2 and (UUID == 1 or not (CHANNEL == 3))"));
+            FieldValueDictionary l_dictionary;
+            CompiledFilter l_filter;
+            l_filter.compile(l_parser, l_dictionary);
+
+            THEN("It has one instruction per comparison and the dictionary has one id per value")
+            {
+                REQUIRE(l_filter.getInstructionsCount() == 3);
+                REQUIRE(l_dictionary.getSize() == 3);
+            }
+        }
+
+    }
+
+    TEST_CASE("compiled filter benchmark", "[.][benchmark]")
+    {
+        // ARRANGE
+        const int l_filtersCount = 1000;
+        const int l_messagesCount = 2000;
+        std::mt19937 l_generator(42);
+        const auto l_value = [&] { return std::to_string(l_generator() % 100); };
+        std::vector<Parser> l_parsers(l_filtersCount);
+        std::vector<CompiledFilter> l_filters(l_filtersCount);
+        FieldValueDictionary l_dictionary;
+        for (int l_index = 0; l_index < l_filtersCount; ++l_index)
+        {
+            const auto l_expression = "CHANNEL == " + l_value() + " and (UUID != " + l_value() + " or not (GUID == " + l_value() + " or GUID == " + l_value() + "))";
+            REQUIRE(l_parsers[l_index].parse(l_expression));
+            l_filters[l_index].compile(l_parsers[l_index], l_dictionary);
+        }
+        std::vector<EvalContext> l_messages;
+        for (int l_index = 0; l_index < l_messagesCount; ++l_index)
+            l_messages.push_back(EvalContext()(FieldType_Channel, l_value())(FieldType_Uuid, l_value())(FieldType_Guid, l_value()));
+
+        // ACT
+        std::size_t l_treeMatchesCount = 0;
+        const auto l_treeStart = std::chrono::steady_clock::now();
+        for (const auto& l_message : l_messages)
+            for (const auto& l_parser : l_parsers)
+                l_treeMatchesCount += l_parser.eval(l_message) ? 1 : 0;
+        const auto l_treeDuration = std::chrono::duration<double>(std::chrono::steady_clock::now() - l_treeStart).count();
+
+        std::size_t l_compiledMatchesCount = 0;
+        const auto l_compiledStart = std::chrono::steady_clock::now();
+        for (const auto& l_message : l_messages)
+        {
+            const InternedEvalContext l_internedMessage(l_dictionary, l_message);
+            for (const auto& l_filter : l_filters)
+                l_compiledMatchesCount += l_filter.eval(l_internedMessage) ? 1 : 0;
+        }
+        const auto l_compiledDuration = std::chrono::duration<double>(std::chrono::steady_clock::now() - l_compiledStart).count();
+
+        // ASSERT
+        REQUIRE(l_compiledMatchesCount == l_treeMatchesCount);
+        const double l_evaluationsCount = static_cast<double>(l_filtersCount) * l_messagesCount;
+        std::cout << "tree walker:     " << l_evaluationsCount / l_treeDuration / 1e6 << " M evaluations/s\n";
+        std::cout << "compiled filter: " << l_evaluationsCount / l_compiledDuration / 1e6 << " M evaluations/s\n";
+    }
+
+}
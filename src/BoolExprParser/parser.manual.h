@@ -5,6 +5,8 @@
 #include "unique_ptr98.h"
 #include <cassert>
 #include <cctype>
+#include <string>
+#include <vector>
 
 
 enum FieldType
@@ -12,6 +14,7 @@ enum FieldType
     FieldType_Channel = 0,
     FieldType_Uuid,
     FieldType_Guid,
+    FieldType_Count,
 };
 
 class ParseContext
@@ -141,6 +144,54 @@ inline bool parse_expectFieldValue(ParseContext& a_context, std::string& a_field
     return false;
 }
 
+// FieldValueList ::= FieldValue | FieldValue "," FieldValueList
+inline bool parse_expectFieldValueList(ParseContext& a_context, std::vector<std::string>& a_fieldValues)
+{
+    do
+    {
+        a_fieldValues.push_back(std::string());
+        if (!parse_expectFieldValue(a_context, a_fieldValues.back()))
+            return false;
+    } while (parse_expectString(a_context, ","));
+    return true;
+}
+
+// Matches the value with a pattern where '*' stands for any sequence of characters and '?' for any character
+inline bool matchLikePattern(const char* a_patternBegin, const char* a_patternEnd, const char* a_valueBegin, const char* a_valueEnd)
+{
+    const char* l_afterStar = 0;
+    const char* l_starValue = 0;
+    while (a_valueBegin != a_valueEnd)
+    {
+        if (a_patternBegin != a_patternEnd && *a_patternBegin == '*')
+        {
+            l_afterStar = ++a_patternBegin;
+            l_starValue = a_valueBegin;
+        }
+        else if (a_patternBegin != a_patternEnd && (*a_patternBegin == '?' || *a_patternBegin == *a_valueBegin))
+        {
+            ++a_patternBegin;
+            ++a_valueBegin;
+        }
+        else if (l_afterStar)
+        {
+            // Lets the last star match one more character
+            a_patternBegin = l_afterStar;
+            a_valueBegin = ++l_starValue;
+        }
+        else
+            return false;
+    }
+    while (a_patternBegin != a_patternEnd && *a_patternBegin == '*')
+        ++a_patternBegin;
+    return a_patternBegin == a_patternEnd;
+}
+
+inline bool matchLikePattern(const std::string& a_pattern, const std::string& a_value)
+{
+    return matchLikePattern(a_pattern.data(), a_pattern.data() + a_pattern.length(), a_value.data(), a_value.data() + a_value.length());
+}
+
 class Comparison
 {
 public:
@@ -151,7 +202,7 @@ public:
     {
     }
 
-    // Comparison ::= FieldName "=" FieldValue | FieldName "!=" FieldValue | FieldName "like" FieldValueRegex | FieldName "in" "(" FieldValueList ")"
+    // Comparison ::= FieldName "=" FieldValue | FieldName "!=" FieldValue | FieldName "like" FieldValuePattern | FieldName "in" "(" FieldValueList ")"
     bool parse(ParseContext& a_context)
     {
         if (!parse_expectFieldName(a_context, m_fieldType))
@@ -175,14 +226,22 @@ public:
 
         if (parse_expectString(a_context, "like"))
         {
-            // TODO
-            return false;
+            if (!parse_expectFieldValue(a_context, m_fieldValue))
+                return false;
+            m_opType = OpType_Like;
+            return true;
         }
 
         if (parse_expectString(a_context, "in"))
         {
-            // TODO
-            return false;
+            if (!parse_expectString(a_context, "("))
+                return false;
+            if (!parse_expectFieldValueList(a_context, m_fieldValues))
+                return false;
+            if (!parse_expectString(a_context, ")"))
+                return false;
+            m_opType = OpType_In;
+            return true;
         }
 
         return false;
@@ -204,16 +263,50 @@ public:
             return m_fieldValue != l_fieldValue;
         }
         case OpType_Like:
-            // TODO
-            return false;
+        {
+            const std::string& l_fieldValue = a_context.getFieldValue(m_fieldType);
+            return matchLikePattern(m_fieldValue, l_fieldValue);
+        }
         case OpType_In:
-            // TODO
+        {
+            const std::string& l_fieldValue = a_context.getFieldValue(m_fieldType);
+            for (std::vector<std::string>::const_iterator l_iterValue = m_fieldValues.begin(); l_iterValue != m_fieldValues.end(); ++l_iterValue)
+            {
+                if (*l_iterValue == l_fieldValue)
+                    return true;
+            }
             return false;
         }
+        }
         assert(!"m_opType does not have a valid value!!!");
         return false;
     }
 
+    // Emits the instructions jumping to a_onTrue or a_onFalse depending on the result, and returns the first one
+    template< typename CompilerT >
+    int compile(CompilerT& a_compiler, int a_onTrue, int a_onFalse) const
+    {
+        switch (m_opType)
+        {
+        case OpType_Equal:
+            return a_compiler.emitEqual(m_fieldType, m_fieldValue, a_onTrue, a_onFalse);
+        case OpType_NotEqual:
+            return a_compiler.emitEqual(m_fieldType, m_fieldValue, a_onFalse, a_onTrue);
+        case OpType_Like:
+            return a_compiler.emitLike(m_fieldType, m_fieldValue, a_onTrue, a_onFalse);
+        case OpType_In:
+        {
+            // Chain of equalities, the last value being emitted first
+            int l_next = a_onFalse;
+            for (std::vector<std::string>::const_reverse_iterator l_iterValue = m_fieldValues.rbegin(); l_iterValue != m_fieldValues.rend(); ++l_iterValue)
+                l_next = a_compiler.emitEqual(m_fieldType, *l_iterValue, a_onTrue, l_next);
+            return l_next;
+        }
+        }
+        assert(!"m_opType does not have a valid value!!!");
+        return a_onFalse;
+    }
+
 private:
 
     enum OpType
@@ -226,7 +319,8 @@ private:
 
     OpType m_opType;
     FieldType m_fieldType;
-    std::string m_fieldValue;
+    std::string m_fieldValue; // pattern for like
+    std::vector<std::string> m_fieldValues; // for in
 };
 
 class Expression;
@@ -246,6 +340,9 @@ public:
     template< typename EvalContextT >
     bool eval(const EvalContextT& a_context) const;
 
+    template< typename CompilerT >
+    int compile(CompilerT& a_compiler, int a_onTrue, int a_onFalse) const;
+
 private:
 
     enum OpType
@@ -328,6 +425,33 @@ public:
         return false;
     }
 
+    // The right side is emitted first, so that the left side can jump to it
+    template< typename CompilerT >
+    int compile(CompilerT& a_compiler, int a_onTrue, int a_onFalse) const
+    {
+        switch (m_opType)
+        {
+        case OpType_None:
+            return m_left.compile(a_compiler, a_onTrue, a_onFalse);
+        case OpType_And:
+        {
+            assert(m_right);
+            const int l_rightStart = m_right->compile(a_compiler, a_onTrue, a_onFalse);
+            return m_left.compile(a_compiler, l_rightStart, a_onFalse);
+        }
+        case OpType_Or:
+        {
+            assert(m_right);
+            const int l_rightStart = m_right->compile(a_compiler, a_onTrue, a_onFalse);
+            return m_left.compile(a_compiler, a_onTrue, l_rightStart);
+        }
+        case OpType_Unknown:
+            break;
+        }
+        assert(!"m_opType does not have a valid value!!!");
+        return a_onFalse;
+    }
+
 private:
 
     enum OpType
@@ -404,6 +528,26 @@ inline bool Term::eval(const EvalContextT& a_context) const
     return false;
 }
 
+template< typename CompilerT >
+inline int Term::compile(CompilerT& a_compiler, int a_onTrue, int a_onFalse) const
+{
+    switch (m_opType)
+    {
+    case OpType_Comparison:
+        return m_comparison.compile(a_compiler, a_onTrue, a_onFalse);
+    case OpType_Expression:
+        assert(m_expression);
+        return m_expression->compile(a_compiler, a_onTrue, a_onFalse);
+    case OpType_NotExpression:
+        assert(m_expression);
+        return m_expression->compile(a_compiler, a_onFalse, a_onTrue);
+    case OpType_Unknown:
+        break;
+    }
+    assert(!"m_opType does not have a valid value!!!");
+    return a_onFalse;
+}
+
 class Parser
 {
 public:
@@ -440,6 +584,13 @@ public:
         return m_expression->eval(a_context);
     }
 
+    template< typename CompilerT >
+    int compile(CompilerT& a_compiler, int a_onTrue, int a_onFalse) const
+    {
+        assert(m_expression);
+        return m_expression->compile(a_compiler, a_onTrue, a_onFalse);
+    }
+
 private:
 
     std_ex::unique_ptr98<Expression> m_expression;
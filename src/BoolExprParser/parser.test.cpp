@@ -294,6 +294,108 @@ namespace ut {
 
     }
 
+    SCENARIO("the parser can evaluate like and in comparisons", "[parser]")
+    {
+
+        GIVEN("a parser")
+        {
+            Parser l_parser;
+
+            WHEN("We parse 'CHANNEL like NEWS.*.FR and UUID in (1, 2,3)'")
+            {
+                const auto l_parseResult = l_parser.parse("CHANNEL like NEWS.*.FR and UUID in (1, 2,3)");
+                REQUIRE(l_parseResult);
+
+                AND_WHEN("We evaluate with context: CHANNEL=NEWS.SPORT.FR, UUID=2")
+                {
+                    const auto l_evalResult = l_parser.eval(EvalContext()(FieldType_Channel, "NEWS.SPORT.FR")(FieldType_Uuid, "2"));
+
+                    THEN("It succeeds")
+                    {
+                        REQUIRE(l_evalResult);
+                    }
+                }
+
+                AND_WHEN("We evaluate with context: CHANNEL=NEWS.FR, UUID=2")
+                {
+                    const auto l_evalResult = l_parser.eval(EvalContext()(FieldType_Channel, "NEWS.FR")(FieldType_Uuid, "2"));
+
+                    THEN("It fails")
+                    {
+                        REQUIRE(!l_evalResult);
+                    }
+                }
+
+                AND_WHEN("We evaluate with context: CHANNEL=NEWS..FR, UUID=4")
+                {
+                    const auto l_evalResult = l_parser.eval(EvalContext()(FieldType_Channel, "NEWS..FR")(FieldType_Uuid, "4"));
+
+                    THEN("It fails")
+                    {
+                        REQUIRE(!l_evalResult);
+                    }
+                }
+            }
+
+            WHEN("We parse 'not (GUID like ?A*)'")
+            {
+                const auto l_parseResult = l_parser.parse("not (GUID like ?A*)");
+                REQUIRE(l_parseResult);
+
+                AND_WHEN("We evaluate with context: GUID=BAOBAB")
+                {
+                    const auto l_evalResult = l_parser.eval(EvalContext()(FieldType_Guid, "BAOBAB"));
+
+                    THEN("It fails")
+                    {
+                        REQUIRE(!l_evalResult);
+                    }
+                }
+
+                AND_WHEN("We evaluate with context: GUID=A")
+                {
+                    const auto l_evalResult = l_parser.eval(EvalContext()(FieldType_Guid, "A"));
+
+                    THEN("It succeeds")
+                    {
+                        REQUIRE(l_evalResult);
+                    }
+                }
+            }
+
+            WHEN("We parse 'UUID in (1,2'")
+            {
+                const auto l_parseResult = l_parser.parse("UUID in (1,2");
+
+                THEN("It fails")
+                {
+                    REQUIRE(!l_parseResult);
+                }
+            }
+
+            WHEN("We parse 'UUID in ()'")
+            {
+                const auto l_parseResult = l_parser.parse("UUID in ()");
+
+                THEN("It fails")
+                {
+                    REQUIRE(!l_parseResult);
+                }
+            }
+
+            WHEN("We parse 'GUID like'")
+            {
+                const auto l_parseResult = l_parser.parse("GUID like");
+
+                THEN("It fails")
+                {
+                    REQUIRE(!l_parseResult);
+                }
+            }
+        }
+
+    }
+
     SCENARIO("the parser can detect invalid expressions", "[parser]")
     {
 
@@ -0,0 +1,394 @@
+#pragma once
+
+
+#include "compiled_filter.h"
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+// Finds the filters, among many, matched by a message, in a time depending on the matches rather than on the filters.
+// Each filter is compiled to a decision graph whose paths to "true" are unfolded into conjunctions of comparisons.
+// The positive comparisons of the conjunctions (=, in, like) are indexed by field value, or by the fixed prefix of the
+// pattern for like; a message increments the counter of every conjunction one of its field values is indexed for, and
+// a conjunction whose counter reaches its number of positive comparisons only has its negative comparisons left to check.
+// A filter unfolding into too many conjunctions is evaluated with its compiled filter instead.
+class SubscriptionIndex
+{
+public:
+
+    typedef size_t FilterId;
+
+    enum
+    {
+        MaxConjunctionsPerFilter = 64,
+        MaxUnfoldSteps = 4096,
+    };
+
+    SubscriptionIndex()
+        : m_stamp(0)
+    {
+    }
+
+    // Returns the id of the filter, which is the number of filters added before it
+    FilterId addFilter(const Parser& a_parser)
+    {
+        const FilterId l_filterId = m_filterStamps.size();
+        m_filterStamps.push_back(0);
+
+        DecisionGraph l_graph;
+        const int l_start = a_parser.compile(l_graph, CompiledFilter::Target_True, CompiledFilter::Target_False);
+        std::vector<Condition> l_path;
+        std::vector<std::vector<Condition> > l_conjunctions;
+        size_t l_stepsCount = 0;
+        if (!unfold(l_graph, l_start, l_path, l_conjunctions, l_stepsCount))
+        {
+            m_fallbackFilters.push_back(FallbackFilter());
+            m_fallbackFilters.back().m_filterId = l_filterId;
+            m_fallbackFilters.back().m_filter.compile(a_parser, m_fallbackDictionary);
+            return l_filterId;
+        }
+
+        for (size_t l_index = 0; l_index < l_conjunctions.size(); ++l_index)
+        {
+            if (normalize(l_conjunctions[l_index]))
+                addConjunction(l_filterId, l_conjunctions[l_index]);
+        }
+        return l_filterId;
+    }
+
+    // Fills a_matchingFilterIds with the ids of the filters matched by the message, in increasing order
+    template< typename EvalContextT >
+    void match(const EvalContextT& a_context, std::vector<FilterId>& a_matchingFilterIds)
+    {
+        a_matchingFilterIds.clear();
+        nextStamp();
+
+        for (int l_fieldType = 0; l_fieldType < FieldType_Count; ++l_fieldType)
+        {
+            const std::string& l_fieldValue = a_context.getFieldValue(static_cast<FieldType>(l_fieldType));
+
+            const EqualIndex::const_iterator l_iterEqual = m_equalIndexes[l_fieldType].find(l_fieldValue);
+            if (l_iterEqual != m_equalIndexes[l_fieldType].end())
+            {
+                for (size_t l_index = 0; l_index < l_iterEqual->second.size(); ++l_index)
+                    countCondition(l_iterEqual->second[l_index], a_context, a_matchingFilterIds);
+            }
+
+            const std::string_view l_fieldValueView(l_fieldValue);
+            for (LikeIndexes::const_iterator l_iterLength = m_likeIndexes[l_fieldType].begin(); l_iterLength != m_likeIndexes[l_fieldType].end(); ++l_iterLength)
+            {
+                if (l_iterLength->first > l_fieldValue.length())
+                    break;
+                const LikeIndex::const_iterator l_iterLike = l_iterLength->second.find(l_fieldValueView.substr(0, l_iterLength->first));
+                if (l_iterLike == l_iterLength->second.end())
+                    continue;
+                for (size_t l_index = 0; l_index < l_iterLike->second.size(); ++l_index)
+                {
+                    const LikeEntry& l_entry = l_iterLike->second[l_index];
+                    if (matchLikePattern(l_entry.m_pattern, l_fieldValue))
+                        countCondition(l_entry.m_conjunctionIndex, a_context, a_matchingFilterIds);
+                }
+            }
+        }
+
+        for (size_t l_index = 0; l_index < m_unindexedConjunctions.size(); ++l_index)
+        {
+            const Conjunction& l_conjunction = m_conjunctions[m_unindexedConjunctions[l_index]];
+            if (areNegativesTrue(l_conjunction, a_context))
+                addMatchingFilter(l_conjunction.m_filterId, a_matchingFilterIds);
+        }
+
+        if (!m_fallbackFilters.empty())
+        {
+            const InternedEvalContext l_internedContext(m_fallbackDictionary, a_context);
+            for (size_t l_index = 0; l_index < m_fallbackFilters.size(); ++l_index)
+            {
+                if (m_fallbackFilters[l_index].m_filter.eval(l_internedContext))
+                    addMatchingFilter(m_fallbackFilters[l_index].m_filterId, a_matchingFilterIds);
+            }
+        }
+
+        std::sort(a_matchingFilterIds.begin(), a_matchingFilterIds.end());
+    }
+
+    size_t getFiltersCount() const
+    {
+        return m_filterStamps.size();
+    }
+
+    size_t getConjunctionsCount() const
+    {
+        return m_conjunctions.size();
+    }
+
+    size_t getFallbackFiltersCount() const
+    {
+        return m_fallbackFilters.size();
+    }
+
+private:
+
+    // Comparison of a conjunction: equality or like, negated or not
+    struct Condition
+    {
+        FieldType m_fieldType;
+        bool m_isLike;
+        bool m_isNegated;
+        std::string m_fieldValue; // pattern for like
+    };
+
+    // Records the nodes emitted by Parser::compile
+    class DecisionGraph
+    {
+    public:
+
+        int emitEqual(FieldType a_fieldType, const std::string& a_fieldValue, int a_onEqual, int a_onNotEqual)
+        {
+            return emit(a_fieldType, false, a_fieldValue, a_onEqual, a_onNotEqual);
+        }
+
+        int emitLike(FieldType a_fieldType, const std::string& a_pattern, int a_onMatch, int a_onMismatch)
+        {
+            return emit(a_fieldType, true, a_pattern, a_onMatch, a_onMismatch);
+        }
+
+        struct Node
+        {
+            Condition m_condition;
+            int m_onTrue;
+            int m_onFalse;
+        };
+
+        std::vector<Node> m_nodes;
+
+    private:
+
+        int emit(FieldType a_fieldType, bool a_isLike, const std::string& a_fieldValue, int a_onTrue, int a_onFalse)
+        {
+            Node l_node;
+            l_node.m_condition.m_fieldType = a_fieldType;
+            l_node.m_condition.m_isLike = a_isLike;
+            l_node.m_condition.m_isNegated = false;
+            l_node.m_condition.m_fieldValue = a_fieldValue;
+            l_node.m_onTrue = a_onTrue;
+            l_node.m_onFalse = a_onFalse;
+            m_nodes.push_back(l_node);
+            return static_cast<int>(m_nodes.size() - 1);
+        }
+    };
+
+    struct Conjunction
+    {
+        FilterId m_filterId;
+        size_t m_positivesCount;
+        std::vector<Condition> m_negatives;
+    };
+
+    struct LikeEntry
+    {
+        size_t m_conjunctionIndex;
+        std::string m_pattern;
+    };
+
+    struct FallbackFilter
+    {
+        FilterId m_filterId;
+        CompiledFilter m_filter;
+    };
+
+    typedef std::unordered_map<std::string, std::vector<size_t> > EqualIndex;
+    typedef std::unordered_map<std::string_view, std::vector<LikeEntry> > LikeIndex; // keys are views of m_likePrefixes
+    typedef std::map<size_t, LikeIndex> LikeIndexes; // by prefix length
+
+    enum Result
+    {
+        Result_Unknown = 0,
+        Result_True,
+        Result_False,
+    };
+
+    // Result of the comparison implied by the comparisons already on the path, if any
+    static Result deduce(const std::vector<Condition>& a_path, const Condition& a_condition)
+    {
+        for (size_t l_index = 0; l_index < a_path.size(); ++l_index)
+        {
+            const Condition& l_known = a_path[l_index];
+            if (l_known.m_fieldType != a_condition.m_fieldType)
+                continue;
+            if (!l_known.m_isLike && !l_known.m_isNegated)
+            {
+                // The field value is known
+                const bool l_isTrue = a_condition.m_isLike
+                    ? matchLikePattern(a_condition.m_fieldValue, l_known.m_fieldValue)
+                    : a_condition.m_fieldValue == l_known.m_fieldValue;
+                return l_isTrue ? Result_True : Result_False;
+            }
+            if (l_known.m_isLike == a_condition.m_isLike && l_known.m_fieldValue == a_condition.m_fieldValue)
+                return l_known.m_isNegated ? Result_False : Result_True;
+        }
+        return Result_Unknown;
+    }
+
+    static bool unfold(const DecisionGraph& a_graph, int a_node, std::vector<Condition>& a_path, std::vector<std::vector<Condition> >& a_conjunctions, size_t& a_stepsCount)
+    {
+        if (++a_stepsCount > MaxUnfoldSteps)
+            return false;
+        if (a_node == CompiledFilter::Target_False)
+            return true;
+        if (a_node == CompiledFilter::Target_True)
+        {
+            a_conjunctions.push_back(a_path);
+            return a_conjunctions.size() <= MaxConjunctionsPerFilter;
+        }
+
+        const DecisionGraph::Node& l_node = a_graph.m_nodes[a_node];
+        const Result l_result = deduce(a_path, l_node.m_condition);
+        if (l_result == Result_True)
+            return unfold(a_graph, l_node.m_onTrue, a_path, a_conjunctions, a_stepsCount);
+        if (l_result == Result_False)
+            return unfold(a_graph, l_node.m_onFalse, a_path, a_conjunctions, a_stepsCount);
+
+        a_path.push_back(l_node.m_condition);
+        if (!unfold(a_graph, l_node.m_onTrue, a_path, a_conjunctions, a_stepsCount))
+            return false;
+        a_path.back().m_isNegated = true;
+        if (!unfold(a_graph, l_node.m_onFalse, a_path, a_conjunctions, a_stepsCount))
+            return false;
+        a_path.pop_back();
+        return true;
+    }
+
+    // Drops the comparisons decided by an equality found later on the path; returns false if the conjunction cannot be true
+    static bool normalize(std::vector<Condition>& a_conjunction)
+    {
+        std::vector<Condition> l_kept;
+        for (size_t l_index = 0; l_index < a_conjunction.size(); ++l_index)
+        {
+            const Condition& l_condition = a_conjunction[l_index];
+            std::vector<Condition> l_equalities;
+            for (size_t l_otherIndex = l_index + 1; l_otherIndex < a_conjunction.size(); ++l_otherIndex)
+            {
+                const Condition& l_other = a_conjunction[l_otherIndex];
+                if (l_other.m_fieldType == l_condition.m_fieldType && !l_other.m_isLike && !l_other.m_isNegated)
+                    l_equalities.push_back(l_other);
+            }
+            const Result l_result = deduce(l_equalities, l_condition);
+            if (l_result == Result_Unknown)
+                l_kept.push_back(l_condition);
+            else if ((l_result == Result_True) == l_condition.m_isNegated)
+                return false;
+        }
+        a_conjunction.swap(l_kept);
+        return true;
+    }
+
+    void addConjunction(FilterId a_filterId, const std::vector<Condition>& a_conditions)
+    {
+        const size_t l_conjunctionIndex = m_conjunctions.size();
+        m_conjunctions.push_back(Conjunction());
+        Conjunction& l_conjunction = m_conjunctions.back();
+        l_conjunction.m_filterId = a_filterId;
+        l_conjunction.m_positivesCount = 0;
+        m_counts.push_back(0);
+        m_countStamps.push_back(0);
+
+        for (size_t l_index = 0; l_index < a_conditions.size(); ++l_index)
+        {
+            const Condition& l_condition = a_conditions[l_index];
+            if (l_condition.m_isNegated)
+            {
+                l_conjunction.m_negatives.push_back(l_condition);
+                continue;
+            }
+
+            ++l_conjunction.m_positivesCount;
+            if (!l_condition.m_isLike)
+            {
+                m_equalIndexes[l_condition.m_fieldType][l_condition.m_fieldValue].push_back(l_conjunctionIndex);
+                continue;
+            }
+
+            const size_t l_prefixLength = std::min(l_condition.m_fieldValue.find_first_of("*?"), l_condition.m_fieldValue.length());
+            const std::string l_prefix = l_condition.m_fieldValue.substr(0, l_prefixLength);
+            LikeIndex& l_likeIndex = m_likeIndexes[l_condition.m_fieldType][l_prefixLength];
+            LikeIndex::iterator l_iterLike = l_likeIndex.find(l_prefix);
+            if (l_iterLike == l_likeIndex.end())
+            {
+                m_likePrefixes.push_back(l_prefix);
+                l_iterLike = l_likeIndex.insert(std::make_pair(std::string_view(m_likePrefixes.back()), std::vector<LikeEntry>())).first;
+            }
+            LikeEntry l_entry;
+            l_entry.m_conjunctionIndex = l_conjunctionIndex;
+            l_entry.m_pattern = l_condition.m_fieldValue;
+            l_iterLike->second.push_back(l_entry);
+        }
+
+        if (l_conjunction.m_positivesCount == 0)
+            m_unindexedConjunctions.push_back(l_conjunctionIndex);
+    }
+
+    void nextStamp()
+    {
+        if (++m_stamp != 0)
+            return;
+        // The stamps wrapped around
+        std::fill(m_countStamps.begin(), m_countStamps.end(), 0);
+        std::fill(m_filterStamps.begin(), m_filterStamps.end(), 0);
+        m_stamp = 1;
+    }
+
+    template< typename EvalContextT >
+    static bool areNegativesTrue(const Conjunction& a_conjunction, const EvalContextT& a_context)
+    {
+        for (size_t l_index = 0; l_index < a_conjunction.m_negatives.size(); ++l_index)
+        {
+            const Condition& l_condition = a_conjunction.m_negatives[l_index];
+            const std::string& l_fieldValue = a_context.getFieldValue(l_condition.m_fieldType);
+            const bool l_isTrue = l_condition.m_isLike ? matchLikePattern(l_condition.m_fieldValue, l_fieldValue) : l_condition.m_fieldValue == l_fieldValue;
+            if (l_isTrue)
+                return false;
+        }
+        return true;
+    }
+
+    template< typename EvalContextT >
+    void countCondition(size_t a_conjunctionIndex, const EvalContextT& a_context, std::vector<FilterId>& a_matchingFilterIds)
+    {
+        if (m_countStamps[a_conjunctionIndex] != m_stamp)
+        {
+            m_countStamps[a_conjunctionIndex] = m_stamp;
+            m_counts[a_conjunctionIndex] = 0;
+        }
+        const Conjunction& l_conjunction = m_conjunctions[a_conjunctionIndex];
+        if (++m_counts[a_conjunctionIndex] == l_conjunction.m_positivesCount && areNegativesTrue(l_conjunction, a_context))
+            addMatchingFilter(l_conjunction.m_filterId, a_matchingFilterIds);
+    }
+
+    void addMatchingFilter(FilterId a_filterId, std::vector<FilterId>& a_matchingFilterIds)
+    {
+        if (m_filterStamps[a_filterId] == m_stamp)
+            return;
+        m_filterStamps[a_filterId] = m_stamp;
+        a_matchingFilterIds.push_back(a_filterId);
+    }
+
+    std::vector<Conjunction> m_conjunctions;
+    std::vector<size_t> m_unindexedConjunctions; // without positive comparison, checked for every message
+    EqualIndex m_equalIndexes[FieldType_Count];
+    LikeIndexes m_likeIndexes[FieldType_Count];
+    std::deque<std::string> m_likePrefixes;
+    std::vector<FallbackFilter> m_fallbackFilters;
+    FieldValueDictionary m_fallbackDictionary;
+
+    // Counters of the current message, reset lazily when their stamp is not the current one
+    std::vector<size_t> m_counts;
+    std::vector<unsigned> m_countStamps;
+    std::vector<unsigned> m_filterStamps;
+    unsigned m_stamp;
+};
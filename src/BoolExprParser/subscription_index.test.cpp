@@ -0,0 +1,234 @@
+
+#include <catch2/catch.hpp>
+#include "subscription_index.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+
+
+namespace ut {
+
+    namespace {
+
+        class EvalContext
+        {
+        public:
+
+            const std::string& getFieldValue(FieldType a_fieldType) const
+            {
+                static std::string l_empty;
+                const auto l_iterField = m_fields.find(a_fieldType);
+                if (l_iterField == m_fields.end())
+                    return l_empty;
+                return l_iterField->second;
+            }
+
+            EvalContext& operator()(FieldType a_fieldType, const std::string& a_fieldValue)
+            {
+                m_fields[a_fieldType] = a_fieldValue;
+                return *this;
+            }
+
+        private:
+
+            std::map<FieldType, std::string> m_fields;
+        };
+
+        const char* const gs_fieldNames[] = { "CHANNEL", "UUID", "GUID" };
+        const char* const gs_values[] = { "1", "2", "X", "X1", "XY2" };
+        const char* const gs_patterns[] = { "*", "X*", "*1", "?", "X?*", "*Y*" };
+
+        std::string randomExpression(std::mt19937& a_generator, int a_depth)
+        {
+            const auto l_pick = [&](int a_count) { return static_cast<int>(a_generator() % a_count); };
+            if (a_depth > 0 && l_pick(3) != 0)
+            {
+                const auto l_left = l_pick(4) == 0 ? "not (" + randomExpression(a_generator, a_depth - 1) + ")" : "(" + randomExpression(a_generator, a_depth - 1) + ")";
+                return l_left + (l_pick(2) == 0 ? " and " : " or ") + randomExpression(a_generator, a_depth - 1);
+            }
+            const std::string l_fieldName = gs_fieldNames[l_pick(3)];
+            switch (l_pick(4))
+            {
+            case 0:
+                return l_fieldName + " == " + gs_values[l_pick(5)];
+            case 1:
+                return l_fieldName + " != " + gs_values[l_pick(5)];
+            case 2:
+                return l_fieldName + " like " + gs_patterns[l_pick(6)];
+            default:
+                return l_fieldName + " in (" + gs_values[l_pick(5)] + "," + gs_values[l_pick(5)] + ")";
+            }
+        }
+
+    }
+
+    SCENARIO("the subscription index finds the filters matched by a message", "[subscription_index]")
+    {
+
+        GIVEN("an index of a few filters")
+        {
+            const char* const l_expressions[] = {
+                "CHANNEL == NEWS",
+                "CHANNEL == NEWS and UUID in (1, 2)",
+                "CHANNEL like NEWS.* and not (GUID like *.TEST)",
+                "UUID != 1",
+                "CHANNEL in (SPORT, NEWS) or GUID == G",
+            };
+            std::vector<Parser> l_parsers(5);
+            SubscriptionIndex l_index;
+            for (size_t l_filterIndex = 0; l_filterIndex < l_parsers.size(); ++l_filterIndex)
+            {
+                REQUIRE(l_parsers[l_filterIndex].parse(std::string(l_expressions[l_filterIndex])));
+                REQUIRE(l_index.addFilter(l_parsers[l_filterIndex]) == l_filterIndex);
+            }
+            std::vector<SubscriptionIndex::FilterId> l_matchingFilterIds;
+
+            WHEN("We match a message with CHANNEL=NEWS, UUID=2")
+            {
+                l_index.match(EvalContext()(FieldType_Channel, "NEWS")(FieldType_Uuid, "2"), l_matchingFilterIds);
+
+                THEN("It matches the filters 0, 1, 3 and 4")
+                {
+                    REQUIRE(l_matchingFilterIds == std::vector<SubscriptionIndex::FilterId>{ 0, 1, 3, 4 });
+                }
+            }
+
+            WHEN("We match a message with CHANNEL=NEWS.FR, UUID=1, GUID=A.TEST")
+            {
+                l_index.match(EvalContext()(FieldType_Channel, "NEWS.FR")(FieldType_Uuid, "1")(FieldType_Guid, "A.TEST"), l_matchingFilterIds);
+
+                THEN("It matches no filter")
+                {
+                    REQUIRE(l_matchingFilterIds.empty());
+                }
+            }
+
+            WHEN("We match a message with CHANNEL=NEWS.FR, GUID=G")
+            {
+                l_index.match(EvalContext()(FieldType_Channel, "NEWS.FR")(FieldType_Guid, "G"), l_matchingFilterIds);
+
+                THEN("It matches the filters 2, 3 and 4")
+                {
+                    REQUIRE(l_matchingFilterIds == std::vector<SubscriptionIndex::FilterId>{ 2, 3, 4 });
+                }
+            }
+        }
+
+        GIVEN("an index of a filter unfolding into too many conjunctions")
+        {
+            std::string l_expression = "CHANNEL like *";
+            for (int l_index = 0; l_index < 7; ++l_index)
+                l_expression += " and (UUID like *" + std::to_string(l_index) + "* or GUID like *" + std::to_string(l_index) + "*)";
+            Parser l_parser;
+            REQUIRE(l_parser.parse(l_expression));
+            SubscriptionIndex l_index;
+            l_index.addFilter(l_parser);
+            std::vector<SubscriptionIndex::FilterId> l_matchingFilterIds;
+
+            THEN("It evaluates the compiled filter instead")
+            {
+                REQUIRE(l_index.getFallbackFiltersCount() == 1);
+                l_index.match(EvalContext()(FieldType_Uuid, "0123")(FieldType_Guid, "456"), l_matchingFilterIds);
+                REQUIRE(l_matchingFilterIds == std::vector<SubscriptionIndex::FilterId>{ 0 });
+                l_index.match(EvalContext()(FieldType_Uuid, "0123")(FieldType_Guid, "45"), l_matchingFilterIds);
+                REQUIRE(l_matchingFilterIds.empty());
+            }
+        }
+
+        GIVEN("an index of random filters")
+        {
+            std::mt19937 l_generator(7);
+            std::vector<Parser> l_parsers(500);
+            std::vector<std::string> l_expressions;
+            SubscriptionIndex l_index;
+            for (auto& l_parser : l_parsers)
+            {
+                l_expressions.push_back(randomExpression(l_generator, 3));
+                REQUIRE(l_parser.parse(l_expressions.back()));
+                l_index.addFilter(l_parser);
+            }
+
+            WHEN("We match random messages")
+            {
+                THEN("It finds the filters matched by the parsers")
+                {
+                    std::vector<SubscriptionIndex::FilterId> l_matchingFilterIds;
+                    for (int l_messageIndex = 0; l_messageIndex < 300; ++l_messageIndex)
+                    {
+                        EvalContext l_message;
+                        for (int l_fieldType = 0; l_fieldType < FieldType_Count; ++l_fieldType)
+                        {
+                            if (l_generator() % 6 != 0)
+                                l_message(static_cast<FieldType>(l_fieldType), gs_values[l_generator() % 5]);
+                        }
+                        std::vector<SubscriptionIndex::FilterId> l_expectedFilterIds;
+                        for (size_t l_filterIndex = 0; l_filterIndex < l_parsers.size(); ++l_filterIndex)
+                        {
+                            if (l_parsers[l_filterIndex].eval(l_message))
+                                l_expectedFilterIds.push_back(l_filterIndex);
+                        }
+
+                        l_index.match(l_message, l_matchingFilterIds);
+
+                        REQUIRE(l_matchingFilterIds == l_expectedFilterIds);
+                    }
+                }
+            }
+        }
+
+    }
+
+    TEST_CASE("subscription index benchmark", "[.][benchmark]")
+    {
+        // ARRANGE
+        const int l_filtersCount = 20000;
+        const int l_messagesCount = 2000;
+        std::mt19937 l_generator(42);
+        const auto l_value = [&](int a_count) { return std::to_string(l_generator() % a_count); };
+        std::vector<Parser> l_parsers(l_filtersCount);
+        std::vector<CompiledFilter> l_filters(l_filtersCount);
+        FieldValueDictionary l_dictionary;
+        SubscriptionIndex l_index;
+        for (int l_filterIndex = 0; l_filterIndex < l_filtersCount; ++l_filterIndex)
+        {
+            const auto l_expression = (l_filterIndex % 2 == 0)
+                ? "CHANNEL == C" + l_value(1000) + " and UUID in (" + l_value(50) + "," + l_value(50) + ")"
+                : "CHANNEL like C" + l_value(100) + "* and not (GUID == " + l_value(10) + ")";
+            REQUIRE(l_parsers[l_filterIndex].parse(l_expression));
+            l_filters[l_filterIndex].compile(l_parsers[l_filterIndex], l_dictionary);
+            l_index.addFilter(l_parsers[l_filterIndex]);
+        }
+        std::vector<EvalContext> l_messages;
+        for (int l_messageIndex = 0; l_messageIndex < l_messagesCount; ++l_messageIndex)
+            l_messages.push_back(EvalContext()(FieldType_Channel, "C" + l_value(1000))(FieldType_Uuid, l_value(50))(FieldType_Guid, l_value(10)));
+
+        // ACT
+        std::size_t l_compiledMatchesCount = 0;
+        const auto l_compiledStart = std::chrono::steady_clock::now();
+        for (const auto& l_message : l_messages)
+        {
+            const InternedEvalContext l_internedMessage(l_dictionary, l_message);
+            for (const auto& l_filter : l_filters)
+                l_compiledMatchesCount += l_filter.eval(l_internedMessage) ? 1 : 0;
+        }
+        const auto l_compiledDuration = std::chrono::duration<double>(std::chrono::steady_clock::now() - l_compiledStart).count();
+
+        std::size_t l_indexMatchesCount = 0;
+        std::vector<SubscriptionIndex::FilterId> l_matchingFilterIds;
+        const auto l_indexStart = std::chrono::steady_clock::now();
+        for (const auto& l_message : l_messages)
+        {
+            l_index.match(l_message, l_matchingFilterIds);
+            l_indexMatchesCount += l_matchingFilterIds.size();
+        }
+        const auto l_indexDuration = std::chrono::duration<double>(std::chrono::steady_clock::now() - l_indexStart).count();
+
+        // ASSERT
+        REQUIRE(l_indexMatchesCount == l_compiledMatchesCount);
+        std::cout << l_filtersCount << " filters, " << static_cast<double>(l_indexMatchesCount) / l_messagesCount << " matches per message\n";
+        std::cout << "compiled filters:   " << l_messagesCount / l_compiledDuration << " messages/s\n";
+        std::cout << "subscription index: " << l_messagesCount / l_indexDuration << " messages/s\n";
+    }
+
+}
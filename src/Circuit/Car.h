@@ -4,8 +4,8 @@
 
 #include "Track.h"
 #include "Resources.h"
+#include "Simulation.h"
 #include <SFML/Graphics.hpp>
-#include <cmath>
 
 
 class Car
@@ -19,12 +19,14 @@ public:
         const auto& l_size = m_texture.getSize();
         m_sprite.setOrigin({ (float) l_size.x / 2.f, (float) l_size.y / 2.f });
         m_sprite.scale({ 0.1f, 0.1f });
-        m_sprite.setRotation(180.f);
+        m_state.resize(1);
+        m_state.place(0, 0.f, 0.f, 180.f);
+        m_sprite.setRotation(m_state.orientation[0]);
     }
 
     unsigned int getGaz() const
     {
-        return m_gaz;
+        return m_state.gaz[0];
     }
 
     void draw(sf::RenderWindow& a_window) const
@@ -34,48 +36,40 @@ public:
 
     void moveToStartPoint(const Track& a_track)
     {
-        m_sprite.setPosition(a_track.getStartPoint());
-        m_gaz = 0;
+        const auto l_startPoint = a_track.getStartPoint();
+        m_state.place(0, l_startPoint.x, l_startPoint.y, m_state.orientation[0]);
+        m_sprite.setPosition(l_startPoint);
     }
 
-    bool move(const sf::RenderWindow& a_window, const Track& a_track, unsigned int& a_checkpointLevel)
+    // Moves the car for one simulation step
+    bool move(const TrackGrid& a_grid, unsigned int& a_checkpointLevel)
     {
-        static const auto RadianFactor = 3.141592f / 180.f;
-
-        const auto l_orientation = m_sprite.getRotation() * RadianFactor;
-
-        auto l_position = m_sprite.getPosition();
-
-        l_position.x += (float) m_gaz * std::cos(l_orientation);
-        l_position.y += (float) m_gaz * std::sin(l_orientation);
-
-        if (!a_track.isInRoad(l_position, a_checkpointLevel))
+        if (!moveCar(m_state, 0, a_grid, a_checkpointLevel))
             return false;
 
-        m_sprite.setPosition(l_position);
+        m_sprite.setPosition({ m_state.x[0], m_state.y[0] });
         return true;
     }
 
     void rotate(bool a_left)
     {
-        m_sprite.rotate(a_left ? -10.f : 10.f);
+        applyCommand(m_state, 0, a_left ? CarCommand::TurnLeft : CarCommand::TurnRight);
+        m_sprite.setRotation(m_state.orientation[0]);
     }
 
     void incGaz()
     {
-        if (m_gaz < 5)
-            ++m_gaz;
+        applyCommand(m_state, 0, CarCommand::Accelerate);
     }
 
     void decGaz()
     {
-        if (m_gaz > 0)
-            --m_gaz;
+        applyCommand(m_state, 0, CarCommand::Brake);
     }
 
 private:
 
-    unsigned int m_gaz = 0;
+    CarsState m_state;
     sf::Texture m_texture;
     sf::Sprite m_sprite;
 };
@@ -26,25 +26,12 @@ public:
         return m_checkpointLevel;
     }
 
-    void draw(sf::RenderWindow& a_window) const
-    {
-        a_window.draw(m_shape);
-    }
-
-    void setPositionAndSize(const sf::Vector2f& a_position, const sf::Vector2f& a_size)
-    {
-        m_shape.setFillColor(getColor());
-        m_shape.setPosition(a_position);
-        m_shape.setSize(a_size);
-    }
-
     bool setType(CellType a_cellType, unsigned int a_checkpointLevel)
     {
         if (a_cellType == CellType::Grass)
         {
             m_type = a_cellType;
             m_checkpointLevel = 0;
-            m_shape.setFillColor(getColor());
             return true;
         }
 
@@ -52,7 +39,6 @@ public:
         {
             m_type = a_cellType;
             m_checkpointLevel = a_checkpointLevel;
-            m_shape.setFillColor(getColor());
         }
 
         return false;
@@ -61,11 +47,8 @@ public:
     void resetCheckpointLevel()
     {
         m_checkpointLevel = 0;
-        m_shape.setFillColor(getColor());
     }
 
-private:
-
     sf::Color getColor() const
     {
         static const sf::Color ColorGrass = { 100, 200, 0 };
@@ -86,7 +69,8 @@ private:
         return ColorGrass;
     }
 
+private:
+
     CellType m_type = CellType::Grass;
     unsigned int m_checkpointLevel = 0;
-    sf::RectangleShape m_shape;
 };
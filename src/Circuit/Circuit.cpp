@@ -2,10 +2,92 @@
 #include "Car.h"
 #include "EventDispatcher.h"
 #include <SFML/Graphics.hpp>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
 #include <vector>
 
+// Draws tracks of 100x100 up to 1000x1000 cells, as one shape per cell, then as the track does, then while editing it, and prints the frames per second
+static void runTrackBenchmark(unsigned int a_framesCount)
+{
+    const sf::Vector2u l_windowSize{ 1000, 1000 };
+    sf::RenderWindow l_window{ { l_windowSize.x, l_windowSize.y }, "Track benchmark", sf::Style::None };
+    l_window.setVerticalSyncEnabled(false);
+
+    const auto l_measureFps = [&](const auto& a_drawFrame)
+    {
+        const auto l_startTime = std::chrono::steady_clock::now();
+        for (auto l_frameIndex = (unsigned int) 0; l_frameIndex < a_framesCount; ++l_frameIndex)
+        {
+            l_window.clear(sf::Color::Black);
+            a_drawFrame(l_frameIndex);
+            l_window.display();
+        }
+        const std::chrono::duration<double> l_duration = std::chrono::steady_clock::now() - l_startTime;
+        return a_framesCount / l_duration.count();
+    };
+
+    for (const auto l_gridSide : { 100u, 250u, 500u, 1000u })
+    {
+        Track l_track{ l_windowSize, { l_gridSide, l_gridSide } };
+        const auto l_cellSize = l_track.getCellSize();
+
+        // A road around the window, as drawn in editing mode
+        for (auto l_position = 0; l_position < (int) l_windowSize.x; l_position += (int) l_cellSize.x)
+        {
+            const auto l_radius = l_gridSide / 50;
+            const auto l_border = (int) l_windowSize.x / 10;
+            l_track.setCellType(l_position, l_border, l_radius, CellType::Road, 0);
+            l_track.setCellType(l_position, (int) l_windowSize.y - l_border, l_radius, CellType::Road, 0);
+            l_track.setCellType(l_border, l_position, l_radius, CellType::Road, 0);
+            l_track.setCellType((int) l_windowSize.x - l_border, l_position, l_radius, CellType::Road, 0);
+        }
+
+        // The cells as they were drawn before the vertex buffer
+        std::vector<sf::RectangleShape> l_shapes(l_gridSide*l_gridSide);
+        for (auto l_shapeIndex = (size_t) 0; l_shapeIndex < l_shapes.size(); ++l_shapeIndex)
+        {
+            auto& l_shape = l_shapes[l_shapeIndex];
+            l_shape.setPosition({ (float) (l_shapeIndex % l_gridSide)*l_cellSize.x, (float) (l_shapeIndex / l_gridSide)*l_cellSize.y });
+            l_shape.setSize(l_cellSize);
+            l_shape.setFillColor(Cell{}.getColor());
+        }
+
+        const auto l_shapesFps = l_measureFps([&](unsigned int)
+        {
+            for (const auto& l_shape : l_shapes)
+                l_window.draw(l_shape);
+        });
+        const auto l_trackFps = l_measureFps([&](unsigned int)
+        {
+            l_track.draw(l_window);
+        });
+        const auto l_editingFps = l_measureFps([&](unsigned int a_frameIndex)
+        {
+            // Moves the brush along the diagonal, as the mouse would
+            const auto l_position = (int) (a_frameIndex*7 % l_windowSize.x);
+            l_track.setCellType(l_position, l_position, 2, a_frameIndex % 2 == 0 ? CellType::Road : CellType::Grass, 0);
+            l_track.draw(l_window);
+        });
+
+        std::cout << std::fixed << std::setprecision(1)
+            << l_gridSide << "x" << l_gridSide << " cells: "
+            << l_shapesFps << " fps with a shape per cell, "
+            << l_trackFps << " fps with the vertex buffer, "
+            << l_editingFps << " fps while editing\n";
+    }
+}
+
 int main(int argc, char *argv[])
 {
+    // --benchmark [framesCount] compares the ways to draw the track
+    if (argc > 1 && std::string(argv[1]) == "--benchmark")
+    {
+        runTrackBenchmark(argc > 2 ? (unsigned int) std::stoul(argv[2]) : 60);
+        return 0;
+    }
+
     sf::RenderWindow l_window{{1200, 800}, "Track"};
     l_window.setFramerateLimit(60);
 
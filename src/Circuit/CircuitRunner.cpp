@@ -0,0 +1,238 @@
+
+#include "LapRunner.h"
+#include "TrackFile.h"
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+
+
+// Elliptic ring road of the size of the game's window, with a_checkpointsCount checkpoints
+// across it in the direction the cars start to, the last one just before the start point
+static TrackGrid makeRingTrackGrid(unsigned int a_columnsCount, unsigned int a_rowsCount, unsigned int a_checkpointsCount)
+{
+    static const auto DegreeFactor = 180.f / 3.141592f;
+    const auto l_windowWidth = 1200.f;
+    const auto l_windowHeight = 800.f;
+    const auto l_radiusX = 450.f;
+    const auto l_radiusY = 280.f;
+
+    TrackGrid l_grid;
+    l_grid.columnsCount = a_columnsCount;
+    l_grid.rowsCount = a_rowsCount;
+    l_grid.cellWidth = l_windowWidth / l_grid.columnsCount;
+    l_grid.cellHeight = l_windowHeight / l_grid.rowsCount;
+    l_grid.roads.resize(l_grid.columnsCount*l_grid.rowsCount);
+    l_grid.checkpointLevels.resize(l_grid.roads.size());
+    for (auto l_rowIndex = 0u; l_rowIndex < l_grid.rowsCount; ++l_rowIndex)
+    {
+        for (auto l_colIndex = 0u; l_colIndex < l_grid.columnsCount; ++l_colIndex)
+        {
+            const auto l_x = ((float) l_colIndex + .5f) * l_grid.cellWidth - l_windowWidth / 2.f;
+            const auto l_y = ((float) l_rowIndex + .5f) * l_grid.cellHeight - l_windowHeight / 2.f;
+            const auto l_radius = std::hypot(l_x / l_radiusX, l_y / l_radiusY);
+            if (l_radius < .88f || l_radius > 1.12f)
+                continue;
+            const auto l_cellIndex = l_colIndex + l_rowIndex*l_grid.columnsCount;
+            l_grid.roads[l_cellIndex] = 1;
+
+            // Cars start at the top going left, so counterclockwise on the screen
+            auto l_progress = -90.f - std::atan2(l_y / l_radiusY, l_x / l_radiusX) * DegreeFactor;
+            if (l_progress < 0.f)
+                l_progress += 360.f;
+            for (auto l_checkpointLevel = 1u; l_checkpointLevel <= a_checkpointsCount; ++l_checkpointLevel)
+            {
+                const auto l_checkpointProgress = 360.f * l_checkpointLevel / a_checkpointsCount - 6.f;
+                if (std::abs(l_progress - l_checkpointProgress) < 2.f)
+                    l_grid.checkpointLevels[l_cellIndex] = (std::uint16_t) l_checkpointLevel;
+            }
+        }
+    }
+    l_grid.isStartPointDefined = true;
+    l_grid.startX = l_windowWidth / 2.f;
+    l_grid.startY = l_windowHeight / 2.f - l_radiusY;
+    l_grid.checkpointsCount = a_checkpointsCount;
+    return l_grid;
+}
+
+template <typename Function>
+static double measureMilliseconds(unsigned int a_repetitionsCount, Function&& a_function)
+{
+    auto l_bestDuration = std::chrono::steady_clock::duration::max();
+    for (auto l_repetitionIndex = 0u; l_repetitionIndex < a_repetitionsCount; ++l_repetitionIndex)
+    {
+        const auto l_startTime = std::chrono::steady_clock::now();
+        a_function();
+        l_bestDuration = std::min(l_bestDuration, std::chrono::steady_clock::now() - l_startTime);
+    }
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(l_bestDuration).count();
+}
+
+// Measures the saves, the patches and the loads of a ring track of a_gridSide x a_gridSide cells
+static bool runTrackFileBenchmark(unsigned int a_gridSide)
+{
+    const auto l_path = stdnext::filesystem::temp_directory_path() / "circuit_benchmark.ctrk";
+    auto l_grid = makeRingTrackGrid(a_gridSide, a_gridSide, 8);
+    const auto l_cellsCount = (double) l_grid.roads.size();
+
+    auto l_isSaved = true;
+    const auto l_saveMilliseconds = measureMilliseconds(3, [&] { l_isSaved = l_isSaved && saveTrackFile(l_path, l_grid); });
+    const auto l_fileSize = stdnext::filesystem::file_size(l_path);
+
+    TrackGrid l_loadedGrid;
+    auto l_patchesCount = 0u;
+    auto l_isLoaded = true;
+    const auto l_loadMilliseconds = measureMilliseconds(5, [&] { l_isLoaded = l_isLoaded && loadTrackFile(l_path, l_loadedGrid, l_patchesCount); });
+    const auto l_serialLoadMilliseconds = measureMilliseconds(5, [&] { l_isLoaded = l_isLoaded && loadTrackFile(l_path, l_loadedGrid, l_patchesCount, 1); });
+
+    // Autosave of a brush stroke of 64 x 64 cells, drawing a checkpoint across the road
+    const TrackRegion l_region{ a_gridSide / 2, a_gridSide / 8, a_gridSide / 2 + 64, a_gridSide / 8 + 64 };
+    for (auto l_rowIndex = l_region.firstRowIndex; l_rowIndex < std::min(l_region.lastRowIndex, a_gridSide); ++l_rowIndex)
+    {
+        for (auto l_colIndex = l_region.firstColIndex; l_colIndex < std::min(l_region.lastColIndex, a_gridSide); ++l_colIndex)
+        {
+            l_grid.roads[l_colIndex + l_rowIndex*a_gridSide] = 1;
+            l_grid.checkpointLevels[l_colIndex + l_rowIndex*a_gridSide] = 9;
+        }
+    }
+    l_grid.checkpointsCount = 9;
+    const auto l_beforePatchFileSize = stdnext::filesystem::file_size(l_path);
+    const auto l_patchMilliseconds = measureMilliseconds(1, [&] { l_isSaved = l_isSaved && appendTrackPatch(l_path, l_grid, l_region); });
+    const auto l_patchSize = stdnext::filesystem::file_size(l_path) - l_beforePatchFileSize;
+    stdnext::filesystem::remove(l_path);
+
+    std::cout << std::fixed << std::setprecision(1)
+        << a_gridSide << "x" << a_gridSide << " cells: " << l_fileSize << " bytes ("
+        << l_fileSize / l_cellsCount * 100. << "% of a byte per cell), saved in " << l_saveMilliseconds << " ms, loaded in "
+        << l_loadMilliseconds << " ms (" << l_cellsCount / l_loadMilliseconds / 1e3 << " M cells/s), in "
+        << l_serialLoadMilliseconds << " ms by a single thread\n"
+        << "64x64 cells autosave: " << l_patchSize << " bytes appended in " << l_patchMilliseconds << " ms\n";
+    return l_isSaved && l_isLoaded;
+}
+
+int main(int argc, char *argv[])
+{
+    // --benchmark-track-file [gridSide] measures the saves and the loads of a large track
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-track-file")
+        return runTrackFileBenchmark(argc > 2 ? (unsigned int) std::stoul(argv[2]) : 4096) ? 0 : 1;
+
+    // --cars count: cars simulated together, the first one driven by the scripted driver,
+    //      the others by variations of it
+    // --generations count: generations of drivers, each one made of the best drivers
+    //      of the previous generation and of mutations of them
+    // --threads count: threads sharing the cars, the hardware threads by default
+    // --max-seconds duration: simulated time after which a lap is abandoned
+    // --track path: track saved by the game, a generated ring track by default
+    auto l_carsCount = 4096u;
+    auto l_generationsCount = 10u;
+    auto l_threadsCount = std::max(std::thread::hardware_concurrency(), 1u);
+    auto l_maxSeconds = 60.f;
+    auto l_grid = makeRingTrackGrid(100, 100, 8);
+    for (auto l_argIndex = 1; l_argIndex < argc; l_argIndex += 2)
+    {
+        const std::string l_option = argv[l_argIndex];
+        if (l_argIndex + 1 == argc)
+        {
+            std::cerr << "Missing value of option " << l_option << "\n";
+            return 1;
+        }
+        const std::string l_value = argv[l_argIndex + 1];
+        if (l_option == "--cars")
+            l_carsCount = std::max((unsigned int) std::stoul(l_value), 1u);
+        else if (l_option == "--generations")
+            l_generationsCount = std::max((unsigned int) std::stoul(l_value), 1u);
+        else if (l_option == "--threads")
+            l_threadsCount = std::max((unsigned int) std::stoul(l_value), 1u);
+        else if (l_option == "--max-seconds")
+            l_maxSeconds = std::stof(l_value);
+        else if (l_option == "--track")
+        {
+            auto l_patchesCount = 0u;
+            if (!loadTrackFile(l_value, l_grid, l_patchesCount) || l_grid.checkpointsCount == 0 || !l_grid.isStartPointDefined)
+            {
+                std::cerr << "Cannot load a track with checkpoints and a start point from " << l_value << "\n";
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown option " << l_option << "\n";
+            return 1;
+        }
+    }
+
+    const auto l_maxStepsCount = (unsigned int) (l_maxSeconds / SimulationStepSeconds);
+    const auto l_elitesCount = std::max(l_carsCount / 10, 1u);
+
+    std::mt19937 l_generator{ 0 };
+    std::vector<DriverGenes> l_genes(l_carsCount);
+    for (size_t l_carIndex = 1; l_carIndex < l_genes.size(); ++l_carIndex)
+        l_genes[l_carIndex] = mutateGenes(DriverGenes{}, .3f, l_generator);
+
+    std::vector<std::pair<LapResult, DriverGenes>> l_bestLaps;
+    std::uint64_t l_totalStepsCount = 0;
+    std::chrono::steady_clock::duration l_totalDuration{};
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto l_generationIndex = 0u; l_generationIndex < l_generationsCount; ++l_generationIndex)
+    {
+        std::uint64_t l_stepsCount = 0;
+        const auto l_startTime = std::chrono::steady_clock::now();
+        const auto l_results = runLaps(l_grid, l_genes, l_maxStepsCount, l_threadsCount, l_stepsCount);
+        const auto l_duration = std::chrono::steady_clock::now() - l_startTime;
+        l_totalStepsCount += l_stepsCount;
+        l_totalDuration += l_duration;
+
+        std::vector<size_t> l_ranking(l_results.size());
+        std::iota(l_ranking.begin(), l_ranking.end(), (size_t) 0);
+        std::sort(l_ranking.begin(), l_ranking.end(), [&](size_t a_left, size_t a_right) {
+            return l_results[a_left].isBetterThan(l_results[a_right]);
+        });
+        const auto l_finishedCount = std::count_if(l_results.begin(), l_results.end(), [](const LapResult& a_result) {
+            return a_result.isFinished();
+        });
+        const auto& l_best = l_results[l_ranking[0]];
+        const auto l_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(l_duration).count();
+        std::cout << "Generation " << l_generationIndex << ": "
+            << l_finishedCount << "/" << l_results.size() << " laps finished, best "
+            << (l_best.isFinished() ? l_best.stepsCount * SimulationStepSeconds : 0.f) << " s, "
+            << l_stepsCount / l_seconds / 1e6 << " M steps/s\n";
+
+        // The elites kept from the previous generation drive their laps again
+        for (auto l_rank = (size_t) 0; l_rank < l_ranking.size() && l_results[l_ranking[l_rank]].isFinished() && l_rank < 5; ++l_rank)
+        {
+            if (l_generationIndex == 0 || l_ranking[l_rank] >= l_elitesCount)
+                l_bestLaps.emplace_back(l_results[l_ranking[l_rank]], l_genes[l_ranking[l_rank]]);
+        }
+
+        // Keeps the best drivers and replaces the others by mutations of them
+        std::vector<DriverGenes> l_nextGenes(l_genes.size());
+        for (size_t l_carIndex = 0; l_carIndex < l_nextGenes.size(); ++l_carIndex)
+        {
+            const auto& l_eliteGenes = l_genes[l_ranking[l_carIndex % l_elitesCount]];
+            l_nextGenes[l_carIndex] = l_carIndex < l_elitesCount ? l_eliteGenes : mutateGenes(l_eliteGenes, .1f, l_generator);
+        }
+        l_genes = std::move(l_nextGenes);
+    }
+
+    std::sort(l_bestLaps.begin(), l_bestLaps.end(), [](const auto& a_left, const auto& a_right) {
+        return a_left.first.isBetterThan(a_right.first);
+    });
+    std::cout << "Best laps:\n";
+    for (auto l_rank = (size_t) 0; l_rank < l_bestLaps.size() && l_rank < 5; ++l_rank)
+    {
+        const auto& l_lap = l_bestLaps[l_rank].first;
+        const auto& l_lapGenes = l_bestLaps[l_rank].second;
+        std::cout << "  " << l_lap.stepsCount * SimulationStepSeconds << " s, "
+            << l_lap.faultsCount << " faults, look ahead " << l_lapGenes.lookAhead
+            << ", sensor angle " << l_lapGenes.sensorAngle
+            << ", steering threshold " << l_lapGenes.steeringThreshold
+            << ", braking distance " << l_lapGenes.brakingDistance
+            << ", cruising gaz " << l_lapGenes.cruisingGaz << "\n";
+    }
+    const auto l_totalSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(l_totalDuration).count();
+    std::cout << l_totalStepsCount << " steps in " << l_totalSeconds << " s on "
+        << l_threadsCount << " threads: " << l_totalStepsCount / l_totalSeconds / 1e6 << " M steps/s\n";
+    return 0;
+}
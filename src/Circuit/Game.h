@@ -6,7 +6,9 @@
 #include "Car.h"
 #include "ModeSupport.h"
 #include "Resources.h"
+#include "TrackFile.h"
 #include <SFML/Graphics.hpp>
+#include <chrono>
 
 
 class Game
@@ -22,6 +24,12 @@ public:
     {
         const auto l_fontFilePathName = getResourceFileAbsolutePathName("mickey.ttf");
         m_font.loadFromFile(l_fontFilePathName.string());
+        // A file which cannot be loaded is rewritten whole by the next autosave rather than patched
+        TrackGrid l_grid;
+        if (loadTrackFile(getTrackFilePathName(), l_grid, m_autosavesCount))
+            m_track.setGrid(l_grid);
+        else
+            m_autosavesCount = MaxTrackPatchesCount;
         m_pCurrentModeSupport->onEnterMode();
     }
 
@@ -33,6 +41,7 @@ public:
     void update(const sf::RenderWindow& a_window)
     {
         m_pCurrentModeSupport->onUpdate(a_window);
+        autosave();
     }
 
     Track& getTrack()
@@ -50,8 +59,27 @@ public:
         return m_font;
     }
 
-    void save() const
+    void save()
     {
+        if (!saveTrackFile(getTrackFilePathName(), m_track.getGrid()))
+            return;
+        m_track.clearEdits();
+        m_autosavesCount = 0;
+    }
+
+    // Appends the cells edited since the last save to the track file, every few seconds, encoding them without copying the grid
+    void autosave()
+    {
+        static const auto AutosavePeriod = std::chrono::seconds(5);
+        const auto l_currentTime = std::chrono::steady_clock::now();
+        if (!m_track.hasEdits() || l_currentTime - m_lastAutosaveTimepoint < AutosavePeriod)
+            return;
+        m_lastAutosaveTimepoint = l_currentTime;
+
+        const auto l_editedArea = m_track.getEditedArea();
+        const TrackRegion l_editedRegion{ l_editedArea.first.x, l_editedArea.first.y, l_editedArea.second.x, l_editedArea.second.y };
+        if (autosaveTrackFile(getTrackFilePathName(), [&] { return m_track.getPatch(l_editedRegion); }, [&] { return m_track.getGrid(); }, m_autosavesCount))
+            m_track.clearEdits();
     }
 
     void onKeyPressed(const sf::RenderWindow& a_window, const sf::Event::KeyEvent& a_event)
@@ -100,10 +128,17 @@ public:
 
 private:
 
+    static stdnextfs::path getTrackFilePathName()
+    {
+        return getResourceFileAbsolutePathName("Track.ctrk");
+    }
+
     Track m_track;
     Car m_car;
     sf::Font m_font;
     ModeSupportEditing m_modeSupportEditing;
     ModeSupportPlaying m_modeSupportPlaying;
     ModeSupport* m_pCurrentModeSupport = &m_modeSupportEditing;
+    std::chrono::steady_clock::time_point m_lastAutosaveTimepoint{};
+    unsigned int m_autosavesCount = 0; // patches of the track file, including those of the previous sessions
 };
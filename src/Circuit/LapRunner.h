@@ -0,0 +1,179 @@
+#pragma once
+
+
+#include "Simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+// Parameters of the scripted driver, which evolve from a generation of drivers to the next
+struct DriverGenes
+{
+    float lookAhead = 80.f; // distance looked at in front of the car
+    float sensorAngle = 30.f; // degrees between the front sensor and the side ones
+    float steeringThreshold = 6.f; // difference of free distance on the sides to turn
+    float brakingDistance = 10.f; // free distance needed in front per unit of gaz
+    float cruisingGaz = 5.f;
+};
+
+
+// Distance to the grass along a direction, looked at up to a_maxDistance cell by cell
+inline float getFreeDistance(const TrackGrid& a_grid, float a_x, float a_y, float a_orientation, float a_maxDistance)
+{
+    static const auto RadianFactor = 3.141592f / 180.f;
+    const auto l_stepLength = std::min(a_grid.cellWidth, a_grid.cellHeight);
+    const auto l_stepX = l_stepLength * std::cos(a_orientation * RadianFactor);
+    const auto l_stepY = l_stepLength * std::sin(a_orientation * RadianFactor);
+    auto l_distance = 0.f;
+    while (l_distance < a_maxDistance)
+    {
+        a_x += l_stepX;
+        a_y += l_stepY;
+        if (!a_grid.isRoad(a_x, a_y))
+            break;
+        l_distance += l_stepLength;
+    }
+    return l_distance;
+}
+
+// Keeps to the middle of the road, slowing down before the turns
+inline CarCommand drive(const DriverGenes& a_genes, const CarsState& a_cars, size_t a_carIndex, const TrackGrid& a_grid)
+{
+    const auto l_x = a_cars.x[a_carIndex];
+    const auto l_y = a_cars.y[a_carIndex];
+    const auto l_orientation = a_cars.orientation[a_carIndex];
+    const auto l_gaz = (float) a_cars.gaz[a_carIndex];
+    const auto l_front = getFreeDistance(a_grid, l_x, l_y, l_orientation, a_genes.lookAhead);
+    const auto l_left = getFreeDistance(a_grid, l_x, l_y, l_orientation - a_genes.sensorAngle, a_genes.lookAhead);
+    const auto l_right = getFreeDistance(a_grid, l_x, l_y, l_orientation + a_genes.sensorAngle, a_genes.lookAhead);
+
+    // Blocked in front: turns even when both sides look alike
+    if (l_front < l_gaz)
+        return l_right > l_left ? CarCommand::TurnRight : CarCommand::TurnLeft;
+    if (l_gaz > 1.f && l_front < a_genes.brakingDistance * l_gaz)
+        return CarCommand::Brake;
+    if (l_left > l_right + a_genes.steeringThreshold)
+        return CarCommand::TurnLeft;
+    if (l_right > l_left + a_genes.steeringThreshold)
+        return CarCommand::TurnRight;
+    if (l_gaz == 0.f || (l_gaz < a_genes.cruisingGaz && l_front >= a_genes.brakingDistance * (l_gaz + 1.f)))
+        return CarCommand::Accelerate;
+    return CarCommand::None;
+}
+
+inline DriverGenes mutateGenes(const DriverGenes& a_genes, float a_strength, std::mt19937& a_generator)
+{
+    std::normal_distribution<float> l_distribution(1.f, a_strength);
+    DriverGenes l_genes;
+    l_genes.lookAhead = std::clamp(a_genes.lookAhead * l_distribution(a_generator), 10.f, 300.f);
+    l_genes.sensorAngle = std::clamp(a_genes.sensorAngle * l_distribution(a_generator), 5.f, 90.f);
+    l_genes.steeringThreshold = std::clamp(a_genes.steeringThreshold * l_distribution(a_generator), 0.f, 100.f);
+    l_genes.brakingDistance = std::clamp(a_genes.brakingDistance * l_distribution(a_generator), 0.f, 60.f);
+    l_genes.cruisingGaz = std::clamp(a_genes.cruisingGaz * l_distribution(a_generator), 1.f, (float) MaxGaz);
+    return l_genes;
+}
+
+
+struct LapResult
+{
+    bool isFinished() const
+    {
+        return checkpointLevel == checkpointsCount;
+    }
+
+    // Finished laps first, by increasing duration, then the others by decreasing progress
+    bool isBetterThan(const LapResult& a_other) const
+    {
+        if (checkpointLevel != a_other.checkpointLevel)
+            return checkpointLevel > a_other.checkpointLevel;
+        return stepsCount < a_other.stepsCount;
+    }
+
+    unsigned int stepsCount = 0;
+    unsigned int checkpointLevel = 0;
+    unsigned int checkpointsCount = 0;
+    unsigned int faultsCount = 0;
+};
+
+
+// Drives one car per genes from the start point of the track, until each car passes
+// all the checkpoints or a_maxStepsCount steps, splitting the cars between a_threadsCount threads;
+// a_stepsCount receives the number of steps simulated
+inline std::vector<LapResult> runLaps(const TrackGrid& a_grid, const std::vector<DriverGenes>& a_genes,
+                                      unsigned int a_maxStepsCount, unsigned int a_threadsCount, std::uint64_t& a_stepsCount)
+{
+    std::vector<LapResult> l_results(a_genes.size());
+    for (auto& l_result : l_results)
+        l_result.checkpointsCount = a_grid.checkpointsCount;
+    std::vector<std::uint64_t> l_threadsStepsCounts(std::max(a_threadsCount, 1u));
+
+    const auto l_runSlice = [&](size_t a_firstCarIndex, size_t a_lastCarIndex, std::uint64_t& a_threadStepsCount)
+    {
+        const auto l_carsCount = a_lastCarIndex - a_firstCarIndex;
+        CarsState l_cars;
+        l_cars.resize(l_carsCount);
+        std::vector<unsigned int> l_checkpointLevels(l_carsCount, 0);
+        std::vector<std::uint8_t> l_areFaulty(l_carsCount, 0);
+        std::vector<size_t> l_runningCarIndexes(l_carsCount);
+        for (size_t l_carIndex = 0; l_carIndex < l_carsCount; ++l_carIndex)
+        {
+            l_cars.place(l_carIndex, a_grid.startX, a_grid.startY, 180.f);
+            l_runningCarIndexes[l_carIndex] = l_carIndex;
+        }
+
+        // Steps all the running cars together, forgetting the ones which finish
+        std::uint64_t l_stepsCount = 0;
+        auto l_stepIndex = 0u;
+        for (; l_stepIndex < a_maxStepsCount && !l_runningCarIndexes.empty(); ++l_stepIndex)
+        {
+            l_stepsCount += l_runningCarIndexes.size();
+            auto l_runningIndex = (size_t) 0;
+            while (l_runningIndex < l_runningCarIndexes.size())
+            {
+                const auto l_carIndex = l_runningCarIndexes[l_runningIndex];
+                applyCommand(l_cars, l_carIndex, drive(a_genes[a_firstCarIndex + l_carIndex], l_cars, l_carIndex, a_grid));
+                auto& l_result = l_results[a_firstCarIndex + l_carIndex];
+                if (moveCar(l_cars, l_carIndex, a_grid, l_checkpointLevels[l_carIndex]))
+                    l_areFaulty[l_carIndex] = 0;
+                else if (!l_areFaulty[l_carIndex])
+                {
+                    l_areFaulty[l_carIndex] = 1;
+                    ++l_result.faultsCount;
+                }
+                if (l_checkpointLevels[l_carIndex] == a_grid.checkpointsCount)
+                {
+                    l_result.stepsCount = l_stepIndex + 1;
+                    l_result.checkpointLevel = l_checkpointLevels[l_carIndex];
+                    l_runningCarIndexes[l_runningIndex] = l_runningCarIndexes.back();
+                    l_runningCarIndexes.pop_back();
+                }
+                else
+                    ++l_runningIndex;
+            }
+        }
+        for (const auto l_carIndex : l_runningCarIndexes)
+        {
+            auto& l_result = l_results[a_firstCarIndex + l_carIndex];
+            l_result.stepsCount = l_stepIndex;
+            l_result.checkpointLevel = l_checkpointLevels[l_carIndex];
+        }
+        a_threadStepsCount = l_stepsCount;
+    };
+
+    const auto l_threadsCount = l_threadsStepsCounts.size();
+    std::vector<std::thread> l_threads;
+    for (size_t l_threadIndex = 1; l_threadIndex < l_threadsCount; ++l_threadIndex)
+        l_threads.emplace_back(l_runSlice, a_genes.size() * l_threadIndex / l_threadsCount, a_genes.size() * (l_threadIndex + 1) / l_threadsCount, std::ref(l_threadsStepsCounts[l_threadIndex]));
+    l_runSlice(0, a_genes.size() / l_threadsCount, l_threadsStepsCounts[0]);
+    for (auto& l_thread : l_threads)
+        l_thread.join();
+
+    for (const auto l_threadStepsCount : l_threadsStepsCounts)
+        a_stepsCount += l_threadStepsCount;
+    return l_results;
+}
@@ -164,6 +164,7 @@ void ModeSupportPlaying::onEnterMode()
     m_game.setupText(m_currenDurationText, sf::Color::Black, 14, {20, 80});
 
     m_currentAction = Action::IsIdle;
+    m_trackGrid = m_game.getTrack().getGrid();
     m_game.getCar().moveToStartPoint(m_game.getTrack());
     m_isCurrentlyFaulty = false;
     m_currentCheckpointLevel = 0;
@@ -185,25 +186,32 @@ void ModeSupportPlaying::onUpdate(const sf::RenderWindow& a_window)
     const auto l_currentTime = std::chrono::steady_clock::now();
     if (m_currentAction == Action::IsRunning)
     {
-        const auto l_previousCheckpointLevel = m_currentCheckpointLevel;
-        if (m_game.getCar().move(a_window, m_game.getTrack(), m_currentCheckpointLevel))
+        // Runs as many fixed steps as the elapsed time holds, whatever the frame rate
+        m_simulationLag += l_currentTime - m_previousStepTimepoint;
+        m_previousStepTimepoint = l_currentTime;
+        while (m_simulationLag >= SimulationStepDuration && m_currentAction == Action::IsRunning)
         {
-            m_isCurrentlyFaulty = false;
-            if (l_previousCheckpointLevel != m_currentCheckpointLevel)
+            m_simulationLag -= SimulationStepDuration;
+            const auto l_previousCheckpointLevel = m_currentCheckpointLevel;
+            if (m_game.getCar().move(m_trackGrid, m_currentCheckpointLevel))
             {
-                m_currentCheckpointLevelText.setString(std::string("Check Point: ") + std::to_string(m_currentCheckpointLevel));
-                if (m_currentCheckpointLevel == m_game.getTrack().getCheckpointsCount())
-                    m_currentAction = Action::IsFinished;
+                m_isCurrentlyFaulty = false;
+                if (l_previousCheckpointLevel != m_currentCheckpointLevel)
+                {
+                    m_currentCheckpointLevelText.setString(std::string("Check Point: ") + std::to_string(m_currentCheckpointLevel));
+                    if (m_currentCheckpointLevel == m_trackGrid.checkpointsCount)
+                        m_currentAction = Action::IsFinished;
+                }
             }
-        }
-        else
-        {
-            if (!m_isCurrentlyFaulty)
+            else
             {
-                ++m_currentFaultsCount;
-                m_currentFaultsCountText.setString(std::string("Faults Count: ") + std::to_string(m_currentFaultsCount));
-                m_isCurrentlyFaulty = true;
-                m_faultSound.get().play();
+                if (!m_isCurrentlyFaulty)
+                {
+                    ++m_currentFaultsCount;
+                    m_currentFaultsCountText.setString(std::string("Faults Count: ") + std::to_string(m_currentFaultsCount));
+                    m_isCurrentlyFaulty = true;
+                    m_faultSound.get().play();
+                }
             }
         }
         m_afterLastPauseDuration = l_currentTime - m_lastPauseTimepoint;
@@ -219,7 +227,7 @@ void ModeSupportPlaying::onUpdate(const sf::RenderWindow& a_window)
                 --m_countDown;
                 m_countdownSounds[m_countDown].get().play();
                 if (m_countDown == 0)
-                    m_currentAction = Action::IsRunning;
+                    startRunning(l_currentTime);
                 m_previousCountTimepoint = l_currentTime;
             }
         }
@@ -268,7 +276,7 @@ void ModeSupportPlaying::onKeyPressed(const sf::RenderWindow& a_window, const sf
                 m_countdownSounds[m_countDown].get().play();
             }
             else
-                m_currentAction = Action::IsRunning;
+                startRunning(m_lastPauseTimepoint);
             playEngine(true);
         }
         break;
@@ -159,8 +159,17 @@ private:
         m_currenDurationText.setString(std::string("Elapsed Time: ") + std::to_string(l_totalDuration.count()));
     }
 
+    void startRunning(std::chrono::steady_clock::time_point a_timepoint)
+    {
+        m_currentAction = Action::IsRunning;
+        m_previousStepTimepoint = a_timepoint;
+        m_simulationLag = std::chrono::steady_clock::duration();
+    }
+
     void playEngine(bool a_play);
 
+    static constexpr auto SimulationStepDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(SimulationStepSeconds));
+
     Game& m_game;
     Action m_currentAction = Action::IsIdle;
     bool m_isCurrentlyFaulty = false;
@@ -178,4 +187,7 @@ private:
     std::vector<Sound> m_countdownSounds;
     unsigned int m_countDown = 3;
     std::chrono::steady_clock::time_point m_previousCountTimepoint;
+    TrackGrid m_trackGrid; // copy of the track, which cannot be edited while playing
+    std::chrono::steady_clock::time_point m_previousStepTimepoint;
+    std::chrono::steady_clock::duration m_simulationLag{};
 };
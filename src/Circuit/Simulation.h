@@ -0,0 +1,160 @@
+#pragma once
+
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Fixed duration of a simulation step, the frame rate the game was tuned for
+constexpr float SimulationStepSeconds = 1.f / 60.f;
+
+constexpr unsigned int MaxGaz = 5;
+
+constexpr float RotationStepDegrees = 10.f;
+
+
+// Cells of a track as plain arrays, all that the simulation needs from a track
+struct TrackGrid
+{
+    bool isRoad(float a_x, float a_y) const
+    {
+        const auto l_cellIndex = toCellIndex(a_x, a_y);
+        return l_cellIndex != NoCell && roads[l_cellIndex] != 0;
+    }
+
+    // Passes the next checkpoint when the position is on it
+    bool isInRoad(float a_x, float a_y, unsigned int& a_checkpointLevel) const
+    {
+        const auto l_cellIndex = toCellIndex(a_x, a_y);
+        if (l_cellIndex == NoCell || roads[l_cellIndex] == 0)
+            return false;
+        if (checkpointLevels[l_cellIndex] == a_checkpointLevel + 1)
+            ++a_checkpointLevel;
+        return true;
+    }
+
+    unsigned int columnsCount = 0;
+    unsigned int rowsCount = 0;
+    float cellWidth = 1.f;
+    float cellHeight = 1.f;
+    std::vector<std::uint8_t> roads; // row after row, 1 for a road cell
+    std::vector<std::uint16_t> checkpointLevels;
+    bool isStartPointDefined = false; // otherwise the start point is meaningless
+    float startX = 0.f;
+    float startY = 0.f;
+    unsigned int checkpointsCount = 0;
+
+private:
+
+    static constexpr size_t NoCell = (size_t) -1;
+
+    size_t toCellIndex(float a_x, float a_y) const
+    {
+        if (a_x < 0.f || a_y < 0.f)
+            return NoCell;
+        const auto l_colIndex = (unsigned int) (a_x / cellWidth);
+        if (l_colIndex >= columnsCount)
+            return NoCell;
+        const auto l_rowIndex = (unsigned int) (a_y / cellHeight);
+        if (l_rowIndex >= rowsCount)
+            return NoCell;
+        return l_colIndex + (size_t) l_rowIndex*columnsCount;
+    }
+};
+
+
+enum class CarCommand : std::uint8_t
+{
+    None,
+    TurnLeft,
+    TurnRight,
+    Accelerate,
+    Brake,
+};
+
+
+// Cars simulated together, one array per field, so that a step reads only
+// the fields it needs for all the cars
+struct CarsState
+{
+    size_t size() const
+    {
+        return x.size();
+    }
+
+    void resize(size_t a_carsCount)
+    {
+        x.resize(a_carsCount);
+        y.resize(a_carsCount);
+        orientation.resize(a_carsCount);
+        directionX.resize(a_carsCount);
+        directionY.resize(a_carsCount);
+        gaz.resize(a_carsCount);
+    }
+
+    void place(size_t a_carIndex, float a_x, float a_y, float a_orientation)
+    {
+        x[a_carIndex] = a_x;
+        y[a_carIndex] = a_y;
+        gaz[a_carIndex] = 0;
+        setOrientation(a_carIndex, a_orientation);
+    }
+
+    void setOrientation(size_t a_carIndex, float a_orientation)
+    {
+        static const auto RadianFactor = 3.141592f / 180.f;
+        if (a_orientation < 0.f)
+            a_orientation += 360.f;
+        else if (a_orientation >= 360.f)
+            a_orientation -= 360.f;
+        orientation[a_carIndex] = a_orientation;
+        directionX[a_carIndex] = std::cos(a_orientation * RadianFactor);
+        directionY[a_carIndex] = std::sin(a_orientation * RadianFactor);
+    }
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> orientation; // in degrees, clockwise as sf::Sprite's rotation
+    std::vector<float> directionX; // cosine of the orientation, computed when it changes
+    std::vector<float> directionY;
+    std::vector<std::uint8_t> gaz; // distance run at each step
+};
+
+
+inline void applyCommand(CarsState& a_cars, size_t a_carIndex, CarCommand a_command)
+{
+    switch (a_command)
+    {
+    case CarCommand::TurnLeft:
+        a_cars.setOrientation(a_carIndex, a_cars.orientation[a_carIndex] - RotationStepDegrees);
+        break;
+    case CarCommand::TurnRight:
+        a_cars.setOrientation(a_carIndex, a_cars.orientation[a_carIndex] + RotationStepDegrees);
+        break;
+    case CarCommand::Accelerate:
+        if (a_cars.gaz[a_carIndex] < MaxGaz)
+            ++a_cars.gaz[a_carIndex];
+        break;
+    case CarCommand::Brake:
+        if (a_cars.gaz[a_carIndex] > 0)
+            --a_cars.gaz[a_carIndex];
+        break;
+    case CarCommand::None:
+        break;
+    }
+}
+
+// Moves the car for one step, unless it would leave the road, in which case it stays and false is returned
+inline bool moveCar(CarsState& a_cars, size_t a_carIndex, const TrackGrid& a_grid, unsigned int& a_checkpointLevel)
+{
+    const auto l_gaz = (float) a_cars.gaz[a_carIndex];
+    const auto l_x = a_cars.x[a_carIndex] + l_gaz * a_cars.directionX[a_carIndex];
+    const auto l_y = a_cars.y[a_carIndex] + l_gaz * a_cars.directionY[a_carIndex];
+    if (!a_grid.isInRoad(l_x, l_y, a_checkpointLevel))
+        return false;
+    a_cars.x[a_carIndex] = l_x;
+    a_cars.y[a_carIndex] = l_y;
+    return true;
+}
@@ -3,7 +3,11 @@
 
 
 #include "Cell.h"
+#include "Simulation.h"
+#include "TrackFile.h"
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <utility>
 
 
 class Track
@@ -15,17 +19,29 @@ public:
         , m_gridSize{ a_gridSize }
         , m_cellSize{ (float) (m_windowSize.x / a_gridSize.x), (float) (m_windowSize.y / a_gridSize.y) }
         , m_cells(a_gridSize.x*a_gridSize.y)
+        , m_vertices(sf::Quads, m_cells.size()*4)
+        , m_vertexBuffer(sf::Quads, sf::VertexBuffer::Dynamic)
     {
-        for (auto l_rowIndex = (unsigned int) 0; l_rowIndex < m_gridSize.x; ++l_rowIndex)
+        for (auto l_rowIndex = (unsigned int) 0; l_rowIndex < m_gridSize.y; ++l_rowIndex)
         {
-            for (auto l_colIndex = (unsigned int) 0; l_colIndex < m_gridSize.y; ++l_colIndex)
+            for (auto l_colIndex = (unsigned int) 0; l_colIndex < m_gridSize.x; ++l_colIndex)
             {
                 const sf::Vector2f l_cellPosition{ (float) l_colIndex*m_cellSize.x, (float) l_rowIndex*m_cellSize.y };
-                m_cells[l_colIndex + l_rowIndex*m_gridSize.y].setPositionAndSize(l_cellPosition, m_cellSize);
+                auto* l_quad = &m_vertices[toCellIndex(l_colIndex, l_rowIndex)*4];
+                l_quad[0].position = l_cellPosition;
+                l_quad[1].position = { l_cellPosition.x + m_cellSize.x, l_cellPosition.y };
+                l_quad[2].position = { l_cellPosition.x + m_cellSize.x, l_cellPosition.y + m_cellSize.y };
+                l_quad[3].position = { l_cellPosition.x, l_cellPosition.y + m_cellSize.y };
             }
         }
+        refreshCellsColor(0, m_cells.size());
+
+        // Keeps the vertices in the graphics memory, where only the edited cells are updated
+        if (sf::VertexBuffer::isAvailable() && m_vertexBuffer.create(m_vertices.getVertexCount()))
+            m_vertexBuffer.update(&m_vertices[0]);
 
         resetStartPoint();
+        clearEdits();
     }
 
     sf::Vector2u getWindowSize() const
@@ -48,30 +64,56 @@ public:
         return m_checkpointsCount;
     }
 
-    bool isInRoad(const sf::Vector2f& a_position, unsigned int& a_checkpointLevel) const
+    // Copy of the cells for the simulation, which does not depend on SFML; the cells are in the same order
+    TrackGrid getGrid() const
     {
-        if (a_position.x < 0.f)
-            return false;
-        if (a_position.y < 0.f)
-            return false;
-        const auto l_colIndex = (unsigned int) (a_position.x / m_cellSize.x);
-        if (l_colIndex >= m_gridSize.x)
-            return false;
-        const auto l_rowIndex = (unsigned int) (a_position.y / m_cellSize.y);
-        if (l_rowIndex >= m_gridSize.y)
-            return false;
-        const auto& l_cell = getCell(l_colIndex, l_rowIndex);
-        if (l_cell.getType() == CellType::Grass)
-            return false;
-        if (l_cell.getCheckpointLevel() == a_checkpointLevel + 1)
-            ++a_checkpointLevel;
-        return true;
+        TrackGrid l_grid;
+        l_grid.columnsCount = m_gridSize.x;
+        l_grid.rowsCount = m_gridSize.y;
+        l_grid.cellWidth = m_cellSize.x;
+        l_grid.cellHeight = m_cellSize.y;
+        l_grid.roads.resize(m_cells.size());
+        l_grid.checkpointLevels.resize(m_cells.size());
+        for (auto l_cellIndex = (size_t) 0; l_cellIndex < m_cells.size(); ++l_cellIndex)
+        {
+            const auto& l_cell = m_cells[l_cellIndex];
+            l_grid.roads[l_cellIndex] = l_cell.getType() == CellType::Road ? 1 : 0;
+            l_grid.checkpointLevels[l_cellIndex] = (std::uint16_t) l_cell.getCheckpointLevel();
+        }
+        const auto l_startPoint = getStartPoint();
+        l_grid.isStartPointDefined = m_isStartPointDefined;
+        l_grid.startX = l_startPoint.x;
+        l_grid.startY = l_startPoint.y;
+        l_grid.checkpointsCount = m_checkpointsCount;
+        return l_grid;
     }
 
+    // Cells of the region for an autosave, encoded straight from the track
+    TrackPatch getPatch(const TrackRegion& a_region) const
+    {
+        TrackPatch l_patch;
+        l_patch.gridColumnsCount = m_gridSize.x;
+        l_patch.gridRowsCount = m_gridSize.y;
+        const auto l_startPoint = getStartPoint();
+        l_patch.isStartPointDefined = m_isStartPointDefined;
+        l_patch.startX = l_startPoint.x;
+        l_patch.startY = l_startPoint.y;
+        l_patch.checkpointsCount = m_checkpointsCount;
+        encodeTrackPatchRows(l_patch, a_region, [&](size_t a_cellIndex)
+        {
+            const auto& l_cell = m_cells[a_cellIndex];
+            return toTrackCellValue(l_cell.getType() == CellType::Road, l_cell.getCheckpointLevel());
+        });
+        return l_patch;
+    }
+
+    // Draws all the cells with a single draw call
     void draw(sf::RenderWindow& a_window) const
     {
-        for (const auto& l_cell : m_cells)
-            l_cell.draw(a_window);
+        if (m_vertexBuffer.getVertexCount() != 0)
+            a_window.draw(m_vertexBuffer);
+        else
+            a_window.draw(m_vertices);
         if (m_isStartPointDefined)
             a_window.draw(m_startPoint);
     }
@@ -86,7 +128,9 @@ public:
                 if (getCell(l_colIndex, l_rowIndex).setType(a_cellType, a_checkpointLevel) && m_startPointPosition.x == l_colIndex && m_startPointPosition.y == l_rowIndex)
                     resetStartPoint();
             }
+            refreshCellsColor(toCellIndex(l_surroundingArea.first.x, l_rowIndex), toCellIndex(l_surroundingArea.second.x, l_rowIndex));
         }
+        addEditedArea(l_surroundingArea.first, l_surroundingArea.second);
     }
 
     void setStartPoint(int a_x, int a_y)
@@ -98,6 +142,7 @@ public:
         m_startPointPosition = l_startPointPosition;
         m_startPoint.setPosition({ (float) m_startPointPosition.x*m_cellSize.x, (float) m_startPointPosition.y*m_cellSize.y });
         m_isStartPointDefined = true;
+        m_hasEdits = true;
     }
 
     void resetStartPoint()
@@ -112,12 +157,23 @@ public:
     {
         if (m_checkpointsCount == 0)
             return false;
-        for (auto& l_cell : m_cells)
+        auto l_firstCellIndex = m_cells.size();
+        auto l_lastCellIndex = (size_t) 0;
+        for (auto l_cellIndex = (size_t) 0; l_cellIndex < m_cells.size(); ++l_cellIndex)
         {
+            auto& l_cell = m_cells[l_cellIndex];
             if (l_cell.getCheckpointLevel() == m_checkpointsCount)
+            {
                 l_cell.resetCheckpointLevel();
+                l_firstCellIndex = std::min(l_firstCellIndex, l_cellIndex);
+                l_lastCellIndex = l_cellIndex + 1;
+            }
         }
+        refreshCellsColor(l_firstCellIndex, l_lastCellIndex);
+        if (l_firstCellIndex < l_lastCellIndex)
+            addEditedArea({ 0, (unsigned int) (l_firstCellIndex / m_gridSize.x) }, { m_gridSize.x, (unsigned int) ((l_lastCellIndex - 1) / m_gridSize.x + 1) });
         --m_checkpointsCount;
+        m_hasEdits = true;
         return true;
     }
 
@@ -131,8 +187,53 @@ public:
         }
     }
 
+    // Replaces the cells by the ones of a grid of the same size, as loaded from a file
+    bool setGrid(const TrackGrid& a_grid)
+    {
+        if (a_grid.columnsCount != m_gridSize.x || a_grid.rowsCount != m_gridSize.y)
+            return false;
+        for (auto l_cellIndex = (size_t) 0; l_cellIndex < m_cells.size(); ++l_cellIndex)
+        {
+            auto& l_cell = m_cells[l_cellIndex];
+            l_cell.setType(a_grid.roads[l_cellIndex] != 0 ? CellType::Road : CellType::Grass, 0);
+            if (a_grid.roads[l_cellIndex] != 0 && a_grid.checkpointLevels[l_cellIndex] != 0)
+                l_cell.setType(CellType::Road, a_grid.checkpointLevels[l_cellIndex]);
+        }
+        refreshCellsColor(0, m_cells.size());
+        refreshCheckpointsCount();
+        resetStartPoint();
+        if (a_grid.isStartPointDefined)
+            setStartPoint((int) (a_grid.startX + m_cellSize.x / 2.f), (int) (a_grid.startY + m_cellSize.y / 2.f));
+        clearEdits();
+        return true;
+    }
+
+    // Whether the track changed since the last call to clearEdits, and in which area of cells
+    bool hasEdits() const
+    {
+        return m_hasEdits;
+    }
+
+    std::pair<sf::Vector2u, sf::Vector2u> getEditedArea() const
+    {
+        return m_editedArea;
+    }
+
+    void clearEdits()
+    {
+        m_hasEdits = false;
+        m_editedArea = { m_gridSize, { 0, 0 } };
+    }
+
 private:
 
+    void addEditedArea(const sf::Vector2u& a_first, const sf::Vector2u& a_last)
+    {
+        m_editedArea.first = { std::min(m_editedArea.first.x, a_first.x), std::min(m_editedArea.first.y, a_first.y) };
+        m_editedArea.second = { std::max(m_editedArea.second.x, a_last.x), std::max(m_editedArea.second.y, a_last.y) };
+        m_hasEdits = true;
+    }
+
     sf::Vector2u toCellPosition(int a_x, int a_y) const
     {
         if (a_x < 0)
@@ -165,9 +266,10 @@ private:
         };
     }
 
+    // Cells are stored row after row, as in TrackGrid
     size_t toCellIndex(unsigned int a_colIndex, unsigned int a_rowIndex) const
     {
-        return a_colIndex + a_rowIndex*m_gridSize.y;
+        return a_colIndex + (size_t) a_rowIndex*m_gridSize.x;
     }
 
     const Cell& getCell(unsigned int a_colIndex, unsigned int a_rowIndex) const
@@ -187,12 +289,32 @@ private:
         return getCell(a_cellPosition.x, a_cellPosition.y);
     }
 
+    // Copies the colors of the cells [a_firstCellIndex, a_lastCellIndex) to their vertices, in memory and in the vertex buffer
+    void refreshCellsColor(size_t a_firstCellIndex, size_t a_lastCellIndex)
+    {
+        if (a_firstCellIndex >= a_lastCellIndex)
+            return;
+        for (auto l_cellIndex = a_firstCellIndex; l_cellIndex < a_lastCellIndex; ++l_cellIndex)
+        {
+            const auto l_color = m_cells[l_cellIndex].getColor();
+            auto* l_quad = &m_vertices[l_cellIndex*4];
+            for (auto l_vertexIndex = 0; l_vertexIndex < 4; ++l_vertexIndex)
+                l_quad[l_vertexIndex].color = l_color;
+        }
+        if (m_vertexBuffer.getVertexCount() != 0)
+            m_vertexBuffer.update(&m_vertices[a_firstCellIndex*4], (unsigned int) (a_lastCellIndex - a_firstCellIndex)*4, (unsigned int) a_firstCellIndex*4);
+    }
+
     sf::Vector2u m_windowSize;
     sf::Vector2u m_gridSize;
     sf::Vector2f m_cellSize;
     std::vector<Cell> m_cells;
+    sf::VertexArray m_vertices; // 4 per cell, in the order of the cells
+    sf::VertexBuffer m_vertexBuffer;
     sf::Vector2u m_startPointPosition;
     sf::RectangleShape m_startPoint;
     bool m_isStartPointDefined = false;
     unsigned int m_checkpointsCount = 0;
+    bool m_hasEdits = false;
+    std::pair<sf::Vector2u, sf::Vector2u> m_editedArea; // cells [first, second)
 };
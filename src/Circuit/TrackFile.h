@@ -0,0 +1,364 @@
+#pragma once
+
+
+#include "Simulation.h"
+#include <platform/filesystem.hpp>
+#include <platform/mapped_file.hpp>
+#include <platform/system_error.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// Track file, in the byte order of the machine which wrote it:
+// - a TrackFileHeader, whose start point is meaningful only with the TrackHasStartPoint flag,
+// - the offset of each row of cells then of the end of the rows, from the start of the rows,
+//   so that the rows can be decoded in any order,
+// - the rows of cells, each one as runs of (count, value) bytes, where the value is 0 for grass,
+//   1 for road and 1 + level for a checkpoint,
+// - the patches appended by the autosaves since the file was written: a TrackPatchHeader, then
+//   the rows of the edited region as runs, which replace the cells of the region.
+
+constexpr std::uint32_t TrackFileVersion = 2;
+
+constexpr std::uint32_t TrackHasStartPoint = 1;
+
+constexpr unsigned int MaxSavedCheckpointLevel = 254;
+
+struct TrackFileHeader
+{
+    char magic[4]; // "CTRK"
+    std::uint32_t version;
+    std::uint32_t columnsCount;
+    std::uint32_t rowsCount;
+    float cellWidth;
+    float cellHeight;
+    float startX;
+    float startY;
+    std::uint32_t checkpointsCount;
+    std::uint32_t flags;
+    std::uint64_t rowsSize; // bytes of the rows, after the offsets
+};
+
+static_assert(sizeof(TrackFileHeader) == 48, "TrackFileHeader is written as is");
+
+struct TrackPatchHeader
+{
+    char magic[4]; // "CTRP"
+    std::uint32_t firstColIndex;
+    std::uint32_t firstRowIndex;
+    std::uint32_t columnsCount;
+    std::uint32_t rowsCount;
+    float startX;
+    float startY;
+    std::uint32_t checkpointsCount;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+    std::uint64_t rowsSize;
+};
+
+static_assert(sizeof(TrackPatchHeader) == 48, "TrackPatchHeader is written as is");
+
+// Cells [first, last) of a grid, by column and by row
+struct TrackRegion
+{
+    unsigned int firstColIndex;
+    unsigned int firstRowIndex;
+    unsigned int lastColIndex;
+    unsigned int lastRowIndex;
+};
+
+// Cells of a region of a grid, clipped to the grid, with the start point and the checkpoints count, as appended by an autosave
+struct TrackPatch
+{
+    unsigned int gridColumnsCount = 0;
+    unsigned int gridRowsCount = 0;
+    TrackRegion region{};
+    bool isStartPointDefined = false;
+    float startX = 0.f;
+    float startY = 0.f;
+    unsigned int checkpointsCount = 0;
+    std::vector<std::uint8_t> rows; // runs of the rows of the region
+};
+
+
+// Value saved for a cell: 0 for grass, 1 for road and 1 + level for a checkpoint
+inline std::uint8_t toTrackCellValue(bool a_isRoad, unsigned int a_checkpointLevel)
+{
+    if (!a_isRoad)
+        return 0;
+    return (std::uint8_t) (1 + std::min(a_checkpointLevel, MaxSavedCheckpointLevel));
+}
+
+// Appends the runs of a_cellsCount cells from a_firstCellIndex, a_cellValue giving the value of a cell from its index
+template <typename CellValue>
+inline void encodeTrackRuns(const CellValue& a_cellValue, size_t a_firstCellIndex, size_t a_cellsCount, std::vector<std::uint8_t>& a_bytes)
+{
+    const auto l_lastCellIndex = a_firstCellIndex + a_cellsCount;
+    auto l_cellIndex = a_firstCellIndex;
+    while (l_cellIndex < l_lastCellIndex)
+    {
+        const auto l_value = a_cellValue(l_cellIndex);
+        auto l_count = (size_t) 1;
+        while (l_count < 255 && l_cellIndex + l_count < l_lastCellIndex && a_cellValue(l_cellIndex + l_count) == l_value)
+            ++l_count;
+        a_bytes.push_back((std::uint8_t) l_count);
+        a_bytes.push_back(l_value);
+        l_cellIndex += l_count;
+    }
+}
+
+inline void encodeTrackRuns(const TrackGrid& a_grid, size_t a_firstCellIndex, size_t a_cellsCount, std::vector<std::uint8_t>& a_bytes)
+{
+    encodeTrackRuns([&](size_t a_cellIndex) { return toTrackCellValue(a_grid.roads[a_cellIndex] != 0, a_grid.checkpointLevels[a_cellIndex]); },
+                    a_firstCellIndex, a_cellsCount, a_bytes);
+}
+
+// Clips the region to the grid of the patch and encodes its rows, a_cellValue giving the value of a cell from its index in the grid
+template <typename CellValue>
+inline void encodeTrackPatchRows(TrackPatch& a_patch, const TrackRegion& a_region, const CellValue& a_cellValue)
+{
+    const auto l_lastColIndex = std::min(a_region.lastColIndex, a_patch.gridColumnsCount);
+    const auto l_lastRowIndex = std::min(a_region.lastRowIndex, a_patch.gridRowsCount);
+    a_patch.rows.clear();
+    if (a_region.firstColIndex >= l_lastColIndex || a_region.firstRowIndex >= l_lastRowIndex)
+    {
+        // An empty region still saves the start point and the checkpoints count
+        a_patch.region = {};
+        return;
+    }
+    a_patch.region = { a_region.firstColIndex, a_region.firstRowIndex, l_lastColIndex, l_lastRowIndex };
+    for (auto l_rowIndex = a_region.firstRowIndex; l_rowIndex < l_lastRowIndex; ++l_rowIndex)
+        encodeTrackRuns(a_cellValue, (size_t) l_rowIndex*a_patch.gridColumnsCount + a_region.firstColIndex, l_lastColIndex - a_region.firstColIndex, a_patch.rows);
+}
+
+inline TrackPatch makeTrackPatch(const TrackGrid& a_grid, const TrackRegion& a_region)
+{
+    TrackPatch l_patch;
+    l_patch.gridColumnsCount = a_grid.columnsCount;
+    l_patch.gridRowsCount = a_grid.rowsCount;
+    l_patch.isStartPointDefined = a_grid.isStartPointDefined;
+    l_patch.startX = a_grid.startX;
+    l_patch.startY = a_grid.startY;
+    l_patch.checkpointsCount = a_grid.checkpointsCount;
+    encodeTrackPatchRows(l_patch, a_region, [&](size_t a_cellIndex) { return toTrackCellValue(a_grid.roads[a_cellIndex] != 0, a_grid.checkpointLevels[a_cellIndex]); });
+    return l_patch;
+}
+
+// Decodes runs into exactly a_cellsCount cells of the grid from a_firstCellIndex; returns the end of the runs, or nullptr when they are corrupt
+inline const std::uint8_t* decodeTrackRuns(const std::uint8_t* a_bytes, const std::uint8_t* a_bytesEnd, TrackGrid& a_grid, size_t a_firstCellIndex, size_t a_cellsCount)
+{
+    auto* l_roads = a_grid.roads.data() + a_firstCellIndex;
+    auto* l_checkpointLevels = a_grid.checkpointLevels.data() + a_firstCellIndex;
+    while (a_cellsCount != 0)
+    {
+        if (a_bytesEnd - a_bytes < 2)
+            return nullptr;
+        const auto l_count = (size_t) a_bytes[0];
+        const auto l_value = a_bytes[1];
+        a_bytes += 2;
+        if (l_count == 0 || l_count > a_cellsCount)
+            return nullptr;
+        std::memset(l_roads, l_value != 0 ? 1 : 0, l_count);
+        std::fill(l_checkpointLevels, l_checkpointLevels + l_count, (std::uint16_t) (l_value > 1 ? l_value - 1 : 0));
+        l_roads += l_count;
+        l_checkpointLevels += l_count;
+        a_cellsCount -= l_count;
+    }
+    return a_bytes;
+}
+
+
+// Writes the whole grid, dropping the patches of the previous file, which is replaced only once the new one is complete
+inline bool saveTrackFile(const stdnext::filesystem::path& a_path, const TrackGrid& a_grid)
+{
+    std::vector<std::uint64_t> l_rowsOffsets;
+    l_rowsOffsets.reserve(a_grid.rowsCount + 1);
+    std::vector<std::uint8_t> l_rows;
+    for (auto l_rowIndex = 0u; l_rowIndex < a_grid.rowsCount; ++l_rowIndex)
+    {
+        l_rowsOffsets.push_back(l_rows.size());
+        encodeTrackRuns(a_grid, (size_t) l_rowIndex*a_grid.columnsCount, a_grid.columnsCount, l_rows);
+    }
+    l_rowsOffsets.push_back(l_rows.size());
+
+    TrackFileHeader l_header{ { 'C', 'T', 'R', 'K' }, TrackFileVersion, a_grid.columnsCount, a_grid.rowsCount,
+        a_grid.cellWidth, a_grid.cellHeight, a_grid.startX, a_grid.startY, a_grid.checkpointsCount,
+        a_grid.isStartPointDefined ? TrackHasStartPoint : 0, l_rows.size() };
+
+    auto l_temporaryPath = a_path;
+    l_temporaryPath += ".tmp";
+    {
+        std::ofstream l_file(l_temporaryPath.string(), std::ios::binary | std::ios::trunc);
+        l_file.write((const char*) &l_header, sizeof(l_header));
+        l_file.write((const char*) l_rowsOffsets.data(), (std::streamsize) (l_rowsOffsets.size()*sizeof(std::uint64_t)));
+        l_file.write((const char*) l_rows.data(), (std::streamsize) l_rows.size());
+        if (!l_file.flush())
+            return false;
+    }
+    stdnext::error_code l_error;
+    stdnext::filesystem::rename(l_temporaryPath, a_path, l_error);
+    return !l_error;
+}
+
+// Appends the patch to a file saved from a grid of the same size
+inline bool appendTrackPatch(const stdnext::filesystem::path& a_path, const TrackPatch& a_patch)
+{
+    std::fstream l_file(a_path.string(), std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+    TrackFileHeader l_header{};
+    l_file.seekg(0);
+    if (!l_file.read((char*) &l_header, sizeof(l_header)) || std::memcmp(l_header.magic, "CTRK", 4) != 0 ||
+        l_header.version != TrackFileVersion || l_header.columnsCount != a_patch.gridColumnsCount || l_header.rowsCount != a_patch.gridRowsCount)
+        return false;
+
+    const auto& l_region = a_patch.region;
+    const TrackPatchHeader l_patchHeader{ { 'C', 'T', 'R', 'P' }, l_region.firstColIndex, l_region.firstRowIndex,
+        l_region.lastColIndex - l_region.firstColIndex, l_region.lastRowIndex - l_region.firstRowIndex, a_patch.startX, a_patch.startY,
+        a_patch.checkpointsCount, a_patch.isStartPointDefined ? TrackHasStartPoint : 0, 0, a_patch.rows.size() };
+    l_file.seekp(0, std::ios::end);
+    l_file.write((const char*) &l_patchHeader, sizeof(l_patchHeader));
+    l_file.write((const char*) a_patch.rows.data(), (std::streamsize) a_patch.rows.size());
+    return (bool) l_file.flush();
+}
+
+// Appends the cells of the region, the start point and the checkpoints count to a file saved from a grid of the same size
+inline bool appendTrackPatch(const stdnext::filesystem::path& a_path, const TrackGrid& a_grid, const TrackRegion& a_region)
+{
+    return appendTrackPatch(a_path, makeTrackPatch(a_grid, a_region));
+}
+
+// Patches appended before the whole file is rewritten, so that loading does not slow down as the edits pile up
+constexpr unsigned int MaxTrackPatchesCount = 100;
+
+// Appends the patch made by a_makePatch, or rewrites the whole grid given by a_getGrid when there is no file yet or once a_patchesCount
+// reaches MaxTrackPatchesCount; a_patchesCount counts the patches of the file, so that only the edited cells are encoded most of the time
+template <typename MakePatch, typename GetGrid>
+inline bool autosaveTrackFile(const stdnext::filesystem::path& a_path, const MakePatch& a_makePatch, const GetGrid& a_getGrid, unsigned int& a_patchesCount)
+{
+    if (a_patchesCount < MaxTrackPatchesCount && appendTrackPatch(a_path, a_makePatch()))
+    {
+        ++a_patchesCount;
+        return true;
+    }
+    if (!saveTrackFile(a_path, a_getGrid()))
+        return false;
+    a_patchesCount = 0;
+    return true;
+}
+
+inline bool autosaveTrackFile(const stdnext::filesystem::path& a_path, const TrackGrid& a_grid, const TrackRegion& a_region, unsigned int& a_patchesCount)
+{
+    return autosaveTrackFile(a_path, [&] { return makeTrackPatch(a_grid, a_region); }, [&]() -> const TrackGrid& { return a_grid; }, a_patchesCount);
+}
+
+
+// Reads the grid, then applies the patches, whose count goes to a_patchesCount; the rows of large grids are decoded by a_threadsCount threads.
+// On failure, a_grid and a_patchesCount are left as they were
+inline bool loadTrackFile(const stdnext::filesystem::path& a_path, TrackGrid& a_grid, unsigned int& a_patchesCount,
+                          unsigned int a_threadsCount = std::max(std::thread::hardware_concurrency(), 1u))
+{
+    // Read by several threads at once
+    const platform::mapped_file l_file(a_path, platform::mapped_file_access::whole);
+    const auto* l_bytes = (const std::uint8_t*) l_file.data();
+    const auto* l_bytesEnd = l_bytes + l_file.size();
+    TrackFileHeader l_header{};
+    if (!l_file.is_open() || l_file.size() < sizeof(l_header))
+        return false;
+    std::memcpy(&l_header, l_bytes, sizeof(l_header));
+    l_bytes += sizeof(l_header);
+    if (std::memcmp(l_header.magic, "CTRK", 4) != 0 || l_header.version != TrackFileVersion)
+        return false;
+    const auto l_cellsCount = (std::uint64_t) l_header.columnsCount*l_header.rowsCount;
+    const auto l_offsetsSize = ((std::uint64_t) l_header.rowsCount + 1)*sizeof(std::uint64_t);
+    if ((std::uint64_t) (l_bytesEnd - l_bytes) < l_offsetsSize || (std::uint64_t) (l_bytesEnd - l_bytes) - l_offsetsSize < l_header.rowsSize ||
+        l_header.rowsSize < 2*l_cellsCount/255)
+        return false;
+
+    TrackGrid l_grid;
+    l_grid.columnsCount = l_header.columnsCount;
+    l_grid.rowsCount = l_header.rowsCount;
+    l_grid.cellWidth = l_header.cellWidth;
+    l_grid.cellHeight = l_header.cellHeight;
+    l_grid.isStartPointDefined = (l_header.flags & TrackHasStartPoint) != 0;
+    l_grid.startX = l_header.startX;
+    l_grid.startY = l_header.startY;
+    l_grid.checkpointsCount = l_header.checkpointsCount;
+    l_grid.roads.resize((size_t) l_cellsCount);
+    l_grid.checkpointLevels.resize((size_t) l_cellsCount);
+
+    std::vector<std::uint64_t> l_rowsOffsets(l_header.rowsCount + 1);
+    std::memcpy(l_rowsOffsets.data(), l_bytes, (size_t) l_offsetsSize);
+    l_bytes += l_offsetsSize;
+    const auto* l_rows = l_bytes;
+    const auto* l_rowsEnd = l_rows + l_header.rowsSize;
+    if (l_rowsOffsets.front() != 0 || l_rowsOffsets.back() != l_header.rowsSize)
+        return false;
+
+    const auto l_decodeRows = [&](unsigned int a_firstRowIndex, unsigned int a_lastRowIndex)
+    {
+        for (auto l_rowIndex = a_firstRowIndex; l_rowIndex < a_lastRowIndex; ++l_rowIndex)
+        {
+            const auto l_rowOffset = l_rowsOffsets[l_rowIndex];
+            const auto l_nextRowOffset = l_rowsOffsets[l_rowIndex + 1];
+            if (l_rowOffset > l_nextRowOffset || l_nextRowOffset > l_header.rowsSize ||
+                decodeTrackRuns(l_rows + l_rowOffset, l_rows + l_nextRowOffset, l_grid, (size_t) l_rowIndex*l_grid.columnsCount, l_grid.columnsCount) != l_rows + l_nextRowOffset)
+                return false;
+        }
+        return true;
+    };
+    const auto l_threadsCount = l_cellsCount < (1u << 20) ? 1u : std::min(std::max(a_threadsCount, 1u), std::max(l_grid.rowsCount, 1u));
+    std::vector<std::uint8_t> l_areDecoded(l_threadsCount, 0);
+    std::vector<std::thread> l_threads;
+    for (auto l_threadIndex = 1u; l_threadIndex < l_threadsCount; ++l_threadIndex)
+    {
+        l_threads.emplace_back([&, l_threadIndex]
+        {
+            l_areDecoded[l_threadIndex] = l_decodeRows(
+                (unsigned int) ((std::uint64_t) l_grid.rowsCount*l_threadIndex/l_threadsCount),
+                (unsigned int) ((std::uint64_t) l_grid.rowsCount*(l_threadIndex + 1)/l_threadsCount)) ? 1 : 0;
+        });
+    }
+    l_areDecoded[0] = l_decodeRows(0, l_grid.rowsCount/l_threadsCount) ? 1 : 0;
+    for (auto& l_thread : l_threads)
+        l_thread.join();
+    if (std::find(l_areDecoded.begin(), l_areDecoded.end(), 0) != l_areDecoded.end())
+        return false;
+
+    // Patches, in the order of the autosaves
+    auto l_patchesCount = 0u;
+    l_bytes = l_rowsEnd;
+    while (l_bytes != l_bytesEnd)
+    {
+        TrackPatchHeader l_patchHeader{};
+        if ((size_t) (l_bytesEnd - l_bytes) < sizeof(l_patchHeader))
+            return false;
+        std::memcpy(&l_patchHeader, l_bytes, sizeof(l_patchHeader));
+        l_bytes += sizeof(l_patchHeader);
+        if (std::memcmp(l_patchHeader.magic, "CTRP", 4) != 0 || (std::uint64_t) (l_bytesEnd - l_bytes) < l_patchHeader.rowsSize ||
+            l_patchHeader.firstColIndex > l_grid.columnsCount || l_patchHeader.columnsCount > l_grid.columnsCount - l_patchHeader.firstColIndex ||
+            l_patchHeader.firstRowIndex > l_grid.rowsCount || l_patchHeader.rowsCount > l_grid.rowsCount - l_patchHeader.firstRowIndex)
+            return false;
+        const auto* l_patchRowsEnd = l_bytes + l_patchHeader.rowsSize;
+        for (auto l_rowIndex = l_patchHeader.firstRowIndex; l_rowIndex < l_patchHeader.firstRowIndex + l_patchHeader.rowsCount; ++l_rowIndex)
+        {
+            l_bytes = decodeTrackRuns(l_bytes, l_patchRowsEnd, l_grid, (size_t) l_rowIndex*l_grid.columnsCount + l_patchHeader.firstColIndex, l_patchHeader.columnsCount);
+            if (!l_bytes)
+                return false;
+        }
+        if (l_bytes != l_patchRowsEnd)
+            return false;
+        l_grid.isStartPointDefined = (l_patchHeader.flags & TrackHasStartPoint) != 0;
+        l_grid.startX = l_patchHeader.startX;
+        l_grid.startY = l_patchHeader.startY;
+        l_grid.checkpointsCount = l_patchHeader.checkpointsCount;
+        ++l_patchesCount;
+    }
+
+    a_grid = std::move(l_grid);
+    a_patchesCount = l_patchesCount;
+    return true;
+}
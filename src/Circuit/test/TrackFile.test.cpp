@@ -0,0 +1,325 @@
+#include <catch2/catch.hpp>
+#include "../TrackFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+
+namespace {
+
+    // Roads crossed by grass, with checkpoints of several levels and rows of road longer than a run
+    TrackGrid makeTestGrid(unsigned int a_columnsCount, unsigned int a_rowsCount)
+    {
+        TrackGrid l_grid;
+        l_grid.columnsCount = a_columnsCount;
+        l_grid.rowsCount = a_rowsCount;
+        l_grid.cellWidth = 12.f;
+        l_grid.cellHeight = 8.f;
+        l_grid.roads.resize((size_t) a_columnsCount*a_rowsCount);
+        l_grid.checkpointLevels.resize(l_grid.roads.size());
+        for (auto l_rowIndex = 0u; l_rowIndex < a_rowsCount; ++l_rowIndex)
+        {
+            for (auto l_colIndex = 0u; l_colIndex < a_columnsCount; ++l_colIndex)
+            {
+                const auto l_cellIndex = l_colIndex + (size_t) l_rowIndex*a_columnsCount;
+                l_grid.roads[l_cellIndex] = l_rowIndex % 4 == 1 || (l_colIndex*7 + l_rowIndex*3) % 5 < 2 ? 1 : 0;
+                if (l_grid.roads[l_cellIndex] != 0 && l_colIndex % 50 == 10)
+                    l_grid.checkpointLevels[l_cellIndex] = (std::uint16_t) (1 + l_colIndex / 50);
+            }
+        }
+        l_grid.isStartPointDefined = true;
+        l_grid.startX = 30.f;
+        l_grid.startY = 12.f;
+        l_grid.checkpointsCount = 1 + (a_columnsCount - 11) / 50;
+        return l_grid;
+    }
+
+    // Draws a checkpoint of the given level over the cells of the region
+    void drawCheckpoint(TrackGrid& a_grid, const TrackRegion& a_region, std::uint16_t a_checkpointLevel)
+    {
+        for (auto l_rowIndex = a_region.firstRowIndex; l_rowIndex < a_region.lastRowIndex; ++l_rowIndex)
+        {
+            for (auto l_colIndex = a_region.firstColIndex; l_colIndex < a_region.lastColIndex; ++l_colIndex)
+            {
+                a_grid.roads[l_colIndex + (size_t) l_rowIndex*a_grid.columnsCount] = 1;
+                a_grid.checkpointLevels[l_colIndex + (size_t) l_rowIndex*a_grid.columnsCount] = a_checkpointLevel;
+            }
+        }
+        a_grid.checkpointsCount = std::max(a_grid.checkpointsCount, (unsigned int) a_checkpointLevel);
+    }
+
+    bool areSameGrids(const TrackGrid& a_left, const TrackGrid& a_right)
+    {
+        return a_left.columnsCount == a_right.columnsCount && a_left.rowsCount == a_right.rowsCount &&
+            a_left.cellWidth == a_right.cellWidth && a_left.cellHeight == a_right.cellHeight &&
+            a_left.isStartPointDefined == a_right.isStartPointDefined && a_left.startX == a_right.startX && a_left.startY == a_right.startY &&
+            a_left.checkpointsCount == a_right.checkpointsCount &&
+            a_left.roads == a_right.roads && a_left.checkpointLevels == a_right.checkpointLevels;
+    }
+
+    std::vector<char> readBytes(const stdnext::filesystem::path& a_path)
+    {
+        std::ifstream l_file(a_path.string(), std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(l_file), std::istreambuf_iterator<char>());
+    }
+
+    void writeBytes(const stdnext::filesystem::path& a_path, const std::vector<char>& a_bytes)
+    {
+        std::ofstream l_file(a_path.string(), std::ios::binary | std::ios::trunc);
+        l_file.write(a_bytes.data(), (std::streamsize) a_bytes.size());
+    }
+
+    // Track file in the temporary directory, removed with its temporary copy at the end of the test
+    struct TemporaryTrackFile
+    {
+        TemporaryTrackFile()
+        {
+            remove();
+        }
+
+        ~TemporaryTrackFile()
+        {
+            remove();
+        }
+
+        void remove() const
+        {
+            auto l_temporaryPath = path;
+            l_temporaryPath += ".tmp";
+            stdnext::error_code l_error;
+            stdnext::filesystem::remove(path, l_error);
+            stdnext::filesystem::remove(l_temporaryPath, l_error);
+        }
+
+        const stdnext::filesystem::path path{ stdnext::filesystem::temp_directory_path() / "circuit_test.ctrk" };
+    };
+
+}
+
+
+TEST_CASE("Track file")
+{
+    const TemporaryTrackFile l_file;
+    auto l_grid = makeTestGrid(300, 40);
+    const auto l_rowsOffset = sizeof(TrackFileHeader) + (l_grid.rowsCount + 1)*sizeof(std::uint64_t);
+    TrackGrid l_loadedGrid;
+    auto l_loadedPatchesCount = 1000u;
+
+    SECTION("When saving then loading")
+    {
+        REQUIRE(saveTrackFile(l_file.path, l_grid));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+        REQUIRE(l_loadedPatchesCount == 0);
+
+        // Saving again replaces the file
+        drawCheckpoint(l_grid, { 0, 0, 300, 40 }, 3);
+        REQUIRE(saveTrackFile(l_file.path, l_grid));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+        REQUIRE(stdnext::filesystem::file_size(l_file.path) == l_rowsOffset + 40*4);
+    }
+
+    SECTION("When loading a large grid by several threads")
+    {
+        l_grid = makeTestGrid(1100, 1000);
+        REQUIRE(saveTrackFile(l_file.path, l_grid));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount, 4));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount, 1));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+    }
+
+    SECTION("When appending patches")
+    {
+        REQUIRE(saveTrackFile(l_file.path, l_grid));
+        const auto l_savedFileSize = stdnext::filesystem::file_size(l_file.path);
+
+        drawCheckpoint(l_grid, { 20, 5, 30, 15 }, 7);
+        REQUIRE(appendTrackPatch(l_file.path, l_grid, { 20, 5, 30, 15 }));
+        drawCheckpoint(l_grid, { 290, 35, 300, 40 }, 8);
+        REQUIRE(appendTrackPatch(l_file.path, l_grid, { 290, 35, 310, 50 })); // clipped to the grid
+        l_grid.startX = 100.f;
+        l_grid.startY = 200.f;
+        REQUIRE(appendTrackPatch(l_file.path, l_grid, { 0, 0, 0, 0 }));
+
+        REQUIRE(stdnext::filesystem::file_size(l_file.path) > l_savedFileSize + 3*sizeof(TrackPatchHeader));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+        REQUIRE(l_loadedPatchesCount == 3);
+
+        // Patches apply only to a file of a grid of the same size
+        REQUIRE(!appendTrackPatch(l_file.path, makeTestGrid(200, 40), { 0, 0, 1, 1 }));
+        REQUIRE(!appendTrackPatch(l_file.path.parent_path() / "circuit_test_missing.ctrk", l_grid, { 0, 0, 1, 1 }));
+    }
+
+    SECTION("When autosaving")
+    {
+        // The file is written whole when there is none yet
+        auto l_patchesCount = 0u;
+        REQUIRE(autosaveTrackFile(l_file.path, l_grid, { 0, 0, 300, 40 }, l_patchesCount));
+        REQUIRE(l_patchesCount == 0);
+        const auto l_savedFileSize = stdnext::filesystem::file_size(l_file.path);
+
+        for (auto l_autosaveIndex = 0u; l_autosaveIndex < MaxTrackPatchesCount; ++l_autosaveIndex)
+        {
+            const TrackRegion l_region{ l_autosaveIndex, l_autosaveIndex % 40, l_autosaveIndex + 1, l_autosaveIndex % 40 + 1 };
+            drawCheckpoint(l_grid, l_region, 9);
+            REQUIRE(autosaveTrackFile(l_file.path, l_grid, l_region, l_patchesCount));
+            REQUIRE(l_patchesCount == l_autosaveIndex + 1);
+        }
+        REQUIRE(stdnext::filesystem::file_size(l_file.path) == l_savedFileSize + MaxTrackPatchesCount*(sizeof(TrackPatchHeader) + 2));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+        REQUIRE(l_loadedPatchesCount == MaxTrackPatchesCount);
+
+        // Then rewritten whole, without the patches, once they pile up
+        drawCheckpoint(l_grid, { 150, 0, 151, 40 }, 9);
+        REQUIRE(autosaveTrackFile(l_file.path, l_grid, { 150, 0, 151, 40 }, l_patchesCount));
+        REQUIRE(l_patchesCount == 0);
+        const auto l_rewrittenFileSize = stdnext::filesystem::file_size(l_file.path);
+        REQUIRE(l_rewrittenFileSize < l_savedFileSize + MaxTrackPatchesCount*sizeof(TrackPatchHeader));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+        TrackFileHeader l_header{};
+        std::memcpy(&l_header, readBytes(l_file.path).data(), sizeof(l_header));
+        REQUIRE(l_rewrittenFileSize == l_rowsOffset + l_header.rowsSize);
+
+        // Then patched again
+        drawCheckpoint(l_grid, { 0, 0, 1, 1 }, 9);
+        REQUIRE(autosaveTrackFile(l_file.path, l_grid, { 0, 0, 1, 1 }, l_patchesCount));
+        REQUIRE(l_patchesCount == 1);
+        REQUIRE(stdnext::filesystem::file_size(l_file.path) == l_rewrittenFileSize + sizeof(TrackPatchHeader) + 2);
+
+        // A later session goes on from the patches already in the file
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(l_loadedPatchesCount == 1);
+    }
+
+    SECTION("When autosaving from the cells of a track")
+    {
+        // Patches encoded from another storage of the cells are the same as those of the grid
+        REQUIRE(saveTrackFile(l_file.path, l_grid));
+        drawCheckpoint(l_grid, { 20, 5, 30, 15 }, 7);
+        const auto l_makePatch = [&]
+        {
+            TrackPatch l_patch;
+            l_patch.gridColumnsCount = l_grid.columnsCount;
+            l_patch.gridRowsCount = l_grid.rowsCount;
+            l_patch.isStartPointDefined = l_grid.isStartPointDefined;
+            l_patch.startX = l_grid.startX;
+            l_patch.startY = l_grid.startY;
+            l_patch.checkpointsCount = l_grid.checkpointsCount;
+            encodeTrackPatchRows(l_patch, { 20, 5, 30, 15 }, [&](size_t a_cellIndex) { return toTrackCellValue(l_grid.roads[a_cellIndex] != 0, l_grid.checkpointLevels[a_cellIndex]); });
+            return l_patch;
+        };
+        auto l_isGridNeeded = false;
+        const auto l_getGrid = [&]() -> const TrackGrid&
+        {
+            l_isGridNeeded = true;
+            return l_grid;
+        };
+        REQUIRE(l_makePatch().rows == makeTrackPatch(l_grid, { 20, 5, 30, 15 }).rows);
+        auto l_patchesCount = 0u;
+        REQUIRE(autosaveTrackFile(l_file.path, l_makePatch, l_getGrid, l_patchesCount));
+        REQUIRE(!l_isGridNeeded);
+        REQUIRE(l_patchesCount == 1);
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+    }
+
+    SECTION("When the start point is not defined")
+    {
+        // It stays undefined, instead of becoming the first cell
+        l_grid.isStartPointDefined = false;
+        l_grid.startX = 0.f;
+        l_grid.startY = 0.f;
+        REQUIRE(saveTrackFile(l_file.path, l_grid));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(!l_loadedGrid.isStartPointDefined);
+
+        // Then defined, then undefined again, by patches
+        l_grid.isStartPointDefined = true;
+        REQUIRE(appendTrackPatch(l_file.path, l_grid, { 0, 0, 0, 0 }));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(l_loadedGrid.isStartPointDefined);
+        l_grid.isStartPointDefined = false;
+        REQUIRE(appendTrackPatch(l_file.path, l_grid, { 0, 0, 0, 0 }));
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+        REQUIRE(!l_loadedGrid.isStartPointDefined);
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+    }
+
+    SECTION("When the file is truncated or corrupt")
+    {
+        REQUIRE(saveTrackFile(l_file.path, l_grid));
+        const auto l_savedFileSize = (size_t) stdnext::filesystem::file_size(l_file.path);
+        drawCheckpoint(l_grid, { 20, 5, 30, 15 }, 7);
+        REQUIRE(appendTrackPatch(l_file.path, l_grid, { 20, 5, 30, 15 }));
+        const auto l_bytes = readBytes(l_file.path);
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_loadedPatchesCount));
+
+        // A failed load leaves the grid and the patches count as they were
+        const auto l_isRejected = [&](const std::vector<char>& a_bytes)
+        {
+            writeBytes(l_file.path, a_bytes);
+            auto l_untouchedGrid = makeTestGrid(100, 10);
+            auto l_untouchedPatchesCount = 1000u;
+            return !loadTrackFile(l_file.path, l_untouchedGrid, l_untouchedPatchesCount) && areSameGrids(l_untouchedGrid, makeTestGrid(100, 10)) &&
+                l_untouchedPatchesCount == 1000;
+        };
+
+        for (const auto l_size : { (size_t) 0, (size_t) 20, sizeof(TrackFileHeader), l_rowsOffset - 4, l_rowsOffset + 10, l_savedFileSize - 1,
+                                   l_savedFileSize + 10, l_savedFileSize + sizeof(TrackPatchHeader), l_bytes.size() - 1 })
+        {
+            INFO("Truncated to " << l_size << " bytes");
+            REQUIRE(l_isRejected(std::vector<char>(l_bytes.begin(), l_bytes.begin() + (std::ptrdiff_t) l_size)));
+        }
+
+        // Garbage appended after the patches
+        auto l_corruptBytes = l_bytes;
+        l_corruptBytes.insert(l_corruptBytes.end(), 50, 'x');
+        REQUIRE(l_isRejected(l_corruptBytes));
+
+        // Magic and version
+        l_corruptBytes = l_bytes;
+        l_corruptBytes[0] = 'X';
+        REQUIRE(l_isRejected(l_corruptBytes));
+        l_corruptBytes = l_bytes;
+        l_corruptBytes[4] = (char) (TrackFileVersion + 1);
+        REQUIRE(l_isRejected(l_corruptBytes));
+
+        // Run of no cells, at the start of the rows
+        l_corruptBytes = l_bytes;
+        l_corruptBytes[l_rowsOffset] = 0;
+        REQUIRE(l_isRejected(l_corruptBytes));
+
+        // Offset of a row past the end of the rows
+        l_corruptBytes = l_bytes;
+        l_corruptBytes[sizeof(TrackFileHeader) + 8 + 7] = (char) 0x7f;
+        REQUIRE(l_isRejected(l_corruptBytes));
+
+        // Patch of cells outside the grid
+        l_corruptBytes = l_bytes;
+        const std::uint32_t l_firstColIndex = 295;
+        std::memcpy(l_corruptBytes.data() + l_savedFileSize + 4, &l_firstColIndex, sizeof(l_firstColIndex));
+        REQUIRE(l_isRejected(l_corruptBytes));
+
+        // Patch magic
+        l_corruptBytes = l_bytes;
+        l_corruptBytes[l_savedFileSize] = 'X';
+        REQUIRE(l_isRejected(l_corruptBytes));
+
+        // The next autosave rewrites the file whole rather than appending to patches which cannot be loaded
+        auto l_patchesCount = 0u;
+        REQUIRE(!loadTrackFile(l_file.path, l_loadedGrid, l_patchesCount));
+        l_patchesCount = MaxTrackPatchesCount;
+        REQUIRE(autosaveTrackFile(l_file.path, l_grid, { 0, 0, 1, 1 }, l_patchesCount));
+        REQUIRE(l_patchesCount == 0);
+        REQUIRE(loadTrackFile(l_file.path, l_loadedGrid, l_patchesCount));
+        REQUIRE(areSameGrids(l_loadedGrid, l_grid));
+    }
+}
@@ -3,10 +3,19 @@
 
 
 #include <platform/filesystem.hpp>
+#include <platform/mapped_file.hpp>
+#include <platform/system_error.hpp>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <ctime>
+#include <thread>
 #include <vector>
 #include <iostream>
 
@@ -51,14 +60,14 @@ namespace delaysubtitles {
         int m_milliseconds = 0;
     };
 
-    static Time parseTime(const std::string& timeString)
+    inline Time parseTime(const std::string& timeString)
     {
         Time time;
         string_scanf(timeString, "%d:%d:%d,%d", &time.m_hours, &time.m_minutes, &time.m_seconds, &time.m_milliseconds);
         return time;
     }
 
-    static std::string formatTime(const Time& time)
+    inline std::string formatTime(const Time& time)
     {
         std::string timeString;
         string_printf(timeString, "%02d:%02d:%02d,%03d", time.m_hours, time.m_minutes, time.m_seconds, time.m_milliseconds);
@@ -66,7 +75,7 @@ namespace delaysubtitles {
         return timeString;
     }
 
-    static void delayTime(Time& time, const std::chrono::milliseconds& delay)
+    inline void delayTime(Time& time, const std::chrono::milliseconds& delay)
     {
         auto chrono = std::chrono::hours(time.m_hours) + std::chrono::minutes(time.m_minutes) + std::chrono::seconds(time.m_seconds) + std::chrono::milliseconds(time.m_milliseconds);
         chrono += delay;
@@ -81,14 +90,14 @@ namespace delaysubtitles {
         time.m_milliseconds = (int)std::chrono::duration_cast<std::chrono::milliseconds>(chrono).count();
     }
 
-    static void delayTime(std::string& timeString, const std::chrono::milliseconds& delay)
+    inline void delayTime(std::string& timeString, const std::chrono::milliseconds& delay)
     {
         auto time = parseTime(timeString);
         delayTime(time, delay);
         timeString = formatTime(time);
     }
 
-    static void delayLine(std::string& line, const std::chrono::milliseconds& delay)
+    inline void delayLine(std::string& line, const std::chrono::milliseconds& delay)
     {
         const auto arrowPos = line.find(" --> ");
         if (arrowPos == std::string::npos)
@@ -102,7 +111,7 @@ namespace delaysubtitles {
         line += stopTimeString;
     }
 
-    static void delaySubTitles(
+    inline void delaySubTitles(
         const std::chrono::milliseconds& delay,
         const fs::path& sourcePath,
         fs::path targetPath
@@ -153,4 +162,221 @@ namespace delaysubtitles {
         }
     }
 
+    // Maps time t to factor * t + offset: a plain delay, or a drift correction from two synchronization points
+    class Retiming
+    {
+    public:
+        explicit Retiming(const std::chrono::milliseconds& delay)
+            : m_offset(static_cast<double>(delay.count()))
+        {
+        }
+
+        // The subtitle shown at from1 must be shown at to1, the one shown at from2 at to2
+        Retiming(const std::chrono::milliseconds& from1, const std::chrono::milliseconds& to1, const std::chrono::milliseconds& from2, const std::chrono::milliseconds& to2)
+        {
+            if (from1 != from2)
+                m_factor = static_cast<double>((to2 - to1).count()) / static_cast<double>((from2 - from1).count());
+            m_offset = static_cast<double>(to1.count()) - m_factor * static_cast<double>(from1.count());
+        }
+
+        long long apply(long long milliseconds) const
+        {
+            return std::llround(m_factor * static_cast<double>(milliseconds) + m_offset);
+        }
+
+    private:
+        double m_factor = 1.;
+        double m_offset = 0.;
+    };
+
+    constexpr std::size_t timestampLength = 12; // HH:MM:SS,mmm
+
+    inline bool parseDigits(const char* text, int count, int& value)
+    {
+        value = 0;
+        for (int index = 0; index < count; ++index)
+        {
+            const auto digit = text[index] - '0';
+            if (digit < 0 || digit > 9)
+                return false;
+            value = value * 10 + digit;
+        }
+        return true;
+    }
+
+    // Parses exactly HH:MM:SS,mmm (or HH:MM:SS.mmm)
+    inline bool parseTimestamp(const char* text, long long& milliseconds)
+    {
+        int hours = 0, minutes = 0, seconds = 0, millis = 0;
+        if (!parseDigits(text, 2, hours) || text[2] != ':' || !parseDigits(text + 3, 2, minutes) || text[5] != ':' ||
+            !parseDigits(text + 6, 2, seconds) || (text[8] != ',' && text[8] != '.') || !parseDigits(text + 9, 3, millis))
+            return false;
+        milliseconds = ((hours * 60LL + minutes) * 60LL + seconds) * 1000LL + millis;
+        return true;
+    }
+
+    inline std::chrono::milliseconds parseTimestamp(const std::string& text)
+    {
+        long long milliseconds = 0;
+        if (text.length() != timestampLength || !parseTimestamp(text.c_str(), milliseconds))
+            throw std::invalid_argument("invalid timestamp '" + text + "', expected HH:MM:SS,mmm");
+        return std::chrono::milliseconds(milliseconds);
+    }
+
+    // Parses a whole number of milliseconds, which may be negative
+    inline std::chrono::milliseconds parseDelay(const std::string& text)
+    {
+        long long milliseconds = 0;
+        const auto result = std::from_chars(text.data(), text.data() + text.size(), milliseconds);
+        if (text.empty() || result.ec != std::errc() || result.ptr != text.data() + text.size())
+            throw std::invalid_argument("invalid delay '" + text + "', expected milliseconds");
+        return std::chrono::milliseconds(milliseconds);
+    }
+
+    // Writes exactly 12 characters, saturating at 99:59:59,999
+    inline void formatTimestamp(long long milliseconds, char* text)
+    {
+        milliseconds = std::min(milliseconds, 100LL * 3600 * 1000 - 1);
+        const auto writeDigits = [](char* digits, int count, long long value)
+        {
+            for (int index = count - 1; index >= 0; --index, value /= 10)
+                digits[index] = static_cast<char>('0' + value % 10);
+        };
+        writeDigits(text, 2, milliseconds / 3600000);
+        text[2] = ':';
+        writeDigits(text + 3, 2, milliseconds / 60000 % 60);
+        text[5] = ':';
+        writeDigits(text + 6, 2, milliseconds / 1000 % 60);
+        text[8] = ',';
+        writeDigits(text + 9, 3, milliseconds % 1000);
+    }
+
+    // Re-times the "start --> stop" lines of an srt content; other lines, line endings and anything after the stop
+    // timestamp are kept as is. Like delayTime, a timestamp that would become negative is left unchanged.
+    inline void retimeSubTitles(std::string_view source, const Retiming& retiming, std::string& target)
+    {
+        static constexpr std::string_view arrow = " --> ";
+        target.assign(source.data(), source.size());
+        std::size_t lineBegin = 0;
+        while (lineBegin < target.size())
+        {
+            const auto lineEndPointer = static_cast<const char*>(std::memchr(target.data() + lineBegin, '\n', target.size() - lineBegin));
+            const auto lineEnd = lineEndPointer ? static_cast<std::size_t>(lineEndPointer - target.data()) : target.size();
+            auto start = lineBegin;
+            while (start < lineEnd && (target[start] == ' ' || target[start] == '\t'))
+                ++start;
+            const auto stop = start + timestampLength + arrow.size();
+            long long startTime = 0, stopTime = 0;
+            if (stop + timestampLength <= lineEnd && std::string_view(target.data() + start + timestampLength, arrow.size()) == arrow &&
+                parseTimestamp(target.data() + start, startTime) && parseTimestamp(target.data() + stop, stopTime))
+            {
+                const auto newStartTime = retiming.apply(startTime);
+                const auto newStopTime = retiming.apply(stopTime);
+                if (newStartTime >= 0)
+                    formatTimestamp(newStartTime, &target[start]);
+                if (newStopTime >= 0)
+                    formatTimestamp(newStopTime, &target[stop]);
+            }
+            lineBegin = lineEnd + 1;
+        }
+    }
+
+    inline fs::path delayedPath(const fs::path& sourcePath)
+    {
+        auto targetPath = sourcePath;
+        targetPath.replace_extension(".delayed" + sourcePath.extension().string());
+        return targetPath;
+    }
+
+    // Lists the .srt files of the directory tree, except the .delayed.srt ones; the directories that cannot be read
+    // are reported and skipped. Returns false when some could not be read.
+    inline bool findSubTitlesFiles(const fs::path& sourcePath, std::vector<fs::path>& sourceFilesPaths)
+    {
+        stdnext::error_code error;
+        fs::recursive_directory_iterator iter(sourcePath, fs::directory_options::skip_permission_denied, error);
+        if (error)
+        {
+            std::cout << "Could not read the directory '" << sourcePath.string() << "': " << error.message() << "\n";
+            return false;
+        }
+        auto isComplete = true;
+        for (const fs::recursive_directory_iterator iterEnd; iter != iterEnd;)
+        {
+            const auto& path = iter->path();
+            if (fs::is_regular_file(iter->status(error)) && path.extension() == ".srt" && path.stem().extension() != ".delayed")
+                sourceFilesPaths.push_back(path);
+            iter.increment(error);
+            if (error && iter != iterEnd)
+            {
+                // Steps over the directory which could not be opened, then gives up if the listing still fails
+                std::cout << "Could not read the directory '" << iter->path().string() << "': " << error.message() << "\n";
+                isComplete = false;
+                iter.disable_recursion_pending();
+                iter.increment(error);
+            }
+            if (error)
+            {
+                std::cout << "Could not list the directory tree '" << sourcePath.string() << "': " << error.message() << "\n";
+                return false;
+            }
+        }
+        return isComplete;
+    }
+
+    // Re-times every .srt file of the directory tree in parallel, each written next to its source as .delayed.srt.
+    // Returns false when a directory or a file could not be read, or a file could not be written.
+    inline bool retimeSubTitlesTree(
+        const Retiming& retiming,
+        const fs::path& sourcePath,
+        unsigned threadsCount = std::thread::hardware_concurrency()
+        )
+    {
+        std::vector<fs::path> sourceFilesPaths;
+        const auto isListed = findSubTitlesFiles(sourcePath, sourceFilesPaths);
+        std::cout << "Found " << sourceFilesPaths.size() << " srt file in directory tree '" << sourcePath << "'\n";
+
+        const auto start = std::chrono::steady_clock::now();
+        std::atomic<std::size_t> nextFileIndex{0};
+        std::atomic<std::size_t> failedFilesCount{0};
+        std::atomic<std::uint64_t> bytesCount{0};
+        std::vector<std::thread> threads;
+        for (unsigned threadIndex = 0; threadIndex < std::max(1U, threadsCount); ++threadIndex)
+        {
+            threads.emplace_back([&]
+            {
+                std::string target;
+                for (auto fileIndex = nextFileIndex++; fileIndex < sourceFilesPaths.size(); fileIndex = nextFileIndex++)
+                {
+                    const auto& sourceFilePath = sourceFilesPaths[fileIndex];
+                    const platform::mapped_file sourceFile(sourceFilePath);
+                    std::ofstream targetFile(delayedPath(sourceFilePath).string(), std::ios::binary);
+                    if (!sourceFile.is_open() || !targetFile)
+                    {
+                        ++failedFilesCount;
+                        continue;
+                    }
+                    retimeSubTitles(sourceFile.view(), retiming, target);
+                    targetFile.write(target.data(), static_cast<std::streamsize>(target.size()));
+                    targetFile.close();
+                    if (!targetFile)
+                    {
+                        std::cout << "Could not write the subtitle file '" << delayedPath(sourceFilePath).string() << "'\n";
+                        ++failedFilesCount;
+                        continue;
+                    }
+                    bytesCount += target.size();
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const auto filesCount = sourceFilesPaths.size() - failedFilesCount;
+        std::cout << "Re-timed " << filesCount << " files (" << failedFilesCount << " failed) in " << seconds << " s: "
+                  << (seconds > 0 ? static_cast<double>(filesCount) / seconds : 0.) << " files/s, "
+                  << (seconds > 0 ? static_cast<double>(bytesCount) / (1024. * 1024.) / seconds : 0.) << " MB/s\n";
+        return isListed && failedFilesCount == 0;
+    }
+
 } // namespace delaysubtitles
@@ -1,21 +1,68 @@
 
 #include "delaysubtitles.hpp"
+#include <charconv>
+#include <stdexcept>
 #include <string>
 
 
 int main(int argc, char* argv[])
 {
+    const std::string mode = argc >= 2 ? argv[1] : "";
+    const auto threadsCount = [&](int threadsArgIndex)
+    {
+        if (argc <= threadsArgIndex)
+            return std::thread::hardware_concurrency();
+        const std::string text = argv[threadsArgIndex];
+        unsigned count = 0;
+        const auto result = std::from_chars(text.data(), text.data() + text.size(), count);
+        if (result.ec != std::errc() || result.ptr != text.data() + text.size() || count == 0)
+            throw std::invalid_argument("invalid threads count '" + text + "'");
+        return count;
+    };
+    try
+    {
+        if (mode == "--batch" && argc >= 4)
+        {
+            const delaysubtitles::Retiming retiming(delaysubtitles::parseDelay(argv[2]));
+            return delaysubtitles::retimeSubTitlesTree(retiming, argv[3], threadsCount(4)) ? 0 : 1;
+        }
+        if (mode == "--batch-sync" && argc >= 7)
+        {
+            const delaysubtitles::Retiming retiming(
+                delaysubtitles::parseTimestamp(argv[2]), delaysubtitles::parseTimestamp(argv[3]),
+                delaysubtitles::parseTimestamp(argv[4]), delaysubtitles::parseTimestamp(argv[5]));
+            return delaysubtitles::retimeSubTitlesTree(retiming, argv[6], threadsCount(7)) ? 0 : 1;
+        }
+    }
+    catch (const std::invalid_argument& error)
+    {
+        std::cout << error.what() << "\n";
+        return 1;
+    }
+
     if (argc < 3)
     {
-        std::cout << "Usage:\nDelaySubTitles Delay DirectoryOrSubTitlesFileName [NewFileName]\n";
+        std::cout << "Usage:\nDelaySubTitles Delay DirectoryOrSubTitlesFileName [NewFileName]\n"
+                     "DelaySubTitles --batch Delay DirectoryTree [ThreadsCount]\n"
+                     "DelaySubTitles --batch-sync From1 To1 From2 To2 DirectoryTree [ThreadsCount]\n"
+                     "    (the subtitles shown at From1 are moved to To1, those at From2 to To2, times as HH:MM:SS,mmm)\n";
         return 1;
     }
 
-    const auto delay = std::stoi(argv[1]);
+    std::chrono::milliseconds delay{};
+    try
+    {
+        delay = delaysubtitles::parseDelay(argv[1]);
+    }
+    catch (const std::invalid_argument& error)
+    {
+        std::cout << error.what() << "\n";
+        return 1;
+    }
     const auto* const sourcePath = argv[2];
     const auto* const targetPath = (argc >= 4) ? argv[3] : "";
 
-    delaysubtitles::delaySubTitles(std::chrono::milliseconds(delay), sourcePath, targetPath);
+    delaysubtitles::delaySubTitles(delay, sourcePath, targetPath);
 
     return 0;
 }
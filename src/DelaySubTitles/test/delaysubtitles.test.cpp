@@ -0,0 +1,168 @@
+#include <catch2/catch.hpp>
+#include "../delaysubtitles.hpp"
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+namespace ds = delaysubtitles;
+
+namespace {
+
+    std::string retime(const std::string& source, const ds::Retiming& retiming)
+    {
+        std::string target;
+        ds::retimeSubTitles(source, retiming, target);
+        return target;
+    }
+
+    std::string formatTimestamp(long long milliseconds)
+    {
+        std::string text(ds::timestampLength, ' ');
+        ds::formatTimestamp(milliseconds, &text[0]);
+        return text;
+    }
+
+    std::string readFile(const ds::fs::path& path)
+    {
+        std::ifstream file(path.string(), std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const ds::fs::path& path, const std::string& content)
+    {
+        std::ofstream(path.string(), std::ios::binary) << content;
+    }
+
+    // Directory of its own in the temporary directory, removed at the end of the test
+    struct TemporaryDirectory
+    {
+        TemporaryDirectory()
+        {
+            ds::fs::create_directories(path);
+        }
+
+        ~TemporaryDirectory()
+        {
+            stdnext::error_code error;
+            ds::fs::remove_all(path, error);
+        }
+
+        const ds::fs::path path{ds::fs::temp_directory_path() / ("delaysubtitles_test_" + std::to_string(std::random_device{}()))};
+    };
+
+} // namespace
+
+TEST_CASE("parseTimestamp")
+{
+    REQUIRE(ds::parseTimestamp("01:02:03,004") == std::chrono::milliseconds(3723004));
+    REQUIRE(ds::parseTimestamp("01:02:03.004") == std::chrono::milliseconds(3723004));
+    REQUIRE(ds::parseTimestamp("99:59:59,999") == std::chrono::milliseconds(359999999));
+    REQUIRE_THROWS_AS(ds::parseTimestamp("1:02:03,004"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ds::parseTimestamp("01:02:03,0045"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ds::parseTimestamp("01:02:03;004"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ds::parseTimestamp("01:0a:03,004"), std::invalid_argument);
+}
+
+TEST_CASE("parseDelay")
+{
+    REQUIRE(ds::parseDelay("1500") == std::chrono::milliseconds(1500));
+    REQUIRE(ds::parseDelay("-250") == std::chrono::milliseconds(-250));
+    REQUIRE_THROWS_AS(ds::parseDelay(""), std::invalid_argument);
+    REQUIRE_THROWS_AS(ds::parseDelay("12a"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ds::parseDelay("99999999999999999999"), std::invalid_argument);
+}
+
+TEST_CASE("formatTimestamp")
+{
+    REQUIRE(formatTimestamp(0) == "00:00:00,000");
+    REQUIRE(formatTimestamp(3723004) == "01:02:03,004");
+    REQUIRE(formatTimestamp(359999999) == "99:59:59,999");
+    REQUIRE(formatTimestamp(360000000) == "99:59:59,999");
+    REQUIRE(formatTimestamp(1000LL * 360000000) == "99:59:59,999");
+}
+
+TEST_CASE("retimeSubTitles")
+{
+    SECTION("When delaying")
+    {
+        const ds::Retiming retiming(std::chrono::milliseconds(1500));
+
+        // Line endings and indentation are kept, as well as what follows the stop timestamp
+        REQUIRE(retime("1\r\n00:00:01,000 --> 00:00:02,500\r\nHello\r\n\r\n2\r\n  \t00:01:00,000 --> 00:01:02,000 X1:10\r\nWorld\r\n", retiming) ==
+                "1\r\n00:00:02,500 --> 00:00:04,000\r\nHello\r\n\r\n2\r\n  \t00:01:01,500 --> 00:01:03,500 X1:10\r\nWorld\r\n");
+        REQUIRE(retime("1\n00:00:01,000 --> 00:00:02,500", retiming) == "1\n00:00:02,500 --> 00:00:04,000");
+
+        // Lines which are not exactly "start --> stop" are kept as is
+        for (const auto line : {"00:00:01,000 -> 00:00:02,500\n", "0:00:01,000 --> 00:00:02,500\n", "00:00:01,000 --> 00:00:02\n", "x 00:00:01,000 --> 00:00:02,500\n"})
+        {
+            INFO(line);
+            REQUIRE(retime(line, retiming) == line);
+        }
+    }
+
+    SECTION("When a time would become negative")
+    {
+        const ds::Retiming retiming(std::chrono::milliseconds(-1500));
+        REQUIRE(retime("00:00:01,000 --> 00:00:02,500\n00:00:03,000 --> 00:00:04,000\n", retiming) ==
+                "00:00:01,000 --> 00:00:01,000\n00:00:01,500 --> 00:00:02,500\n");
+    }
+
+    SECTION("When a time would pass 99:59:59,999")
+    {
+        const ds::Retiming retiming(std::chrono::hours(1));
+        REQUIRE(retime("98:00:00,000 --> 99:30:00,000\r\n", retiming) == "99:00:00,000 --> 99:59:59,999\r\n");
+    }
+
+    SECTION("When correcting a drift from two points")
+    {
+        // 1 s late at the start, then 1 ms more late every second
+        const ds::Retiming retiming(std::chrono::milliseconds(0), std::chrono::milliseconds(1000),
+                                    std::chrono::seconds(1000), std::chrono::milliseconds(1002000));
+        REQUIRE(retiming.apply(0) == 1000);
+        REQUIRE(retiming.apply(500000) == 501500);
+        REQUIRE(retiming.apply(2000000) == 2003000);
+        REQUIRE(retime("00:08:20,000 --> 00:16:40,000\n", retiming) == "00:08:21,500 --> 00:16:42,000\n");
+
+        // The same point twice is a plain delay
+        const ds::Retiming delay(std::chrono::seconds(10), std::chrono::seconds(12), std::chrono::seconds(10), std::chrono::seconds(12));
+        REQUIRE(delay.apply(60000) == 62000);
+    }
+}
+
+TEST_CASE("retimeSubTitlesTree")
+{
+    const TemporaryDirectory directory;
+    const auto& root = directory.path;
+    ds::fs::create_directories(root / "season 1");
+    writeFile(root / "a.srt", "1\r\n00:00:01,000 --> 00:00:02,000\r\nA\r\n");
+    writeFile(root / "season 1" / "b.srt", "1\n00:00:03,000 --> 00:00:04,000\nB\n");
+    writeFile(root / "c.delayed.srt", "1\n00:00:05,000 --> 00:00:06,000\nC\n");
+    writeFile(root / "d.txt", "00:00:07,000 --> 00:00:08,000\n");
+    const ds::Retiming retiming(std::chrono::milliseconds(500));
+
+    SECTION("When all the files are written")
+    {
+        REQUIRE(ds::retimeSubTitlesTree(retiming, root, 2));
+        REQUIRE(readFile(root / "a.delayed.srt") == "1\r\n00:00:01,500 --> 00:00:02,500\r\nA\r\n");
+        REQUIRE(readFile(root / "season 1" / "b.delayed.srt") == "1\n00:00:03,500 --> 00:00:04,500\nB\n");
+        REQUIRE(!ds::fs::exists(root / "c.delayed.delayed.srt"));
+        REQUIRE(!ds::fs::exists(root / "d.delayed.txt"));
+    }
+
+    SECTION("When a file cannot be written")
+    {
+        writeFile(root / "e.srt", "1\n00:00:01,000 --> 00:00:02,000\nE\n");
+        ds::fs::create_directories(root / "e.delayed.srt");
+
+        // The other files are still written
+        REQUIRE(!ds::retimeSubTitlesTree(retiming, root, 2));
+        REQUIRE(readFile(root / "a.delayed.srt") == "1\r\n00:00:01,500 --> 00:00:02,500\r\nA\r\n");
+        REQUIRE(ds::fs::exists(root / "season 1" / "b.delayed.srt"));
+    }
+
+    SECTION("When the directory does not exist")
+    {
+        REQUIRE(!ds::retimeSubTitlesTree(retiming, root / "missing", 2));
+    }
+}
@@ -18,12 +18,32 @@ namespace ejson { namespace detail {
         return stdnext::make_optional(json.int_value());
     }
 
+    inline stdnext::optional<double> fromJson(const json11::Json& json, ReturnOptionalTag, double*) {
+        if (!json.is_number())
+            return stdnext::nullopt;
+        return stdnext::make_optional(json.number_value());
+    }
+
     inline stdnext::optional<std::string> fromJson(const json11::Json& json, ReturnOptionalTag, std::string*) {
         if (!json.is_string())
             return stdnext::nullopt;
         return stdnext::make_optional(json.string_value());
     }
 
+    // The generic overloads are declared first, so that they can be found from the vector overload
+
+    template<typename T>
+    std::enable_if_t<
+        stdnext::is_detected_v<detail::staticMemberFromJsonOptionalExpr, T>,
+        stdnext::optional<T>>
+    fromJson(const json11::Json& json, ReturnOptionalTag tag, T*);
+
+    template<typename T>
+    std::enable_if_t<
+        !stdnext::is_detected_v<detail::staticMemberFromJsonOptionalExpr, T> && stdnext::is_constructible_v<T, const json11::Json&>,
+        stdnext::optional<T>>
+    fromJson(const json11::Json& json, ReturnOptionalTag tag, T*);
+
     template<typename T>
     inline stdnext::optional<std::vector<T>> fromJson(const json11::Json& json, ReturnOptionalTag, std::vector<T>*) {
         if (!json.is_array())
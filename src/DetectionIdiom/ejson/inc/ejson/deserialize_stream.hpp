@@ -0,0 +1,257 @@
+#pragma once
+
+#include "ejson/deserialize.hpp"
+#include "ejson/reader.hpp"
+#include "ejson/reflect.hpp"
+#include <vector>
+
+namespace ejson { namespace detail {
+
+    template<typename T>
+    struct IsStreamBuiltin : std::false_type {};
+
+    template<> struct IsStreamBuiltin<bool> : std::true_type {};
+    template<> struct IsStreamBuiltin<int> : std::true_type {};
+    template<> struct IsStreamBuiltin<double> : std::true_type {};
+    template<> struct IsStreamBuiltin<std::string> : std::true_type {};
+    template<typename T> struct IsStreamBuiltin<std::vector<T>> : std::true_type {};
+
+    template<typename T>
+    constexpr bool hasFromJsonReaderObject_v =
+        stdnext::is_detected_v<staticMemberFromJsonReaderObjectExpr, T> || stdnext::is_detected_v<freeStandingFromJsonReaderObjectExpr, T>
+        || stdnext::is_detected_v<objectDefinitionExpr, T>;
+
+    template<typename T>
+    constexpr bool hasFromJsonReaderOptional_v =
+        stdnext::is_detected_v<staticMemberFromJsonReaderOptionalExpr, T> || stdnext::is_detected_v<freeStandingFromJsonReaderOptionalExpr, T>;
+
+    /// Consumes the value starting at mark, after a failed attempt to deserialize it
+    inline void skipFrom(JsonReader& reader, const JsonReader::Mark& mark) {
+        reader.rewind(mark);
+        reader.skipValue();
+    }
+
+    // The generic overloads are declared first, so that they can be found from the vector overload
+
+    template<typename T>
+    stdnext::optional<std::vector<T>> fromJson(JsonReader& reader, ReturnOptionalTag, std::vector<T>*);
+
+    template<typename T>
+    std::enable_if_t<
+        stdnext::is_detected_v<staticMemberFromJsonReaderOptionalExpr, T>,
+        stdnext::optional<T>>
+    fromJson(JsonReader& reader, ReturnOptionalTag tag, T*);
+
+    template<typename T>
+    std::enable_if_t<
+        !stdnext::is_detected_v<staticMemberFromJsonReaderOptionalExpr, T> && hasFromJsonReaderObject_v<T>,
+        stdnext::optional<T>>
+    fromJson(JsonReader& reader, ReturnOptionalTag, T*);
+
+    template<typename T>
+    std::enable_if_t<
+        !hasFromJsonReaderOptional_v<T> && !hasFromJsonReaderObject_v<T> && !IsStreamBuiltin<T>::value,
+        stdnext::optional<T>>
+    fromJson(JsonReader& reader, ReturnOptionalTag, T*);
+
+    template<typename T>
+    std::enable_if_t<
+        stdnext::is_detected_v<staticMemberFromJsonReaderObjectExpr, T>,
+        T>
+    fromJson(JsonReader& reader, ReturnObjectTag tag, T*);
+
+    template<typename T>
+    std::enable_if_t<
+        !stdnext::is_detected_v<staticMemberFromJsonReaderObjectExpr, T> && stdnext::is_detected_v<objectDefinitionExpr, T>,
+        T>
+    fromJson(JsonReader& reader, ReturnObjectTag, T*);
+
+    template<typename T>
+    std::enable_if_t<
+        !stdnext::is_detected_v<staticMemberFromJsonReaderObjectExpr, T> && !stdnext::is_detected_v<objectDefinitionExpr, T>
+            && (IsStreamBuiltin<T>::value || hasFromJsonReaderOptional_v<T>),
+        T>
+    fromJson(JsonReader& reader, ReturnObjectTag, T*);
+
+    template<typename T>
+    std::enable_if_t<
+        !hasFromJsonReaderObject_v<T> && !hasFromJsonReaderOptional_v<T> && !IsStreamBuiltin<T>::value,
+        T>
+    fromJson(JsonReader& reader, ReturnObjectTag, T*);
+
+    inline stdnext::optional<bool> fromJson(JsonReader& reader, ReturnOptionalTag, bool*) {
+        if (reader.peek() != JsonToken::Bool) {
+            reader.skipValue();
+            return stdnext::nullopt;
+        }
+        return stdnext::make_optional(reader.readBool());
+    }
+
+    inline stdnext::optional<int> fromJson(JsonReader& reader, ReturnOptionalTag, int*) {
+        if (reader.peek() != JsonToken::Number) {
+            reader.skipValue();
+            return stdnext::nullopt;
+        }
+        return stdnext::make_optional(reader.readInt());
+    }
+
+    inline stdnext::optional<double> fromJson(JsonReader& reader, ReturnOptionalTag, double*) {
+        if (reader.peek() != JsonToken::Number) {
+            reader.skipValue();
+            return stdnext::nullopt;
+        }
+        return stdnext::make_optional(reader.readDouble());
+    }
+
+    inline stdnext::optional<std::string> fromJson(JsonReader& reader, ReturnOptionalTag, std::string*) {
+        if (reader.peek() != JsonToken::String) {
+            reader.skipValue();
+            return stdnext::nullopt;
+        }
+        return stdnext::make_optional(reader.readString());
+    }
+
+    template<typename T>
+    inline stdnext::optional<std::vector<T>> fromJson(JsonReader& reader, ReturnOptionalTag, std::vector<T>*) {
+        if (reader.peek() != JsonToken::BeginArray) {
+            reader.skipValue();
+            return stdnext::nullopt;
+        }
+        std::vector<T> array;
+        reader.beginArray();
+        while (reader.nextItem()) {
+            auto item = fromJson(reader, ReturnOptionalTag{}, (T*)nullptr);
+            if (!item) {
+                while (reader.nextItem())
+                    reader.skipValue();
+                return stdnext::nullopt;
+            }
+            array.emplace_back(std::move(*item));
+        }
+        return stdnext::optional<std::vector<T>>(std::move(array));
+    }
+
+    template<typename T>
+    inline std::enable_if_t<
+        stdnext::is_detected_v<staticMemberFromJsonReaderOptionalExpr, T>,
+        stdnext::optional<T>>
+    fromJson(JsonReader& reader, ReturnOptionalTag tag, T*) {
+        return T::fromJson(reader, tag);
+    }
+
+    template<typename T>
+    inline std::enable_if_t<
+        !stdnext::is_detected_v<staticMemberFromJsonReaderOptionalExpr, T> && hasFromJsonReaderObject_v<T>,
+        stdnext::optional<T>>
+    fromJson(JsonReader& reader, ReturnOptionalTag, T*) {
+        const auto mark = reader.mark();
+        try {
+            return stdnext::optional<T>(fromJson(reader, ReturnObjectTag{}, (T*)nullptr));
+        } catch(JsonSyntaxError&) {
+            throw;
+        } catch(DeserializationError&) {
+            skipFrom(reader, mark);
+            return stdnext::nullopt;
+        }
+    }
+
+    /// Types which only know about json11 are deserialized from a DOM of their own value
+    template<typename T>
+    inline std::enable_if_t<
+        !hasFromJsonReaderOptional_v<T> && !hasFromJsonReaderObject_v<T> && !IsStreamBuiltin<T>::value,
+        stdnext::optional<T>>
+    fromJson(JsonReader& reader, ReturnOptionalTag tag, T*) {
+        return fromJson(reader.readJson(), tag, (T*)nullptr);
+    }
+
+    template<typename T>
+    inline std::enable_if_t<
+        stdnext::is_detected_v<staticMemberFromJsonReaderObjectExpr, T>,
+        T>
+    fromJson(JsonReader& reader, ReturnObjectTag tag, T*) {
+        return T::fromJson(reader, tag);
+    }
+
+    template<typename T>
+    inline std::enable_if_t<
+        !stdnext::is_detected_v<staticMemberFromJsonReaderObjectExpr, T> && !stdnext::is_detected_v<objectDefinitionExpr, T>
+            && (IsStreamBuiltin<T>::value || hasFromJsonReaderOptional_v<T>),
+        T>
+    fromJson(JsonReader& reader, ReturnObjectTag, T*) {
+        auto opt = fromJson(reader, ReturnOptionalTag{}, (T*)nullptr);
+        if (!opt)
+            throw DeserializationError("C++/JSON type mismatch");
+        return std::move(*opt);
+    }
+
+    template<typename T>
+    inline std::enable_if_t<
+        !hasFromJsonReaderObject_v<T> && !hasFromJsonReaderOptional_v<T> && !IsStreamBuiltin<T>::value,
+        T>
+    fromJson(JsonReader& reader, ReturnObjectTag tag, T*) {
+        return fromJson(reader.readJson(), tag, (T*)nullptr);
+    }
+
+    template<typename T>
+    struct StreamDeserializerEx {
+        using InnerType = typename ReturnTypeTraits<T>::InnerType;
+        using ReturnType = typename ReturnTypeTraits<T>::ReturnType;
+        using TagType = typename ReturnTypeTraits<T>::TagType;
+
+        static ReturnType deserialize(JsonReader& reader) {
+            return fromJson(reader, TagType{}, (InnerType*)nullptr);
+        }
+    };
+
+    template<typename ClassT, typename... DataTs>
+    inline void readFields(JsonReader& reader, const ObjectDefinition<ClassT, DataTs...>& definition, ClassT& object) {
+        if (reader.peek() != JsonToken::BeginObject)
+            throw DeserializationError("C++/JSON type mismatch");
+        reader.beginObject();
+        std::string_view key;
+        while (reader.nextMember(key)) {
+            const auto index = definition.findField(key);
+            if (index == definition.notFound) {
+                reader.skipValue();
+                continue;
+            }
+            definition.visitField(index, [&reader, &object](const auto& fieldDefinition) {
+                using DataType = typename std::decay_t<decltype(fieldDefinition)>::DataType;
+                object.*fieldDefinition.pMember = StreamDeserializerEx<DataType>::deserialize(reader);
+            });
+        }
+    }
+
+    template<typename T>
+    inline std::enable_if_t<
+        !stdnext::is_detected_v<staticMemberFromJsonReaderObjectExpr, T> && stdnext::is_detected_v<objectDefinitionExpr, T>,
+        T>
+    fromJson(JsonReader& reader, ReturnObjectTag, T*) {
+        static constexpr auto definition = getObjectDefinition((T*)nullptr);
+        T object{};
+        readFields(reader, definition, object);
+        return object;
+    }
+
+} } // namespace ejson::detail
+
+namespace ejson {
+
+    template<typename T>
+    inline T deserializeStream(const std::string& jsonString) {
+        JsonReader reader(jsonString);
+        try {
+            auto value = detail::StreamDeserializerEx<T>::deserialize(reader);
+            reader.finish();
+            return value;
+        } catch(JsonSyntaxError& error) {
+            return detail::ReturnTypeTraits<T>::error(error.what());
+        }
+    }
+
+    template<typename T>
+    inline T deserialize(JsonReader& reader) {
+        return detail::StreamDeserializerEx<T>::deserialize(reader);
+    }
+
+}
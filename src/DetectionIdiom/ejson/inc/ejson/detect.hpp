@@ -27,4 +27,34 @@ namespace ejson { namespace detail {
         std::declval<stdnext::optional<T>&>() = T::fromJson(std::declval<const json11::Json&>(), std::declval<ReturnOptionalTag>())
     );
 
+    template<typename T>
+    using freeStandingFromJsonReaderObjectExpr = decltype(
+        std::declval<T&>() = fromJson(std::declval<JsonReader&>(), std::declval<ReturnObjectTag>(), std::declval<T*>())
+    );
+
+    template<typename T>
+    using freeStandingFromJsonReaderOptionalExpr = decltype(
+        std::declval<stdnext::optional<T>&>() = fromJson(std::declval<JsonReader&>(), std::declval<ReturnOptionalTag>(), std::declval<T*>())
+    );
+
+    template<typename T>
+    using staticMemberFromJsonReaderObjectExpr = decltype(
+        std::declval<T&>() = T::fromJson(std::declval<JsonReader&>(), std::declval<ReturnObjectTag>())
+    );
+
+    template<typename T>
+    using staticMemberFromJsonReaderOptionalExpr = decltype(
+        std::declval<stdnext::optional<T>&>() = T::fromJson(std::declval<JsonReader&>(), std::declval<ReturnOptionalTag>())
+    );
+
+    template<typename T>
+    using objectDefinitionExpr = decltype(
+        getObjectDefinition(std::declval<T*>())
+    );
+
+    template<typename T>
+    using memberToJsonExpr = decltype(
+        std::declval<const T&>().toJson(std::declval<JsonWriter&>())
+    );
+
 } } // namespace ejson::detail
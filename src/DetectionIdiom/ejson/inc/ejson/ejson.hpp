@@ -16,12 +16,40 @@ namespace ejson {
     template<typename T>
     T deserialize(const json11::Json& json);
 
+    /// Pull tokenizer over a json character buffer (see ejson/reader.hpp)
+    class JsonReader;
+
+    /// Deserialize from a json string, without building a json11 DOM
+    template<typename T>
+    T deserializeStream(const std::string& jsonString);
+
+    /// Deserialize the next value of a reader
+    template<typename T>
+    T deserialize(JsonReader& reader);
+
+    /// Json string buffer (see ejson/writer.hpp)
+    class JsonWriter;
+
+    /// Serialize to a json string
+    template<typename T>
+    std::string serialize(const T& value);
+
+    /// Serialize by appending to a writer
+    template<typename T>
+    void serialize(JsonWriter& writer, const T& value);
+
     /// Deserialization exception
     class DeserializationError : public std::invalid_argument {
     public:
         using std::invalid_argument::invalid_argument;
     };
 
+    /// Malformed json exception
+    class JsonSyntaxError : public DeserializationError {
+    public:
+        using DeserializationError::DeserializationError;
+    };
+
     /// Return type choices
     class ReturnObjectTag {};
     class ReturnOptionalTag {};
@@ -30,8 +58,27 @@ namespace ejson {
     /// 1 - free-standing function: T fromJson(const json11&, ReturnObjectTag, T*) or optional<T> fromJson(const json11&, ReturnOptionalTag, T*)
     /// 2 - static member function: T T::fromJson(const json11&, ReturnObjectTag) or optional<T> T::fromJson(const json11&, ReturnOptionalTag)
     /// 3 - constructor: T::T(const json11&)
+    ///
+    /// When deserializing from a JsonReader, the same customization points take a JsonReader& instead of a const json11&:
+    /// 1 - free-standing function: T fromJson(JsonReader&, ReturnObjectTag, T*) or optional<T> fromJson(JsonReader&, ReturnOptionalTag, T*)
+    /// 2 - static member function: T T::fromJson(JsonReader&, ReturnObjectTag) or optional<T> T::fromJson(JsonReader&, ReturnOptionalTag)
+    /// Types without a JsonReader customization point are deserialized from a json11 DOM of their own value only.
+    ///
+    /// Reflection: a class described by a constexpr ObjectDefinition (see ejson/reflect.hpp), returned by a free-standing function
+    /// constexpr auto getObjectDefinition(T*), is serialized and deserialized from a JsonReader field by field, without customization point.
+    /// Unknown keys are skipped and missing keys leave the member default initialized.
+    ///
+    /// Serialization customization points, in order of precedence:
+    /// 1 - free-standing function: void toJson(JsonWriter&, const T&)
+    /// 2 - object definition: constexpr auto getObjectDefinition(T*)
+    /// 3 - member function: void T::toJson(JsonWriter&) const
 }
 
 // IMPLEMENTATION
 #include "ejson/detect.hpp"
 #include "ejson/deserialize.hpp"
+#include "ejson/reader.hpp"
+#include "ejson/reflect.hpp"
+#include "ejson/deserialize_stream.hpp"
+#include "ejson/writer.hpp"
+#include "ejson/serialize.hpp"
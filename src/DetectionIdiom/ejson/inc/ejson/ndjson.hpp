@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ejson/ejson.hpp"
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace ejson {
+
+    /// Reads newline delimited json (one value per line) from a stream.
+    /// Only the current line is held in memory, in a buffer reused from one record to the next.
+    /// Blank lines are skipped.
+    class NdjsonReader {
+    public:
+        explicit NdjsonReader(std::istream& is)
+            : m_is(is) {
+        }
+
+        /// Returns false at the end of the stream.
+        /// Errors are reported with the number of the offending line.
+        template<typename T>
+        bool read(T& value) {
+            while (std::getline(m_is, m_line)) {
+                ++m_lineNumber;
+                if (m_line.find_first_not_of(" \t\r") == std::string::npos)
+                    continue;
+                JsonReader reader(m_line);
+                try {
+                    value = deserialize<T>(reader);
+                    reader.finish();
+                } catch(JsonSyntaxError& error) {
+                    throw JsonSyntaxError(lineError(error));
+                } catch(DeserializationError& error) {
+                    throw DeserializationError(lineError(error));
+                }
+                return true;
+            }
+            return false;
+        }
+
+        std::size_t lineNumber() const {
+            return m_lineNumber;
+        }
+
+    private:
+        std::string lineError(const std::exception& error) const {
+            return "line " + std::to_string(m_lineNumber) + ": " + error.what();
+        }
+
+        std::istream& m_is;
+        std::string m_line;
+        std::size_t m_lineNumber = 0;
+    };
+
+    /// Writes newline delimited json (one value per line) to a stream, reusing the same buffer for all the records
+    class NdjsonWriter {
+    public:
+        explicit NdjsonWriter(std::ostream& os)
+            : m_os(os) {
+        }
+
+        template<typename T>
+        void write(const T& value) {
+            m_writer.clear();
+            serialize(m_writer, value);
+            m_os.write(m_writer.str().data(), static_cast<std::streamsize>(m_writer.str().size()));
+            m_os.put('\n');
+        }
+
+    private:
+        std::ostream& m_os;
+        JsonWriter m_writer;
+    };
+
+} // namespace ejson
@@ -0,0 +1,433 @@
+#pragma once
+
+#include "json11/json11.hpp"
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace ejson {
+
+    /// Kind of the next value (or closing bracket) available in a JsonReader
+    enum class JsonToken {
+        Null,
+        Bool,
+        Number,
+        String,
+        BeginObject,
+        EndObject,
+        BeginArray,
+        EndArray,
+        End,
+    };
+
+    /// Pull tokenizer reading json values directly from a character buffer, without building a DOM.
+    /// The buffer is not copied and must outlive the reader.
+    /// Objects are read with beginObject() followed by nextMember() until it returns false,
+    /// arrays with beginArray() followed by nextItem() until it returns false.
+    /// Syntax errors throw JsonSyntaxError.
+    class JsonReader {
+    public:
+        /// Reading position, used to come back to the beginning of a value
+        class Mark {
+            friend class JsonReader;
+            const char* m_pos = nullptr;
+            int m_depth = 0;
+            bool m_afterValue = false;
+        };
+
+        JsonReader(const char* first, const char* last)
+            : m_first(first)
+            , m_pos(first)
+            , m_last(last) {
+        }
+
+        explicit JsonReader(const std::string& json)
+            : JsonReader(json.data(), json.data() + json.size()) {
+        }
+
+        JsonToken peek() {
+            skipWhitespaces();
+            if (m_pos == m_last)
+                return JsonToken::End;
+            switch (*m_pos) {
+            case 'n': return JsonToken::Null;
+            case 't': case 'f': return JsonToken::Bool;
+            case '"': return JsonToken::String;
+            case '{': return JsonToken::BeginObject;
+            case '}': return JsonToken::EndObject;
+            case '[': return JsonToken::BeginArray;
+            case ']': return JsonToken::EndArray;
+            case '-': return JsonToken::Number;
+            default:
+                if (*m_pos >= '0' && *m_pos <= '9')
+                    return JsonToken::Number;
+                error("unexpected character");
+            }
+        }
+
+        void readNull() {
+            skipWhitespaces();
+            expectLiteral("null");
+            m_afterValue = true;
+        }
+
+        bool readBool() {
+            skipWhitespaces();
+            const bool value = m_pos != m_last && *m_pos == 't';
+            expectLiteral(value ? "true" : "false");
+            m_afterValue = true;
+            return value;
+        }
+
+        /// Non integral numbers are truncated, as json11::Json::int_value() does.
+        /// Numbers out of the range of int throw JsonSyntaxError.
+        int readInt() {
+            skipWhitespaces();
+            const auto number = scanNumber();
+            m_afterValue = true;
+            if (number.m_integral) {
+                int value = 0;
+                const auto result = std::from_chars(number.m_first, number.m_last, value);
+                if (result.ec == std::errc{} && result.ptr == number.m_last)
+                    return value;
+            }
+            const auto value = toDouble(number);
+            // Checked before the conversion, which is undefined for values out of range
+            if (!(value > static_cast<double>(std::numeric_limits<int>::min()) - 1. &&
+                  value < static_cast<double>(std::numeric_limits<int>::max()) + 1.))
+                error("number out of int range");
+            return static_cast<int>(value);
+        }
+
+        double readDouble() {
+            skipWhitespaces();
+            const auto number = scanNumber();
+            m_afterValue = true;
+            return toDouble(number);
+        }
+
+        std::string readString() {
+            std::string value;
+            readString(value);
+            return value;
+        }
+
+        /// Replaces the content of value, reusing its capacity
+        void readString(std::string& value) {
+            skipWhitespaces();
+            value.clear();
+            const auto view = scanString(value);
+            if (view.data() != value.data())
+                value.assign(view.data(), view.size());
+            m_afterValue = true;
+        }
+
+        void beginObject() {
+            skipWhitespaces();
+            expect('{', "expected '{'");
+            enter();
+        }
+
+        /// Reads the key of the next member, or the end of the object.
+        /// The key view is only valid until the reader is used again.
+        bool nextMember(std::string_view& key) {
+            skipWhitespaces();
+            if (m_pos != m_last && *m_pos == '}') {
+                leave();
+                return false;
+            }
+            if (m_afterValue) {
+                expect(',', "expected ',' or '}'");
+                skipWhitespaces();
+            }
+            if (m_pos == m_last || *m_pos != '"')
+                error("expected member key");
+            key = scanString(m_keyBuffer);
+            skipWhitespaces();
+            expect(':', "expected ':'");
+            m_afterValue = false;
+            return true;
+        }
+
+        void beginArray() {
+            skipWhitespaces();
+            expect('[', "expected '['");
+            enter();
+        }
+
+        /// Positions the reader on the next item, or reads the end of the array
+        bool nextItem() {
+            skipWhitespaces();
+            if (m_pos != m_last && *m_pos == ']') {
+                leave();
+                return false;
+            }
+            if (m_afterValue) {
+                expect(',', "expected ',' or ']'");
+                skipWhitespaces();
+                if (m_pos != m_last && *m_pos == ']')
+                    error("unexpected ']'");
+            }
+            m_afterValue = false;
+            return true;
+        }
+
+        /// Skips the next value, validating its syntax
+        void skipValue() {
+            switch (peek()) {
+            case JsonToken::Null: readNull(); break;
+            case JsonToken::Bool: readBool(); break;
+            case JsonToken::Number: scanNumber(); m_afterValue = true; break;
+            case JsonToken::String: scanString(m_keyBuffer); m_afterValue = true; break;
+            case JsonToken::BeginObject: {
+                beginObject();
+                std::string_view key;
+                while (nextMember(key))
+                    skipValue();
+                break;
+            }
+            case JsonToken::BeginArray:
+                beginArray();
+                while (nextItem())
+                    skipValue();
+                break;
+            default:
+                error("expected value");
+            }
+        }
+
+        /// Reads the next value as a json11 DOM, for types which only know how to deserialize from a json11::Json
+        json11::Json readJson() {
+            skipWhitespaces();
+            const auto first = m_pos;
+            skipValue();
+            std::string parseError;
+            auto json = json11::Json::parse(std::string(first, m_pos), parseError);
+            if (!parseError.empty())
+                error(parseError.c_str());
+            return json;
+        }
+
+        /// Checks that nothing but whitespaces remain after the last value
+        void finish() {
+            skipWhitespaces();
+            if (m_pos != m_last)
+                error("unexpected trailing characters");
+        }
+
+        Mark mark() const {
+            Mark mark;
+            mark.m_pos = m_pos;
+            mark.m_depth = m_depth;
+            mark.m_afterValue = m_afterValue;
+            return mark;
+        }
+
+        void rewind(const Mark& mark) {
+            m_pos = mark.m_pos;
+            m_depth = mark.m_depth;
+            m_afterValue = mark.m_afterValue;
+        }
+
+        std::size_t offset() const {
+            return static_cast<std::size_t>(m_pos - m_first);
+        }
+
+    private:
+        static constexpr int maxDepth = 200;
+
+        struct Number {
+            const char* m_first;
+            const char* m_last;
+            bool m_integral;
+        };
+
+        [[noreturn]] void error(const char* message) const {
+            throw JsonSyntaxError("json parsing error: " + std::string(message) + " at offset " + std::to_string(offset()));
+        }
+
+        void skipWhitespaces() {
+            while (m_pos != m_last && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t'))
+                ++m_pos;
+        }
+
+        void expect(char c, const char* message) {
+            if (m_pos == m_last || *m_pos != c)
+                error(message);
+            ++m_pos;
+        }
+
+        void expectLiteral(std::string_view literal) {
+            if (static_cast<std::size_t>(m_last - m_pos) < literal.size() || std::string_view(m_pos, literal.size()) != literal)
+                error("invalid literal");
+            m_pos += literal.size();
+        }
+
+        void enter() {
+            if (++m_depth > maxDepth)
+                error("exceeded maximum nesting depth");
+            m_afterValue = false;
+        }
+
+        void leave() {
+            ++m_pos;
+            --m_depth;
+            m_afterValue = true;
+        }
+
+        bool isDigit() const {
+            return m_pos != m_last && *m_pos >= '0' && *m_pos <= '9';
+        }
+
+        void skipDigits() {
+            if (!isDigit())
+                error("expected digit");
+            while (isDigit())
+                ++m_pos;
+        }
+
+        Number scanNumber() {
+            Number number{m_pos, m_pos, true};
+            if (m_pos != m_last && *m_pos == '-')
+                ++m_pos;
+            if (m_pos != m_last && *m_pos == '0') {
+                ++m_pos;
+                if (isDigit())
+                    error("leading zeros not permitted");
+            } else {
+                skipDigits();
+            }
+            if (m_pos != m_last && *m_pos == '.') {
+                ++m_pos;
+                skipDigits();
+                number.m_integral = false;
+            }
+            if (m_pos != m_last && (*m_pos == 'e' || *m_pos == 'E')) {
+                ++m_pos;
+                if (m_pos != m_last && (*m_pos == '+' || *m_pos == '-'))
+                    ++m_pos;
+                skipDigits();
+                number.m_integral = false;
+            }
+            number.m_last = m_pos;
+            return number;
+        }
+
+        double toDouble(const Number& number) const {
+            double value = 0.;
+            const auto result = std::from_chars(number.m_first, number.m_last, value);
+            if (result.ptr != number.m_last)
+                error("invalid number");
+            return value;
+        }
+
+        static void appendUtf8(std::string& out, std::uint32_t codePoint) {
+            if (codePoint < 0x80) {
+                out += static_cast<char>(codePoint);
+            } else if (codePoint < 0x800) {
+                out += static_cast<char>(0xC0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            } else if (codePoint < 0x10000) {
+                out += static_cast<char>(0xE0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        std::uint32_t readHex4() {
+            if (m_last - m_pos < 4)
+                error("truncated \\u escape");
+            std::uint32_t value = 0;
+            for (int i = 0; i < 4; ++i, ++m_pos) {
+                const char c = *m_pos;
+                value <<= 4;
+                if (c >= '0' && c <= '9')
+                    value |= static_cast<std::uint32_t>(c - '0');
+                else if (c >= 'a' && c <= 'f')
+                    value |= static_cast<std::uint32_t>(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F')
+                    value |= static_cast<std::uint32_t>(c - 'A' + 10);
+                else
+                    error("invalid \\u escape");
+            }
+            return value;
+        }
+
+        void readEscape(std::string& out) {
+            if (m_pos == m_last)
+                error("unterminated string");
+            switch (*m_pos++) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                auto codePoint = readHex4();
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF && m_last - m_pos >= 6 && m_pos[0] == '\\' && m_pos[1] == 'u') {
+                    const auto backup = m_pos;
+                    m_pos += 2;
+                    const auto low = readHex4();
+                    if (low >= 0xDC00 && low <= 0xDFFF)
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    else
+                        m_pos = backup;
+                }
+                appendUtf8(out, codePoint);
+                break;
+            }
+            default:
+                error("invalid escape sequence");
+            }
+        }
+
+        /// Returns a view on the buffer when the string has no escape sequence,
+        /// otherwise decodes it into scratch and returns a view on scratch
+        std::string_view scanString(std::string& scratch) {
+            expect('"', "expected '\"'");
+            const auto first = m_pos;
+            while (m_pos != m_last && *m_pos != '"' && *m_pos != '\\') {
+                if (static_cast<unsigned char>(*m_pos) < 0x20)
+                    error("unescaped control character in string");
+                ++m_pos;
+            }
+            if (m_pos == m_last)
+                error("unterminated string");
+            if (*m_pos == '"')
+                return std::string_view(first, static_cast<std::size_t>(m_pos++ - first));
+            scratch.assign(first, m_pos);
+            while (true) {
+                if (m_pos == m_last)
+                    error("unterminated string");
+                const char c = *m_pos++;
+                if (c == '"')
+                    break;
+                if (c == '\\')
+                    readEscape(scratch);
+                else if (static_cast<unsigned char>(c) < 0x20)
+                    error("unescaped control character in string");
+                else
+                    scratch += c;
+            }
+            return scratch;
+        }
+
+        const char* m_first;
+        const char* m_pos;
+        const char* m_last;
+        int m_depth = 0;
+        bool m_afterValue = false;
+        std::string m_keyBuffer;
+    };
+
+} // namespace ejson
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+namespace ejson {
+
+    /// FNV-1a hash of a json object key, computed at compile time for field definitions
+    constexpr std::uint64_t hashFieldName(std::string_view name) {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const char c : name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /// Associates a json object key with a member of a C++ class.
+    /// The name is written as is, so it must not contain characters requiring escaping.
+    template<typename ClassT, typename DataT>
+    class FieldDefinition {
+    public:
+        using ClassType = ClassT;
+        using DataType = DataT;
+
+        const std::string_view fieldName;
+        DataT ClassT::* pMember;
+        std::uint64_t fieldNameHash;
+    };
+
+    template<typename ClassT, typename... DataTs>
+    using FieldDefinitions = std::tuple<FieldDefinition<ClassT, DataTs>...>;
+
+    /// Describes a C++ class as a json object, with an open addressing table of the key hashes
+    /// so that each member read from json is dispatched to its field without comparing all the keys
+    template<typename ClassT, typename... DataTs>
+    class ObjectDefinition {
+    public:
+        static constexpr std::size_t fieldsCount = sizeof...(DataTs);
+        static constexpr std::size_t notFound = fieldsCount;
+
+        static_assert(fieldsCount < 255, "too many fields");
+
+        static constexpr std::size_t tableSize() {
+            std::size_t size = 2;
+            while (size < 2 * fieldsCount)
+                size *= 2;
+            return size;
+        }
+
+        using HashTable = std::array<std::uint8_t, tableSize()>;
+
+        const FieldDefinitions<ClassT, DataTs...> fieldDefinitions;
+        const std::array<std::string_view, fieldsCount> fieldNames;
+        const std::array<std::uint64_t, fieldsCount> fieldNameHashes;
+        const HashTable hashTable;
+
+        constexpr std::size_t findField(std::string_view name) const {
+            const auto hash = hashFieldName(name);
+            for (auto slot = hash & (tableSize() - 1); hashTable[slot] != 0; slot = (slot + 1) & (tableSize() - 1)) {
+                const std::size_t index = hashTable[slot] - 1u;
+                if (fieldNameHashes[index] == hash && fieldNames[index] == name)
+                    return index;
+            }
+            return notFound;
+        }
+
+        /// Calls func with the definition of the field at index
+        template<typename FuncT>
+        constexpr void visitField(std::size_t index, FuncT&& func) const {
+            visitField(index, func, std::index_sequence_for<DataTs...>{});
+        }
+
+        /// Calls func with the definition of each field, in declaration order
+        template<typename FuncT>
+        constexpr void forEachField(FuncT&& func) const {
+            std::apply([&func](const auto&... fieldDefinition) { (func(fieldDefinition), ...); }, fieldDefinitions);
+        }
+
+    private:
+        template<typename FuncT, std::size_t... Is>
+        constexpr void visitField(std::size_t index, FuncT& func, std::index_sequence<Is...>) const {
+            (void)((index == Is ? (func(std::get<Is>(fieldDefinitions)), true) : false) || ...);
+        }
+    };
+
+    namespace detail {
+
+        template<std::size_t TableSizeV, std::size_t FieldsCountV>
+        constexpr std::array<std::uint8_t, TableSizeV> makeHashTable(const std::array<std::string_view, FieldsCountV>& names, const std::array<std::uint64_t, FieldsCountV>& hashes) {
+            std::array<std::uint8_t, TableSizeV> table{};
+            for (std::size_t index = 0; index < FieldsCountV; ++index) {
+                auto slot = hashes[index] & (TableSizeV - 1);
+                while (table[slot] != 0) {
+                    if (names[table[slot] - 1u] == names[index])
+                        throw std::logic_error("duplicate field name");
+                    slot = (slot + 1) & (TableSizeV - 1);
+                }
+                table[slot] = static_cast<std::uint8_t>(index + 1);
+            }
+            return table;
+        }
+
+    } // namespace detail
+
+    template<typename ClassT, typename DataT>
+    constexpr FieldDefinition<ClassT, DataT> makeFieldDefinition(std::string_view fieldName, DataT ClassT::* pMember) {
+        return FieldDefinition<ClassT, DataT>{fieldName, pMember, hashFieldName(fieldName)};
+    }
+
+    template<typename ClassT, typename... DataTs>
+    constexpr ObjectDefinition<ClassT, DataTs...> makeObjectDefinition(const FieldDefinition<ClassT, DataTs>&... fieldDefs) {
+        using Definition = ObjectDefinition<ClassT, DataTs...>;
+        const std::array<std::string_view, sizeof...(DataTs)> names{fieldDefs.fieldName...};
+        const std::array<std::uint64_t, sizeof...(DataTs)> hashes{fieldDefs.fieldNameHash...};
+        return Definition{
+            FieldDefinitions<ClassT, DataTs...>(fieldDefs...),
+            names,
+            hashes,
+            detail::makeHashTable<Definition::tableSize()>(names, hashes),
+        };
+    }
+
+} // namespace ejson
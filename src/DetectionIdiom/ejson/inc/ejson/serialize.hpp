@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ejson/detect.hpp"
+#include "ejson/reflect.hpp"
+#include "ejson/writer.hpp"
+#include "json11/json11.hpp"
+#include <vector>
+
+namespace ejson { namespace detail {
+
+    // The generic overloads are declared first, so that they can be found from the container overloads
+
+    template<typename T>
+    std::enable_if_t<
+        stdnext::is_detected_v<objectDefinitionExpr, T>>
+    toJson(JsonWriter& writer, const T& value);
+
+    template<typename T>
+    std::enable_if_t<
+        !stdnext::is_detected_v<objectDefinitionExpr, T> && stdnext::is_detected_v<memberToJsonExpr, T>>
+    toJson(JsonWriter& writer, const T& value);
+
+    template<typename T>
+    void toJson(JsonWriter& writer, const std::vector<T>& values);
+
+    template<typename T>
+    void toJson(JsonWriter& writer, const stdnext::optional<T>& value);
+
+    inline void toJson(JsonWriter& writer, bool value) {
+        writer.writeBool(value);
+    }
+
+    inline void toJson(JsonWriter& writer, int value) {
+        writer.writeInt(value);
+    }
+
+    inline void toJson(JsonWriter& writer, double value) {
+        writer.writeDouble(value);
+    }
+
+    inline void toJson(JsonWriter& writer, const std::string& value) {
+        writer.writeString(value);
+    }
+
+    inline void toJson(JsonWriter& writer, const char* value) {
+        writer.writeString(value);
+    }
+
+    inline void toJson(JsonWriter& writer, const json11::Json& value) {
+        writer.writeRaw(value.dump());
+    }
+
+    template<typename T>
+    inline void toJson(JsonWriter& writer, const std::vector<T>& values) {
+        writer.beginArray();
+        for (const auto& value : values)
+            toJson(writer, value);
+        writer.endArray();
+    }
+
+    template<typename T>
+    inline void toJson(JsonWriter& writer, const stdnext::optional<T>& value) {
+        if (!value)
+            writer.writeNull();
+        else
+            toJson(writer, *value);
+    }
+
+    template<typename T>
+    inline std::enable_if_t<
+        stdnext::is_detected_v<objectDefinitionExpr, T>>
+    toJson(JsonWriter& writer, const T& value) {
+        static constexpr auto definition = getObjectDefinition((T*)nullptr);
+        writer.beginObject();
+        definition.forEachField([&writer, &value](const auto& fieldDefinition) {
+            writer.key(fieldDefinition.fieldName);
+            toJson(writer, value.*fieldDefinition.pMember);
+        });
+        writer.endObject();
+    }
+
+    template<typename T>
+    inline std::enable_if_t<
+        !stdnext::is_detected_v<objectDefinitionExpr, T> && stdnext::is_detected_v<memberToJsonExpr, T>>
+    toJson(JsonWriter& writer, const T& value) {
+        value.toJson(writer);
+    }
+
+} } // namespace ejson::detail
+
+namespace ejson {
+
+    template<typename T>
+    inline void serialize(JsonWriter& writer, const T& value) {
+        using detail::toJson;
+        toJson(writer, value);
+    }
+
+    template<typename T>
+    inline std::string serialize(const T& value) {
+        JsonWriter writer;
+        serialize(writer, value);
+        return writer.str();
+    }
+
+}
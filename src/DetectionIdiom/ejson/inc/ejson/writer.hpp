@@ -0,0 +1,135 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+namespace ejson {
+
+    /// Appends json values to a string buffer, inserting the separators.
+    /// Objects are written with beginObject(), then key() followed by a value for each member, then endObject().
+    /// The buffer can be cleared and reused, so that writing many values only allocates while it grows.
+    class JsonWriter {
+    public:
+        const std::string& str() const {
+            return m_buffer;
+        }
+
+        void clear() {
+            m_buffer.clear();
+            m_afterValue = false;
+        }
+
+        void writeNull() {
+            separate();
+            m_buffer += "null";
+            m_afterValue = true;
+        }
+
+        void writeBool(bool value) {
+            separate();
+            m_buffer += value ? "true" : "false";
+            m_afterValue = true;
+        }
+
+        void writeInt(int value) {
+            separate();
+            char digits[16];
+            const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            m_buffer.append(digits, result.ptr);
+            m_afterValue = true;
+        }
+
+        /// Non finite values are written as null, as json11 does
+        void writeDouble(double value) {
+            if (!std::isfinite(value))
+                return writeNull();
+            separate();
+            char digits[32];
+            const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            m_buffer.append(digits, result.ptr);
+            m_afterValue = true;
+        }
+
+        void writeString(std::string_view value) {
+            separate();
+            appendString(value);
+            m_afterValue = true;
+        }
+
+        void beginObject() {
+            separate();
+            m_buffer += '{';
+            m_afterValue = false;
+        }
+
+        void key(std::string_view name) {
+            separate();
+            appendString(name);
+            m_buffer += ':';
+            m_afterValue = false;
+        }
+
+        void endObject() {
+            m_buffer += '}';
+            m_afterValue = true;
+        }
+
+        void beginArray() {
+            separate();
+            m_buffer += '[';
+            m_afterValue = false;
+        }
+
+        void endArray() {
+            m_buffer += ']';
+            m_afterValue = true;
+        }
+
+        /// Appends an already serialized value
+        void writeRaw(std::string_view json) {
+            separate();
+            m_buffer += json;
+            m_afterValue = true;
+        }
+
+    private:
+        void separate() {
+            if (m_afterValue)
+                m_buffer += ',';
+        }
+
+        void appendString(std::string_view value) {
+            static constexpr char hexDigits[] = "0123456789abcdef";
+            m_buffer += '"';
+            auto first = value.begin();
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                const auto c = static_cast<unsigned char>(*it);
+                if (c >= 0x20 && c != '"' && c != '\\')
+                    continue;
+                m_buffer.append(first, it);
+                first = it + 1;
+                switch (c) {
+                case '"': m_buffer += "\\\""; break;
+                case '\\': m_buffer += "\\\\"; break;
+                case '\b': m_buffer += "\\b"; break;
+                case '\f': m_buffer += "\\f"; break;
+                case '\n': m_buffer += "\\n"; break;
+                case '\r': m_buffer += "\\r"; break;
+                case '\t': m_buffer += "\\t"; break;
+                default:
+                    m_buffer += "\\u00";
+                    m_buffer += hexDigits[c >> 4];
+                    m_buffer += hexDigits[c & 0xF];
+                }
+            }
+            m_buffer.append(first, value.end());
+            m_buffer += '"';
+        }
+
+        std::string m_buffer;
+        bool m_afterValue = false;
+    };
+
+} // namespace ejson
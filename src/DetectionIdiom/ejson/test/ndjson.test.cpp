@@ -0,0 +1,181 @@
+#include "ejson/ndjson.hpp"
+#include <nlohmann/json.hpp>
+#include <catch/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+    struct Event {
+        int id{};
+        std::string kind{};
+        double value{};
+        bool acknowledged{};
+        std::vector<int> tags{};
+    };
+
+    constexpr auto ObjectDefinition_for_Event = ejson::makeObjectDefinition(
+        ejson::makeFieldDefinition("id", &Event::id),
+        ejson::makeFieldDefinition("kind", &Event::kind),
+        ejson::makeFieldDefinition("value", &Event::value),
+        ejson::makeFieldDefinition("acknowledged", &Event::acknowledged),
+        ejson::makeFieldDefinition("tags", &Event::tags)
+        );
+
+    constexpr auto getObjectDefinition(Event*) -> decltype(ObjectDefinition_for_Event) {
+        return ObjectDefinition_for_Event;
+    }
+
+    Event makeEvent(int i) {
+        return Event{i, "kind " + std::to_string(i % 7), i * 0.25, i % 3 == 0, {i, i + 1, i + 2}};
+    }
+
+    bool operator==(const Event& lhs, const Event& rhs) {
+        return lhs.id == rhs.id && lhs.kind == rhs.kind && lhs.value == rhs.value && lhs.acknowledged == rhs.acknowledged && lhs.tags == rhs.tags;
+    }
+
+    template<typename F>
+    auto measure(F&& func) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+}
+
+TEST_CASE("ndjson", "[ndjson]") {
+    SECTION("When writing records") {
+        // ARRANGE
+        std::ostringstream os;
+        ejson::NdjsonWriter writer(os);
+
+        // ACT
+        writer.write(Event{1, "a", 0.5, true, {1}});
+        writer.write(Event{2, "b", 1, false, {}});
+
+        // ASSERT
+        REQUIRE(os.str() ==
+            "{\"id\":1,\"kind\":\"a\",\"value\":0.5,\"acknowledged\":true,\"tags\":[1]}\n"
+            "{\"id\":2,\"kind\":\"b\",\"value\":1,\"acknowledged\":false,\"tags\":[]}\n");
+    }
+    SECTION("When reading records") {
+        // ARRANGE
+        std::istringstream is("{\"id\":1,\"kind\":\"a\"}\r\n\n   \n{\"id\":2,\"tags\":[3]}");
+        ejson::NdjsonReader reader(is);
+        Event event;
+
+        // ACT & ASSERT
+        REQUIRE(reader.read(event));
+        REQUIRE(event.id == 1);
+        REQUIRE(event.kind == "a");
+        REQUIRE(reader.read(event));
+        REQUIRE(event.id == 2);
+        REQUIRE((event.tags == std::vector<int>{3}));
+        REQUIRE(reader.lineNumber() == 4);
+        REQUIRE(!reader.read(event));
+    }
+    SECTION("When a record is malformed") {
+        std::istringstream is("{\"id\":1}\n{\"id\":2} 3\n");
+        ejson::NdjsonReader reader(is);
+        Event event;
+        REQUIRE(reader.read(event));
+        REQUIRE_THROWS_WITH(reader.read(event), Catch::Contains("line 2"));
+    }
+    SECTION("When round tripping") {
+        // ARRANGE
+        std::stringstream stream;
+        ejson::NdjsonWriter writer(stream);
+        for (int i = 0; i < 100; ++i)
+            writer.write(makeEvent(i));
+
+        // ACT
+        ejson::NdjsonReader reader(stream);
+        std::vector<Event> events;
+        Event event;
+        while (reader.read(event))
+            events.push_back(event);
+
+        // ASSERT
+        REQUIRE(events.size() == 100);
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(events[i] == makeEvent(i));
+    }
+}
+
+TEST_CASE("ndjson benchmark", "[.][benchmark]") {
+    const int count = 200000;
+    std::vector<Event> events;
+    for (int i = 0; i < count; ++i)
+        events.push_back(makeEvent(i));
+
+    std::ostringstream os;
+    const auto ejsonWrite = measure([&] {
+        ejson::NdjsonWriter writer(os);
+        for (const auto& event : events)
+            writer.write(event);
+    });
+    const auto ndjson = os.str();
+
+    const auto json11Write = measure([&] {
+        std::ostringstream json11Os;
+        std::string line;
+        for (const auto& event : events) {
+            line.clear();
+            json11::Json(json11::Json::object{
+                {"id", event.id}, {"kind", event.kind}, {"value", event.value}, {"acknowledged", event.acknowledged}, {"tags", event.tags},
+            }).dump(line);
+            json11Os << line << '\n';
+        }
+    });
+
+    const auto nlohmannWrite = measure([&] {
+        std::ostringstream nlohmannOs;
+        for (const auto& event : events) {
+            nlohmannOs << nlohmann::json{
+                {"id", event.id}, {"kind", event.kind}, {"value", event.value}, {"acknowledged", event.acknowledged}, {"tags", event.tags},
+            }.dump() << '\n';
+        }
+    });
+
+    std::size_t ejsonCount = 0;
+    const auto ejsonRead = measure([&] {
+        std::istringstream is(ndjson);
+        ejson::NdjsonReader reader(is);
+        Event event;
+        while (reader.read(event))
+            ejsonCount += event == events[ejsonCount];
+    });
+
+    std::size_t json11Count = 0;
+    const auto json11Read = measure([&] {
+        std::istringstream is(ndjson);
+        std::string line;
+        std::string error;
+        while (std::getline(is, line)) {
+            const auto json = json11::Json::parse(line, error);
+            Event event{json["id"].int_value(), json["kind"].string_value(), json["value"].number_value(), json["acknowledged"].bool_value(), {}};
+            for (const auto& tag : json["tags"].array_items())
+                event.tags.push_back(tag.int_value());
+            json11Count += event == events[json11Count];
+        }
+    });
+
+    std::size_t nlohmannCount = 0;
+    const auto nlohmannRead = measure([&] {
+        std::istringstream is(ndjson);
+        std::string line;
+        while (std::getline(is, line)) {
+            const auto json = nlohmann::json::parse(line);
+            Event event{json["id"].get<int>(), json["kind"].get<std::string>(), json["value"].get<double>(), json["acknowledged"].get<bool>(), json["tags"].get<std::vector<int>>()};
+            nlohmannCount += event == events[nlohmannCount];
+        }
+    });
+
+    REQUIRE(ejsonCount == events.size());
+    REQUIRE(json11Count == events.size());
+    REQUIRE(nlohmannCount == events.size());
+    std::cout << count << " records, " << ndjson.size() / 1024 << " KiB\n";
+    std::cout << "write: ejson " << ejsonWrite << " ms, json11 " << json11Write << " ms, nlohmann " << nlohmannWrite << " ms\n";
+    std::cout << "read:  ejson " << ejsonRead << " ms, json11 " << json11Read << " ms, nlohmann " << nlohmannRead << " ms\n";
+}
@@ -0,0 +1,153 @@
+#include "ejson/ejson.hpp"
+#include <catch/catch.hpp>
+
+namespace sample {
+
+    struct Child {
+        int i{};
+        std::string s{};
+    };
+
+    constexpr auto ObjectDefinition_for_Child = ejson::makeObjectDefinition(
+        ejson::makeFieldDefinition("i", &Child::i),
+        ejson::makeFieldDefinition("s", &Child::s)
+        );
+
+    constexpr auto getObjectDefinition(Child*) -> decltype(ObjectDefinition_for_Child) {
+        return ObjectDefinition_for_Child;
+    }
+
+    struct Person {
+        std::string id{};
+        double weight{};
+        int age{};
+        bool active{};
+        std::vector<int> scores{};
+        stdnext::optional<std::string> nickname{};
+        std::vector<Child> children{};
+    };
+
+    constexpr auto ObjectDefinition_for_Person = ejson::makeObjectDefinition(
+        ejson::makeFieldDefinition("id", &Person::id),
+        ejson::makeFieldDefinition("weight", &Person::weight),
+        ejson::makeFieldDefinition("age", &Person::age),
+        ejson::makeFieldDefinition("active", &Person::active),
+        ejson::makeFieldDefinition("scores", &Person::scores),
+        ejson::makeFieldDefinition("nickname", &Person::nickname),
+        ejson::makeFieldDefinition("children", &Person::children)
+        );
+
+    constexpr auto getObjectDefinition(Person*) -> decltype(ObjectDefinition_for_Person) {
+        return ObjectDefinition_for_Person;
+    }
+
+    struct HasMemberToJson {
+        void toJson(ejson::JsonWriter& writer) const {
+            writer.writeString("member");
+        }
+    };
+
+    struct HasFreeStandingToJson {
+        int i{};
+    };
+
+    void toJson(ejson::JsonWriter& writer, const HasFreeStandingToJson& value) {
+        writer.writeInt(value.i * 2);
+    }
+
+}
+
+TEST_CASE("object definition", "[reflection]") {
+    SECTION("When looking up known keys") {
+        static_assert(sample::ObjectDefinition_for_Person.findField("id") == 0, "");
+        static_assert(sample::ObjectDefinition_for_Person.findField("children") == 6, "");
+        REQUIRE(sample::ObjectDefinition_for_Person.findField("age") == 2);
+        REQUIRE(sample::ObjectDefinition_for_Person.findField("nickname") == 5);
+    }
+    SECTION("When looking up unknown keys") {
+        REQUIRE(sample::ObjectDefinition_for_Person.findField("") == sample::ObjectDefinition_for_Person.notFound);
+        REQUIRE(sample::ObjectDefinition_for_Person.findField("ages") == sample::ObjectDefinition_for_Person.notFound);
+    }
+    SECTION("When type has an object definition") {
+        const auto result = stdnext::is_detected_v<ejson::detail::objectDefinitionExpr, sample::Person>;
+        REQUIRE(result);
+    }
+    SECTION("When type has no object definition") {
+        const auto result = stdnext::is_detected_v<ejson::detail::objectDefinitionExpr, sample::HasMemberToJson>;
+        REQUIRE(!result);
+    }
+}
+
+TEST_CASE("serialize", "[serialization]") {
+    SECTION("When type is builtin") {
+        REQUIRE(ejson::serialize(true) == "true");
+        REQUIRE(ejson::serialize(-1234) == "-1234");
+        REQUIRE(ejson::serialize(0.5) == "0.5");
+        REQUIRE(ejson::serialize(std::string("a\"b\\c\n\x01")) == R"("a\"b\\c\n\u0001")");
+        REQUIRE(ejson::serialize(std::vector<int>{1, 2, 3}) == "[1,2,3]");
+        REQUIRE(ejson::serialize(stdnext::optional<int>{}) == "null");
+    }
+    SECTION("When type has an object definition") {
+        // ARRANGE
+        sample::Person person{"p1", 72.5, 42, true, {1, 2}, stdnext::nullopt, {{1, "a"}, {2, "b"}}};
+
+        // ACT
+        const auto json = ejson::serialize(person);
+
+        // ASSERT
+        REQUIRE(json == R"({"id":"p1","weight":72.5,"age":42,"active":true,"scores":[1,2],"nickname":null,"children":[{"i":1,"s":"a"},{"i":2,"s":"b"}]})");
+    }
+    SECTION("When type has customization points") {
+        REQUIRE(ejson::serialize(sample::HasMemberToJson{}) == R"("member")");
+        REQUIRE(ejson::serialize(std::vector<sample::HasFreeStandingToJson>{{1}, {2}}) == "[2,4]");
+    }
+}
+
+TEST_CASE("deserialize reflected", "[parsing]") {
+    SECTION("When all keys are present") {
+        // ARRANGE
+        const std::string json = R"({ "children": [ { "s": "a", "i": 1 } ], "id": "p1", "weight": 72.5, "age": 42, "active": true, "scores": [ 1, 2 ], "nickname": "bob" })";
+
+        // ACT
+        const auto person = ejson::deserializeStream<sample::Person>(json);
+
+        // ASSERT
+        REQUIRE(person.id == "p1");
+        REQUIRE(person.weight == 72.5);
+        REQUIRE(person.age == 42);
+        REQUIRE(person.active);
+        REQUIRE((person.scores == std::vector<int>{1, 2}));
+        REQUIRE(person.nickname);
+        REQUIRE(*person.nickname == "bob");
+        REQUIRE(person.children.size() == 1);
+        REQUIRE(person.children[0].i == 1);
+        REQUIRE(person.children[0].s == "a");
+    }
+    SECTION("When keys are missing or unknown") {
+        const auto person = ejson::deserializeStream<sample::Person>(std::string(R"({ "age": 7, "unknown": { "id": "x" }, "nickname": null })"));
+        REQUIRE(person.id.empty());
+        REQUIRE(person.age == 7);
+        REQUIRE(!person.nickname);
+    }
+    SECTION("When a field mismatches") {
+        REQUIRE_THROWS_AS(ejson::deserializeStream<sample::Person>(std::string(R"({ "age": "7" })")), ejson::DeserializationError);
+        REQUIRE_THROWS_AS(ejson::deserializeStream<sample::Person>(std::string(R"([])")), ejson::DeserializationError);
+        REQUIRE(!ejson::deserializeStream<stdnext::optional<sample::Person>>(std::string(R"({ "age": "7" })")));
+    }
+    SECTION("When round tripping") {
+        // ARRANGE
+        sample::Person person{"p\"1", -1e-3, 42, false, {}, std::string("\xC3\xA9t\xC3\xA9"), {{1, "a\tb"}}};
+
+        // ACT
+        const auto result = ejson::deserializeStream<sample::Person>(ejson::serialize(person));
+
+        // ASSERT
+        REQUIRE(result.id == person.id);
+        REQUIRE(result.weight == person.weight);
+        REQUIRE(result.age == person.age);
+        REQUIRE(result.active == person.active);
+        REQUIRE(result.scores == person.scores);
+        REQUIRE(*result.nickname == *person.nickname);
+        REQUIRE(result.children[0].s == person.children[0].s);
+    }
+}
@@ -0,0 +1,368 @@
+#include "ejson/ejson.hpp"
+#include <catch/catch.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace {
+
+    std::atomic<std::size_t> g_allocationsCount{0};
+
+}
+
+void* operator new(std::size_t size) {
+    ++g_allocationsCount;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+    struct HasStaticMemberFromJsonReader {
+        static auto fromJson(ejson::JsonReader& reader, ejson::ReturnObjectTag) {
+            HasStaticMemberFromJsonReader value;
+            reader.beginObject();
+            std::string_view key;
+            while (reader.nextMember(key)) {
+                if (key == "i")
+                    value.m_i = ejson::deserialize<int>(reader);
+                else if (key == "s")
+                    value.m_s = ejson::deserialize<std::string>(reader);
+                else
+                    reader.skipValue();
+            }
+            return value;
+        }
+
+        int m_i = 0;
+        std::string m_s;
+    };
+
+    struct HasFreeStandingFromJsonReader {
+        int m_i = 0;
+        std::string m_s;
+    };
+
+    stdnext::optional<HasFreeStandingFromJsonReader> fromJson(ejson::JsonReader& reader, ejson::ReturnOptionalTag, HasFreeStandingFromJsonReader*) {
+        if (reader.peek() != ejson::JsonToken::BeginObject) {
+            reader.skipValue();
+            return stdnext::nullopt;
+        }
+        HasFreeStandingFromJsonReader value;
+        reader.beginObject();
+        std::string_view key;
+        while (reader.nextMember(key)) {
+            if (key == "i")
+                value.m_i = ejson::deserialize<int>(reader);
+            else if (key == "s")
+                value.m_s = ejson::deserialize<std::string>(reader);
+            else
+                reader.skipValue();
+        }
+        return stdnext::optional<HasFreeStandingFromJsonReader>(std::move(value));
+    }
+
+    struct IsConstructibleFromJson {
+        IsConstructibleFromJson(const json11::Json& json)
+            : m_i{ejson::deserialize<int>(json["i"])}
+            , m_s{ejson::deserialize<std::string>(json["s"])} {
+        }
+
+        int m_i = 0;
+        std::string m_s;
+    };
+
+    struct Record {
+        static auto fromJson(ejson::JsonReader& reader, ejson::ReturnObjectTag) {
+            Record record;
+            reader.beginObject();
+            std::string_view key;
+            while (reader.nextMember(key)) {
+                if (key == "id")
+                    record.m_id = ejson::deserialize<int>(reader);
+                else if (key == "name")
+                    record.m_name = ejson::deserialize<std::string>(reader);
+                else if (key == "active")
+                    record.m_active = ejson::deserialize<bool>(reader);
+                else if (key == "scores")
+                    record.m_scores = ejson::deserialize<std::vector<int>>(reader);
+                else if (key == "child")
+                    record.m_child = ejson::deserialize<HasStaticMemberFromJsonReader>(reader);
+                else
+                    reader.skipValue();
+            }
+            return record;
+        }
+
+        static auto fromJson(const json11::Json& json, ejson::ReturnObjectTag) {
+            Record record;
+            record.m_id = ejson::deserialize<int>(json["id"]);
+            record.m_name = ejson::deserialize<std::string>(json["name"]);
+            record.m_active = ejson::deserialize<bool>(json["active"]);
+            record.m_scores = ejson::deserialize<std::vector<int>>(json["scores"]);
+            record.m_child.m_i = ejson::deserialize<int>(json["child"]["i"]);
+            record.m_child.m_s = ejson::deserialize<std::string>(json["child"]["s"]);
+            return record;
+        }
+
+        static auto fromJson(const json11::Json& json, ejson::ReturnOptionalTag) {
+            return stdnext::optional<Record>(fromJson(json, ejson::ReturnObjectTag{}));
+        }
+
+        int m_id = 0;
+        std::string m_name;
+        bool m_active = false;
+        std::vector<int> m_scores;
+        HasStaticMemberFromJsonReader m_child;
+    };
+
+    std::string makeRecords(int count) {
+        std::string json = "[";
+        for (int i = 0; i < count; ++i) {
+            if (i)
+                json += ",\n";
+            const auto id = std::to_string(i);
+            json += R"({ "id": )" + id + R"(, "name": "record number )" + id + R"(", "active": )" + (i % 2 ? "true" : "false")
+                + R"(, "scores": [ 1, 22, 333, 4444, 55555 ], "comment": { "text": "ignored", "tags": [ "a", "b" ] })"
+                + R"(, "child": { "i": )" + id + R"(, "s": "child\tof )" + id + R"(" } })";
+        }
+        json += "]";
+        return json;
+    }
+
+    template<typename F>
+    auto measure(F&& func) {
+        const auto allocationsCount = g_allocationsCount.load();
+        const auto start = std::chrono::steady_clock::now();
+        auto result = func();
+        const auto duration = std::chrono::steady_clock::now() - start;
+        return std::make_tuple(std::move(result), std::chrono::duration_cast<std::chrono::microseconds>(duration), g_allocationsCount.load() - allocationsCount);
+    }
+}
+
+TEST_CASE("detect reader", "[traits]") {
+    SECTION("staticMemberFromJsonReaderObjectExpr") {
+        const auto result = stdnext::is_detected_v<ejson::detail::staticMemberFromJsonReaderObjectExpr, HasStaticMemberFromJsonReader>;
+        REQUIRE(result);
+    }
+    SECTION("staticMemberFromJsonReaderObjectExpr when type is constructible from Json") {
+        const auto result = stdnext::is_detected_v<ejson::detail::staticMemberFromJsonReaderObjectExpr, IsConstructibleFromJson>;
+        REQUIRE(!result);
+    }
+    SECTION("staticMemberFromJsonReaderOptionalExpr") {
+        const auto result = stdnext::is_detected_v<ejson::detail::staticMemberFromJsonReaderOptionalExpr, HasStaticMemberFromJsonReader>;
+        REQUIRE(!result);
+    }
+    SECTION("freeStandingFromJsonReaderOptionalExpr") {
+        const auto result = stdnext::is_detected_v<ejson::detail::freeStandingFromJsonReaderOptionalExpr, HasFreeStandingFromJsonReader>;
+        REQUIRE(result);
+    }
+}
+
+TEST_CASE("reader", "[parsing]") {
+    SECTION("When reading nested values") {
+        // ARRANGE
+        const std::string json = R"( { "a" : [ 1, -2.5e1, true, null ], "b\"" : { }, "c": [] } )";
+        ejson::JsonReader reader(json);
+        std::string_view key;
+
+        // ACT & ASSERT
+        reader.beginObject();
+        REQUIRE(reader.nextMember(key));
+        REQUIRE(key == "a");
+        reader.beginArray();
+        REQUIRE(reader.nextItem());
+        REQUIRE(reader.readInt() == 1);
+        REQUIRE(reader.nextItem());
+        REQUIRE(reader.readDouble() == -25.);
+        REQUIRE(reader.nextItem());
+        REQUIRE(reader.readBool());
+        REQUIRE(reader.nextItem());
+        REQUIRE(reader.peek() == ejson::JsonToken::Null);
+        reader.readNull();
+        REQUIRE(!reader.nextItem());
+        REQUIRE(reader.nextMember(key));
+        REQUIRE(key == "b\"");
+        reader.skipValue();
+        REQUIRE(reader.nextMember(key));
+        REQUIRE(key == "c");
+        reader.beginArray();
+        REQUIRE(!reader.nextItem());
+        REQUIRE(!reader.nextMember(key));
+        REQUIRE(reader.peek() == ejson::JsonToken::End);
+        reader.finish();
+    }
+    SECTION("When reading escaped strings") {
+        // ARRANGE
+        const std::string json = R"("a\"\\\/\b\f\n\r\t\u00e9\u20ac\ud83d\ude00")";
+        ejson::JsonReader reader(json);
+
+        // ACT
+        const auto val = reader.readString();
+
+        // ASSERT
+        REQUIRE(val == "a\"\\/\b\f\n\r\t\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+    }
+    SECTION("When reading ints") {
+        // ARRANGE
+        const std::string json = R"([ -2147483648, 2147483647, 12.75, -1e3 ])";
+        ejson::JsonReader reader(json);
+
+        // ACT & ASSERT
+        reader.beginArray();
+        REQUIRE(reader.nextItem());
+        REQUIRE(reader.readInt() == -2147483648LL);
+        REQUIRE(reader.nextItem());
+        REQUIRE(reader.readInt() == 2147483647);
+        REQUIRE(reader.nextItem());
+        REQUIRE(reader.readInt() == 12);
+        REQUIRE(reader.nextItem());
+        REQUIRE(reader.readInt() == -1000);
+        REQUIRE(!reader.nextItem());
+    }
+    SECTION("When ints are out of range") {
+        for (const char* json : {"2147483648", "-2147483649", "1e10", "-1.5e300", "99999999999999999999"}) {
+            INFO(json);
+            ejson::JsonReader reader(json, json + std::strlen(json));
+            REQUIRE_THROWS_AS(reader.readInt(), ejson::JsonSyntaxError);
+            REQUIRE_THROWS_AS(ejson::deserializeStream<int>(std::string(json)), ejson::DeserializationError);
+        }
+    }
+    SECTION("When json is malformed") {
+        for (const char* json : {"[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":1,}", "01", "\"abc", "tru", "[", "{,}", "1 2", "-", "1.", "\"\\x\""}) {
+            INFO(json);
+            REQUIRE_THROWS_AS(ejson::deserializeStream<json11::Json>(json), ejson::DeserializationError);
+        }
+    }
+    SECTION("When json is too deeply nested") {
+        REQUIRE_THROWS_AS(ejson::deserializeStream<std::vector<int>>(std::string(1000, '[') + std::string(1000, ']')), ejson::DeserializationError);
+    }
+}
+
+TEST_CASE("deserialize stream", "[parsing]") {
+    SECTION("non-optional") {
+        SECTION("When type is bool") {
+            const auto val = ejson::deserializeStream<bool>(std::string(R"(false)"));
+            REQUIRE(val == false);
+        }
+        SECTION("When type is int") {
+            const auto val = ejson::deserializeStream<int>(std::string(R"(1234)"));
+            REQUIRE(val == 1234);
+        }
+        SECTION("When type is string") {
+            const auto val = ejson::deserializeStream<std::string>(std::string(R"("blablah")"));
+            REQUIRE(val == "blablah");
+        }
+        SECTION("When type is HasStaticMemberFromJsonReader") {
+            const auto val = ejson::deserializeStream<HasStaticMemberFromJsonReader>(std::string(R"({ "i": 789, "x": [{}], "s": "blablah" })"));
+            REQUIRE(val.m_i == 789);
+            REQUIRE(val.m_s == "blablah");
+        }
+        SECTION("When type is HasFreeStandingFromJsonReader") {
+            const auto val = ejson::deserializeStream<HasFreeStandingFromJsonReader>(std::string(R"({ "i": 789, "s": "blablah" })"));
+            REQUIRE(val.m_i == 789);
+            REQUIRE(val.m_s == "blablah");
+        }
+        SECTION("When type is IsConstructibleFromJson") {
+            const auto val = ejson::deserializeStream<IsConstructibleFromJson>(std::string(R"({ "i": 789, "s": "blablah" })"));
+            REQUIRE(val.m_i == 789);
+            REQUIRE(val.m_s == "blablah");
+        }
+        SECTION("When type is std::vector<HasStaticMemberFromJsonReader>") {
+            const auto val = ejson::deserializeStream<std::vector<HasStaticMemberFromJsonReader>>(std::string(R"([ { "i": 1, "s": "a" }, { "i": 2, "s": "b" } ])"));
+            REQUIRE(val.size() == 2);
+            REQUIRE(val[1].m_i == 2);
+            REQUIRE(val[1].m_s == "b");
+        }
+        SECTION("When type mismatches") {
+            REQUIRE_THROWS_AS(ejson::deserializeStream<int>(std::string(R"("1234")")), ejson::DeserializationError);
+            REQUIRE_THROWS_AS(ejson::deserializeStream<std::vector<int>>(std::string(R"([ 1, "2", 3 ])")), ejson::DeserializationError);
+        }
+    }
+    SECTION("optional") {
+        SECTION("When type is std::vector<int>") {
+            const auto val = ejson::deserializeStream<stdnext::optional<std::vector<int>>>(std::string(R"([ 1, 2, 3 ])"));
+            REQUIRE(val);
+            REQUIRE((*val == std::vector<int>{1, 2, 3}));
+        }
+        SECTION("When type is HasStaticMemberFromJsonReader") {
+            const auto val = ejson::deserializeStream<stdnext::optional<HasStaticMemberFromJsonReader>>(std::string(R"({ "i": 789, "s": "blablah" })"));
+            REQUIRE(val);
+            REQUIRE(val->m_i == 789);
+        }
+        SECTION("When type is IsConstructibleFromJson") {
+            const auto val = ejson::deserializeStream<stdnext::optional<IsConstructibleFromJson>>(std::string(R"({ "i": 789, "s": "blablah" })"));
+            REQUIRE(val);
+            REQUIRE(val->m_s == "blablah");
+        }
+        SECTION("When an item mismatches, the reader skips the rest of the value") {
+            // ARRANGE
+            const std::string json = R"([ [ 1, "2", [3] ], { "i": "789" }, 4 ])";
+            ejson::JsonReader reader(json);
+
+            // ACT
+            reader.beginArray();
+            reader.nextItem();
+            const auto val1 = ejson::deserialize<stdnext::optional<std::vector<int>>>(reader);
+            reader.nextItem();
+            const auto val2 = ejson::deserialize<stdnext::optional<HasStaticMemberFromJsonReader>>(reader);
+            reader.nextItem();
+            const auto val3 = ejson::deserialize<stdnext::optional<int>>(reader);
+
+            // ASSERT
+            REQUIRE(!val1);
+            REQUIRE(!val2);
+            REQUIRE(val3);
+            REQUIRE(*val3 == 4);
+            REQUIRE(!reader.nextItem());
+        }
+        SECTION("When json is malformed") {
+            const auto val = ejson::deserializeStream<stdnext::optional<std::vector<int>>>(std::string(R"([ 1, 2, )"));
+            REQUIRE(!val);
+        }
+    }
+    SECTION("same result as json11") {
+        // ARRANGE
+        const auto json = makeRecords(10);
+
+        // ACT
+        const auto domRecords = ejson::deserialize<std::vector<Record>>(json);
+        const auto streamRecords = ejson::deserializeStream<std::vector<Record>>(json);
+
+        // ASSERT
+        REQUIRE(domRecords.size() == 10);
+        REQUIRE(streamRecords.size() == 10);
+        for (std::size_t i = 0; i < 10; ++i) {
+            REQUIRE(streamRecords[i].m_id == domRecords[i].m_id);
+            REQUIRE(streamRecords[i].m_name == domRecords[i].m_name);
+            REQUIRE(streamRecords[i].m_active == domRecords[i].m_active);
+            REQUIRE(streamRecords[i].m_scores == domRecords[i].m_scores);
+            REQUIRE(streamRecords[i].m_child.m_i == domRecords[i].m_child.m_i);
+            REQUIRE(streamRecords[i].m_child.m_s == domRecords[i].m_child.m_s);
+        }
+    }
+}
+
+TEST_CASE("deserialize stream benchmark", "[.][benchmark]") {
+    const auto json = makeRecords(100000);
+
+    const auto dom = measure([&] { return ejson::deserialize<std::vector<Record>>(json); });
+    const auto stream = measure([&] { return ejson::deserializeStream<std::vector<Record>>(json); });
+
+    REQUIRE(std::get<0>(dom).size() == std::get<0>(stream).size());
+    std::cout << "payload: " << json.size() / 1024 << " KiB\n";
+    std::cout << "json11 DOM: " << std::get<1>(dom).count() << " us, " << std::get<2>(dom) << " allocations\n";
+    std::cout << "stream:     " << std::get<1>(stream).count() << " us, " << std::get<2>(stream) << " allocations\n";
+}
@@ -12,170 +12,13 @@ file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 ///////////////////////////////////////////////////////////////////////////////
 
-#include <boost/config/warning_disable.hpp>
-#include <boost/spirit/include/qi.hpp>
-#include <boost/spirit/include/phoenix_core.hpp>
-#include <boost/spirit/include/phoenix_operator.hpp>
-#include <boost/spirit/include/phoenix_fusion.hpp>
-#include <boost/spirit/include/phoenix_stl.hpp>
-#include <boost/fusion/include/adapt_struct.hpp>
-#include <boost/variant/recursive_variant.hpp>
-#include <boost/foreach.hpp>
+#include "mini_xml1.h"
 
-#include <iostream>
 #include <fstream>
+#include <iostream>
+#include <iterator>
 #include <string>
-#include <vector>
-
-namespace client
-{
-    namespace fusion = boost::fusion;
-    namespace phoenix = boost::phoenix;
-    namespace qi = boost::spirit::qi;
-    namespace ascii = boost::spirit::ascii;
-
-    ///////////////////////////////////////////////////////////////////////////
-    //  Our mini XML tree representation
-    ///////////////////////////////////////////////////////////////////////////
-    //[tutorial_xml1_structures
-    struct mini_xml;
-
-    typedef
-        boost::variant<
-        boost::recursive_wrapper<mini_xml>
-        , std::string
-        >
-        mini_xml_node;
-
-    struct mini_xml
-    {
-        std::string name;                           // tag name
-        std::vector<mini_xml_node> children;        // children
-    };
-    //]
-}
-
-// We need to tell fusion about our mini_xml struct
-// to make it a first-class fusion citizen
-//[tutorial_xml1_adapt_structures
-BOOST_FUSION_ADAPT_STRUCT(
-    client::mini_xml,
-    (std::string, name)
-    (std::vector<client::mini_xml_node>, children)
-    )
-    //]
-
-namespace client
-{
-    ///////////////////////////////////////////////////////////////////////////
-    //  Print out the mini xml tree
-    ///////////////////////////////////////////////////////////////////////////
-    int const tabsize = 4;
-
-    void tab(int indent)
-    {
-        for (int i = 0; i < indent; ++i)
-            std::cout << ' ';
-    }
-
-    struct mini_xml_printer
-    {
-        mini_xml_printer(int indent = 0)
-            : indent(indent)
-        {
-        }
-
-        void operator()(mini_xml const& xml) const;
-
-        int indent;
-    };
 
-    struct mini_xml_node_printer : boost::static_visitor<>
-    {
-        mini_xml_node_printer(int indent = 0)
-            : indent(indent)
-        {
-        }
-
-        void operator()(mini_xml const& xml) const
-        {
-            mini_xml_printer(indent + tabsize)(xml);
-        }
-
-        void operator()(std::string const& text) const
-        {
-            tab(indent + tabsize);
-            std::cout << "text: \"" << text << '"' << std::endl;
-        }
-
-        int indent;
-    };
-
-    void mini_xml_printer::operator()(mini_xml const& xml) const
-    {
-        tab(indent);
-        std::cout << "tag: " << xml.name << std::endl;
-        tab(indent);
-        std::cout << '{' << std::endl;
-
-        BOOST_FOREACH(mini_xml_node const& node, xml.children)
-        {
-            boost::apply_visitor(mini_xml_node_printer(indent), node);
-        }
-
-        tab(indent);
-        std::cout << '}' << std::endl;
-    }
-
-    ///////////////////////////////////////////////////////////////////////////
-    //  Our mini XML grammar definition
-    ///////////////////////////////////////////////////////////////////////////
-    //[tutorial_xml1_grammar
-    template <typename Iterator>
-    struct mini_xml_grammar : qi::grammar<Iterator, mini_xml(), ascii::space_type>
-    {
-        mini_xml_grammar() : mini_xml_grammar::base_type(xml)
-        {
-            using qi::lit;
-            using qi::lexeme;
-            using ascii::char_;
-            using ascii::string;
-            using namespace qi::labels;
-
-            using phoenix::at_c;
-            using phoenix::push_back;
-
-            text = lexeme[+(char_ - '<')[_val += _1]];
-            node = (xml | text)[_val = _1];
-
-            start_tag =
-                '<'
-                >> !lit('/')
-                >> lexeme[+(char_ - '>')[_val += _1]]
-                >> '>'
-                ;
-
-            end_tag =
-                "</"
-                >> string(_r1)
-                >> '>'
-                ;
-
-            xml =
-                start_tag[at_c<0>(_val) = _1]
-                >> *node[push_back(at_c<1>(_val), _1)]
-                >> end_tag(at_c<0>(_val))
-                ;
-        }
-
-        qi::rule<Iterator, mini_xml(), ascii::space_type> xml;
-        qi::rule<Iterator, mini_xml_node(), ascii::space_type> node;
-        qi::rule<Iterator, std::string(), ascii::space_type> text;
-        qi::rule<Iterator, std::string(), ascii::space_type> start_tag;
-        qi::rule<Iterator, void(std::string), ascii::space_type> end_tag;
-    };
-    //]
-}
 #if 1
 ///////////////////////////////////////////////////////////////////////////////
 //  Main program
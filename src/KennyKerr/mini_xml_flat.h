@@ -0,0 +1,364 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  A hand-written mini XML-like parser, accepting the same language as the
+//  Spirit grammar of mini_xml1.h:
+//
+//  - mini_xml_document parses a whole buffer into a flat array of nodes
+//    linked by indices, whose names and texts are string_views into the
+//    source (no allocation per node, the buffer must outlive the document)
+//  - mini_xml_sax_parser<HandlerT> parses chunked input and calls back
+//    on_start_element(name), on_text(text) and on_end_element(name); only a
+//    token straddling two chunks is copied
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace client
+{
+    namespace detail
+    {
+        // Same characters as boost::spirit::ascii::space
+        inline bool is_space(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+        }
+
+        inline std::size_t skip_spaces(std::string_view input, std::size_t pos)
+        {
+            while (pos < input.size() && is_space(input[pos]))
+                ++pos;
+            return pos;
+        }
+
+        enum class token_kind
+        {
+            start_tag,
+            end_tag,
+            text,
+            end_of_input,
+            incomplete,
+            error,
+        };
+
+        struct token
+        {
+            token_kind kind;
+            std::string_view value;     // tag name, end tag content or text
+            std::size_t offset;         // where the token starts in the input
+        };
+
+        // Scans the token following pos and moves pos past it.
+        // On incomplete or error, pos is left at the start of the token (after the spaces).
+        // A text running to the end of the input is incomplete, unless text_ends_input is set.
+        inline token scan_token(std::string_view input, std::size_t& pos, bool text_ends_input = false)
+        {
+            pos = skip_spaces(input, pos);
+            const auto start = pos;
+            if (start == input.size())
+                return { token_kind::end_of_input, {}, start };
+
+            if (input[start] != '<')
+            {
+                // text = lexeme[+(char_ - '<')], so trailing spaces are part of the text
+                auto end = input.find('<', start);
+                if (end == std::string_view::npos)
+                {
+                    if (!text_ends_input)
+                        return { token_kind::incomplete, {}, start };
+                    end = input.size();
+                }
+                pos = end;
+                return { token_kind::text, input.substr(start, end - start), start };
+            }
+
+            const auto gt = input.find('>', start + 1);
+            if (gt == std::string_view::npos)
+                return { token_kind::incomplete, {}, start };
+
+            if (input[start + 1] == '/')
+            {
+                // end_tag = "</" >> string(name) >> '>', with spaces skipped around the name
+                const auto content = skip_spaces(input, start + 2);
+                pos = gt + 1;
+                return { token_kind::end_tag, input.substr(content, gt - content), start };
+            }
+
+            // start_tag = '<' >> !lit('/') >> lexeme[+(char_ - '>')] >> '>'
+            const auto name = skip_spaces(input, start + 1);
+            if (name == gt || input[name] == '/')
+                return { token_kind::error, {}, start };
+            pos = gt + 1;
+            return { token_kind::start_tag, input.substr(name, gt - name), start };
+        }
+
+        // The end tag content must be the name, followed by nothing but spaces
+        inline bool end_tag_matches(std::string_view content, std::string_view name)
+        {
+            if (content.compare(0, name.size(), name) != 0)
+                return false;
+            for (auto pos = name.size(); pos < content.size(); ++pos)
+                if (!is_space(content[pos]))
+                    return false;
+            return true;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    //  Flat document
+    ///////////////////////////////////////////////////////////////////////////
+    enum class mini_xml_node_kind : std::uint8_t
+    {
+        element,
+        text,
+    };
+
+    struct mini_xml_flat_node
+    {
+        mini_xml_node_kind kind;
+        std::string_view value;     // tag name or text, pointing into the source
+        std::uint32_t parent;
+        std::uint32_t first_child;
+        std::uint32_t next_sibling;
+    };
+
+    class mini_xml_document
+    {
+    public:
+        static constexpr std::uint32_t npos = static_cast<std::uint32_t>(-1);
+
+        // Parses source, which must outlive the document; the nodes of a previous parse are dropped
+        bool parse(std::string_view source)
+        {
+            m_nodes.clear();
+            m_open.clear();
+            m_error_offset = std::string_view::npos;
+            bool root_done = false;
+            std::size_t pos = 0;
+            for (;;)
+            {
+                const auto token = detail::scan_token(source, pos);
+                switch (token.kind)
+                {
+                case detail::token_kind::start_tag:
+                    if (root_done)
+                        return fail(token.offset);
+                    m_open.push_back({ add_node(mini_xml_node_kind::element, token.value), npos });
+                    break;
+                case detail::token_kind::text:
+                    if (m_open.empty())
+                        return fail(token.offset);
+                    add_node(mini_xml_node_kind::text, token.value);
+                    break;
+                case detail::token_kind::end_tag:
+                    if (m_open.empty() || !detail::end_tag_matches(token.value, m_nodes[m_open.back().index].value))
+                        return fail(token.offset);
+                    m_open.pop_back();
+                    root_done = m_open.empty();
+                    break;
+                case detail::token_kind::end_of_input:
+                    if (!root_done)
+                        return fail(token.offset);
+                    return true;
+                default:
+                    return fail(token.offset);
+                }
+            }
+        }
+
+        bool empty() const { return m_nodes.empty(); }
+        std::size_t size() const { return m_nodes.size(); }
+        const std::vector<mini_xml_flat_node>& nodes() const { return m_nodes; }
+        const mini_xml_flat_node& operator[](std::uint32_t index) const { return m_nodes[index]; }
+
+        // The root element is the first node
+        const mini_xml_flat_node& root() const { return m_nodes.front(); }
+
+        template< typename FuncT >
+        void for_each_child(std::uint32_t index, FuncT&& func) const
+        {
+            for (auto child = m_nodes[index].first_child; child != npos; child = m_nodes[child].next_sibling)
+                func(child, m_nodes[child]);
+        }
+
+        // Offset in the source where the last parse failed, or std::string_view::npos
+        std::size_t error_offset() const { return m_error_offset; }
+
+    private:
+        struct open_element
+        {
+            std::uint32_t index;
+            std::uint32_t last_child;
+        };
+
+        std::uint32_t add_node(mini_xml_node_kind kind, std::string_view value)
+        {
+            const auto index = static_cast<std::uint32_t>(m_nodes.size());
+            const auto parent = m_open.empty() ? npos : m_open.back().index;
+            m_nodes.push_back({ kind, value, parent, npos, npos });
+            if (!m_open.empty())
+            {
+                auto& open = m_open.back();
+                if (open.last_child == npos)
+                    m_nodes[open.index].first_child = index;
+                else
+                    m_nodes[open.last_child].next_sibling = index;
+                open.last_child = index;
+            }
+            return index;
+        }
+
+        bool fail(std::size_t offset)
+        {
+            m_error_offset = offset;
+            return false;
+        }
+
+        std::vector<mini_xml_flat_node> m_nodes;
+        std::vector<open_element> m_open;
+        std::size_t m_error_offset = std::string_view::npos;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    //  Streaming SAX parser
+    ///////////////////////////////////////////////////////////////////////////
+    template< typename HandlerT >
+    class mini_xml_sax_parser
+    {
+    public:
+        explicit mini_xml_sax_parser(HandlerT& handler)
+            : m_handler(handler)
+        {
+        }
+
+        // The views given to the handler are only valid during the call
+        bool feed(std::string_view chunk)
+        {
+            if (m_failed)
+                return false;
+
+            if (!m_pending.empty())
+            {
+                // Complete the straddling token with the head of the chunk, and parse it on its own
+                const bool in_tag = m_pending.front() == '<';
+                const auto end = chunk.find(in_tag ? '>' : '<');
+                if (end == std::string_view::npos)
+                {
+                    m_pending.append(chunk.data(), chunk.size());
+                    return true;
+                }
+                const auto split = in_tag ? end + 1 : end;
+                m_pending.append(chunk.data(), split);
+                chunk.remove_prefix(split);
+                std::size_t pos = 0;
+                if (!parse_tokens(m_pending, pos, true))
+                    return false;
+                m_consumed += m_pending.size();
+                m_pending.clear();
+            }
+
+            std::size_t pos = 0;
+            if (!parse_tokens(chunk, pos, false))
+                return false;
+            m_consumed += pos;
+            m_pending.assign(chunk.data() + pos, chunk.size() - pos);
+            return true;
+        }
+
+        // Returns true if exactly one root element was parsed and nothing but spaces follows it
+        bool finish()
+        {
+            if (m_failed)
+                return false;
+            if (!m_pending.empty() || !m_root_done)
+                return fail(m_consumed);
+            return true;
+        }
+
+        bool failed() const { return m_failed; }
+
+        // Offset in the whole input where parsing failed, or std::string_view::npos
+        std::size_t error_offset() const { return m_error_offset; }
+
+    private:
+        bool parse_tokens(std::string_view input, std::size_t& pos, bool text_ends_input)
+        {
+            for (;;)
+            {
+                const auto token = detail::scan_token(input, pos, text_ends_input);
+                switch (token.kind)
+                {
+                case detail::token_kind::start_tag:
+                    if (m_root_done)
+                        return fail(m_consumed + token.offset);
+                    m_open_offsets.push_back(m_open_names.size());
+                    m_open_names.append(token.value.data(), token.value.size());
+                    m_handler.on_start_element(token.value);
+                    break;
+                case detail::token_kind::text:
+                    if (m_open_offsets.empty())
+                        return fail(m_consumed + token.offset);
+                    m_handler.on_text(token.value);
+                    break;
+                case detail::token_kind::end_tag:
+                {
+                    if (m_open_offsets.empty())
+                        return fail(m_consumed + token.offset);
+                    const auto name = std::string_view(m_open_names).substr(m_open_offsets.back());
+                    if (!detail::end_tag_matches(token.value, name))
+                        return fail(m_consumed + token.offset);
+                    m_handler.on_end_element(name);
+                    m_open_names.resize(m_open_offsets.back());
+                    m_open_offsets.pop_back();
+                    m_root_done = m_open_offsets.empty();
+                    break;
+                }
+                case detail::token_kind::end_of_input:
+                case detail::token_kind::incomplete:
+                    return true;
+                default:
+                    return fail(m_consumed + token.offset);
+                }
+            }
+        }
+
+        bool fail(std::size_t offset)
+        {
+            m_failed = true;
+            m_error_offset = offset;
+            return false;
+        }
+
+        HandlerT& m_handler;
+        std::string m_pending;                      // start of a token cut by the end of the previous chunk
+        std::string m_open_names;                   // names of the open elements, back to back
+        std::vector<std::size_t> m_open_offsets;    // where each open element name starts in m_open_names
+        std::size_t m_consumed = 0;                 // input offset of the start of m_pending
+        std::size_t m_error_offset = std::string_view::npos;
+        bool m_root_done = false;
+        bool m_failed = false;
+    };
+
+    // Feeds the stream to a SAX parser, chunk_size bytes at a time
+    template< typename HandlerT >
+    bool parse_mini_xml_stream(std::istream& in, HandlerT& handler, std::size_t chunk_size = 64 * 1024)
+    {
+        mini_xml_sax_parser<HandlerT> parser(handler);
+        std::vector<char> buffer(chunk_size);
+        while (in)
+        {
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            const auto count = static_cast<std::size_t>(in.gcount());
+            if (count != 0 && !parser.feed(std::string_view(buffer.data(), count)))
+                return false;
+        }
+        return parser.finish();
+    }
+}
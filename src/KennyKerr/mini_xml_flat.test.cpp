@@ -0,0 +1,270 @@
+#include <catch2/catch.hpp>
+#include "mini_xml_flat.h"
+#include "mini_xml1.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+
+namespace ut {
+
+    namespace {
+
+        // All backends are turned into the same event string, e.g. "<a>text(x)</a>"
+        struct event_recorder
+        {
+            void on_start_element(std::string_view name) { events += "<" + std::string(name) + ">"; }
+            void on_text(std::string_view text) { events += "text(" + std::string(text) + ")"; }
+            void on_end_element(std::string_view name) { events += "</" + std::string(name) + ">"; }
+
+            std::string events;
+        };
+
+        struct event_counter
+        {
+            void on_start_element(std::string_view name) { bytes += name.size(); ++count; }
+            void on_text(std::string_view text) { bytes += text.size(); ++count; }
+            void on_end_element(std::string_view) {}
+
+            std::size_t bytes = 0;
+            std::size_t count = 0;
+        };
+
+        void record_flat(const client::mini_xml_document& document, std::uint32_t index, std::string& events)
+        {
+            const auto& node = document[index];
+            if (node.kind == client::mini_xml_node_kind::text)
+            {
+                events += "text(" + std::string(node.value) + ")";
+                return;
+            }
+            events += "<" + std::string(node.value) + ">";
+            document.for_each_child(index, [&](std::uint32_t child, const client::mini_xml_flat_node&) { record_flat(document, child, events); });
+            events += "</" + std::string(node.value) + ">";
+        }
+
+        struct spirit_recorder : boost::static_visitor<>
+        {
+            void operator()(const client::mini_xml& xml) const
+            {
+                events += "<" + xml.name + ">";
+                for (const auto& child : xml.children)
+                    boost::apply_visitor(*this, child);
+                events += "</" + xml.name + ">";
+            }
+
+            void operator()(const std::string& text) const { events += "text(" + text + ")"; }
+
+            std::string& events;
+        };
+
+        bool parse_spirit(const std::string& source, client::mini_xml& ast)
+        {
+            static const client::mini_xml_grammar<std::string::const_iterator> grammar;
+            auto iter = source.cbegin();
+            const auto end = source.cend();
+            return boost::spirit::qi::phrase_parse(iter, end, grammar, boost::spirit::ascii::space, ast) && iter == end;
+        }
+
+        std::string flat_events(const std::string& source)
+        {
+            client::mini_xml_document document;
+            if (!document.parse(source))
+                return "error";
+            std::string events;
+            record_flat(document, 0, events);
+            return events;
+        }
+
+        std::string spirit_events(const std::string& source)
+        {
+            client::mini_xml ast;
+            if (!parse_spirit(source, ast))
+                return "error";
+            std::string events;
+            spirit_recorder{ {}, events }(ast);
+            return events;
+        }
+
+        std::string sax_events(const std::string& source, std::size_t chunk_size)
+        {
+            event_recorder recorder;
+            client::mini_xml_sax_parser<event_recorder> parser(recorder);
+            for (std::size_t pos = 0; pos < source.size(); pos += chunk_size)
+            {
+                if (!parser.feed(std::string_view(source).substr(pos, chunk_size)))
+                    return "error";
+            }
+            return parser.finish() ? recorder.events : "error";
+        }
+
+        std::string make_document(std::size_t items)
+        {
+            std::string source = "<catalog>\n";
+            for (std::size_t i = 0; i < items; ++i)
+            {
+                source += "  <item>\n    <id>" + std::to_string(i) + "</id>\n    <name>item number " + std::to_string(i) + "</name>\n";
+                source += "    <description>a longer text describing the item, with some more words</description>\n  </item>\n";
+            }
+            source += "</catalog>\n";
+            return source;
+        }
+
+        template< typename FuncT >
+        long long measure_duration_ms(FuncT&& func)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        const char* const documents[] = {
+            "<a></a>",
+            "  <a>  hello world  </a>  ",
+            "<root><b>1</b> text <c><d>x</d></c>\n\t</root>",
+            "< a b ><x y>z</x y></  a b\n>",
+            "<a><b>text</b></a >",
+            "<a<b>t</a<b>",
+            "<a></b>",
+            "<a><b></a></b>",
+            "<a>",
+            "<a>text",
+            "text<a></a>",
+            "<a></a><b></b>",
+            "<a></a>trailing",
+            "<a>< /b></a>",
+            "<a><></a>",
+            "</a>",
+            "<a></ab>",
+            "",
+            "   ",
+        };
+
+    } // anonymous namespace
+
+
+    TEST_CASE("mini_xml_document", "[mini_xml]")
+    {
+
+        SECTION("When parsing, the nodes are linked and point into the source")
+        {
+            // ARRANGE
+            const std::string source = "<root> first <child>inner</child><empty></empty> last</root>";
+            client::mini_xml_document document;
+
+            // ACT
+            const auto parsed = document.parse(source);
+
+            // ASSERT
+            REQUIRE(parsed);
+            REQUIRE(document.size() == 6);
+            REQUIRE(document.root().value == "root");
+            REQUIRE(document.root().parent == client::mini_xml_document::npos);
+            std::vector<std::string_view> children;
+            document.for_each_child(0, [&](std::uint32_t, const client::mini_xml_flat_node& node) { children.push_back(node.value); });
+            REQUIRE((children == std::vector<std::string_view>{ "first ", "child", "empty", "last" }));
+            REQUIRE(document[2].kind == client::mini_xml_node_kind::element);
+            REQUIRE(document[3].value == "inner");
+            REQUIRE(document[3].parent == 2);
+            REQUIRE(document[4].first_child == client::mini_xml_document::npos);
+            for (const auto& node : document.nodes())
+                REQUIRE((node.value.data() >= source.data() && node.value.data() + node.value.size() <= source.data() + source.size()));
+        }
+
+        SECTION("When the input is malformed, the error offset is reported")
+        {
+            client::mini_xml_document document;
+            REQUIRE(!document.parse("<a><b></c></a>"));
+            REQUIRE(document.error_offset() == 6);
+            REQUIRE(!document.parse("<a>"));
+            REQUIRE(document.error_offset() == 3);
+            REQUIRE(document.parse("<a/>   </a/>"));
+            REQUIRE(document.error_offset() == std::string_view::npos);
+        }
+
+        SECTION("When parsing, it accepts the same language as the Spirit grammar")
+        {
+            for (const auto document : documents)
+            {
+                INFO(document);
+                REQUIRE(flat_events(document) == spirit_events(document));
+            }
+            const auto generated = make_document(50);
+            REQUIRE(flat_events(generated) == spirit_events(generated));
+        }
+
+    }
+
+    TEST_CASE("mini_xml_sax_parser", "[mini_xml]")
+    {
+
+        SECTION("When fed in chunks of any size, it reports the same events as the document")
+        {
+            for (const auto document : documents)
+            {
+                for (std::size_t chunk_size = 1; chunk_size <= 16; ++chunk_size)
+                {
+                    INFO(document << " / " << chunk_size);
+                    REQUIRE(sax_events(document, chunk_size) == flat_events(document));
+                }
+            }
+            const auto generated = make_document(50);
+            for (const std::size_t chunk_size : { 1, 7, 64, 4096 })
+                REQUIRE(sax_events(generated, chunk_size) == flat_events(generated));
+        }
+
+        SECTION("When an error occurs, its offset is relative to the whole input")
+        {
+            event_recorder recorder;
+            client::mini_xml_sax_parser<event_recorder> parser(recorder);
+            REQUIRE(parser.feed("<a><b>te"));
+            REQUIRE(!parser.feed("xt</c></a>"));
+            REQUIRE(parser.error_offset() == 10);
+            REQUIRE(!parser.feed("</a>"));
+            REQUIRE(!parser.finish());
+        }
+
+        SECTION("When reading a stream")
+        {
+            std::istringstream in(make_document(10));
+            event_counter counter;
+            REQUIRE(client::parse_mini_xml_stream(in, counter, 100));
+            REQUIRE(counter.count == 1 + 10 * 7);
+        }
+
+    }
+
+    TEST_CASE("mini_xml benchmark", "[.][benchmark]")
+    {
+        const auto source = make_document(40000);
+
+        std::size_t spirit_count = 0;
+        const auto spirit_duration = measure_duration_ms([&] {
+            client::mini_xml ast;
+            REQUIRE(parse_spirit(source, ast));
+            spirit_count = ast.children.size();
+        });
+
+        std::size_t flat_count = 0;
+        const auto flat_duration = measure_duration_ms([&] {
+            client::mini_xml_document document;
+            REQUIRE(document.parse(source));
+            flat_count = document.size();
+        });
+
+        event_counter counter;
+        const auto sax_duration = measure_duration_ms([&] {
+            std::istringstream in(source);
+            REQUIRE(client::parse_mini_xml_stream(in, counter));
+        });
+
+        REQUIRE(spirit_count == 40000);
+        REQUIRE(flat_count == counter.count);
+        std::cout << source.size() / 1024 << " KiB, " << flat_count << " nodes\n";
+        std::cout << "spirit: " << spirit_duration << " ms\n";
+        std::cout << "flat document: " << flat_duration << " ms\n";
+        std::cout << "sax (64 KiB chunks): " << sax_duration << " ms\n";
+    }
+
+} // namespace ut
@@ -0,0 +1,774 @@
+#pragma once
+
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+// Compile-time checked printf-like formatting
+// - the format string is a literal wrapped with PASC_FORMAT, parsed by constexpr functions:
+//   a mismatch between the format string and the arguments fails to compile, and nothing is checked at runtime
+// - the output is written in a single pass into a caller-supplied buffer, or into a stack buffer which falls back to the heap
+// - %n is rejected, length modifiers must match the size of the arguments
+
+
+namespace pasc {
+
+    struct FormatStringTag
+    {
+    };
+
+} // namespace pasc
+
+
+#define PASC_FORMAT(format_literal) \
+    [] { \
+        struct FormatString : ::pasc::FormatStringTag \
+        { \
+            static constexpr std::string_view value() { return format_literal; } \
+        }; \
+        return FormatString{}; \
+    }()
+
+
+namespace pasc { namespace detail {
+
+    enum class LengthModifier
+    {
+        None, hh, h, l, ll, j, z, t, L,
+    };
+
+    constexpr std::size_t noArg = static_cast<std::size_t>(-1);
+    constexpr int notSpecified = -1;
+    constexpr int fromArg = -2;
+
+    struct FormatSpec
+    {
+        std::size_t m_begin = 0; // offset of the '%'
+        std::size_t m_end = 0; // offset after the conversion specifier
+        bool m_leftAlign = false;
+        bool m_plusSign = false;
+        bool m_spaceSign = false;
+        bool m_alternate = false;
+        bool m_zeroPad = false;
+        int m_width = notSpecified;
+        int m_precision = notSpecified;
+        LengthModifier m_length = LengthModifier::None;
+        char m_conversion = 0;
+        std::size_t m_widthArg = noArg;
+        std::size_t m_precisionArg = noArg;
+        std::size_t m_arg = noArg;
+    };
+
+    constexpr bool isDigit(char character)
+    {
+        return character >= '0' && character <= '9';
+    }
+
+    constexpr int parseNumber(std::string_view format, std::size_t& pos)
+    {
+        int number = 0;
+        while (pos < format.size() && isDigit(format[pos]))
+            number = number * 10 + (format[pos++] - '0');
+        return number;
+    }
+
+    // Parses the specifier starting at the '%' found at pos, and moves pos after it
+    constexpr bool parseSpec(std::string_view format, std::size_t& pos, std::size_t& argsCount, FormatSpec& spec)
+    {
+        spec = FormatSpec{};
+        spec.m_begin = pos++;
+
+        for (; pos < format.size(); ++pos)
+        {
+            const auto character = format[pos];
+            if (character == '-')
+                spec.m_leftAlign = true;
+            else if (character == '+')
+                spec.m_plusSign = true;
+            else if (character == ' ')
+                spec.m_spaceSign = true;
+            else if (character == '#')
+                spec.m_alternate = true;
+            else if (character == '0')
+                spec.m_zeroPad = true;
+            else
+                break;
+        }
+
+        if (pos < format.size() && format[pos] == '*')
+        {
+            ++pos;
+            spec.m_width = fromArg;
+            spec.m_widthArg = argsCount++;
+        }
+        else if (pos < format.size() && isDigit(format[pos]))
+        {
+            spec.m_width = parseNumber(format, pos);
+        }
+
+        if (pos < format.size() && format[pos] == '.')
+        {
+            ++pos;
+            if (pos < format.size() && format[pos] == '*')
+            {
+                ++pos;
+                spec.m_precision = fromArg;
+                spec.m_precisionArg = argsCount++;
+            }
+            else if (pos < format.size() && isDigit(format[pos]))
+            {
+                spec.m_precision = parseNumber(format, pos);
+            }
+            else
+            {
+                return false; // '.' must be followed by '*' or an integer number
+            }
+        }
+
+        if (pos < format.size())
+        {
+            switch (format[pos])
+            {
+            case 'h':
+                ++pos;
+                spec.m_length = LengthModifier::h;
+                if (pos < format.size() && format[pos] == 'h')
+                {
+                    ++pos;
+                    spec.m_length = LengthModifier::hh;
+                }
+                break;
+            case 'l':
+                ++pos;
+                spec.m_length = LengthModifier::l;
+                if (pos < format.size() && format[pos] == 'l')
+                {
+                    ++pos;
+                    spec.m_length = LengthModifier::ll;
+                }
+                break;
+            case 'j': ++pos; spec.m_length = LengthModifier::j; break;
+            case 'z': ++pos; spec.m_length = LengthModifier::z; break;
+            case 't': ++pos; spec.m_length = LengthModifier::t; break;
+            case 'L': ++pos; spec.m_length = LengthModifier::L; break;
+            }
+        }
+
+        if (pos == format.size())
+            return false;
+
+        switch (format[pos])
+        {
+        case '%':
+            if (pos != spec.m_begin + 1)
+                return false;
+            break;
+        case 'c': case 's': case 'd': case 'i': case 'o': case 'x': case 'X': case 'u':
+        case 'f': case 'F': case 'e': case 'E': case 'a': case 'A': case 'g': case 'G': case 'p':
+            spec.m_arg = argsCount++;
+            break;
+        default:
+            return false; // unknown conversion, or %n
+        }
+        spec.m_conversion = format[pos++];
+        spec.m_end = pos;
+        return true;
+    }
+
+    struct FormatInfo
+    {
+        bool m_valid = true;
+        std::size_t m_specsCount = 0;
+        std::size_t m_argsCount = 0;
+    };
+
+    constexpr FormatInfo getFormatInfo(std::string_view format)
+    {
+        FormatInfo info;
+        for (std::size_t pos = 0; pos < format.size();)
+        {
+            if (format[pos] != '%')
+            {
+                ++pos;
+                continue;
+            }
+            FormatSpec spec;
+            if (!parseSpec(format, pos, info.m_argsCount, spec))
+            {
+                info.m_valid = false;
+                break;
+            }
+            ++info.m_specsCount;
+        }
+        return info;
+    }
+
+    template< std::size_t SpecsCountV >
+    constexpr std::array<FormatSpec, SpecsCountV> parseSpecs(std::string_view format)
+    {
+        std::array<FormatSpec, SpecsCountV> specs{};
+        std::size_t argsCount = 0;
+        std::size_t specIndex = 0;
+        for (std::size_t pos = 0; pos < format.size() && specIndex < SpecsCountV;)
+        {
+            if (format[pos] != '%')
+            {
+                ++pos;
+                continue;
+            }
+            parseSpec(format, pos, argsCount, specs[specIndex++]);
+        }
+        return specs;
+    }
+
+    enum class ArgKind
+    {
+        SignedInteger, UnsignedInteger, Floating, LongDouble, CharPointer, Pointer, Other,
+    };
+
+    struct ArgInfo
+    {
+        ArgKind m_kind = ArgKind::Other;
+        std::size_t m_size = 0;
+    };
+
+    template< typename ArgT >
+    constexpr ArgInfo getArgInfo()
+    {
+        using Type = std::decay_t<ArgT>;
+        if (std::is_integral<Type>::value)
+            return {std::is_signed<Type>::value ? ArgKind::SignedInteger : ArgKind::UnsignedInteger, sizeof(Type)};
+        if (std::is_same<Type, long double>::value)
+            return {ArgKind::LongDouble, sizeof(Type)};
+        if (std::is_floating_point<Type>::value)
+            return {ArgKind::Floating, sizeof(Type)};
+        if (std::is_pointer<Type>::value && std::is_same<std::remove_cv_t<std::remove_pointer_t<Type>>, char>::value)
+            return {ArgKind::CharPointer, sizeof(Type)};
+        if (std::is_pointer<Type>::value)
+            return {ArgKind::Pointer, sizeof(Type)};
+        return {ArgKind::Other, sizeof(Type)};
+    }
+
+    constexpr bool isInteger(const ArgInfo& arg)
+    {
+        return arg.m_kind == ArgKind::SignedInteger || arg.m_kind == ArgKind::UnsignedInteger;
+    }
+
+    constexpr std::size_t getIntegerSize(LengthModifier length)
+    {
+        switch (length)
+        {
+        case LengthModifier::hh: return sizeof(char);
+        case LengthModifier::h: return sizeof(short);
+        case LengthModifier::l: return sizeof(long);
+        case LengthModifier::ll: return sizeof(long long);
+        case LengthModifier::j: return sizeof(std::intmax_t);
+        case LengthModifier::z: return sizeof(std::size_t);
+        case LengthModifier::t: return sizeof(std::ptrdiff_t);
+        default: return 0;
+        }
+    }
+
+    constexpr bool isCompatible(const FormatSpec& spec, const ArgInfo& arg)
+    {
+        switch (spec.m_conversion)
+        {
+        case 'c':
+            return isInteger(arg) && spec.m_length == LengthModifier::None;
+        case 'd': case 'i': case 'o': case 'x': case 'X': case 'u':
+            if (!isInteger(arg) || spec.m_length == LengthModifier::L)
+                return false;
+            return spec.m_length == LengthModifier::None || getIntegerSize(spec.m_length) == arg.m_size;
+        case 'f': case 'F': case 'e': case 'E': case 'a': case 'A': case 'g': case 'G':
+            if (spec.m_length == LengthModifier::L)
+                return arg.m_kind == ArgKind::LongDouble;
+            return arg.m_kind == ArgKind::Floating && (spec.m_length == LengthModifier::None || spec.m_length == LengthModifier::l);
+        case 's':
+            return arg.m_kind == ArgKind::CharPointer && spec.m_length == LengthModifier::None;
+        case 'p':
+            return (arg.m_kind == ArgKind::Pointer || arg.m_kind == ArgKind::CharPointer) && spec.m_length == LengthModifier::None;
+        }
+        return false;
+    }
+
+    template< typename... ArgsT >
+    constexpr bool checkFormat(std::string_view format)
+    {
+        const auto info = getFormatInfo(format);
+        if (!info.m_valid || info.m_argsCount != sizeof...(ArgsT))
+            return false;
+        const ArgInfo args[] = { getArgInfo<ArgsT>()..., ArgInfo{} };
+        std::size_t argsCount = 0;
+        for (std::size_t pos = 0; pos < format.size();)
+        {
+            if (format[pos] != '%')
+            {
+                ++pos;
+                continue;
+            }
+            FormatSpec spec;
+            parseSpec(format, pos, argsCount, spec);
+            if (spec.m_widthArg != noArg && !isInteger(args[spec.m_widthArg]))
+                return false;
+            if (spec.m_precisionArg != noArg && !isInteger(args[spec.m_precisionArg]))
+                return false;
+            if (spec.m_arg != noArg && !isCompatible(spec, args[spec.m_arg]))
+                return false;
+        }
+        return true;
+    }
+
+    template< typename FormatT >
+    struct CompiledFormat
+    {
+        static constexpr std::string_view format = FormatT::value();
+        static constexpr FormatInfo info = getFormatInfo(format);
+        static constexpr std::array<FormatSpec, info.m_specsCount> specs = parseSpecs<info.m_specsCount>(format);
+    };
+
+    // Output of the formatting functions: writes into a given buffer, and either stops at its end or moves to the heap
+    class FormatBuffer
+    {
+    public:
+
+        FormatBuffer(char* data, std::size_t capacity, bool canGrow)
+            : m_data(data)
+            , m_capacity(capacity)
+            , m_canGrow(canGrow)
+        {
+        }
+
+        FormatBuffer(FormatBuffer const&) = delete;
+
+        FormatBuffer& operator=(FormatBuffer const&) = delete;
+
+        void append(const char* string, std::size_t count)
+        {
+            if (count == 0 || !reserve(count))
+                return;
+            std::memcpy(m_data + m_size, string, count);
+            m_size += count;
+        }
+
+        void fill(char character, std::size_t count)
+        {
+            if (count == 0 || !reserve(count))
+                return;
+            std::memset(m_data + m_size, character, count);
+            m_size += count;
+        }
+
+        // Adds the terminating null character, which is not counted in the size
+        bool terminate()
+        {
+            if (!reserve(1))
+            {
+                if (m_capacity != 0)
+                    m_data[m_capacity - 1] = '\0';
+                return false;
+            }
+            m_data[m_size] = '\0';
+            return !m_overflow;
+        }
+
+        const char* data() const
+        {
+            return m_data;
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        bool overflowed() const
+        {
+            return m_overflow;
+        }
+
+    private:
+
+        bool reserve(std::size_t count)
+        {
+            if (m_overflow)
+                return false;
+            if (m_size + count <= m_capacity)
+                return true;
+            if (!m_canGrow)
+            {
+                m_overflow = true;
+                return false;
+            }
+            auto capacity = m_capacity * 2;
+            if (capacity < m_size + count)
+                capacity = m_size + count;
+            auto heap = std::make_unique<char[]>(capacity);
+            std::memcpy(heap.get(), m_data, m_size);
+            m_heap = std::move(heap);
+            m_data = m_heap.get();
+            m_capacity = capacity;
+            return true;
+        }
+
+        char* m_data;
+        std::size_t m_size = 0;
+        std::size_t m_capacity;
+        bool m_canGrow;
+        bool m_overflow = false;
+        std::unique_ptr<char[]> m_heap;
+    };
+
+    inline void pad(FormatBuffer& buffer, int width, std::size_t length)
+    {
+        if (width > 0 && static_cast<std::size_t>(width) > length)
+            buffer.fill(' ', static_cast<std::size_t>(width) - length);
+    }
+
+    // Writes sign/prefix + zeros + digits, padded to width
+    inline void writePadded(FormatBuffer& buffer, int width, bool leftAlign, bool zeroPad,
+                            std::string_view prefix, std::size_t zerosCount, std::string_view digits)
+    {
+        const auto length = prefix.size() + zerosCount + digits.size();
+        if (zeroPad && !leftAlign && width > 0 && static_cast<std::size_t>(width) > length)
+            zerosCount += static_cast<std::size_t>(width) - length;
+        else if (!leftAlign)
+            pad(buffer, width, length);
+        buffer.append(prefix.data(), prefix.size());
+        buffer.fill('0', zerosCount);
+        buffer.append(digits.data(), digits.size());
+        if (leftAlign)
+            pad(buffer, width, prefix.size() + zerosCount + digits.size());
+    }
+
+    inline void writeInteger(FormatBuffer& buffer, const FormatSpec& spec, int width, bool leftAlign, int precision,
+                             std::uintmax_t magnitude, bool negative)
+    {
+        int base = 10;
+        if (spec.m_conversion == 'o')
+            base = 8;
+        else if (spec.m_conversion == 'x' || spec.m_conversion == 'X')
+            base = 16;
+
+        char digits[3 * sizeof(std::uintmax_t) + 1];
+        auto digitsEnd = digits;
+        if (magnitude != 0 || precision != 0)
+            digitsEnd = std::to_chars(digits, digits + sizeof(digits), magnitude, base).ptr;
+        if (spec.m_conversion == 'X')
+            for (auto it = digits; it != digitsEnd; ++it)
+                if (*it >= 'a' && *it <= 'f')
+                    *it = static_cast<char>(*it - 'a' + 'A');
+        const auto digitsCount = static_cast<std::size_t>(digitsEnd - digits);
+
+        std::size_t zerosCount = 0;
+        if (precision > 0 && static_cast<std::size_t>(precision) > digitsCount)
+            zerosCount = static_cast<std::size_t>(precision) - digitsCount;
+
+        std::string_view prefix;
+        if (spec.m_conversion == 'd' || spec.m_conversion == 'i')
+        {
+            if (negative)
+                prefix = "-";
+            else if (spec.m_plusSign)
+                prefix = "+";
+            else if (spec.m_spaceSign)
+                prefix = " ";
+        }
+        else if (spec.m_alternate)
+        {
+            if (spec.m_conversion == 'o' && zerosCount == 0 && (digitsCount == 0 || digits[0] != '0'))
+                zerosCount = 1;
+            else if (spec.m_conversion == 'x' && magnitude != 0)
+                prefix = "0x";
+            else if (spec.m_conversion == 'X' && magnitude != 0)
+                prefix = "0X";
+        }
+
+        writePadded(buffer, width, leftAlign, spec.m_zeroPad && precision < 0, prefix, zerosCount,
+                    std::string_view(digits, digitsCount));
+    }
+
+    inline void writeString(FormatBuffer& buffer, int width, bool leftAlign, int precision, const char* string)
+    {
+        if (!string)
+            string = "(null)";
+        std::size_t length = 0;
+        if (precision < 0)
+            length = std::strlen(string);
+        else
+            while (length < static_cast<std::size_t>(precision) && string[length])
+                ++length;
+        if (!leftAlign)
+            pad(buffer, width, length);
+        buffer.append(string, length);
+        if (leftAlign)
+            pad(buffer, width, length);
+    }
+
+    // Formats a single specifier with the C library, for the rare cases not handled natively
+    template< typename ArgT >
+    inline void writeWithSnprintf(FormatBuffer& buffer, std::string_view format, const FormatSpec& spec, int width, int precision, ArgT arg)
+    {
+        char specFormat[32] = "%";
+        auto it = specFormat + 1;
+        if (spec.m_leftAlign)
+            *it++ = '-';
+        if (spec.m_plusSign)
+            *it++ = '+';
+        if (spec.m_spaceSign)
+            *it++ = ' ';
+        if (spec.m_alternate)
+            *it++ = '#';
+        if (spec.m_zeroPad)
+            *it++ = '0';
+        *it++ = '*';
+        *it++ = '.';
+        *it++ = '*';
+        if (spec.m_length == LengthModifier::L)
+            *it++ = 'L';
+        *it++ = format[spec.m_end - 1];
+        *it = '\0';
+
+        char local[512];
+        const auto length = std::snprintf(local, sizeof(local), specFormat, width, precision, arg);
+        if (length < 0)
+            return;
+        if (static_cast<std::size_t>(length) < sizeof(local))
+            return buffer.append(local, static_cast<std::size_t>(length));
+        auto heap = std::make_unique<char[]>(static_cast<std::size_t>(length) + 1);
+        std::snprintf(heap.get(), static_cast<std::size_t>(length) + 1, specFormat, width, precision, arg);
+        buffer.append(heap.get(), static_cast<std::size_t>(length));
+    }
+
+    inline void writeFloating(FormatBuffer& buffer, std::string_view format, const FormatSpec& spec, int width, bool leftAlign, int precision, double value)
+    {
+        std::chars_format charsFormat = std::chars_format::fixed;
+        switch (spec.m_conversion)
+        {
+        case 'e': case 'E': charsFormat = std::chars_format::scientific; break;
+        case 'g': case 'G': charsFormat = std::chars_format::general; break;
+        case 'a': case 'A': return writeWithSnprintf(buffer, format, spec, leftAlign ? -width : width, precision, value);
+        }
+        if (spec.m_alternate)
+            return writeWithSnprintf(buffer, format, spec, leftAlign ? -width : width, precision, value);
+
+        char digits[512];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value, charsFormat, precision < 0 ? 6 : precision);
+        if (result.ec != std::errc{})
+            return writeWithSnprintf(buffer, format, spec, leftAlign ? -width : width, precision, value);
+
+        std::string_view number(digits, static_cast<std::size_t>(result.ptr - digits));
+        const bool negative = !number.empty() && number[0] == '-';
+        if (negative)
+            number.remove_prefix(1);
+        if (spec.m_conversion == 'F' || spec.m_conversion == 'E' || spec.m_conversion == 'G')
+            for (auto it = digits; it != result.ptr; ++it)
+                if (*it >= 'a' && *it <= 'z')
+                    *it = static_cast<char>(*it - 'a' + 'A');
+
+        std::string_view prefix;
+        if (negative)
+            prefix = "-";
+        else if (spec.m_plusSign)
+            prefix = "+";
+        else if (spec.m_spaceSign)
+            prefix = " ";
+
+        writePadded(buffer, width, leftAlign, spec.m_zeroPad && std::isfinite(value), prefix, 0, number);
+    }
+
+    template< typename ArgT >
+    inline int getStarValue(const ArgT& arg)
+    {
+        return static_cast<int>(arg);
+    }
+
+    template< typename CompiledFormatT, std::size_t SpecIndexV, typename ArgT >
+    inline void writeArg(FormatBuffer& buffer, std::string_view format, int width, bool leftAlign, int precision, const ArgT& arg)
+    {
+        using Type = std::decay_t<ArgT>;
+        constexpr const FormatSpec& spec = CompiledFormatT::specs[SpecIndexV];
+        constexpr auto conversion = spec.m_conversion;
+        if constexpr (conversion == 'c')
+        {
+            const char character = static_cast<char>(arg);
+            if (!leftAlign)
+                pad(buffer, width, 1);
+            buffer.append(&character, 1);
+            if (leftAlign)
+                pad(buffer, width, 1);
+        }
+        else if constexpr (conversion == 's')
+        {
+            writeString(buffer, width, leftAlign, precision, arg);
+        }
+        else if constexpr (conversion == 'p')
+        {
+            writeWithSnprintf(buffer, format, spec, leftAlign ? -width : width, precision, static_cast<const void*>(arg));
+        }
+        else if constexpr (std::is_floating_point<Type>::value)
+        {
+            if constexpr (std::is_same<Type, long double>::value)
+                writeWithSnprintf(buffer, format, spec, leftAlign ? -width : width, precision, arg);
+            else
+                writeFloating(buffer, format, spec, width, leftAlign, precision, static_cast<double>(arg));
+        }
+        else
+        {
+            // Same conversions as printf: integral promotion, then narrowing to the length modifier
+            using Promoted = decltype(+arg);
+            using Signed = std::conditional_t<spec.m_length == LengthModifier::hh, signed char,
+                           std::conditional_t<spec.m_length == LengthModifier::h, short, std::make_signed_t<Promoted>>>;
+            using Unsigned = std::make_unsigned_t<Signed>;
+            if constexpr (conversion == 'd' || conversion == 'i')
+            {
+                const auto value = static_cast<Signed>(arg);
+                const auto magnitude = value < 0 ? std::uintmax_t(0) - static_cast<std::uintmax_t>(value) : static_cast<std::uintmax_t>(value);
+                writeInteger(buffer, spec, width, leftAlign, precision, magnitude, value < 0);
+            }
+            else
+            {
+                writeInteger(buffer, spec, width, leftAlign, precision, static_cast<Unsigned>(arg), false);
+            }
+        }
+    }
+
+    template< typename CompiledFormatT, std::size_t SpecIndexV, typename ArgsTupleT >
+    inline void writeSpec(FormatBuffer& buffer, const ArgsTupleT& args)
+    {
+        constexpr const FormatSpec& spec = CompiledFormatT::specs[SpecIndexV];
+        constexpr auto format = CompiledFormatT::format;
+        constexpr std::size_t textBegin = SpecIndexV == 0 ? 0 : CompiledFormatT::specs[SpecIndexV - 1].m_end;
+        buffer.append(format.data() + textBegin, spec.m_begin - textBegin);
+
+        if constexpr (spec.m_conversion == '%')
+        {
+            buffer.append("%", 1);
+        }
+        else
+        {
+            int width = spec.m_width;
+            bool leftAlign = spec.m_leftAlign;
+            if constexpr (spec.m_widthArg != noArg)
+            {
+                width = getStarValue(std::get<spec.m_widthArg>(args));
+                if (width < 0)
+                {
+                    leftAlign = true;
+                    width = -width;
+                }
+            }
+            int precision = spec.m_precision;
+            if constexpr (spec.m_precisionArg != noArg)
+            {
+                precision = getStarValue(std::get<spec.m_precisionArg>(args));
+                if (precision < 0)
+                    precision = notSpecified;
+            }
+            writeArg<CompiledFormatT, SpecIndexV>(buffer, format, width, leftAlign, precision, std::get<spec.m_arg>(args));
+        }
+    }
+
+    template< typename CompiledFormatT, typename ArgsTupleT, std::size_t... SpecIndexesV >
+    inline void writeSpecs(FormatBuffer& buffer, const ArgsTupleT& args, std::index_sequence<SpecIndexesV...>)
+    {
+        (writeSpec<CompiledFormatT, SpecIndexesV>(buffer, args), ...);
+        constexpr auto format = CompiledFormatT::format;
+        constexpr std::size_t textBegin = sizeof...(SpecIndexesV) == 0 ? 0 : CompiledFormatT::specs[sizeof...(SpecIndexesV) - 1].m_end;
+        buffer.append(format.data() + textBegin, format.size() - textBegin);
+    }
+
+    template< typename FormatT, typename... ArgsT >
+    inline void format(FormatBuffer& buffer, FormatT, const ArgsT&... args)
+    {
+        static_assert(std::is_base_of<FormatStringTag, FormatT>::value, "the format string must be wrapped with PASC_FORMAT");
+        constexpr bool isValid = checkFormat<ArgsT...>(FormatT::value());
+        static_assert(isValid, "the format string does not match the arguments");
+        if constexpr (isValid)
+        {
+            using Compiled = CompiledFormat<FormatT>;
+            writeSpecs<Compiled>(buffer, std::forward_as_tuple(args...), std::make_index_sequence<Compiled::info.m_specsCount>{});
+        }
+    }
+
+} } // namespace pasc::detail
+
+
+namespace pasc {
+
+    // Formatted string stored in place when it fits in BufferSizeV characters (including the null terminator), on the heap otherwise
+    template< std::size_t BufferSizeV >
+    class FormattedString
+    {
+    public:
+
+        template< typename FormatT, typename... ArgsT >
+        FormattedString(FormatT format, const ArgsT&... args)
+        {
+            detail::format(m_buffer, format, args...);
+            m_buffer.terminate();
+        }
+
+        FormattedString(FormattedString const&) = delete;
+
+        FormattedString& operator=(FormattedString const&) = delete;
+
+        const char* c_str() const
+        {
+            return m_buffer.data();
+        }
+
+        std::size_t size() const
+        {
+            return m_buffer.size();
+        }
+
+        std::string_view view() const
+        {
+            return std::string_view(m_buffer.data(), m_buffer.size());
+        }
+
+    private:
+
+        char m_storage[BufferSizeV];
+        detail::FormatBuffer m_buffer{m_storage, BufferSizeV, true};
+    };
+
+    // Formats into a caller-supplied buffer; returns the length of the output, or -1 when it does not fit (the buffer then holds a truncated string)
+    template< std::size_t BufferSizeV, typename FormatT, typename... ArgsT >
+    inline int format_to(char (&buffer)[BufferSizeV], FormatT format, const ArgsT&... args)
+    {
+        detail::FormatBuffer formatBuffer(buffer, BufferSizeV, false);
+        detail::format(formatBuffer, format, args...);
+        if (!formatBuffer.terminate())
+            return -1;
+        return static_cast<int>(formatBuffer.size());
+    }
+
+    // Formats into a stack buffer of BufferSizeV characters, falling back to the heap for longer outputs
+    template< std::size_t BufferSizeV = 256, typename FormatT, typename... ArgsT >
+    inline FormattedString<BufferSizeV> format(FormatT format, const ArgsT&... args)
+    {
+        return FormattedString<BufferSizeV>(format, args...);
+    }
+
+    template< typename FormatT, typename... ArgsT >
+    inline int format_print(FILE* file, FormatT format, const ArgsT&... args)
+    {
+        const FormattedString<256> formatted(format, args...);
+        if (std::fwrite(formatted.c_str(), 1, formatted.size(), file) != formatted.size())
+            return -1;
+        return static_cast<int>(formatted.size());
+    }
+
+} // namespace pasc
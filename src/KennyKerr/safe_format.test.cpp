@@ -0,0 +1,180 @@
+#include <catch2/catch.hpp>
+#include "safe_format.h"
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+
+namespace ut {
+
+    namespace {
+
+        template< typename... ArgsT >
+        std::string snprintf_to_string(const char* format, const ArgsT&... args)
+        {
+            char buffer[1024];
+            const auto length = std::snprintf(buffer, sizeof(buffer), format, args...);
+            return std::string(buffer, static_cast<std::size_t>(length));
+        }
+
+        template< typename FuncT >
+        long long measure_duration_ms(FuncT&& func)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    } // anonymous namespace
+
+
+#define REQUIRE_SAME_AS_SNPRINTF(format_literal, ...) \
+    REQUIRE(std::string(pasc::format(PASC_FORMAT(format_literal), __VA_ARGS__).view()) == snprintf_to_string(format_literal, __VA_ARGS__))
+
+
+    // Mismatches are compile errors, so the checks are exercised with static_assert
+    static_assert(pasc::detail::checkFormat<>("12345"), "");
+    static_assert(pasc::detail::checkFormat<>("100%%"), "");
+    static_assert(!pasc::detail::checkFormat<>("0123%d456"), "");
+    static_assert(!pasc::detail::checkFormat<int>("12345"), "");
+    static_assert(!pasc::detail::checkFormat<int>("12%s34%d"), "");
+    static_assert(pasc::detail::checkFormat<int, const char*>("%d%s"), "");
+    static_assert(!pasc::detail::checkFormat<int, const char*>("%li%s%s"), "");
+    static_assert(pasc::detail::checkFormat<char, long long>("%%%c$%lld"), "");
+    static_assert(!pasc::detail::checkFormat<int>("%lld"), "");
+    static_assert(!pasc::detail::checkFormat<double>("%d"), "");
+    static_assert(!pasc::detail::checkFormat<long double>("%f"), "");
+    static_assert(pasc::detail::checkFormat<long double>("%Lf"), "");
+    static_assert(pasc::detail::checkFormat<int, int, double>("%*.*f"), "");
+    static_assert(!pasc::detail::checkFormat<double, int, double>("%*.*f"), "");
+    static_assert(!pasc::detail::checkFormat<int*>("%n"), "");
+    static_assert(!pasc::detail::checkFormat<int>("%.d"), "");
+    static_assert(!pasc::detail::checkFormat<int>("%d%"), "");
+    static_assert(pasc::detail::checkFormat<void*>("%p"), "");
+
+
+    TEST_CASE("format", "[printf]")
+    {
+
+        SECTION("When the format has no specifier")
+        {
+            REQUIRE(std::string(pasc::format(PASC_FORMAT("12345")).view()) == "12345");
+            REQUIRE(std::string(pasc::format(PASC_FORMAT("100%%")).view()) == "100%");
+            REQUIRE(std::string(pasc::format(PASC_FORMAT("")).view()).empty());
+        }
+
+        SECTION("When formatting integers")
+        {
+            REQUIRE_SAME_AS_SNPRINTF("%d!!!", 42);
+            REQUIRE_SAME_AS_SNPRINTF(" %i|%d|%d", -42, INT_MIN, INT_MAX);
+            REQUIRE_SAME_AS_SNPRINTF("Octal:%o|%#o|%#o", 42, 42, 0);
+            REQUIRE_SAME_AS_SNPRINTF("0x%x0x|%#x|%#X|%#x", 15, 255, 255, 0);
+            REQUIRE_SAME_AS_SNPRINTF(".%u.%x.", 1234u, -1);
+            REQUIRE_SAME_AS_SNPRINTF("%+010d!!!%i", 42, 42);
+            REQUIRE_SAME_AS_SNPRINTF(" %i!!!0x%08X", 42, 0x123);
+            REQUIRE_SAME_AS_SNPRINTF("[%5d|%-5d|% d|%+d|%05d|%-05d]", 42, 42, 42, 0, -42, -42);
+            REQUIRE_SAME_AS_SNPRINTF("[%.3d|%8.3d|%08.3d|%.0d|%5.0d]", 7, -7, 7, 0, 0);
+            REQUIRE_SAME_AS_SNPRINTF("%lld|%llu|%llx", LLONG_MIN, ULLONG_MAX, 123LL);
+            REQUIRE_SAME_AS_SNPRINTF("%hhd|%hhu|%hd|%hu", static_cast<signed char>(-1), static_cast<unsigned char>(255), static_cast<short>(-2), static_cast<unsigned short>(65535));
+            REQUIRE_SAME_AS_SNPRINTF("%zu|%zx", std::size_t(12345), std::size_t(255));
+            REQUIRE_SAME_AS_SNPRINTF("%*d|%-*d|%*d", 6, 42, 6, 42, -6, 42);
+        }
+
+        SECTION("When formatting characters and strings")
+        {
+            REQUIRE_SAME_AS_SNPRINTF("%%%c$", 'A');
+            REQUIRE_SAME_AS_SNPRINTF("he-%s++", "BOO");
+            REQUIRE_SAME_AS_SNPRINTF("[%10s|%-10s|%.2s|%10.2s|%.*s|%3c|%-3c]", "abc", "abc", "abc", "abc", 1, "abc", 'x', 'y');
+            const char* string = "pointer";
+            REQUIRE_SAME_AS_SNPRINTF("%s=%d", string, 1);
+        }
+
+        SECTION("When formatting floating point numbers")
+        {
+            REQUIRE_SAME_AS_SNPRINTF("%f****", 23.45);
+            REQUIRE_SAME_AS_SNPRINTF("%F****", 23.45);
+            REQUIRE_SAME_AS_SNPRINTF("%e****|%E", 23.45, 23.45);
+            REQUIRE_SAME_AS_SNPRINTF("%a/hex|%A", 23.45, 23.45);
+            REQUIRE_SAME_AS_SNPRINTF("???%g|%G???", 23.45, 98.6543e-10);
+            REQUIRE_SAME_AS_SNPRINTF("%f**%.1f**%.0f", 23.45, 23.45, 2.5);
+            REQUIRE_SAME_AS_SNPRINTF("[%10.3f|%-10.3f|%+.2e|% f|%010.2f|%+010.2f]", 3.14159, 3.14159, 31415.9, 1.0, -2.5, 2.5);
+            REQUIRE_SAME_AS_SNPRINTF("[%g|%g|%g|%.0g|%#g|%#.0f]", 100000.0, 1000000.0, 0.0001, 0.5, 1.5, 3.0);
+            REQUIRE_SAME_AS_SNPRINTF("[%f|%5f|%05f|%F|%f]", HUGE_VAL, -HUGE_VAL, HUGE_VAL, HUGE_VAL, std::nan(""));
+            REQUIRE_SAME_AS_SNPRINTF("[%f|%e]", 1e300, -0.0);
+            REQUIRE_SAME_AS_SNPRINTF("[%f|%.2lf]", 1.5f, 2.25);
+            REQUIRE_SAME_AS_SNPRINTF("[%Lf|%10.3Le]", 1.5L, 2.25L);
+            REQUIRE_SAME_AS_SNPRINTF("%*.*f", 12, 3, 3.14159);
+        }
+
+        SECTION("When formatting pointers")
+        {
+            int value = 0;
+            REQUIRE_SAME_AS_SNPRINTF("p:%p", static_cast<void*>(&value));
+        }
+
+        SECTION("When the output does not fit in the stack buffer")
+        {
+            const std::string long_string(1000, 'x');
+            const auto formatted = pasc::format<16>(PASC_FORMAT("[%s]%d"), long_string.c_str(), 42);
+            REQUIRE(formatted.size() == 1004);
+            REQUIRE(std::string(formatted.c_str()) == "[" + long_string + "]42");
+        }
+
+    }
+
+    TEST_CASE("format_to", "[printf]")
+    {
+
+        SECTION("When the output fits in the buffer")
+        {
+            char buffer[10];
+            REQUIRE(pasc::format_to(buffer, PASC_FORMAT("%s%d"), "1234", 56789) == 9);
+            REQUIRE(std::string(buffer) == "123456789");
+        }
+
+        SECTION("When the output does not fit in the buffer")
+        {
+            char buffer[10];
+            REQUIRE(pasc::format_to(buffer, PASC_FORMAT("%s%d"), "1234", 567890) == -1);
+            REQUIRE(std::string(buffer) == "123456789");
+        }
+
+    }
+
+    TEST_CASE("format benchmark", "[.][benchmark]")
+    {
+        const int iterations = 1000000;
+        std::size_t total = 0;
+
+        const auto format_duration = measure_duration_ms([&] {
+            for (int i = 0; i < iterations; ++i)
+                total += pasc::format(PASC_FORMAT("%s:%d %08.3f 0x%x|%-10s|"), "item", i, i * 0.5, i, "name").size();
+        });
+
+        const auto snprintf_duration = measure_duration_ms([&] {
+            char buffer[256];
+            for (int i = 0; i < iterations; ++i)
+                total += static_cast<std::size_t>(std::snprintf(buffer, sizeof(buffer), "%s:%d %08.3f 0x%x|%-10s|", "item", i, i * 0.5, i, "name"));
+        });
+
+        const auto ostringstream_duration = measure_duration_ms([&] {
+            for (int i = 0; i < iterations; ++i)
+            {
+                std::ostringstream os;
+                os << "item" << ':' << i << ' ' << std::setw(8) << std::setfill('0') << std::fixed << std::setprecision(3) << i * 0.5
+                   << std::setfill(' ') << " 0x" << std::hex << i << std::dec << '|' << std::left << std::setw(10) << "name" << '|';
+                total += os.str().size();
+            }
+        });
+
+        REQUIRE(total != 0);
+        std::cout << "format: " << format_duration << " ms\n";
+        std::cout << "snprintf: " << snprintf_duration << " ms\n";
+        std::cout << "ostringstream: " << ostringstream_duration << " ms\n";
+    }
+
+} // namespace ut
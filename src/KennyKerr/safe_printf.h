@@ -341,15 +341,19 @@ namespace pasc { namespace detail {
     template< typename BufferT, typename... ArgsT >
     inline int sprintf_check_adjust_buffer_size(BufferT& buffer, const char* format, const ArgsT&... args)
     {
+#if defined(_MSC_VER)
 #pragma warning(push)
 #pragma warning(disable : 4996) // warning C4996: 'sprintf': This function or variable may be unsafe. Consider using sprintf_s instead. To disable deprecation, use _CRT_SECURE_NO_WARNINGS. See online help for details.
-        const auto resulting_string_length = _snprintf(nullptr, 0, format, args...);
+#endif
+        const auto resulting_string_length = std::snprintf(nullptr, 0, format, args...);
         if (resulting_string_length < 0)
             return -1;
         if (!buffer_check_adjust_size(buffer, static_cast<size_t>(resulting_string_length) + 1))
             return -1;
         return std::sprintf(buffer_get_data(buffer), format, args...);
+#if defined(_MSC_VER)
 #pragma warning(pop)
+#endif
     }
 
 } } // namespace pasc::detail
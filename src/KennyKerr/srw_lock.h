@@ -1,13 +1,390 @@
-
 #pragma once
 
 
 #include "compatibility.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+#if defined(_WIN32)
 #include <windows.h>
+#if defined(_MSC_VER)
+#pragma comment(lib, "Synchronization.lib")
+#endif
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace kkerr { namespace detail {
+
+    // Blocks while the word still holds the expected value (spurious wake ups are possible)
+    inline void wait_on_address(std::atomic<std::uint32_t>& word, std::uint32_t expected) KKERR_NOEXCEPT
+    {
+#if defined(_WIN32)
+        ::WaitOnAddress(&word, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+        if (word.load(std::memory_order_relaxed) == expected)
+            std::this_thread::yield();
+#endif
+    }
+
+    inline void wake_one(std::atomic<std::uint32_t>& word) KKERR_NOEXCEPT
+    {
+#if defined(_WIN32)
+        ::WakeByAddressSingle(&word);
+#elif defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+
+    inline void wake_all(std::atomic<std::uint32_t>& word) KKERR_NOEXCEPT
+    {
+#if defined(_WIN32)
+        ::WakeByAddressAll(&word);
+#elif defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+
+    inline void cpu_relax() KKERR_NOEXCEPT
+    {
+#if defined(_WIN32)
+        YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    template< typename LockT, typename = void >
+    struct SharedToken
+    {
+        using type = void;
+    };
+
+    template< typename LockT >
+    struct SharedToken<LockT, std::void_t<decltype(std::declval<LockT&>().lock_shared())>>
+    {
+        using type = decltype(std::declval<LockT&>().lock_shared());
+    };
+
+} } // namespace kkerr::detail
 
 
 namespace kkerr {
 
+    // Reader-writer lock on a single futex word, preferring writers:
+    // once a writer waits, new readers wait too
+    class RWLock
+    {
+    public:
+
+        RWLock() KKERR_NOEXCEPT = default;
+
+        RWLock(RWLock const&) = delete;
+
+        RWLock& operator=(RWLock const&) = delete;
+
+        RWLock(RWLock&&) = delete;
+
+        RWLock& operator=(RWLock&&) = delete;
+
+        void lock() KKERR_NOEXCEPT
+        {
+            std::uint32_t state = 0;
+            if (m_state.compare_exchange_strong(state, WRITER, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            lock_contended();
+        }
+
+        bool try_lock() KKERR_NOEXCEPT
+        {
+            auto state = m_state.load(std::memory_order_relaxed);
+            return (state & (WRITER | READERS_MASK)) == 0
+                && m_state.compare_exchange_strong(state, state | WRITER, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void unlock() KKERR_NOEXCEPT
+        {
+            if (m_state.exchange(0, std::memory_order_release) & (WRITERS_WAITING | READERS_WAITING))
+                detail::wake_all(m_state);
+        }
+
+        void lock_shared() KKERR_NOEXCEPT
+        {
+            auto state = m_state.load(std::memory_order_relaxed);
+            if ((state & (WRITER | WRITERS_WAITING)) == 0
+                && m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            lock_shared_contended();
+        }
+
+        bool try_lock_shared() KKERR_NOEXCEPT
+        {
+            auto state = m_state.load(std::memory_order_relaxed);
+            while ((state & (WRITER | WRITERS_WAITING)) == 0)
+            {
+                if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+            }
+            return false;
+        }
+
+        void unlock_shared() KKERR_NOEXCEPT
+        {
+            const auto state = m_state.fetch_sub(1, std::memory_order_release) - 1;
+            if ((state & READERS_MASK) == 0 && (state & WRITERS_WAITING))
+                detail::wake_all(m_state);
+        }
+
+    private:
+
+        static constexpr std::uint32_t WRITER = 1u << 31;
+        static constexpr std::uint32_t WRITERS_WAITING = 1u << 30;
+        static constexpr std::uint32_t READERS_WAITING = 1u << 29;
+        static constexpr std::uint32_t READERS_MASK = READERS_WAITING - 1;
+        static constexpr int SPIN_COUNT = 100;
+
+        void lock_contended() KKERR_NOEXCEPT
+        {
+            for (int spin = 0; spin < SPIN_COUNT; ++spin)
+            {
+                auto state = m_state.load(std::memory_order_relaxed);
+                if ((state & (WRITER | READERS_MASK)) == 0
+                    && m_state.compare_exchange_weak(state, state | WRITER, std::memory_order_acquire, std::memory_order_relaxed))
+                    return;
+                detail::cpu_relax();
+            }
+            auto state = m_state.load(std::memory_order_relaxed);
+            while (true)
+            {
+                // After waiting, keep the waiting flag: other writers may still be asleep
+                if ((state & (WRITER | READERS_MASK)) == 0)
+                {
+                    if (m_state.compare_exchange_weak(state, state | WRITER | WRITERS_WAITING, std::memory_order_acquire, std::memory_order_relaxed))
+                        return;
+                    continue;
+                }
+                if ((state & WRITERS_WAITING) == 0
+                    && !m_state.compare_exchange_weak(state, state | WRITERS_WAITING, std::memory_order_relaxed))
+                    continue;
+                detail::wait_on_address(m_state, state | WRITERS_WAITING);
+                state = m_state.load(std::memory_order_relaxed);
+            }
+        }
+
+        void lock_shared_contended() KKERR_NOEXCEPT
+        {
+            for (int spin = 0; spin < SPIN_COUNT; ++spin)
+            {
+                if (try_lock_shared())
+                    return;
+                detail::cpu_relax();
+            }
+            auto state = m_state.load(std::memory_order_relaxed);
+            while (true)
+            {
+                if ((state & (WRITER | WRITERS_WAITING)) == 0)
+                {
+                    if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                        return;
+                    continue;
+                }
+                if ((state & READERS_WAITING) == 0
+                    && !m_state.compare_exchange_weak(state, state | READERS_WAITING, std::memory_order_relaxed))
+                    continue;
+                detail::wait_on_address(m_state, state | READERS_WAITING);
+                state = m_state.load(std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic<std::uint32_t> m_state{0};
+    };
+
+    // Mutex spinning for a while before parking the thread, the spin budget adapting to the observed hold times
+    class AdaptiveMutex
+    {
+    public:
+
+        AdaptiveMutex() KKERR_NOEXCEPT = default;
+
+        AdaptiveMutex(AdaptiveMutex const&) = delete;
+
+        AdaptiveMutex& operator=(AdaptiveMutex const&) = delete;
+
+        AdaptiveMutex(AdaptiveMutex&&) = delete;
+
+        AdaptiveMutex& operator=(AdaptiveMutex&&) = delete;
+
+        void lock() KKERR_NOEXCEPT
+        {
+            std::uint32_t state = UNLOCKED;
+            if (m_state.compare_exchange_strong(state, LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            lock_contended();
+        }
+
+        bool try_lock() KKERR_NOEXCEPT
+        {
+            std::uint32_t state = UNLOCKED;
+            return m_state.compare_exchange_strong(state, LOCKED, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void unlock() KKERR_NOEXCEPT
+        {
+            if (m_state.exchange(UNLOCKED, std::memory_order_release) == CONTENDED)
+                detail::wake_one(m_state);
+        }
+
+    private:
+
+        static constexpr std::uint32_t UNLOCKED = 0;
+        static constexpr std::uint32_t LOCKED = 1;
+        static constexpr std::uint32_t CONTENDED = 2;
+        static constexpr int MAX_SPIN_COUNT = 1000;
+
+        void lock_contended() KKERR_NOEXCEPT
+        {
+            const auto spin_limit = std::min(MAX_SPIN_COUNT, m_spin_average.load(std::memory_order_relaxed) * 2 + 10);
+            for (int spin = 0; spin < spin_limit; ++spin)
+            {
+                if (m_state.load(std::memory_order_relaxed) == UNLOCKED && try_lock())
+                {
+                    const auto average = m_spin_average.load(std::memory_order_relaxed);
+                    m_spin_average.store(average + (spin - average) / 8, std::memory_order_relaxed);
+                    return;
+                }
+                detail::cpu_relax();
+            }
+            const auto average = m_spin_average.load(std::memory_order_relaxed);
+            m_spin_average.store(average + (spin_limit - average) / 8, std::memory_order_relaxed);
+            while (m_state.exchange(CONTENDED, std::memory_order_acquire) != UNLOCKED)
+                detail::wait_on_address(m_state, CONTENDED);
+        }
+
+        std::atomic<std::uint32_t> m_state{UNLOCKED};
+        std::atomic<int> m_spin_average{0};
+    };
+
+    // Reader-writer lock with a biased fast path for readers, after "BRAVO - Biased Locking for Reader-Writer Locks" (Dice & Kogan):
+    // while the lock is read-biased, readers only publish themselves in a slot of a global table hashed by thread and lock,
+    // so that readers running on different cores do not share any cache line.
+    // A writer revokes the bias and waits for the published readers to leave; the bias is re-enabled by a slow reader
+    // after a delay proportional to the cost of the revocation.
+    template< typename UnderlyingLockT = RWLock >
+    class BravoRWLock
+    {
+    public:
+
+        // Identifies how a reader acquired the lock (null when it went through the underlying lock)
+        using ReadToken = std::atomic<const void*>*;
+
+        BravoRWLock() KKERR_NOEXCEPT = default;
+
+        BravoRWLock(BravoRWLock const&) = delete;
+
+        BravoRWLock& operator=(BravoRWLock const&) = delete;
+
+        BravoRWLock(BravoRWLock&&) = delete;
+
+        BravoRWLock& operator=(BravoRWLock&&) = delete;
+
+        void lock() KKERR_NOEXCEPT
+        {
+            m_lock.lock();
+            if (m_read_bias.load(std::memory_order_relaxed))
+                revoke_bias();
+        }
+
+        void unlock() KKERR_NOEXCEPT
+        {
+            m_lock.unlock();
+        }
+
+        ReadToken lock_shared() KKERR_NOEXCEPT
+        {
+            if (m_read_bias.load(std::memory_order_acquire))
+            {
+                auto& slot = visible_readers()[slot_index()];
+                const void* expected = nullptr;
+                if (slot.compare_exchange_strong(expected, this, std::memory_order_seq_cst))
+                {
+                    if (m_read_bias.load(std::memory_order_seq_cst))
+                        return &slot;
+                    slot.store(nullptr, std::memory_order_release);
+                }
+            }
+            m_lock.lock_shared();
+            if (!m_read_bias.load(std::memory_order_relaxed) && now() >= m_inhibit_until.load(std::memory_order_relaxed))
+                m_read_bias.store(true, std::memory_order_release);
+            return nullptr;
+        }
+
+        void unlock_shared(ReadToken token) KKERR_NOEXCEPT
+        {
+            if (token)
+                token->store(nullptr, std::memory_order_release);
+            else
+                m_lock.unlock_shared();
+        }
+
+    private:
+
+        static constexpr std::size_t VISIBLE_READERS_COUNT = 4096;
+        static constexpr std::int64_t INHIBIT_MULTIPLIER = 9;
+
+        using VisibleReaders = std::array<std::atomic<const void*>, VISIBLE_READERS_COUNT>;
+
+        static VisibleReaders& visible_readers() KKERR_NOEXCEPT
+        {
+            static VisibleReaders readers{};
+            return readers;
+        }
+
+        static std::int64_t now() KKERR_NOEXCEPT
+        {
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+
+        std::size_t slot_index() const KKERR_NOEXCEPT
+        {
+            static thread_local const std::uint64_t thread_hash = std::hash<std::thread::id>()(std::this_thread::get_id()) * 0x9E3779B97F4A7C15ull;
+            const std::uint64_t lock_hash = reinterpret_cast<std::uintptr_t>(this) >> 4;
+            return static_cast<std::size_t>(((thread_hash ^ (lock_hash * 0xC2B2AE3D27D4EB4Full)) >> 16) % VISIBLE_READERS_COUNT);
+        }
+
+        void revoke_bias() KKERR_NOEXCEPT
+        {
+            m_read_bias.store(false, std::memory_order_seq_cst);
+            const auto start = now();
+            for (auto& slot : visible_readers())
+                while (slot.load(std::memory_order_seq_cst) == this)
+                    detail::cpu_relax();
+            m_inhibit_until.store(now() + (now() - start) * INHIBIT_MULTIPLIER, std::memory_order_relaxed);
+        }
+
+        std::atomic<bool> m_read_bias{true};
+        std::atomic<std::int64_t> m_inhibit_until{0};
+        UnderlyingLockT m_lock;
+    };
+
+#if defined(_WIN32)
+
     class SRWLock
     {
     public:
@@ -27,16 +404,43 @@ namespace kkerr {
             ::AcquireSRWLockExclusive(&m_lock);
         }
 
+        bool try_lock() KKERR_NOEXCEPT
+        {
+            return ::TryAcquireSRWLockExclusive(&m_lock) != 0;
+        }
+
         void unlock() KKERR_NOEXCEPT
         {
             ::ReleaseSRWLockExclusive(&m_lock);
         }
 
+        void lock_shared() KKERR_NOEXCEPT
+        {
+            ::AcquireSRWLockShared(&m_lock);
+        }
+
+        bool try_lock_shared() KKERR_NOEXCEPT
+        {
+            return ::TryAcquireSRWLockShared(&m_lock) != 0;
+        }
+
+        void unlock_shared() KKERR_NOEXCEPT
+        {
+            ::ReleaseSRWLockShared(&m_lock);
+        }
+
     private:
 
         SRWLOCK m_lock = {};
     };
 
+#else
+
+    using SRWLock = RWLock;
+
+#endif
+
+    template< typename LockT = SRWLock >
     class LockGuard
     {
     public:
@@ -49,7 +453,7 @@ namespace kkerr {
 
         LockGuard& operator=(LockGuard&&) = delete;
 
-        explicit LockGuard(SRWLock& lock) KKERR_NOEXCEPT 
+        explicit LockGuard(LockT& lock) KKERR_NOEXCEPT
             : m_lock(lock)
         {
             m_lock.lock();
@@ -62,7 +466,57 @@ namespace kkerr {
 
     private:
 
-        SRWLock& m_lock;
+        LockT& m_lock;
+    };
+
+    // Holds a lock in shared mode; works with locks whose lock_shared() returns a token to give back to unlock_shared()
+    template< typename LockT = SRWLock >
+    class SharedLockGuard
+    {
+    public:
+
+        SharedLockGuard(SharedLockGuard const&) = delete;
+
+        SharedLockGuard& operator=(SharedLockGuard const&) = delete;
+
+        SharedLockGuard(SharedLockGuard&&) = delete;
+
+        SharedLockGuard& operator=(SharedLockGuard&&) = delete;
+
+        explicit SharedLockGuard(LockT& lock) KKERR_NOEXCEPT
+            : m_lock(lock)
+            , m_token(acquire(lock))
+        {
+        }
+
+        ~SharedLockGuard() KKERR_NOEXCEPT
+        {
+            if constexpr (std::is_void<Token>::value)
+                m_lock.unlock_shared();
+            else
+                m_lock.unlock_shared(m_token);
+        }
+
+    private:
+
+        using Token = typename detail::SharedToken<LockT>::type;
+        using TokenHolder = std::conditional_t<std::is_void<Token>::value, bool, Token>;
+
+        static TokenHolder acquire(LockT& lock) KKERR_NOEXCEPT
+        {
+            if constexpr (std::is_void<Token>::value)
+            {
+                lock.lock_shared();
+                return true;
+            }
+            else
+            {
+                return lock.lock_shared();
+            }
+        }
+
+        LockT& m_lock;
+        TokenHolder m_token;
     };
 
 } // namespace kkerr
@@ -1,3 +1,232 @@
-
 #include <catch2/catch.hpp>
 #include "srw_lock.h"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+
+namespace ut {
+
+    namespace {
+
+        // Writers keep the two values equal, readers check that they never see them differ
+        struct SharedData
+        {
+            long long m_first = 0;
+            long long m_second = 0;
+        };
+
+        template< typename LockT >
+        struct Exclusive
+        {
+            using Guard = kkerr::LockGuard<LockT>;
+        };
+
+        template< typename LockT >
+        struct Shared
+        {
+            using Guard = kkerr::SharedLockGuard<LockT>;
+        };
+
+        template< typename LockT, template< typename > class ReadModeT >
+        bool run_readers_writers(int threads_count, int iterations, int write_percent, long long& writes_count)
+        {
+            LockT lock;
+            SharedData data;
+            std::atomic<bool> consistent{true};
+            std::vector<std::thread> threads;
+            for (int thread_index = 0; thread_index < threads_count; ++thread_index)
+            {
+                threads.emplace_back([&, thread_index] {
+                    unsigned random = static_cast<unsigned>(thread_index) * 7919u + 1u;
+                    for (int iteration = 0; iteration < iterations; ++iteration)
+                    {
+                        random = random * 1103515245u + 12345u;
+                        if (static_cast<int>((random >> 16) % 100) < write_percent)
+                        {
+                            kkerr::LockGuard<LockT> guard(lock);
+                            ++data.m_first;
+                            ++data.m_second;
+                        }
+                        else
+                        {
+                            typename ReadModeT<LockT>::Guard guard(lock);
+                            if (data.m_first != data.m_second)
+                                consistent = false;
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+            writes_count = data.m_first;
+            return consistent && data.m_first == data.m_second;
+        }
+
+        template< typename LockT, template< typename > class ReadModeT >
+        long long measure_duration_ms(int threads_count, int iterations, int write_percent)
+        {
+            long long writes_count = 0;
+            const auto start = std::chrono::steady_clock::now();
+            run_readers_writers<LockT, ReadModeT>(threads_count, iterations, write_percent, writes_count);
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        template< typename LockT >
+        void require_exclusive_counting()
+        {
+            LockT lock;
+            long long counter = 0;
+            std::vector<std::thread> threads;
+            for (int thread_index = 0; thread_index < 8; ++thread_index)
+            {
+                threads.emplace_back([&] {
+                    for (int iteration = 0; iteration < 20000; ++iteration)
+                    {
+                        kkerr::LockGuard<LockT> guard(lock);
+                        ++counter;
+                    }
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+            REQUIRE(counter == 8 * 20000);
+        }
+
+    } // anonymous namespace
+
+
+    TEST_CASE("RWLock", "[lock]")
+    {
+
+        SECTION("When locked exclusively, it excludes writers")
+        {
+            require_exclusive_counting<kkerr::RWLock>();
+        }
+
+        SECTION("When locked in shared mode, it admits other readers but no writer")
+        {
+            kkerr::RWLock lock;
+            lock.lock_shared();
+            REQUIRE(lock.try_lock_shared());
+            REQUIRE(!lock.try_lock());
+            lock.unlock_shared();
+            lock.unlock_shared();
+            REQUIRE(lock.try_lock());
+            REQUIRE(!lock.try_lock_shared());
+            lock.unlock();
+        }
+
+        SECTION("When readers and writers contend, readers never see a partial write")
+        {
+            long long writes_count = 0;
+            REQUIRE(run_readers_writers<kkerr::RWLock, Shared>(8, 20000, 20, writes_count));
+            REQUIRE(writes_count > 0);
+        }
+
+        SECTION("When a reader holds the lock, a writer waits for it")
+        {
+            kkerr::RWLock lock;
+            std::atomic<bool> written{false};
+            lock.lock_shared();
+            std::thread writer([&] {
+                kkerr::LockGuard<kkerr::RWLock> guard(lock);
+                written = true;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            REQUIRE(!written);
+            lock.unlock_shared();
+            writer.join();
+            REQUIRE(written);
+        }
+
+    }
+
+    TEST_CASE("AdaptiveMutex", "[lock]")
+    {
+
+        SECTION("When locked, it excludes other threads")
+        {
+            require_exclusive_counting<kkerr::AdaptiveMutex>();
+        }
+
+        SECTION("When locked, try_lock fails")
+        {
+            kkerr::AdaptiveMutex mutex;
+            mutex.lock();
+            REQUIRE(!mutex.try_lock());
+            mutex.unlock();
+            REQUIRE(mutex.try_lock());
+            mutex.unlock();
+        }
+
+    }
+
+    TEST_CASE("BravoRWLock", "[lock]")
+    {
+
+        SECTION("When locked exclusively, it excludes writers")
+        {
+            require_exclusive_counting<kkerr::BravoRWLock<>>();
+        }
+
+        SECTION("When readers and writers contend, readers never see a partial write")
+        {
+            long long writes_count = 0;
+            REQUIRE(run_readers_writers<kkerr::BravoRWLock<>, Shared>(8, 20000, 5, writes_count));
+            REQUIRE(writes_count > 0);
+        }
+
+        SECTION("When a biased reader holds the lock, a writer waits for it")
+        {
+            kkerr::BravoRWLock<> lock;
+            std::atomic<bool> written{false};
+            const auto token = lock.lock_shared();
+            REQUIRE(token != nullptr);
+            std::thread writer([&] {
+                kkerr::LockGuard<kkerr::BravoRWLock<>> guard(lock);
+                written = true;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            REQUIRE(!written);
+            lock.unlock_shared(token);
+            writer.join();
+            REQUIRE(written);
+        }
+
+    }
+
+    TEST_CASE("SRWLock", "[lock]")
+    {
+
+        SECTION("When readers and writers contend, readers never see a partial write")
+        {
+            long long writes_count = 0;
+            REQUIRE(run_readers_writers<kkerr::SRWLock, Shared>(8, 20000, 20, writes_count));
+        }
+
+    }
+
+    TEST_CASE("locks benchmark", "[.][benchmark]")
+    {
+        const int iterations = 200000;
+        const auto hardware_threads = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+        std::cout << "threads\twrite%\tstd::shared_mutex\tSRWLock\tRWLock\tBravoRWLock\tAdaptiveMutex (exclusive)\n";
+        for (int threads_count = 1; threads_count <= hardware_threads; threads_count *= 2)
+        {
+            for (const int write_percent : {0, 1, 10, 50})
+            {
+                std::cout << threads_count << '\t' << write_percent << '\t'
+                          << measure_duration_ms<std::shared_mutex, Shared>(threads_count, iterations, write_percent) << " ms\t"
+                          << measure_duration_ms<kkerr::SRWLock, Shared>(threads_count, iterations, write_percent) << " ms\t"
+                          << measure_duration_ms<kkerr::RWLock, Shared>(threads_count, iterations, write_percent) << " ms\t"
+                          << measure_duration_ms<kkerr::BravoRWLock<>, Shared>(threads_count, iterations, write_percent) << " ms\t"
+                          << measure_duration_ms<kkerr::AdaptiveMutex, Exclusive>(threads_count, iterations, write_percent) << " ms\n";
+            }
+        }
+    }
+
+} // namespace ut
@@ -1,8 +1,132 @@
 
 #include "vcard.hpp"
 #include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
 
+static std::string generateContacts(std::size_t contactsCount)
+{
+    // Synthetic export where a contact out of ten is an older copy of another one, sharing its email or its phone
+    std::mt19937 generator(42);
+    std::ostringstream file;
+    for (std::size_t contactIndex = 0; contactIndex < contactsCount; ++contactIndex)
+    {
+        auto personIndex = contactIndex;
+        if (contactIndex > 0 && generator() % 10 == 0)
+            personIndex = generator() % contactIndex;
+        file << "BEGIN:VCARD\r\n";
+        file << "VERSION:2.1\r\n";
+        file << "N:Name" << personIndex << ";First" << personIndex << ";;;\r\n";
+        file << "FN:First" << personIndex << " Name" << personIndex << "\r\n";
+        if (personIndex == contactIndex || generator() % 2 == 0)
+            file << "EMAIL;HOME:first" << personIndex << ".name" << personIndex << "@example.com\r\n";
+        if (personIndex == contactIndex || generator() % 2 == 0)
+            file << "TEL;CELL:+33 6 " << 10000000 + personIndex << "\r\n";
+        if (generator() % 3 == 0)
+            file << "ADR;HOME;ENCODING=QUOTED-PRINTABLE:;;" << personIndex << " rue de la Paix;Paris;;75002;France\r\n";
+        if (generator() % 4 == 0)
+            file << "NOTE;ENCODING=QUOTED-PRINTABLE:=43=6F=6C=6C=C3=A8=67=75=65\r\n";
+        file << "END:VCARD\r\n";
+    }
+    return file.str();
+}
+
+static std::size_t estimateMemoryUsage(const vcard::Directory::Contacts& contacts)
+{
+    std::size_t memoryUsage = contacts.capacity() * sizeof(vcard::Contact);
+    for (const auto& contact : contacts)
+    {
+        const auto& properties = contact.getProperties();
+        memoryUsage += properties.bucket_count() * sizeof(void*) + properties.size() * (sizeof(vcard::Contact::Properties::value_type) + 2 * sizeof(void*));
+        for (const auto& property : properties)
+        {
+            // Short strings are stored inline
+            if (property.first.capacity() > 15)
+                memoryUsage += property.first.capacity() + 1;
+            if (property.second.capacity() > 15)
+                memoryUsage += property.second.capacity() + 1;
+        }
+    }
+    return memoryUsage;
+}
+
+static bool haveSameContacts(const vcard::ContactStore& store, const vcard::ContactStore& otherStore)
+{
+    if (store.getContactsCount() != otherStore.getContactsCount() || store.getPropertiesCount() != otherStore.getPropertiesCount())
+        return false;
+    for (vcard::ContactStore::PropertyId propertyId = 0; propertyId < store.getPropertiesCount(); ++propertyId)
+    {
+        const auto otherPropertyId = otherStore.findPropertyId(store.getPropertyName(propertyId));
+        if (otherPropertyId == vcard::ContactStore::noPropertyId)
+            return false;
+        for (vcard::ContactStore::ContactIndex contactIndex = 0; contactIndex < store.getContactsCount(); ++contactIndex)
+        {
+            if (store.getProperty(contactIndex, propertyId) != otherStore.getProperty(contactIndex, otherPropertyId))
+                return false;
+        }
+    }
+    return true;
+}
+
+static void runBenchmark(std::size_t contactsCount, unsigned threadsCountMax)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto milliseconds = [](Clock::duration duration) { return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(); };
+    const auto megabytes = [](std::size_t bytes) { return bytes / (1024 * 1024); };
+
+    const auto contactsText = generateContacts(contactsCount);
+    std::cout << "Generated " << contactsCount << " contacts, " << megabytes(contactsText.size()) << " MB\n";
+
+    {
+        const auto start = Clock::now();
+        std::istringstream file(contactsText);
+        vcard::Directory::Contacts contacts;
+        while (file)
+        {
+            vcard::Contact contact;
+            contact.load(file);
+            if (!contact.getProperties().empty())
+                contacts.push_back(std::move(contact));
+        }
+        const auto duration = Clock::now() - start;
+        std::cout << "Contacts:     " << contacts.size() << " contacts loaded in " << milliseconds(duration) << " ms, about "
+                  << megabytes(estimateMemoryUsage(contacts)) << " MB\n";
+    }
+
+    const auto start = Clock::now();
+    std::istringstream file(contactsText);
+    vcard::ContactStore store;
+    store.load(file);
+    const auto loadDuration = Clock::now() - start;
+    std::cout << "ContactStore: " << store.getContactsCount() << " contacts loaded in " << milliseconds(loadDuration) << " ms, about "
+              << megabytes(store.getMemoryUsage()) << " MB, " << megabytes(contactsText.size()) * 1000. / std::max<long long>(1, milliseconds(loadDuration)) << " MB/s\n";
+
+    const auto contactsFilePath = stdnext::filesystem::temp_directory_path() / "vcard_benchmark.vcf";
+    std::ofstream(contactsFilePath.string(), std::ios::binary) << contactsText;
+    for (const auto threadsCount : {1U, threadsCountMax})
+    {
+        const auto mappedStart = Clock::now();
+        vcard::ContactStore mappedStore;
+        mappedStore.loadMappedFile(contactsFilePath, threadsCount);
+        const auto mappedDuration = Clock::now() - mappedStart;
+        std::cout << "Mapped file:  " << mappedStore.getContactsCount() << " contacts loaded in " << milliseconds(mappedDuration) << " ms with "
+                  << threadsCount << " thread(s), " << megabytes(contactsText.size()) * 1000. / std::max<long long>(1, milliseconds(mappedDuration)) << " MB/s, "
+                  << (haveSameContacts(store, mappedStore) ? "same contacts" : "DIFFERENT contacts") << "\n";
+    }
+    std::remove(contactsFilePath.string().c_str());
+
+    const auto deduplicateStart = Clock::now();
+    const auto removedCount = store.deduplicate();
+    const auto deduplicateDuration = Clock::now() - deduplicateStart;
+    std::cout << "ContactStore: " << removedCount << " duplicates merged in " << milliseconds(deduplicateDuration) << " ms, "
+              << store.getContactsCount() << " contacts left, about " << megabytes(store.getMemoryUsage()) << " MB with the index\n";
+}
 
 int main(int argc, char** argv)
 {
@@ -13,12 +137,23 @@ int main(int argc, char** argv)
         ("help", "produce help message")
         ("source", po::value<std::string>(), "contacts source file")
         ("target", po::value<std::string>(), "contacts target file")
+        ("columnar", "load the contacts into a columnar store")
+        ("deduplicate", "merge the contacts sharing an email or a phone (implies --columnar)")
+        ("mapped", "load the contacts into a columnar store from the file mapped in memory, in parallel")
+        ("threads", po::value<unsigned>()->default_value(std::max(1U, std::thread::hardware_concurrency())), "threads parsing the mapped file")
+        ("benchmark", po::value<std::size_t>(), "compare the contacts and the columnar store on this number of synthetic contacts")
         ;
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
     po::notify(vm);
 
+    if (vm.count("benchmark"))
+    {
+        runBenchmark(vm["benchmark"].as<std::size_t>(), vm["threads"].as<unsigned>());
+        return 0;
+    }
+
     if (vm.count("help") || ! vm.count("source") || !vm.count("target"))
     {
         std::cout << desc << "\n";
@@ -28,6 +163,22 @@ int main(int argc, char** argv)
     const auto sourceFileName = vm["source"].as<std::string>();
     const auto targetFileName = vm["target"].as<std::string>();
 
+    if (vm.count("columnar") || vm.count("deduplicate") || vm.count("mapped"))
+    {
+        vcard::ContactStore store;
+        if (!vm.count("mapped"))
+            store.loadFile(vcard::ContactFileType::Vcf, sourceFileName);
+        else if (!store.loadMappedFile(sourceFileName, vm["threads"].as<unsigned>()))
+        {
+            std::cout << "Could not open " << sourceFileName << "\n";
+            return 1;
+        }
+        if (vm.count("deduplicate"))
+            std::cout << store.deduplicate() << " duplicates merged\n";
+        store.saveFile(vcard::ContactFileType::Csv, targetFileName);
+        return 0;
+    }
+
     vcard::Directory directory;
 
     directory.loadFile(vcard::ContactFileType::Vcf, sourceFileName);
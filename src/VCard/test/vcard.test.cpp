@@ -0,0 +1,278 @@
+#include <catch2/catch.hpp>
+#include "../vcard.hpp"
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    const std::string vcfWithLf =
+        "BEGIN:VCARD\n"
+        "VERSION:3.0\n"
+        "FN:John Doe\n"
+        "EMAIL;TYPE=work:john@example.com\n"
+        "END:VCARD\n"
+        "BEGIN:VCARD\n"
+        "FN:Jane Roe\n"
+        "END:VCARD\n";
+
+    std::string withCrLf(const std::string& text)
+    {
+        std::string crLfText;
+        for (const auto c : text)
+        {
+            if (c == '\n')
+                crLfText += '\r';
+            crLfText += c;
+        }
+        return crLfText;
+    }
+
+    vcard::ContactStore makeStore(const std::string& vcf)
+    {
+        vcard::ContactStore store;
+        store.load(std::string_view(vcf));
+        return store;
+    }
+
+    stdnext::filesystem::path makeTemporaryFileName()
+    {
+        return stdnext::filesystem::temp_directory_path() / ("vcard_test_" + std::to_string(std::random_device{}()) + ".vcf");
+    }
+
+} // namespace
+
+TEST_CASE("Contact::load")
+{
+    for (const auto& vcf : {vcfWithLf, withCrLf(vcfWithLf)})
+    {
+        INFO((vcf == vcfWithLf ? "LF" : "CRLF"));
+        std::istringstream file(vcf);
+        vcard::Contact john;
+        vcard::Contact jane;
+
+        john.load(file);
+        jane.load(file);
+
+        // The '\r' of CRLF lines is dropped, so that END:VCARD ends each contact and no value keeps it
+        REQUIRE(john.getProperties().size() == 3);
+        REQUIRE(john.getProperties().at("FN") == "John Doe");
+        REQUIRE(john.getProperties().at("EMAIL") == "john@example.com");
+        REQUIRE(john.getProperties().at("VERSION") == "3.0");
+        REQUIRE(jane.getProperties().size() == 1);
+        REQUIRE(jane.getProperties().at("FN") == "Jane Roe");
+    }
+}
+
+TEST_CASE("ContactStore::load")
+{
+    for (const auto& vcf : {vcfWithLf, withCrLf(vcfWithLf)})
+    {
+        INFO((vcf == vcfWithLf ? "LF" : "CRLF"));
+        vcard::ContactStore streamStore;
+        std::istringstream file(vcf);
+        streamStore.load(file);
+        vcard::ContactStore textStore;
+        textStore.load(std::string_view(vcf));
+
+        for (const auto* store : {&streamStore, &textStore})
+        {
+            REQUIRE(store->getContactsCount() == 2);
+            REQUIRE(store->getProperty(0, store->findPropertyId("FN")) == "John Doe");
+            REQUIRE(store->getProperty(0, store->findPropertyId("EMAIL")) == "john@example.com");
+            REQUIRE(store->getProperty(1, store->findPropertyId("FN")) == "Jane Roe");
+        }
+    }
+}
+
+TEST_CASE("ContactStore::loadMappedFile")
+{
+    const auto fileName = makeTemporaryFileName();
+    std::string vcf;
+    for (int contactIndex = 0; contactIndex < 100; ++contactIndex)
+        vcf += "BEGIN:VCARD\r\nFN:Contact " + std::to_string(contactIndex) + "\r\nEND:VCARD\r\n";
+    std::ofstream(fileName.string(), std::ios::binary) << vcf;
+
+    vcard::ContactStore store;
+    const auto isLoaded = store.loadMappedFile(fileName, 3);
+    stdnext::filesystem::remove(fileName);
+
+    REQUIRE(isLoaded);
+    REQUIRE(store.getContactsCount() == 100);
+    REQUIRE(store.getProperty(99, store.findPropertyId("FN")) == "Contact 99");
+    REQUIRE(!store.loadMappedFile(fileName));
+}
+
+TEST_CASE("ContactStore::loadFile")
+{
+    const auto fileName = makeTemporaryFileName();
+    std::ofstream(fileName.string(), std::ios::binary) << vcfWithLf;
+
+    vcard::ContactStore store;
+    store.loadFile(vcard::ContactFileType::Vcf, fileName);
+    REQUIRE_THROWS_AS(store.loadFile(vcard::ContactFileType::Csv, fileName), std::invalid_argument);
+    stdnext::filesystem::remove(fileName);
+
+    REQUIRE(store.getContactsCount() == 2);
+    REQUIRE(store.getProperty(1, store.findPropertyId("FN")) == "Jane Roe");
+}
+
+TEST_CASE("ContactStore::findByEmail and findByPhone")
+{
+    auto store = makeStore(
+        "BEGIN:VCARD\nFN:A\nEMAIL:Ann@Example.com\nTEL:+33 1 23 45 67 89\nEND:VCARD\n"
+        "BEGIN:VCARD\nFN:B\nEMAIL:bob@example.com\nEND:VCARD\n"
+        "BEGIN:VCARD\nFN:C\nEMAIL: ann@example.com \nTEL:(33) 123-456-789\nEND:VCARD\n");
+    using Matches = std::vector<vcard::ContactStore::ContactIndex>;
+
+    // Nothing is found before the index is built
+    REQUIRE(store.findByEmail("ann@example.com").empty());
+
+    store.buildIndex();
+
+    // Emails match whatever their case and spaces, phones whatever their formatting
+    REQUIRE(store.findByEmail("ANN@example.COM") == Matches{0, 2});
+    REQUIRE(store.findByEmail("bob@example.com") == Matches{1});
+    REQUIRE(store.findByEmail("eve@example.com").empty());
+    REQUIRE(store.findByEmail("").empty());
+    REQUIRE(store.findByPhone("33123456789") == Matches{0, 2});
+    REQUIRE(store.findByPhone("123456789").empty());
+    REQUIRE(store.findByPhone("-").empty());
+
+    // Contacts added later are only found once the index is built again
+    const auto contactIndex = store.addContact();
+    store.addProperty(contactIndex, store.internPropertyName("EMAIL"), "eve@example.com");
+    REQUIRE(store.findByEmail("eve@example.com").empty());
+    store.buildIndex();
+    REQUIRE(store.findByEmail("eve@example.com") == Matches{3});
+}
+
+TEST_CASE("ContactStore::deduplicate")
+{
+    SECTION("When contacts are linked through other contacts")
+    {
+        // C shares nothing with A, but its phone is the one of B, whose email is the one of A
+        auto store = makeStore(
+            "BEGIN:VCARD\nFN:A\nEMAIL:a@example.com\nEND:VCARD\n"
+            "BEGIN:VCARD\nFN:C\nTEL:01 23\nNOTE:from C\nEND:VCARD\n"
+            "BEGIN:VCARD\nFN:D\nEMAIL:d@example.com\nTEL:4567\nEND:VCARD\n"
+            "BEGIN:VCARD\nFN:B\nEMAIL:A@EXAMPLE.COM\nTEL:0123\nNOTE:from B\nORG:from B\nEND:VCARD\n"
+            "BEGIN:VCARD\nFN:E\nTEL:45-67\nEND:VCARD\n");
+
+        REQUIRE(store.deduplicate() == 3);
+
+        // Each group is merged into its first contact, the missing properties being taken from the others in order
+        REQUIRE(store.getContactsCount() == 2);
+        const auto property = [&](vcard::ContactStore::ContactIndex contactIndex, const char* propertyName)
+        {
+            return store.getProperty(contactIndex, store.findPropertyId(propertyName));
+        };
+        REQUIRE(property(0, "FN") == "A");
+        REQUIRE(property(0, "EMAIL") == "a@example.com");
+        REQUIRE(property(0, "TEL") == "01 23");
+        REQUIRE(property(0, "NOTE") == "from C");
+        REQUIRE(property(0, "ORG") == "from B");
+        REQUIRE(property(1, "FN") == "D");
+        REQUIRE(property(1, "TEL") == "4567");
+        REQUIRE(property(1, "ORG").empty());
+
+        // The index is rebuilt for the remaining contacts
+        REQUIRE(store.findByEmail("a@example.com") == std::vector<vcard::ContactStore::ContactIndex>{0});
+        REQUIRE(store.findByPhone("4567") == std::vector<vcard::ContactStore::ContactIndex>{1});
+    }
+
+    SECTION("When no contacts are duplicated")
+    {
+        auto store = makeStore(vcfWithLf);
+
+        REQUIRE(store.deduplicate() == 0);
+        REQUIRE(store.getContactsCount() == 2);
+        REQUIRE(store.getProperty(1, store.findPropertyId("FN")) == "Jane Roe");
+    }
+
+    SECTION("When the values of the removed contacts are no longer needed")
+    {
+        const std::string note(100000, 'n');
+        auto store = makeStore(
+            "BEGIN:VCARD\nFN:A\nEMAIL:a@example.com\nNOTE:kept\nEND:VCARD\n"
+            "BEGIN:VCARD\nFN:B\nEMAIL:a@example.com\nNOTE:" + note + "\nEND:VCARD\n");
+        store.buildIndex();
+        const auto memoryUsage = store.getMemoryUsage();
+
+        REQUIRE(store.deduplicate() == 1);
+
+        // The arena is compacted, without the values hidden by those of the first contact
+        REQUIRE(store.getProperty(0, store.findPropertyId("NOTE")) == "kept");
+        REQUIRE(store.getMemoryUsage() + note.length() <= memoryUsage);
+    }
+}
+
+TEST_CASE("ContactStore::load decodes values as Contact::load")
+{
+    // The text loader decodes in place what the stream loader decodes through temporary strings
+    const std::vector<std::pair<std::string, std::string>> encodedValues{
+        {"=48=65=6C=6C=6F", "Hello"},
+        {"Doe;John;;Mr.;", "Doe John  Mr. "},
+        {";;", "  "},
+        {";=41;", " A "},
+        {"=41==42=", "AB"},
+        {"Caf=C3=A9", "Caf=C3=A9"},
+        {"=43=61=66=C3=A9;=", "Caf\xC3\xA9 "},
+        {"=", ""},
+        {"=6c", "`"},
+        {"", ""},
+    };
+    std::string vcf = "BEGIN:VCARD\n";
+    for (std::size_t valueIndex = 0; valueIndex < encodedValues.size(); ++valueIndex)
+        vcf += "X-VALUE-" + std::to_string(valueIndex) + ";ENCODING=QUOTED-PRINTABLE:" + encodedValues[valueIndex].first + "\n";
+    vcf += "END:VCARD\n";
+
+    std::istringstream file(vcf);
+    vcard::Contact contact;
+    contact.load(file);
+    const auto store = makeStore(vcf);
+
+    for (std::size_t valueIndex = 0; valueIndex < encodedValues.size(); ++valueIndex)
+    {
+        const auto propertyName = "X-VALUE-" + std::to_string(valueIndex);
+        INFO(encodedValues[valueIndex].first);
+        REQUIRE(contact.getProperties().at(propertyName) == encodedValues[valueIndex].second);
+        REQUIRE(store.getProperty(0, store.findPropertyId(propertyName)) == encodedValues[valueIndex].second);
+    }
+}
+
+TEST_CASE("ContactStore::loadMappedFile splits the file between contacts")
+{
+    // Contacts of the same length put the parts boundaries right on BEGIN:VCARD lines when the threads count
+    // divides the contacts count, and inside contacts otherwise; a BEGIN:VCARDS line is not taken for the start of a contact
+    std::string vcf;
+    const int contactsCount = 24;
+    for (int contactIndex = 0; contactIndex < contactsCount; ++contactIndex)
+    {
+        vcf += "BEGIN:VCARD\r\nFN:Contact " + std::to_string(10 + contactIndex) + "\r\n";
+        vcf += (contactIndex % 2 == 0) ? "NOTE:x\r\nBEGIN:VCARDS\r\n" : "NOTE:y\r\nX-NOTE:VCARDS\r\n";
+        vcf += "END:VCARD\r\n";
+    }
+    const auto fileName = makeTemporaryFileName();
+    std::ofstream(fileName.string(), std::ios::binary) << vcf;
+
+    for (unsigned threadsCount = 1; threadsCount <= 2 * contactsCount; ++threadsCount)
+    {
+        INFO(threadsCount);
+        vcard::ContactStore store;
+        REQUIRE(store.loadMappedFile(fileName, threadsCount));
+
+        REQUIRE(store.getContactsCount() == contactsCount);
+        for (int contactIndex = 0; contactIndex < contactsCount; ++contactIndex)
+        {
+            INFO(contactIndex);
+            REQUIRE(store.getProperty(contactIndex, store.findPropertyId("FN")) == "Contact " + std::to_string(10 + contactIndex));
+            REQUIRE(store.getProperty(contactIndex, store.findPropertyId("NOTE")) == ((contactIndex % 2 == 0) ? "x" : "y"));
+        }
+    }
+    stdnext::filesystem::remove(fileName);
+}
@@ -1,6 +1,14 @@
 
 #include "vcard.hpp"
+#include <platform/mapped_file.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
 #pragma warning(disable : 4348) // disable warning C4348: 'boost::spirit::terminal<boost::spirit::tag::lit>::result_helper': redefinition of default parameter: parameter 3
 #pragma warning(disable : 4180) // disable warning C4180: qualifier applied to function type has no meaning; ignored
 #include <boost/spirit/include/qi.hpp>
@@ -126,6 +134,8 @@ namespace vcard {
     {
         propertyName.clear();
         getline(file, propertyName);
+        if (!propertyName.empty() && propertyName.back() == '\r')
+            propertyName.pop_back();
         const auto colonPos = propertyName.find(':');
         if (colonPos == std::string::npos)
         {
@@ -232,5 +242,518 @@ namespace vcard {
         return m_contacts;
     }
 
+    static std::string normalizeEmail(std::string_view email)
+    {
+        std::string normalizedEmail;
+        normalizedEmail.reserve(email.length());
+        for (const auto c : email)
+        {
+            if (!std::isspace(static_cast<unsigned char>(c)))
+                normalizedEmail += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return normalizedEmail;
+    }
+
+    static std::string normalizePhone(std::string_view phone)
+    {
+        std::string normalizedPhone;
+        normalizedPhone.reserve(phone.length());
+        for (const auto c : phone)
+        {
+            if (c >= '0' && c <= '9')
+                normalizedPhone += c;
+        }
+        return normalizedPhone;
+    }
+
+    ContactStore::PropertyId ContactStore::internPropertyName(std::string_view propertyName)
+    {
+        const auto iterPropertyId = m_propertyIds.find(propertyName);
+        if (iterPropertyId != end(m_propertyIds))
+            return iterPropertyId->second;
+        const auto propertyId = static_cast<PropertyId>(m_propertyNames.size());
+        m_propertyNames.emplace_back(propertyName);
+        m_propertyIds.emplace(m_propertyNames.back(), propertyId);
+        m_columns.emplace_back();
+        return propertyId;
+    }
+
+    ContactStore::PropertyId ContactStore::findPropertyId(std::string_view propertyName) const
+    {
+        const auto iterPropertyId = m_propertyIds.find(propertyName);
+        return iterPropertyId != end(m_propertyIds) ? iterPropertyId->second : noPropertyId;
+    }
+
+    const std::string& ContactStore::getPropertyName(PropertyId propertyId) const
+    {
+        return m_propertyNames[propertyId];
+    }
+
+    std::size_t ContactStore::getPropertiesCount() const
+    {
+        return m_propertyNames.size();
+    }
+
+    ContactStore::ContactIndex ContactStore::addContact()
+    {
+        return m_contactsCount++;
+    }
+
+    void ContactStore::addProperty(ContactIndex contactIndex, PropertyId propertyId, std::string_view propertyValue)
+    {
+        if (propertyValue.empty())
+            return;
+        // Columns only grow up to the last contact having the property
+        auto& column = m_columns[propertyId];
+        if (column.size() <= contactIndex)
+            column.resize(contactIndex + 1);
+        auto& cell = column[contactIndex];
+        if (cell.length != 0)
+            return;
+        if (m_values.size() + propertyValue.length() > UINT32_MAX)
+            throw std::length_error("vcard::ContactStore values exceed 4 GB");
+        cell.offset = static_cast<std::uint32_t>(m_values.size());
+        cell.length = static_cast<std::uint32_t>(propertyValue.length());
+        m_values.append(propertyValue.data(), propertyValue.length());
+    }
+
+    std::string_view ContactStore::getProperty(ContactIndex contactIndex, PropertyId propertyId) const
+    {
+        if (propertyId >= m_columns.size())
+            return {};
+        const auto& column = m_columns[propertyId];
+        if (contactIndex >= column.size())
+            return {};
+        const auto& cell = column[contactIndex];
+        return std::string_view(m_values.data() + cell.offset, cell.length);
+    }
+
+    std::size_t ContactStore::getContactsCount() const
+    {
+        return m_contactsCount;
+    }
+
+    void ContactStore::load(std::istream& file)
+    {
+        std::string propertyName;
+        std::string propertyValue;
+        while (file)
+        {
+            loadProperty(file, propertyName, propertyValue);
+            while (file && (propertyName != "BEGIN" || propertyValue != "VCARD"))
+                loadProperty(file, propertyName, propertyValue);
+            if (!file)
+                return;
+            const auto contactIndex = addContact();
+            loadProperty(file, propertyName, propertyValue);
+            while (file && (propertyName != "END" || propertyValue != "VCARD"))
+            {
+                if (!propertyName.empty())
+                    addProperty(contactIndex, internPropertyName(propertyName), propertyValue);
+                loadProperty(file, propertyName, propertyValue);
+            }
+        }
+    }
+
+    // Value of each hexadecimal digit, the other characters counting as 0 as in decodeHexa
+    struct HexaTable
+    {
+        HexaTable()
+        {
+            for (int digit = 0; digit < 10; ++digit)
+                values['0' + digit] = static_cast<unsigned char>(digit);
+            for (int digit = 0; digit < 6; ++digit)
+                values['A' + digit] = static_cast<unsigned char>(10 + digit);
+        }
+        unsigned char values[256]{};
+    };
+
+    static const HexaTable hexaTable;
+
+    // Same result as decodePropertyValue, appended to decodedPropertyValue without temporary strings
+    static void decodePropertyValue(std::string_view encodedPropertyValue, std::string& decodedPropertyValue)
+    {
+        const auto* current = encodedPropertyValue.data();
+        const auto* const last = current + encodedPropertyValue.length();
+        for (;;)
+        {
+            const auto* partEnd = static_cast<const char*>(std::memchr(current, ';', static_cast<std::size_t>(last - current)));
+            if (!partEnd)
+                partEnd = last;
+            if (current != partEnd && *current == '=')
+            {
+                unsigned int number = 0;
+                bool hasDigits = false;
+                for (++current; current != partEnd; ++current)
+                {
+                    if (*current == '=')
+                    {
+                        if (hasDigits)
+                            decodedPropertyValue += static_cast<char>(number);
+                        number = 0;
+                        hasDigits = false;
+                        continue;
+                    }
+                    number = (number << 4) + hexaTable.values[static_cast<unsigned char>(*current)];
+                    hasDigits = true;
+                }
+                if (hasDigits)
+                    decodedPropertyValue += static_cast<char>(number);
+            }
+            else
+                decodedPropertyValue.append(current, partEnd);
+            if (partEnd == last)
+                return;
+            decodedPropertyValue += ' ';
+            current = partEnd + 1;
+        }
+    }
+
+    // Splits a line into its name, without parameters, and its raw value; the name is empty if there is no colon
+    static void splitProperty(std::string_view line, std::string_view& propertyName, std::string_view& encodedPropertyValue)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        const auto colonPos = line.find(':');
+        if (colonPos == std::string_view::npos)
+        {
+            propertyName = {};
+            encodedPropertyValue = {};
+            return;
+        }
+        encodedPropertyValue = line.substr(colonPos + 1);
+        propertyName = line.substr(0, std::min(colonPos, line.find(';')));
+    }
+
+    static bool isPlainValue(std::string_view encodedPropertyValue)
+    {
+        return encodedPropertyValue.find_first_of(";=") == std::string_view::npos;
+    }
+
+    void ContactStore::load(std::string_view text)
+    {
+        std::string decodedPropertyValue;
+        std::string_view propertyName;
+        std::string_view encodedPropertyValue;
+        const auto isLine = [&](std::string_view expectedName)
+        {
+            return propertyName == expectedName && isPlainValue(encodedPropertyValue) && encodedPropertyValue == "VCARD";
+        };
+        // Contacts mostly list the same properties in the same order, so the name is first compared with the one
+        // at the same position in the previous contact before being looked up
+        std::vector<PropertyId> previousPropertyIds;
+        std::vector<PropertyId> propertyIds;
+        const auto getPropertyId = [&]
+        {
+            const auto position = propertyIds.size();
+            const auto propertyId = (position < previousPropertyIds.size() && m_propertyNames[previousPropertyIds[position]] == propertyName)
+                ? previousPropertyIds[position]
+                : internPropertyName(propertyName);
+            propertyIds.push_back(propertyId);
+            return propertyId;
+        };
+        bool isInContact = false;
+        ContactIndex contactIndex = 0;
+        std::size_t lineStart = 0;
+        while (lineStart < text.length())
+        {
+            auto lineEnd = text.find('\n', lineStart);
+            if (lineEnd == std::string_view::npos)
+                lineEnd = text.length();
+            splitProperty(text.substr(lineStart, lineEnd - lineStart), propertyName, encodedPropertyValue);
+            lineStart = lineEnd + 1;
+
+            if (!isInContact)
+            {
+                if (isLine("BEGIN"))
+                {
+                    contactIndex = addContact();
+                    isInContact = true;
+                    propertyIds.clear();
+                }
+                continue;
+            }
+            if (isLine("END"))
+            {
+                isInContact = false;
+                std::swap(previousPropertyIds, propertyIds);
+                continue;
+            }
+            if (propertyName.empty())
+                continue;
+            if (isPlainValue(encodedPropertyValue))
+            {
+                addProperty(contactIndex, getPropertyId(), encodedPropertyValue);
+                continue;
+            }
+            decodedPropertyValue.clear();
+            decodePropertyValue(encodedPropertyValue, decodedPropertyValue);
+            addProperty(contactIndex, getPropertyId(), decodedPropertyValue);
+        }
+    }
+
+    void ContactStore::append(const ContactStore& other)
+    {
+        std::vector<PropertyId> propertyIds;
+        for (const auto& propertyName : other.m_propertyNames)
+        {
+            propertyIds.push_back(internPropertyName(propertyName));
+        }
+        if (m_values.size() + other.m_values.size() > UINT32_MAX)
+            throw std::length_error("vcard::ContactStore values exceed 4 GB");
+        const auto valuesOffset = static_cast<std::uint32_t>(m_values.size());
+        m_values += other.m_values;
+        for (PropertyId otherPropertyId = 0; otherPropertyId < other.m_columns.size(); ++otherPropertyId)
+        {
+            const auto& otherColumn = other.m_columns[otherPropertyId];
+            if (otherColumn.empty())
+                continue;
+            auto& column = m_columns[propertyIds[otherPropertyId]];
+            column.resize(m_contactsCount);
+            column.reserve(m_contactsCount + otherColumn.size());
+            for (const auto& cell : otherColumn)
+            {
+                column.push_back(cell.length != 0 ? Cell{cell.offset + valuesOffset, cell.length} : Cell{});
+            }
+        }
+        m_contactsCount += other.m_contactsCount;
+    }
+
+    bool ContactStore::loadMappedFile(const FilePath& fileName, unsigned threadsCount)
+    {
+        const platform::mapped_file file(fileName, platform::mapped_file_access::whole);
+        if (!file.is_open())
+            return false;
+        const auto text = file.view();
+
+        // Each part starts at a BEGIN:VCARD line, so that its contacts do not straddle two parts
+        threadsCount = std::max(1U, threadsCount);
+        std::vector<std::size_t> partsStarts{0};
+        for (unsigned partIndex = 1; partIndex < threadsCount; ++partIndex)
+        {
+            auto partStart = std::max(partsStarts.back(), text.length() * partIndex / threadsCount);
+            for (;;)
+            {
+                partStart = text.find("\nBEGIN:VCARD", partStart);
+                if (partStart == std::string_view::npos)
+                    break;
+                ++partStart;
+                const auto afterMarker = partStart + 11;
+                if (afterMarker == text.length() || text[afterMarker] == '\r' || text[afterMarker] == '\n')
+                    break;
+            }
+            if (partStart == std::string_view::npos)
+                break;
+            partsStarts.push_back(partStart);
+        }
+        partsStarts.push_back(text.length());
+
+        std::vector<ContactStore> partsStores(partsStarts.size() - 1);
+        std::vector<std::thread> threads;
+        for (std::size_t partIndex = 0; partIndex + 1 < partsStarts.size(); ++partIndex)
+        {
+            threads.emplace_back([&, partIndex]
+            {
+                partsStores[partIndex].load(text.substr(partsStarts[partIndex], partsStarts[partIndex + 1] - partsStarts[partIndex]));
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const auto& partStore : partsStores)
+        {
+            append(partStore);
+        }
+        return true;
+    }
+
+    void ContactStore::loadFile(ContactFileType fileType, const FilePath& fileName)
+    {
+        if (fileType != ContactFileType::Vcf)
+            throw std::invalid_argument("vcard::ContactStore only loads vCard files");
+        std::ifstream file(fileName.string());
+        load(file);
+    }
+
+    void ContactStore::saveFile(ContactFileType fileType, const FilePath& fileName) const
+    {
+        std::ofstream file(fileName.string());
+        if (fileType == ContactFileType::Vcf)
+        {
+            for (ContactIndex contactIndex = 0; contactIndex < m_contactsCount; ++contactIndex)
+            {
+                file << "BEGIN:VCARD\n";
+                for (PropertyId propertyId = 0; propertyId < m_propertyNames.size(); ++propertyId)
+                {
+                    const auto propertyValue = getProperty(contactIndex, propertyId);
+                    if (!propertyValue.empty())
+                        file << m_propertyNames[propertyId] << ':' << propertyValue << "\n";
+                }
+                file << "END:VCARD\n";
+            }
+            return;
+        }
+
+        for (const auto& propertyName : m_propertyNames)
+        {
+            file << propertyName << ";";
+        }
+        file << "\n";
+        for (ContactIndex contactIndex = 0; contactIndex < m_contactsCount; ++contactIndex)
+        {
+            for (PropertyId propertyId = 0; propertyId < m_propertyNames.size(); ++propertyId)
+            {
+                file << getProperty(contactIndex, propertyId) << ";";
+            }
+            file << "\n";
+        }
+    }
+
+    void ContactStore::buildIndex()
+    {
+        m_emailIndex.clear();
+        m_phoneIndex.clear();
+        const auto emailPropertyId = findPropertyId("EMAIL");
+        const auto phonePropertyId = findPropertyId("TEL");
+        const std::hash<std::string_view> hash;
+        for (ContactIndex contactIndex = 0; contactIndex < m_contactsCount; ++contactIndex)
+        {
+            const auto email = normalizeEmail(getProperty(contactIndex, emailPropertyId));
+            if (!email.empty())
+                m_emailIndex.emplace(hash(email), contactIndex);
+            const auto phone = normalizePhone(getProperty(contactIndex, phonePropertyId));
+            if (!phone.empty())
+                m_phoneIndex.emplace(hash(phone), contactIndex);
+        }
+    }
+
+    std::vector<ContactStore::ContactIndex> ContactStore::find(const Index& index, PropertyId propertyId, std::string_view normalizedKey, bool isPhone) const
+    {
+        // The index only keeps hashes, so the matches are checked against the values
+        std::vector<ContactIndex> contactIndexes;
+        if (normalizedKey.empty())
+            return contactIndexes;
+        const auto range = index.equal_range(std::hash<std::string_view>()(normalizedKey));
+        for (auto iterEntry = range.first; iterEntry != range.second; ++iterEntry)
+        {
+            const auto propertyValue = getProperty(iterEntry->second, propertyId);
+            if ((isPhone ? normalizePhone(propertyValue) : normalizeEmail(propertyValue)) == normalizedKey)
+                contactIndexes.push_back(iterEntry->second);
+        }
+        std::sort(begin(contactIndexes), end(contactIndexes));
+        return contactIndexes;
+    }
+
+    std::vector<ContactStore::ContactIndex> ContactStore::findByEmail(std::string_view email) const
+    {
+        return find(m_emailIndex, findPropertyId("EMAIL"), normalizeEmail(email), false);
+    }
+
+    std::vector<ContactStore::ContactIndex> ContactStore::findByPhone(std::string_view phone) const
+    {
+        return find(m_phoneIndex, findPropertyId("TEL"), normalizePhone(phone), true);
+    }
+
+    std::size_t ContactStore::deduplicate()
+    {
+        // Union-find whose roots are the first contact of each group
+        std::vector<ContactIndex> parents(m_contactsCount);
+        std::iota(begin(parents), end(parents), ContactIndex{0});
+        const auto findRoot = [&](ContactIndex contactIndex)
+        {
+            while (parents[contactIndex] != contactIndex)
+            {
+                parents[contactIndex] = parents[parents[contactIndex]];
+                contactIndex = parents[contactIndex];
+            }
+            return contactIndex;
+        };
+        const auto merge = [&](ContactIndex contactIndex, ContactIndex otherContactIndex)
+        {
+            const auto root = findRoot(contactIndex);
+            const auto otherRoot = findRoot(otherContactIndex);
+            parents[std::max(root, otherRoot)] = std::min(root, otherRoot);
+        };
+
+        // Each contact is merged with the first one having the same key, found by hash then checked
+        const auto mergeByKey = [&](PropertyId propertyId, bool isPhone)
+        {
+            std::unordered_map<std::size_t, ContactIndex> firstContacts;
+            firstContacts.reserve(m_contactsCount);
+            Index collisions;
+            const std::hash<std::string_view> hash;
+            for (ContactIndex contactIndex = 0; contactIndex < m_contactsCount; ++contactIndex)
+            {
+                const auto propertyValue = getProperty(contactIndex, propertyId);
+                if (propertyValue.empty())
+                    continue;
+                const auto key = isPhone ? normalizePhone(propertyValue) : normalizeEmail(propertyValue);
+                if (key.empty())
+                    continue;
+                const auto keyHash = hash(key);
+                const auto insertion = firstContacts.emplace(keyHash, contactIndex);
+                if (insertion.second)
+                    continue;
+                const auto firstValue = getProperty(insertion.first->second, propertyId);
+                if ((isPhone ? normalizePhone(firstValue) : normalizeEmail(firstValue)) == key)
+                {
+                    merge(contactIndex, insertion.first->second);
+                    continue;
+                }
+                const auto matches = find(collisions, propertyId, key, isPhone);
+                if (matches.empty())
+                    collisions.emplace(keyHash, contactIndex);
+                else
+                    merge(contactIndex, matches.front());
+            }
+        };
+        mergeByKey(findPropertyId("EMAIL"), false);
+        mergeByKey(findPropertyId("TEL"), true);
+
+        ContactStore deduplicatedStore;
+        for (const auto& propertyName : m_propertyNames)
+        {
+            deduplicatedStore.internPropertyName(propertyName);
+        }
+        deduplicatedStore.m_values.reserve(m_values.size());
+        std::vector<ContactIndex> newIndexes(m_contactsCount);
+        for (ContactIndex contactIndex = 0; contactIndex < m_contactsCount; ++contactIndex)
+        {
+            const auto root = findRoot(contactIndex);
+            newIndexes[contactIndex] = (root == contactIndex) ? deduplicatedStore.addContact() : newIndexes[root];
+            for (PropertyId propertyId = 0; propertyId < m_propertyNames.size(); ++propertyId)
+            {
+                deduplicatedStore.addProperty(newIndexes[contactIndex], propertyId, getProperty(contactIndex, propertyId));
+            }
+        }
+        deduplicatedStore.m_values.shrink_to_fit();
+
+        const auto removedCount = m_contactsCount - deduplicatedStore.m_contactsCount;
+        *this = std::move(deduplicatedStore);
+        buildIndex();
+        return removedCount;
+    }
+
+    std::size_t ContactStore::getMemoryUsage() const
+    {
+        std::size_t memoryUsage = m_values.capacity();
+        for (const auto& column : m_columns)
+        {
+            memoryUsage += column.capacity() * sizeof(Cell);
+        }
+        for (const auto& propertyName : m_propertyNames)
+        {
+            memoryUsage += sizeof(propertyName) + propertyName.capacity() + sizeof(std::pair<std::string_view, PropertyId>) + 2 * sizeof(void*);
+        }
+        for (const auto* index : {&m_emailIndex, &m_phoneIndex})
+        {
+            // A node holds the entry, the next node pointer and the cached hash
+            memoryUsage += index->bucket_count() * sizeof(void*) + index->size() * (sizeof(Index::value_type) + 2 * sizeof(void*));
+        }
+        return memoryUsage;
+    }
+
 } // namespace vcard
 
@@ -2,10 +2,15 @@
 #pragma once
 
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <platform/filesystem.hpp>
 
@@ -54,5 +59,93 @@ namespace vcard {
         Contacts m_contacts;
     };
 
+    // Columnar alternative to Directory for large exports:
+    // property names are interned once, the values of all contacts are appended to a single arena,
+    // and each property has a column of (offset, length) cells indexed by contact.
+    // As with Contact, only the first value of a property is kept, and an empty value means a missing property.
+    class ContactStore
+    {
+    public:
+
+        using ContactIndex = std::size_t;
+        using PropertyId = std::uint32_t;
+        using FilePath = stdnext::filesystem::path;
+
+        static constexpr PropertyId noPropertyId = static_cast<PropertyId>(-1);
+
+        ContactStore() = default;
+        ContactStore(const ContactStore&) = delete;
+        ContactStore& operator=(const ContactStore&) = delete;
+        ContactStore(ContactStore&&) = default;
+        ContactStore& operator=(ContactStore&&) = default;
+
+        PropertyId internPropertyName(std::string_view propertyName);
+
+        PropertyId findPropertyId(std::string_view propertyName) const;
+
+        const std::string& getPropertyName(PropertyId propertyId) const;
+
+        std::size_t getPropertiesCount() const;
+
+        ContactIndex addContact();
+
+        void addProperty(ContactIndex contactIndex, PropertyId propertyId, std::string_view propertyValue);
+
+        std::string_view getProperty(ContactIndex contactIndex, PropertyId propertyId) const;
+
+        std::size_t getContactsCount() const;
+
+        void load(std::istream& file);
+
+        // Parses the contacts of the text without copying its lines, decoding the values into a reused buffer
+        void load(std::string_view text);
+
+        // Maps the file in memory, splits it at BEGIN:VCARD lines, and parses the parts in parallel before appending them in order
+        bool loadMappedFile(const FilePath& fileName, unsigned threadsCount = std::thread::hardware_concurrency());
+
+        // Copies the contacts of the other store after those of this one
+        void append(const ContactStore& other);
+
+        // Only vCard files are loaded, other types throw std::invalid_argument
+        void loadFile(ContactFileType fileType, const FilePath& fileName);
+
+        void saveFile(ContactFileType fileType, const FilePath& fileName) const;
+
+        // Indexes the contacts by normalized EMAIL (lower case) and TEL (digits only); to be called again after adding contacts
+        void buildIndex();
+
+        std::vector<ContactIndex> findByEmail(std::string_view email) const;
+
+        std::vector<ContactIndex> findByPhone(std::string_view phone) const;
+
+        // Merges the contacts sharing an email or a phone into the first of them, whose missing properties are taken
+        // from the others in order, and compacts the arena; returns the number of contacts removed
+        std::size_t deduplicate();
+
+        // Bytes allocated by the store, index included
+        std::size_t getMemoryUsage() const;
+
+    private:
+
+        struct Cell
+        {
+            std::uint32_t offset{};
+            std::uint32_t length{};
+        };
+
+        using Column = std::vector<Cell>;
+        using Index = std::unordered_multimap<std::size_t, ContactIndex>;
+
+        std::vector<ContactIndex> find(const Index& index, PropertyId propertyId, std::string_view normalizedKey, bool isPhone) const;
+
+        std::deque<std::string> m_propertyNames; // a deque keeps the names in place for the keys of m_propertyIds
+        std::unordered_map<std::string_view, PropertyId> m_propertyIds;
+        std::string m_values;
+        std::vector<Column> m_columns;
+        std::size_t m_contactsCount{};
+        Index m_emailIndex;
+        Index m_phoneIndex;
+    };
+
 } // namespace vcard
 
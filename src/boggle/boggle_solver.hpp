@@ -0,0 +1,354 @@
+
+#pragma once
+
+#include <platform/platform.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if EXP_PLATFORM_CPL_IS_MSVC
+#include <intrin.h>
+#endif
+
+
+namespace boggle_detail
+{
+    inline int popcount(std::uint32_t value)
+    {
+#if EXP_PLATFORM_CPL_IS_MSVC
+        return static_cast<int>(__popcnt(value));
+#else
+        return __builtin_popcount(value);
+#endif
+    }
+
+    inline int count_trailing_zeros(std::uint64_t value)
+    {
+#if EXP_PLATFORM_CPL_IS_MSVC
+        unsigned long index = 0;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+} // namespace boggle_detail
+
+
+// Dictionary of uppercase A-Z words, stored as a bitmap trie laid out breadth first:
+// the children of a node are contiguous, and the child for a letter is found by counting
+// the letters before it in the node mask, so a node is 12 bytes and a lookup touches one node.
+class Trie
+{
+public:
+    static constexpr std::uint32_t no_node = UINT32_MAX;
+    static constexpr std::uint32_t no_word = UINT32_MAX;
+    static constexpr std::uint32_t root = 0;
+
+    struct Node
+    {
+        std::uint32_t child_mask{0};
+        std::uint32_t first_child{0};
+        std::uint32_t word{no_word};
+    };
+
+    Trie() : m_nodes(1)
+    {
+    }
+
+    // Words are upper-cased; words with other characters than letters are dropped
+    explicit Trie(std::vector<std::string> words, std::size_t min_length = 1)
+    {
+        for (auto& word : words)
+            std::transform(word.begin(), word.end(), word.begin(), [](char c) { return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c; });
+        words.erase(std::remove_if(words.begin(), words.end(),
+                                   [min_length](const std::string& word) {
+                                       return word.size() < min_length || !std::all_of(word.begin(), word.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+                                   }),
+                    words.end());
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        m_words = std::move(words);
+        build();
+    }
+
+    std::uint32_t child(std::uint32_t node, int letter) const
+    {
+        const auto& parent = m_nodes[node];
+        const auto bit = 1u << letter;
+        if ((parent.child_mask & bit) == 0)
+            return no_node;
+        return parent.first_child + static_cast<std::uint32_t>(boggle_detail::popcount(parent.child_mask & (bit - 1)));
+    }
+
+    const Node& node(std::uint32_t index) const { return m_nodes[index]; }
+    const std::string& word(std::uint32_t index) const { return m_words[index]; }
+    std::size_t word_count() const { return m_words.size(); }
+    std::size_t node_count() const { return m_nodes.size(); }
+
+    bool contains(const std::string& word) const
+    {
+        auto node = root;
+        for (const auto c : word)
+        {
+            if (c < 'A' || c > 'Z' || (node = child(node, c - 'A')) == no_node)
+                return false;
+        }
+        return m_nodes[node].word != no_word;
+    }
+
+    std::size_t nodes_memory() const { return m_nodes.size() * sizeof(Node); }
+
+    std::size_t words_memory() const
+    {
+        std::size_t size = m_words.size() * sizeof(std::string);
+        for (const auto& word : m_words)
+            size += word.size() + 1;
+        return size;
+    }
+
+private:
+    // The words are sorted, so each node covers a range of words sharing its prefix
+    void build()
+    {
+        struct Pending
+        {
+            std::uint32_t node;
+            std::size_t begin;
+            std::size_t end;
+            std::size_t depth;
+        };
+
+        m_nodes.assign(1, Node{});
+        std::vector<Pending> queue{{root, 0, m_words.size(), 0}};
+        for (std::size_t next = 0; next < queue.size(); ++next)
+        {
+            const auto pending = queue[next];
+            auto begin = pending.begin;
+            if (begin < pending.end && m_words[begin].size() == pending.depth)
+                m_nodes[pending.node].word = static_cast<std::uint32_t>(begin++);
+            m_nodes[pending.node].first_child = static_cast<std::uint32_t>(m_nodes.size());
+            while (begin < pending.end)
+            {
+                const auto letter = m_words[begin][pending.depth];
+                auto end = begin + 1;
+                while (end < pending.end && m_words[end][pending.depth] == letter)
+                    ++end;
+                m_nodes[pending.node].child_mask |= 1u << (letter - 'A');
+                queue.push_back({static_cast<std::uint32_t>(m_nodes.size()), begin, end, pending.depth + 1});
+                m_nodes.emplace_back();
+                begin = end;
+            }
+        }
+        m_nodes.shrink_to_fit();
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<std::string> m_words;
+};
+
+// One word per line, words shorter than 3 letters are not playable
+inline Trie load_dictionary(std::istream& is)
+{
+    std::vector<std::string> words;
+    std::string line;
+    while (std::getline(is, line))
+    {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+            line.pop_back();
+        words.push_back(line);
+    }
+    return Trie(std::move(words), 3);
+}
+
+
+// Letters of a grid of at most 64 cells, row by row
+struct Grid
+{
+    int width{6};
+    int height{6};
+    std::string letters;
+};
+
+inline char random_letter(std::default_random_engine& rg)
+{
+    std::uniform_int_distribution<int> uniform_dist('A', 'Z');
+    return static_cast<char>(uniform_dist(rg));
+}
+
+inline Grid random_grid(std::default_random_engine& rg, int width = 6, int height = 6)
+{
+    Grid grid{width, height, std::string(static_cast<std::size_t>(width * height), ' ')};
+    for (auto& letter : grid.letters)
+        letter = random_letter(rg);
+    return grid;
+}
+
+
+// Finds the dictionary words that can be traced through adjacent cells, each cell used once per word.
+// A solver owns its buffers, so it is reused across grids but not shared between threads.
+class Solver
+{
+public:
+    explicit Solver(const Trie& trie) : m_trie(trie), m_seen(trie.word_count(), 0)
+    {
+    }
+
+    // Returns the indices of the words found, sorted
+    const std::vector<std::uint32_t>& solve(const Grid& grid) { return solve_cells(grid, 0, 1); }
+
+    // Only starts the words from the cells first, first + step, ...
+    const std::vector<std::uint32_t>& solve_cells(const Grid& grid, int first, int step)
+    {
+        prepare(grid);
+        for (int cell = first; cell < grid.width * grid.height; cell += step)
+            search(cell, Trie::root, 0);
+        std::sort(m_found.begin(), m_found.end());
+        return m_found;
+    }
+
+private:
+    void prepare(const Grid& grid)
+    {
+        assert(grid.width * grid.height <= 64 && grid.letters.size() == static_cast<std::size_t>(grid.width * grid.height));
+        if (grid.width != m_width || grid.height != m_height)
+        {
+            m_width = grid.width;
+            m_height = grid.height;
+            m_neighbours.assign(static_cast<std::size_t>(m_width * m_height), 0);
+            for (int y = 0; y < m_height; ++y)
+                for (int x = 0; x < m_width; ++x)
+                    for (int dy = -1; dy <= 1; ++dy)
+                        for (int dx = -1; dx <= 1; ++dx)
+                        {
+                            const auto nx = x + dx;
+                            const auto ny = y + dy;
+                            if ((dx != 0 || dy != 0) && nx >= 0 && nx < m_width && ny >= 0 && ny < m_height)
+                                m_neighbours[static_cast<std::size_t>(y * m_width + x)] |= std::uint64_t{1} << (ny * m_width + nx);
+                        }
+        }
+        m_letters.resize(grid.letters.size());
+        for (std::size_t cell = 0; cell < grid.letters.size(); ++cell)
+            m_letters[cell] = grid.letters[cell] - 'A';
+        m_found.clear();
+        if (++m_stamp == 0)
+        {
+            std::fill(m_seen.begin(), m_seen.end(), 0);
+            m_stamp = 1;
+        }
+    }
+
+    void search(int cell, std::uint32_t node, std::uint64_t visited)
+    {
+        const auto letter = m_letters[static_cast<std::size_t>(cell)];
+        if (letter < 0 || letter >= 26 || (node = m_trie.child(node, letter)) == Trie::no_node)
+            return;
+        const auto& current = m_trie.node(node);
+        if (current.word != Trie::no_word && m_seen[current.word] != m_stamp)
+        {
+            m_seen[current.word] = m_stamp;
+            m_found.push_back(current.word);
+        }
+        if (current.child_mask == 0)
+            return;
+        visited |= std::uint64_t{1} << cell;
+        for (auto next = m_neighbours[static_cast<std::size_t>(cell)] & ~visited; next != 0; next &= next - 1)
+            search(boggle_detail::count_trailing_zeros(next), node, visited);
+    }
+
+    const Trie& m_trie;
+    std::vector<std::uint32_t> m_seen; // stamp of the last solve that found each word
+    std::uint32_t m_stamp{0};
+    std::vector<std::uint32_t> m_found;
+    std::vector<std::uint64_t> m_neighbours;
+    std::vector<int> m_letters;
+    int m_width{0};
+    int m_height{0};
+};
+
+// Solves one grid, the starting cells being shared between threads
+inline std::vector<std::uint32_t> solve_parallel(const Trie& trie, const Grid& grid, unsigned threads_count = std::thread::hardware_concurrency())
+{
+    threads_count = std::max(1u, std::min(threads_count, static_cast<unsigned>(grid.width * grid.height)));
+    std::vector<std::vector<std::uint32_t>> results(threads_count);
+    std::vector<std::thread> threads;
+    for (unsigned index = 0; index < threads_count; ++index)
+        threads.emplace_back([&, index] {
+            Solver solver(trie);
+            results[index] = solver.solve_cells(grid, static_cast<int>(index), static_cast<int>(threads_count));
+        });
+    std::vector<std::uint32_t> found;
+    for (unsigned index = 0; index < threads_count; ++index)
+    {
+        threads[index].join();
+        found.insert(found.end(), results[index].begin(), results[index].end());
+    }
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+struct BatchResult
+{
+    std::size_t grids{0};
+    std::size_t words{0};
+    std::chrono::steady_clock::duration duration{};
+};
+
+// Solves count random grids across threads; grid i is generated from seed + i, so the result does
+// not depend on the number of threads. on_progress is called about every 100ms from the calling thread.
+inline BatchResult solve_random_grids(const Trie& trie, std::size_t count, unsigned seed,
+                                      const std::function<void(std::size_t done, std::chrono::steady_clock::duration elapsed)>& on_progress = {},
+                                      unsigned threads_count = std::thread::hardware_concurrency())
+{
+    constexpr std::size_t block_size = 64;
+    std::atomic<std::size_t> next_block{0};
+    std::atomic<std::size_t> done{0};
+    std::atomic<std::size_t> words{0};
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (unsigned index = 0; index < std::max(1u, threads_count); ++index)
+        threads.emplace_back([&] {
+            Solver solver(trie);
+            std::size_t local_words = 0;
+            for (;;)
+            {
+                const auto begin = next_block.fetch_add(block_size);
+                if (begin >= count)
+                    break;
+                const auto end = std::min(count, begin + block_size);
+                for (auto grid_index = begin; grid_index < end; ++grid_index)
+                {
+                    std::default_random_engine rg(seed + static_cast<unsigned>(grid_index));
+                    local_words += solver.solve(random_grid(rg)).size();
+                }
+                done += end - begin;
+            }
+            words += local_words;
+        });
+
+    if (on_progress)
+    {
+        while (done < count)
+        {
+            on_progress(done, std::chrono::steady_clock::now() - start);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    BatchResult result{count, words, std::chrono::steady_clock::now() - start};
+    if (on_progress)
+        on_progress(count, result.duration);
+    return result;
+}
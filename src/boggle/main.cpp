@@ -1,14 +1,18 @@
 
+#include "boggle_solver.hpp"
 #include "progress_bar.hpp"
 #include <platform/platform.h>
 #include <cassert>
+#include <charconv>
 #include <chrono>
 #include <clocale>
 #include <cstdio>
 #include <ctime>
 #include <cwchar>
+#include <fstream>
 #include <iostream>
 #include <random>
+#include <string_view>
 #include <thread>
 
 #if EXP_PLATFORM_OS_IS_WINDOWS
@@ -84,10 +88,17 @@ void show_random_multiplications(int wait_seconds)
     }
 }
 
-char random_letter(std::default_random_engine& rg)
+void show_grid(const Grid& grid)
 {
-    std::uniform_int_distribution<int> uniform_dist('A', 'Z');
-    return uniform_dist(rg);
+    for (int ligne = 0; ligne < grid.height; ++ligne)
+    {
+        for (int colonne = 0; colonne < grid.width; ++colonne)
+        {
+            char letter = grid.letters[static_cast<std::size_t>(ligne * grid.width + colonne)];
+            std::cout << letter << " ";
+        }
+        std::cout << "\n\n";
+    }
 }
 
 void show_boggle()
@@ -95,15 +106,67 @@ void show_boggle()
     std::random_device rd;
     std::default_random_engine rg(rd());
 
-    for (int ligne = 0; ligne < 6; ++ligne)
+    show_grid(random_grid(rg));
+}
+
+bool load_dictionary(const char* path, Trie& trie)
+{
+    std::ifstream is(path);
+    if (!is)
     {
-        for (int colonne = 0; colonne < 6; ++colonne)
-        {
-            char letter = random_letter(rg);
-            std::cout << letter << " ";
-        }
-        std::cout << "\n\n";
+        std::cerr << "Could not open dictionary " << path << "\n";
+        return false;
     }
+    const auto start = std::chrono::steady_clock::now();
+    trie = load_dictionary(is);
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << trie.word_count() << " words loaded in " << duration.count() << " ms: " << trie.node_count() << " trie nodes, "
+              << trie.nodes_memory() / 1024 << " KiB of nodes + " << trie.words_memory() / 1024 << " KiB of words\n";
+    return true;
+}
+
+int solve_boggle(const char* dictionary_path)
+{
+    Trie trie;
+    if (!load_dictionary(dictionary_path, trie))
+        return 1;
+
+    std::random_device rd;
+    std::default_random_engine rg(rd());
+    const auto grid = random_grid(rg);
+    std::cout << "\n";
+    show_grid(grid);
+
+    const auto words = solve_parallel(trie, grid);
+    std::cout << words.size() << " words:";
+    for (const auto word : words)
+        std::cout << " " << trie.word(word);
+    std::cout << "\n";
+    return 0;
+}
+
+int solve_boggle_batch(const char* dictionary_path, std::size_t count)
+{
+    Trie trie;
+    if (!load_dictionary(dictionary_path, trie))
+        return 1;
+
+    ProgressBar bar;
+    std::cout << "\x1b[2J";
+    const auto result = solve_random_grids(trie, count, std::random_device{}(), [&](std::size_t done, std::chrono::steady_clock::duration elapsed) {
+        const auto seconds = std::chrono::duration<double>(elapsed).count();
+        bar.value = 100.f * static_cast<float>(done) / static_cast<float>(count);
+        bar.status = std::to_string(done) + " grids, " + std::to_string(static_cast<long long>(seconds > 0 ? static_cast<double>(done) / seconds : 0.)) + " grids/s   ";
+        write_progress({1, 1}, bar);
+        std::cout << std::flush;
+    });
+
+    const auto seconds = std::chrono::duration<double>(result.duration).count();
+    std::cout << "\n\n"
+              << result.grids << " grids solved in " << seconds << " s (" << static_cast<double>(result.grids) / seconds << " grids/s, "
+              << std::thread::hardware_concurrency() << " threads), " << static_cast<double>(result.words) / static_cast<double>(result.grids)
+              << " words per grid\n";
+    return 0;
 }
 
 void test_utf8()
@@ -198,8 +261,29 @@ void test_progress_bars()
     }
 }
 
-int main()
+// boggle solve <dictionary>: solves a random grid
+// boggle batch <dictionary> [count]: solves count random grids and reports the throughput
+int main(int argc, char* argv[])
 {
+    if (argc >= 3 && argv[1] == "solve"sv)
+        return solve_boggle(argv[2]);
+    if (argc >= 3 && argv[1] == "batch"sv)
+    {
+        std::size_t count = 100000;
+        if (argc >= 4)
+        {
+            const std::string_view count_arg = argv[3];
+            const auto [end, error] = std::from_chars(count_arg.data(), count_arg.data() + count_arg.size(), count);
+            if (error != std::errc{} || end != count_arg.data() + count_arg.size() || count == 0)
+            {
+                std::cerr << "Invalid count '" << count_arg << "'\n"
+                          << "Usage:\nboggle solve <dictionary>\nboggle batch <dictionary> [count]\n";
+                return 1;
+            }
+        }
+        return solve_boggle_batch(argv[2], count);
+    }
+
     //    test_ANSI_escape_codes();
     test_progress_bars();
 }
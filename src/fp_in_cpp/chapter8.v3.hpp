@@ -0,0 +1,1441 @@
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fp_in_cpp { namespace v3 {
+
+    using TrieSize = std::uint32_t;
+
+    // Reference counting policies of the trie nodes.
+    // With SingleThreadRefCount, a trie and all the tries sharing nodes with
+    // it must stay in the same thread.
+    struct SingleThreadRefCount
+    {
+        using counter_type = TrieSize;
+
+        static void increment(counter_type& count) { ++count; }
+
+        static bool decrement(counter_type& count) { return --count == 0; }
+
+        static bool is_unique(const counter_type& count) { return count == 1; }
+    };
+
+    struct ThreadSafeRefCount
+    {
+        using counter_type = std::atomic<TrieSize>;
+
+        static void increment(counter_type& count)
+        {
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static bool decrement(counter_type& count)
+        {
+            return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        static bool is_unique(const counter_type& count)
+        {
+            return count.load(std::memory_order_acquire) == 1;
+        }
+    };
+
+    template <typename T, TrieSize ChunkBitsCountV, typename RefCountPolicyT>
+    class Trie;
+
+    namespace detail {
+
+        // Per-thread cache of free blocks of a given size.
+        // Each block is allocated individually, so a block allocated in one
+        // thread can be given back to the pool of another thread.
+        template <std::size_t BlockSizeV, std::size_t MaxFreeBlocksV = 4096>
+        class NodePool
+        {
+        public:
+            static void* allocate()
+            {
+                auto& state = thread_state();
+                if (!state.m_free)
+                    return ::operator new(BlockSize);
+                const auto block = state.m_free;
+                state.m_free = block->m_next;
+                --state.m_free_count;
+                return block;
+            }
+
+            static void deallocate(void* ptr) noexcept
+            {
+                auto& state = thread_state();
+                if (state.m_closed || state.m_free_count >= MaxFreeBlocksV)
+                {
+                    ::operator delete(ptr);
+                    return;
+                }
+                const auto block = static_cast<FreeBlock*>(ptr);
+                block->m_next = state.m_free;
+                state.m_free = block;
+                ++state.m_free_count;
+            }
+
+            static std::size_t free_blocks_count()
+            {
+                return thread_state().m_free_count;
+            }
+
+        private:
+            struct FreeBlock
+            {
+                FreeBlock* m_next;
+            };
+
+            static constexpr std::size_t BlockSize =
+                std::max(BlockSizeV, sizeof(FreeBlock));
+
+            struct State
+            {
+                FreeBlock* m_free{};
+                std::size_t m_free_count{};
+                bool m_closed{};
+            };
+
+            struct Releaser
+            {
+                ~Releaser()
+                {
+                    m_state.m_closed = true;
+                    while (m_state.m_free)
+                    {
+                        const auto next = m_state.m_free->m_next;
+                        ::operator delete(m_state.m_free);
+                        m_state.m_free = next;
+                    }
+                    m_state.m_free_count = 0;
+                }
+
+                State& m_state;
+            };
+
+            static State& thread_state()
+            {
+                thread_local State state;
+                thread_local Releaser releaser{state};
+                return state;
+            }
+        };
+
+
+        template <typename RefCountPolicyT>
+        struct TrieNode
+        {
+            mutable typename RefCountPolicyT::counter_type m_ref_count{1};
+            TrieSize m_count{};
+        };
+
+        template <typename T, TrieSize ChunkSizeV, typename RefCountPolicyT>
+        struct TrieLeaf : TrieNode<RefCountPolicyT>
+        {
+            T* values() { return reinterpret_cast<T*>(&m_storage); }
+
+            const T* values() const
+            {
+                return reinterpret_cast<const T*>(&m_storage);
+            }
+
+            std::aligned_storage_t<sizeof(T) * ChunkSizeV, alignof(T)>
+                m_storage;
+        };
+
+        // An inner node is either regular, when all its children but the
+        // last one are full, or relaxed, when m_sizes holds the cumulated
+        // sizes of its children (only relaxed nodes maintain m_sizes)
+        template <TrieSize ChunkSizeV, typename RefCountPolicyT>
+        struct TrieInner : TrieNode<RefCountPolicyT>
+        {
+            TrieNode<RefCountPolicyT>* m_children[ChunkSizeV];
+            TrieSize m_sizes[ChunkSizeV];
+            bool m_relaxed{};
+        };
+
+        // Allocation, copy, release and navigation of the trie nodes.
+        // A node does not know whether it is a leaf or an inner node: the
+        // caller does, from the level (shift) of the node in the trie.
+        template <typename T, TrieSize ChunkBitsCountV, typename RefCountPolicyT>
+        struct TrieNodes
+        {
+            using size_type = TrieSize;
+
+            static constexpr size_type ChunkBitsCount = ChunkBitsCountV;
+            static constexpr size_type ChunkSize = 1U << ChunkBitsCountV;
+            static constexpr size_type ChunkBitsMask = ChunkSize - 1;
+
+            using Node = TrieNode<RefCountPolicyT>;
+            using Leaf = TrieLeaf<T, ChunkSize, RefCountPolicyT>;
+            using Inner = TrieInner<ChunkSize, RefCountPolicyT>;
+            using LeafPool = NodePool<sizeof(Leaf)>;
+            using InnerPool = NodePool<sizeof(Inner)>;
+
+            static_assert(alignof(Leaf) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+            static Leaf* as_leaf(Node* node) { return static_cast<Leaf*>(node); }
+
+            static const Leaf* as_leaf(const Node* node)
+            {
+                return static_cast<const Leaf*>(node);
+            }
+
+            static Inner* as_inner(Node* node)
+            {
+                return static_cast<Inner*>(node);
+            }
+
+            static const Inner* as_inner(const Node* node)
+            {
+                return static_cast<const Inner*>(node);
+            }
+
+            static void retain(const Node* node)
+            {
+                if (node)
+                    RefCountPolicyT::increment(node->m_ref_count);
+            }
+
+            static bool is_unique(const Node* node)
+            {
+                return RefCountPolicyT::is_unique(node->m_ref_count);
+            }
+
+            static void release(const Node* node, size_type shift)
+            {
+                if (!node || !RefCountPolicyT::decrement(node->m_ref_count))
+                    return;
+                if (shift == 0)
+                {
+                    const auto leaf = const_cast<Leaf*>(as_leaf(node));
+                    std::destroy_n(leaf->values(), leaf->m_count);
+                    leaf->~Leaf();
+                    LeafPool::deallocate(leaf);
+                    return;
+                }
+                const auto inner = const_cast<Inner*>(as_inner(node));
+                for (size_type index = 0; index < inner->m_count; ++index)
+                    release(inner->m_children[index], shift - ChunkBitsCount);
+                inner->~Inner();
+                InnerPool::deallocate(inner);
+            }
+
+            // Releases a node at the given shift, which is not linked in a
+            // tree yet, when an exception is thrown before it is
+            struct Releaser
+            {
+                void operator()(const Node* node) const { release(node, m_shift); }
+
+                size_type m_shift;
+            };
+
+            template <typename NodeT>
+            using Holder = std::unique_ptr<NodeT, Releaser>;
+
+            // Number of values a node at the given shift holds when full
+            static std::uint64_t capacity(size_type shift)
+            {
+                return std::uint64_t{1} << (shift + ChunkBitsCount);
+            }
+
+            static size_type size_of(const Node* node, size_type shift)
+            {
+                if (shift == 0)
+                    return node->m_count;
+                const auto inner = as_inner(node);
+                const auto last = inner->m_count - 1;
+                if (inner->m_relaxed)
+                    return inner->m_sizes[last];
+                return (last << shift) +
+                       size_of(inner->m_children[last], shift - ChunkBitsCount);
+            }
+
+            static size_type child_size(const Inner& inner, size_type shift,
+                                        size_type child_index)
+            {
+                if (inner.m_relaxed)
+                    return inner.m_sizes[child_index] -
+                           (child_index ? inner.m_sizes[child_index - 1] : 0U);
+                if (child_index + 1 < inner.m_count)
+                    return 1U << shift;
+                return size_of(inner.m_children[child_index],
+                               shift - ChunkBitsCount);
+            }
+
+            // Returns the index of the child containing the value at index,
+            // and the index of this value in the child
+            static std::pair<size_type, size_type>
+            find_child(const Inner& inner, size_type shift, size_type index)
+            {
+                auto child_index = index >> shift;
+                if (!inner.m_relaxed)
+                    return {child_index, index - (child_index << shift)};
+                while (inner.m_sizes[child_index] <= index)
+                    ++child_index;
+                assert(child_index < inner.m_count);
+                return {child_index,
+                        index - (child_index ? inner.m_sizes[child_index - 1]
+                                             : 0U)};
+            }
+
+            static Leaf* make_leaf() { return new (LeafPool::allocate()) Leaf; }
+
+            static Leaf* make_leaf(const T& value)
+            {
+                const auto leaf = make_leaf();
+                try
+                {
+                    append(leaf, value);
+                }
+                catch (...)
+                {
+                    release(leaf, 0);
+                    throw;
+                }
+                return leaf;
+            }
+
+            static void append(Leaf* leaf, const T& value)
+            {
+                assert(leaf->m_count < ChunkSize);
+                new (leaf->values() + leaf->m_count) T(value);
+                ++leaf->m_count;
+            }
+
+            // Appends the values [first, last) of leaf to new_leaf
+            static void append(Leaf* new_leaf, const Leaf& leaf,
+                               size_type first, size_type last)
+            {
+                assert(new_leaf->m_count + last - first <= ChunkSize);
+                for (; first < last; ++first)
+                    append(new_leaf, leaf.values()[first]);
+            }
+
+            // Copies the values [first, last) of leaf
+            static Leaf* copy_leaf(const Leaf& leaf, size_type first,
+                                   size_type last)
+            {
+                assert(first <= last && last <= leaf.m_count);
+                const auto new_leaf = make_leaf();
+                try
+                {
+                    append(new_leaf, leaf, first, last);
+                }
+                catch (...)
+                {
+                    release(new_leaf, 0);
+                    throw;
+                }
+                return new_leaf;
+            }
+
+            // Copies the first count values of leaf
+            static Leaf* copy_leaf(const Leaf& leaf, size_type count)
+            {
+                return copy_leaf(leaf, 0, count);
+            }
+
+            static Inner* make_inner() { return new (InnerPool::allocate()) Inner; }
+
+            static Inner* make_inner(Node* child)
+            {
+                const auto inner = make_inner();
+                inner->m_children[0] = child;
+                inner->m_count = 1;
+                return inner;
+            }
+
+            // Makes an inner node at the given shift, owning the given
+            // children, relaxed only when needed
+            static Inner* make_inner(Node* const* children, size_type count,
+                                     size_type shift)
+            {
+                assert(count > 0 && count <= ChunkSize);
+                const auto inner = make_inner();
+                std::copy(children, children + count, inner->m_children);
+                inner->m_count = count;
+                size_type size = 0;
+                for (size_type index = 0; index < count; ++index)
+                {
+                    const auto child_size =
+                        size_of(children[index], shift - ChunkBitsCount);
+                    if (index + 1 < count && child_size != capacity(shift - ChunkBitsCount))
+                        inner->m_relaxed = true;
+                    size += child_size;
+                    inner->m_sizes[index] = size;
+                }
+                return inner;
+            }
+
+            // Copies (and retains) the first count children of inner
+            static Inner* copy_inner(const Inner& inner, size_type count)
+            {
+                assert(count <= inner.m_count);
+                const auto new_inner = make_inner();
+                std::for_each(inner.m_children, inner.m_children + count,
+                              [](const Node* child) { retain(child); });
+                std::copy(inner.m_children, inner.m_children + count,
+                          new_inner->m_children);
+                new_inner->m_count = count;
+                new_inner->m_relaxed = inner.m_relaxed;
+                if (inner.m_relaxed)
+                    std::copy(inner.m_sizes, inner.m_sizes + count,
+                              new_inner->m_sizes);
+                return new_inner;
+            }
+
+            // Makes the inner node relaxed, computing its sizes
+            static void relax(Inner& inner, size_type shift)
+            {
+                if (inner.m_relaxed)
+                    return;
+                size_type size = 0;
+                for (size_type index = 0; index < inner.m_count; ++index)
+                {
+                    size += child_size(inner, shift, index);
+                    inner.m_sizes[index] = size;
+                }
+                inner.m_relaxed = true;
+            }
+
+            // Sets the last child of inner, updating its sizes if relaxed
+            static void set_last_child(Inner& inner, size_type shift,
+                                       size_type child_index, Node* child)
+            {
+                inner.m_children[child_index] = child;
+                inner.m_count = child_index + 1;
+                if (inner.m_relaxed)
+                    inner.m_sizes[child_index] =
+                        (child_index ? inner.m_sizes[child_index - 1] : 0U) +
+                        size_of(child, shift - ChunkBitsCount);
+            }
+
+            // Builds a branch of single-child inner nodes from shift down to
+            // the given leaf, which is retained
+            static Node* make_path(size_type shift, Leaf* leaf)
+            {
+                retain(leaf);
+                Node* node = leaf;
+                for (size_type level = ChunkBitsCount; level <= shift;
+                     level += ChunkBitsCount)
+                    node = make_inner(node);
+                return node;
+            }
+
+            // Returns the tree rooted at node (an inner node at shift) with
+            // leaf appended as its rightmost leaf, or nullptr when node has
+            // no room left
+            static Node* push_leaf(const Node* node, size_type shift,
+                                   Leaf* leaf)
+            {
+                const auto inner = as_inner(node);
+                const auto last = inner->m_count - 1;
+                if (shift > ChunkBitsCount)
+                {
+                    const auto new_child =
+                        push_leaf(inner->m_children[last],
+                                  shift - ChunkBitsCount, leaf);
+                    if (new_child)
+                    {
+                        const auto new_inner = copy_inner(*inner, last);
+                        set_last_child(*new_inner, shift, last, new_child);
+                        return new_inner;
+                    }
+                }
+                if (inner->m_count == ChunkSize)
+                    return nullptr;
+                const auto new_inner = copy_inner(*inner, inner->m_count);
+                if (child_size(*inner, shift, last) != 1U << shift)
+                    relax(*new_inner, shift);
+                set_last_child(*new_inner, shift, inner->m_count,
+                               make_path(shift - ChunkBitsCount, leaf));
+                return new_inner;
+            }
+
+            // Returns the tree rooted at node without its rightmost leaf, or
+            // nullptr when the tree becomes empty
+            static Node* pop_leaf(const Node* node, size_type shift)
+            {
+                if (shift == 0)
+                    return nullptr;
+                const auto inner = as_inner(node);
+                const auto last = inner->m_count - 1;
+                const auto new_child =
+                    pop_leaf(inner->m_children[last], shift - ChunkBitsCount);
+                if (!new_child && last == 0)
+                    return nullptr;
+                const auto new_inner = copy_inner(*inner, last);
+                if (new_child)
+                    set_last_child(*new_inner, shift, last, new_child);
+                return new_inner;
+            }
+
+            static Node* update(const Node* node, size_type shift,
+                                size_type index, const T& value)
+            {
+                if (shift == 0)
+                {
+                    const auto leaf = as_leaf(node);
+                    Holder<Leaf> new_leaf{copy_leaf(*leaf, leaf->m_count),
+                                          Releaser{0U}};
+                    new_leaf->values()[index] = value;
+                    return new_leaf.release();
+                }
+                const auto inner = as_inner(node);
+                const auto [child_index, index_in_child] =
+                    find_child(*inner, shift, index);
+                Holder<Node> new_child{
+                    update(inner->m_children[child_index],
+                           shift - ChunkBitsCount, index_in_child, value),
+                    Releaser{shift - ChunkBitsCount}};
+                const auto new_inner = copy_inner(*inner, inner->m_count);
+                release(new_inner->m_children[child_index],
+                        shift - ChunkBitsCount);
+                new_inner->m_children[child_index] = new_child.release();
+                return new_inner;
+            }
+
+            // Returns the first count values of the tree rooted at node,
+            // count being smaller than its size and ending a leaf
+            static Node* take(const Node* node, size_type shift,
+                              size_type count)
+            {
+                assert(shift > 0);
+                const auto inner = as_inner(node);
+                const auto [child_index, index_in_child] =
+                    find_child(*inner, shift, count - 1);
+                const auto child = inner->m_children[child_index];
+                const auto child_count = index_in_child + 1;
+                const auto new_inner = copy_inner(*inner, child_index);
+                if (child_count == child_size(*inner, shift, child_index))
+                {
+                    retain(child);
+                    set_last_child(*new_inner, shift, child_index, child);
+                }
+                else
+                    set_last_child(
+                        *new_inner, shift, child_index,
+                        take(child, shift - ChunkBitsCount, child_count));
+                return new_inner;
+            }
+
+            // Returns the tree rooted at node without its first count values,
+            // count being smaller than its size
+            static Node* drop(const Node* node, size_type shift,
+                              size_type count)
+            {
+                if (count == 0)
+                {
+                    retain(node);
+                    return const_cast<Node*>(node);
+                }
+                if (shift == 0)
+                {
+                    const auto leaf = as_leaf(node);
+                    return copy_leaf(*leaf, count, leaf->m_count);
+                }
+                const auto inner = as_inner(node);
+                const auto [child_index, index_in_child] =
+                    find_child(*inner, shift, count);
+                Node* children[ChunkSize];
+                children[0] = drop(inner->m_children[child_index],
+                                   shift - ChunkBitsCount, index_in_child);
+                const auto count_after = inner->m_count - child_index - 1;
+                std::for_each(inner->m_children + child_index + 1,
+                              inner->m_children + inner->m_count,
+                              [](const Node* child) { retain(child); });
+                std::copy_n(inner->m_children + child_index + 1, count_after,
+                            children + 1);
+                return make_inner(children, count_after + 1, shift);
+            }
+
+            // Concatenation of relaxed radix balanced trees (see "Improving
+            // RRB-Tree Performance through Transience", J. N. L'orange).
+            // Fills merged with the 1 or 2 nodes, at the highest shift of the
+            // two trees, holding the values of left then right, and returns
+            // their count
+            static size_type concat(const Node* left, size_type left_shift,
+                                    const Node* right, size_type right_shift,
+                                    bool top, Node** merged)
+            {
+                Node* centre[2];
+                if (left_shift > right_shift)
+                {
+                    const auto left_inner = as_inner(left);
+                    const auto centre_count = concat(
+                        left_inner->m_children[left_inner->m_count - 1],
+                        left_shift - ChunkBitsCount, right, right_shift, false,
+                        centre);
+                    return rebalance(left_inner, centre, centre_count, nullptr,
+                                     left_shift, merged);
+                }
+                if (left_shift < right_shift)
+                {
+                    const auto right_inner = as_inner(right);
+                    const auto centre_count =
+                        concat(left, left_shift, right_inner->m_children[0],
+                               right_shift - ChunkBitsCount, false, centre);
+                    return rebalance(nullptr, centre, centre_count,
+                                     right_inner, right_shift, merged);
+                }
+                if (left_shift == 0)
+                {
+                    if (top && left->m_count + right->m_count <= ChunkSize)
+                    {
+                        const auto leaf = copy_leaf(*as_leaf(left),
+                                                    left->m_count);
+                        append(leaf, *as_leaf(right), 0, right->m_count);
+                        merged[0] = leaf;
+                        return 1;
+                    }
+                    retain(left);
+                    retain(right);
+                    merged[0] = const_cast<Node*>(left);
+                    merged[1] = const_cast<Node*>(right);
+                    return 2;
+                }
+                const auto left_inner = as_inner(left);
+                const auto right_inner = as_inner(right);
+                const auto centre_count = concat(
+                    left_inner->m_children[left_inner->m_count - 1],
+                    left_shift - ChunkBitsCount, right_inner->m_children[0],
+                    right_shift - ChunkBitsCount, false, centre);
+                return rebalance(left_inner, centre, centre_count, right_inner,
+                                 left_shift, merged);
+            }
+
+            // Merges the children of left (but the last one), the centre
+            // nodes and the children of right (but the first one), all at
+            // shift - ChunkBitsCount, into 1 or 2 nodes at shift
+            static size_type rebalance(const Inner* left, Node** centre,
+                                       size_type centre_count,
+                                       const Inner* right, size_type shift,
+                                       Node** merged)
+            {
+                Node* nodes[2 * ChunkSize];
+                size_type count = 0;
+                const auto add_node = [&](Node* node) { nodes[count++] = node; };
+                const auto add_retained_node = [&](Node* node) {
+                    retain(node);
+                    add_node(node);
+                };
+                if (left)
+                    std::for_each(left->m_children,
+                                  left->m_children + left->m_count - 1,
+                                  add_retained_node);
+                std::for_each(centre, centre + centre_count, add_node);
+                if (right)
+                    std::for_each(right->m_children + 1,
+                                  right->m_children + right->m_count,
+                                  add_retained_node);
+
+                count = redistribute(nodes, count, shift - ChunkBitsCount);
+
+                if (count <= ChunkSize)
+                {
+                    merged[0] = make_inner(nodes, count, shift);
+                    return 1;
+                }
+                merged[0] = make_inner(nodes, ChunkSize, shift);
+                merged[1] = make_inner(nodes + ChunkSize, count - ChunkSize,
+                                       shift);
+                return 2;
+            }
+
+            // Number of nodes a concatenation may leave above the optimal
+            // count, and number of missing slots a node may have before
+            // being merged with its neighbours
+            static constexpr size_type ConcatExtraNodes = 2;
+            static constexpr size_type ConcatMissingSlots = 1;
+
+            // Redistributes the slots of nodes (all at shift), in place, so
+            // that they fit in at most the optimal number of nodes plus
+            // ConcatExtraNodes, and returns the new count of nodes
+            static size_type redistribute(Node** nodes, size_type count,
+                                          size_type shift)
+            {
+                size_type plan[2 * ChunkSize];
+                size_type total_slots = 0;
+                for (size_type index = 0; index < count; ++index)
+                {
+                    plan[index] = nodes[index]->m_count;
+                    total_slots += plan[index];
+                }
+
+                const auto optimal_count =
+                    (total_slots + ChunkSize - 1) / ChunkSize;
+                auto plan_count = count;
+                size_type index = 0;
+                while (optimal_count + ConcatExtraNodes < plan_count)
+                {
+                    while (plan[index] > ChunkSize - ConcatMissingSlots)
+                        ++index;
+                    auto remaining = plan[index];
+                    do
+                    {
+                        const auto slots =
+                            std::min(remaining + plan[index + 1], ChunkSize);
+                        plan[index] = slots;
+                        remaining = remaining + plan[index + 1] - slots;
+                        ++index;
+                    } while (remaining > 0);
+                    std::copy(plan + index + 1, plan + plan_count,
+                              plan + index);
+                    --plan_count;
+                    --index;
+                }
+
+                if (plan_count == count)
+                    return count;
+
+                Node* old_nodes[2 * ChunkSize];
+                std::copy(nodes, nodes + count, old_nodes);
+                size_type old_index = 0;
+                size_type old_offset = 0;
+                for (size_type new_index = 0; new_index < plan_count;
+                     ++new_index)
+                {
+                    const auto slots = plan[new_index];
+                    if (old_offset == 0 &&
+                        old_nodes[old_index]->m_count == slots)
+                    {
+                        nodes[new_index] = old_nodes[old_index++];
+                        continue;
+                    }
+
+                    Node* new_children[ChunkSize];
+                    const auto new_leaf = shift == 0 ? make_leaf() : nullptr;
+                    size_type new_count = 0;
+                    while (new_count < slots)
+                    {
+                        const auto old_node = old_nodes[old_index];
+                        const auto moved = std::min(
+                            slots - new_count, old_node->m_count - old_offset);
+                        if (new_leaf)
+                            append(new_leaf, *as_leaf(old_node), old_offset,
+                                   old_offset + moved);
+                        else
+                        {
+                            const auto first =
+                                as_inner(old_node)->m_children + old_offset;
+                            std::for_each(first, first + moved,
+                                          [](const Node* child) {
+                                              retain(child);
+                                          });
+                            std::copy(first, first + moved,
+                                      new_children + new_count);
+                        }
+                        new_count += moved;
+                        old_offset += moved;
+                        if (old_offset == old_node->m_count)
+                        {
+                            release(old_node, shift);
+                            ++old_index;
+                            old_offset = 0;
+                        }
+                    }
+                    nodes[new_index] =
+                        new_leaf ? static_cast<Node*>(new_leaf)
+                                 : make_inner(new_children, slots, shift);
+                }
+                assert(old_index == count);
+                return plan_count;
+            }
+
+            // Calls func(first, last) for each leaf of the tree, in order
+            template <typename FuncT>
+            static void for_each_chunk(const Node* node, size_type shift,
+                                       FuncT& func)
+            {
+                if (shift == 0)
+                {
+                    const auto leaf = as_leaf(node);
+                    func(leaf->values(), leaf->values() + leaf->m_count);
+                    return;
+                }
+                const auto inner = as_inner(node);
+                std::for_each(inner->m_children,
+                              inner->m_children + inner->m_count,
+                              [&](const Node* child) {
+                                  for_each_chunk(child, shift - ChunkBitsCount,
+                                                 func);
+                              });
+            }
+
+            // Calls func(child_index) for each child index of inner, in
+            // parallel (one task per child) when parallel is true, and
+            // rethrows the first exception thrown once all calls are done
+            template <typename FuncT>
+            static void for_each_child(const Inner& inner, bool parallel,
+                                       FuncT&& func)
+            {
+                if (!parallel)
+                {
+                    for (size_type index = 0; index < inner.m_count; ++index)
+                        func(index);
+                    return;
+                }
+                std::vector<std::future<void>> futures;
+                futures.reserve(inner.m_count - 1);
+                for (size_type index = 1; index < inner.m_count; ++index)
+                    futures.push_back(
+                        std::async(std::launch::async, func, index));
+                std::exception_ptr exception;
+                try
+                {
+                    func(0U);
+                }
+                catch (...)
+                {
+                    exception = std::current_exception();
+                }
+                for (auto& future : futures)
+                {
+                    try
+                    {
+                        future.get();
+                    }
+                    catch (...)
+                    {
+                        if (!exception)
+                            exception = std::current_exception();
+                    }
+                }
+                if (exception)
+                    std::rethrow_exception(exception);
+            }
+
+            // Returns a tree of the same shape as the one rooted at node,
+            // whose values are func(value), the subtrees of the
+            // parallel_levels upper levels being transformed in parallel
+            template <typename U, typename FuncT>
+            static Node* transform(const Node* node, size_type shift,
+                                   FuncT& func, size_type parallel_levels)
+            {
+                using UNodes = TrieNodes<U, ChunkBitsCountV, RefCountPolicyT>;
+                if (shift == 0)
+                {
+                    const auto leaf = as_leaf(node);
+                    const auto new_leaf = UNodes::make_leaf();
+                    try
+                    {
+                        for (size_type index = 0; index < leaf->m_count;
+                             ++index)
+                            UNodes::append(new_leaf,
+                                           func(leaf->values()[index]));
+                    }
+                    catch (...)
+                    {
+                        UNodes::release(new_leaf, 0);
+                        throw;
+                    }
+                    return new_leaf;
+                }
+                const auto inner = as_inner(node);
+                Node* children[ChunkSize] = {};
+                try
+                {
+                    for_each_child(
+                        *inner, parallel_levels > 0,
+                        [&](size_type index) {
+                            children[index] = transform<U>(
+                                inner->m_children[index],
+                                shift - ChunkBitsCount, func,
+                                parallel_levels ? parallel_levels - 1 : 0U);
+                        });
+                }
+                catch (...)
+                {
+                    std::for_each(children, children + inner->m_count,
+                                  [&](const Node* child) {
+                                      UNodes::release(child,
+                                                      shift - ChunkBitsCount);
+                                  });
+                    throw;
+                }
+                const auto new_inner = make_inner();
+                std::copy(children, children + inner->m_count,
+                          new_inner->m_children);
+                new_inner->m_count = inner->m_count;
+                new_inner->m_relaxed = inner->m_relaxed;
+                std::copy(inner->m_sizes, inner->m_sizes + inner->m_count,
+                          new_inner->m_sizes);
+                return new_inner;
+            }
+
+            // Returns the reduction with op of the values of the tree rooted
+            // at node, the subtrees of the parallel_levels upper levels being
+            // reduced in parallel
+            template <typename BinaryOpT>
+            static T reduce(const Node* node, size_type shift, BinaryOpT& op,
+                            size_type parallel_levels)
+            {
+                if (shift == 0)
+                {
+                    const auto leaf = as_leaf(node);
+                    return std::accumulate(leaf->values() + 1,
+                                           leaf->values() + leaf->m_count,
+                                           leaf->values()[0], op);
+                }
+                const auto inner = as_inner(node);
+                std::vector<std::optional<T>> results(inner->m_count);
+                for_each_child(*inner, parallel_levels > 0,
+                               [&](size_type index) {
+                                   results[index] = reduce(
+                                       inner->m_children[index],
+                                       shift - ChunkBitsCount, op,
+                                       parallel_levels ? parallel_levels - 1
+                                                       : 0U);
+                               });
+                return std::accumulate(
+                    results.begin() + 1, results.end(), *results[0],
+                    [&](T acc, const auto& result) {
+                        return op(std::move(acc), *result);
+                    });
+            }
+        };
+
+        template <typename T, TrieSize ChunkBitsCountV, typename RefCountPolicyT>
+        class TrieIterator
+        {
+            friend class Trie<T, ChunkBitsCountV, RefCountPolicyT>;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            TrieIterator() = default;
+
+            TrieIterator& operator++()
+            {
+                assert(m_current != m_chunk_end);
+                ++m_index;
+                if (++m_current == m_chunk_end)
+                    load_chunk();
+                return *this;
+            }
+
+            TrieIterator operator++(int)
+            {
+                TrieIterator it = *this;
+                ++(*this);
+                return it;
+            }
+
+            bool operator==(const TrieIterator& other) const
+            {
+                return m_trie == other.m_trie && m_index == other.m_index;
+            }
+
+            bool operator!=(const TrieIterator& other) const
+            {
+                return !(*this == other);
+            }
+
+            reference operator*() const
+            {
+                assert(m_current != m_chunk_end);
+                return *m_current;
+            }
+
+            pointer operator->() const { return m_current; }
+
+        private:
+            TrieIterator(const Trie<T, ChunkBitsCountV, RefCountPolicyT>& trie,
+                         TrieSize index)
+                : m_trie{&trie}, m_index{index}
+            {
+                load_chunk();
+            }
+
+            void load_chunk();
+
+            const Trie<T, ChunkBitsCountV, RefCountPolicyT>* m_trie{};
+            TrieSize m_index{};
+            const T* m_current{};
+            const T* m_chunk_end{};
+        };
+
+    } // namespace detail
+
+    // Persistent vector implemented as a relaxed radix balanced trie.
+    // The last chunk of values (the tail) is kept out of the tree, so that
+    // push_back and pop_back only touch the tree once every ChunkSize calls.
+    // The tree stays regular (indexed with bit shifts) as long as only
+    // push_back, pop_back and update are used; concat, take, drop and
+    // insert_at introduce relaxed nodes, indexed through their sizes.
+    template <typename T, TrieSize ChunkBitsCountV = 5,
+              typename RefCountPolicyT = SingleThreadRefCount>
+    class Trie
+    {
+        template <typename, TrieSize, typename>
+        friend class Trie;
+
+        friend class detail::TrieIterator<T, ChunkBitsCountV, RefCountPolicyT>;
+
+        using Nodes = detail::TrieNodes<T, ChunkBitsCountV, RefCountPolicyT>;
+        using Node = typename Nodes::Node;
+        using Leaf = typename Nodes::Leaf;
+        using Inner = typename Nodes::Inner;
+
+    public:
+        static_assert(ChunkBitsCountV > 0 && ChunkBitsCountV < 8);
+
+        using value_type = T;
+        using const_reference = const T&;
+        using const_iterator =
+            detail::TrieIterator<T, ChunkBitsCountV, RefCountPolicyT>;
+        using size_type = TrieSize;
+
+        static constexpr auto ChunkBitsCount = ChunkBitsCountV;
+        static constexpr size_type ChunkSize = 1U << ChunkBitsCountV;
+        static constexpr size_type ChunkBitsMask = ChunkSize - 1;
+
+        Trie() = default;
+
+        template <
+            typename InputIter,
+            typename = std::enable_if_t<std::is_convertible_v<
+                typename std::iterator_traits<InputIter>::value_type, T>>>
+        Trie(InputIter first, InputIter last)
+        {
+            std::for_each(first, last, [this](const auto& value) {
+                mutable_push_back(static_cast<T>(value));
+            });
+        }
+
+        Trie(std::initializer_list<T> il) : Trie(std::begin(il), std::end(il))
+        {
+        }
+
+        Trie(const Trie& other)
+            : m_root{other.m_root}, m_tail{other.m_tail},
+              m_size{other.m_size}, m_shift{other.m_shift}
+        {
+            Nodes::retain(m_root);
+            Nodes::retain(m_tail);
+        }
+
+        Trie(Trie&& other) noexcept
+            : m_root{std::exchange(other.m_root, nullptr)},
+              m_tail{std::exchange(other.m_tail, nullptr)},
+              m_size{std::exchange(other.m_size, 0U)},
+              m_shift{std::exchange(other.m_shift, 0U)}
+        {
+        }
+
+        Trie& operator=(const Trie& other)
+        {
+            Trie copy{other};
+            swap(copy);
+            return *this;
+        }
+
+        Trie& operator=(Trie&& other) noexcept
+        {
+            Trie moved{std::move(other)};
+            swap(moved);
+            return *this;
+        }
+
+        ~Trie()
+        {
+            Nodes::release(m_root, m_shift);
+            Nodes::release(m_tail, 0);
+        }
+
+        void swap(Trie& other) noexcept
+        {
+            std::swap(m_root, other.m_root);
+            std::swap(m_tail, other.m_tail);
+            std::swap(m_size, other.m_size);
+            std::swap(m_shift, other.m_shift);
+        }
+
+        auto empty() const { return m_size == 0; }
+
+        auto size() const { return m_size; }
+
+        // Number of levels of the tree, the tail excluded
+        auto levels() const
+        {
+            return m_root ? m_shift / ChunkBitsCount + 1 : 0U;
+        }
+
+        auto begin() const { return const_iterator(*this, 0U); }
+
+        auto end() const { return const_iterator(*this, m_size); }
+
+        const T& at(size_type index) const
+        {
+            const auto [leaf, index_in_leaf] = get_leaf(index);
+            return leaf->values()[index_in_leaf];
+        }
+
+        const T& operator[](size_type index) const { return at(index); }
+
+        // Calls func(first, last) for each contiguous chunk of values, in
+        // order
+        template <typename FuncT>
+        void for_each_chunk(FuncT&& func) const
+        {
+            if (m_root)
+                Nodes::for_each_chunk(m_root, m_shift, func);
+            if (m_tail)
+                func(m_tail->values(), m_tail->values() + m_tail->m_count);
+        }
+
+        Trie push_back(const T& value) const&
+        {
+            if (!m_tail)
+                return Trie{nullptr, Nodes::make_leaf(value), 1U, 0U};
+
+            if (m_tail->m_count < ChunkSize)
+            {
+                const auto new_tail = Nodes::copy_leaf(*m_tail, m_tail->m_count);
+                Trie trie{m_root, new_tail, m_size + 1, m_shift};
+                Nodes::retain(m_root);
+                Nodes::append(new_tail, value);
+                return trie;
+            }
+
+            Trie trie{push_tail(), nullptr, m_size};
+            trie.m_tail = Nodes::make_leaf(value);
+            ++trie.m_size;
+            return trie;
+        }
+
+        // Appends in place when the tail is not shared with another trie
+        Trie push_back(const T& value) &&
+        {
+            mutable_push_back(value);
+            return std::move(*this);
+        }
+
+        Trie update(size_type index, const T& value) const
+        {
+            assert(index < m_size);
+
+            const auto tail_offset = this->tail_offset();
+            if (index >= tail_offset)
+            {
+                const auto new_tail = Nodes::copy_leaf(*m_tail, m_tail->m_count);
+                Trie trie{m_root, new_tail, m_size, m_shift};
+                Nodes::retain(m_root);
+                new_tail->values()[index - tail_offset] = value;
+                return trie;
+            }
+
+            Nodes::retain(m_tail);
+            Trie trie{nullptr, m_tail, m_size, m_shift};
+            trie.m_root = Nodes::update(m_root, m_shift, index, value);
+            return trie;
+        }
+
+        Trie pop_back() const
+        {
+            assert(m_size > 0);
+
+            if (m_size == 1)
+                return Trie{};
+
+            if (m_tail->m_count > 1)
+            {
+                Nodes::retain(m_root);
+                return Trie{m_root,
+                            Nodes::copy_leaf(*m_tail, m_tail->m_count - 1),
+                            m_size - 1, m_shift};
+            }
+
+            const auto [new_tail, index_in_leaf] = get_leaf(m_size - 2);
+            assert(index_in_leaf + 1 == new_tail->m_count);
+            Nodes::retain(new_tail);
+            Trie trie{nullptr, const_cast<Leaf*>(new_tail), m_size - 1,
+                      m_shift};
+            trie.m_root = Nodes::pop_leaf(m_root, m_shift);
+            trie.collapse_root();
+            return trie;
+        }
+
+        // Returns the concatenation of this trie and other
+        Trie concat(const Trie& other) const
+        {
+            if (other.empty())
+                return *this;
+            if (empty())
+                return other;
+
+            if (!other.m_root)
+            {
+                auto trie = *this;
+                std::for_each(other.m_tail->values(),
+                              other.m_tail->values() + other.m_tail->m_count,
+                              [&](const T& value) {
+                                  trie.mutable_push_back(value);
+                              });
+                return trie;
+            }
+
+            const Trie left{push_tail(), nullptr, m_size};
+            Node* merged[2];
+            const auto merged_count =
+                Nodes::concat(left.m_root, left.m_shift, other.m_root,
+                              other.m_shift, true, merged);
+            const auto shift = std::max(left.m_shift, other.m_shift);
+            Nodes::retain(other.m_tail);
+            Trie trie{merged[0], other.m_tail, m_size + other.m_size, shift};
+            if (merged_count == 2)
+            {
+                trie.m_root = Nodes::make_inner(merged, 2, shift + ChunkBitsCount);
+                trie.m_shift += ChunkBitsCount;
+            }
+            trie.collapse_root();
+            return trie;
+        }
+
+        // Returns the first count values
+        Trie take(size_type count) const
+        {
+            if (count >= m_size)
+                return *this;
+            if (count == 0)
+                return Trie{};
+
+            const auto tail_offset = this->tail_offset();
+            if (count > tail_offset)
+            {
+                Nodes::retain(m_root);
+                return Trie{m_root,
+                            Nodes::copy_leaf(*m_tail, count - tail_offset),
+                            count, m_shift};
+            }
+
+            const auto [leaf, index_in_leaf] = get_leaf(count - 1);
+            const auto new_tail =
+                index_in_leaf + 1 == leaf->m_count
+                    ? const_cast<Leaf*>(leaf)
+                    : Nodes::copy_leaf(*leaf, index_in_leaf + 1);
+            if (new_tail == leaf)
+                Nodes::retain(leaf);
+            Trie trie{nullptr, new_tail, count, m_shift};
+            const auto tree_count = count - index_in_leaf - 1;
+            if (tree_count > 0)
+                trie.m_root = Nodes::take(m_root, m_shift, tree_count);
+            trie.collapse_root();
+            return trie;
+        }
+
+        // Returns the values after the first count ones
+        Trie drop(size_type count) const
+        {
+            if (count == 0)
+                return *this;
+            if (count >= m_size)
+                return Trie{};
+
+            const auto tail_offset = this->tail_offset();
+            if (count >= tail_offset)
+                return Trie{nullptr,
+                            Nodes::copy_leaf(*m_tail, count - tail_offset,
+                                             m_tail->m_count),
+                            m_size - count, 0U};
+
+            Nodes::retain(m_tail);
+            Trie trie{nullptr, m_tail, m_size - count, m_shift};
+            trie.m_root = Nodes::drop(m_root, m_shift, count);
+            trie.collapse_root();
+            return trie;
+        }
+
+        Trie insert_at(size_type index, const T& value) const
+        {
+            assert(index <= m_size);
+            return take(index).push_back(value).concat(drop(index));
+        }
+
+        // Returns the trie of the func(value), computed in parallel over the
+        // subtrees of the upper levels of the tree
+        template <typename FuncT>
+        auto parallel_transform(FuncT func) const
+        {
+            using U = std::decay_t<std::invoke_result_t<FuncT&, const T&>>;
+            using Result = Trie<U, ChunkBitsCountV, RefCountPolicyT>;
+            using ResultNodes = typename Result::Nodes;
+
+            Result result;
+            if (m_root)
+            {
+                result.m_root = Nodes::template transform<U>(
+                    m_root, m_shift, func, parallel_levels());
+                result.m_shift = m_shift;
+            }
+            if (m_tail)
+                result.m_tail = ResultNodes::as_leaf(
+                    Nodes::template transform<U>(m_tail, 0U, func, 0U));
+            result.m_size = m_size;
+            return result;
+        }
+
+        // Returns the reduction of init and the values with op, computed in
+        // parallel over the subtrees of the upper levels of the tree.
+        // As with std::reduce, op must be associative.
+        template <typename BinaryOpT>
+        T parallel_reduce(T init, BinaryOpT op) const
+        {
+            if (m_root)
+                init = op(std::move(init),
+                          Nodes::reduce(m_root, m_shift, op, parallel_levels()));
+            if (m_tail)
+                init = std::accumulate(m_tail->values(),
+                                       m_tail->values() + m_tail->m_count,
+                                       std::move(init), op);
+            return init;
+        }
+
+    private:
+        Trie(Node* root, Leaf* tail, size_type size, size_type shift)
+            : m_root{root}, m_tail{tail}, m_size{size}, m_shift{shift}
+        {
+        }
+
+        Trie(std::pair<Node*, size_type> tree, Leaf* tail, size_type size)
+            : Trie{tree.first, tail, size, tree.second}
+        {
+        }
+
+        size_type tail_offset() const
+        {
+            return m_tail ? m_size - m_tail->m_count : 0U;
+        }
+
+        void mutable_push_back(const T& value)
+        {
+            if (m_tail && m_tail->m_count < ChunkSize &&
+                Nodes::is_unique(m_tail))
+            {
+                Nodes::append(m_tail, value);
+                ++m_size;
+                return;
+            }
+            *this = static_cast<const Trie&>(*this).push_back(value);
+        }
+
+        // Returns the new root and shift of the tree once the tail has been
+        // pushed into it as its rightmost leaf
+        std::pair<Node*, size_type> push_tail() const
+        {
+            assert(m_tail);
+
+            if (!m_root)
+            {
+                Nodes::retain(m_tail);
+                return {m_tail, 0U};
+            }
+
+            if (m_shift > 0)
+            {
+                if (const auto new_root =
+                        Nodes::push_leaf(m_root, m_shift, m_tail))
+                    return {new_root, m_shift};
+            }
+
+            Node* children[] = {m_root,
+                                Nodes::make_path(m_shift, m_tail)};
+            Nodes::retain(m_root);
+            return {Nodes::make_inner(children, 2, m_shift + ChunkBitsCount),
+                    m_shift + ChunkBitsCount};
+        }
+
+        void collapse_root()
+        {
+            while (m_root && m_shift > 0 && m_root->m_count == 1)
+            {
+                const auto old_root = m_root;
+                m_root = Nodes::as_inner(old_root)->m_children[0];
+                Nodes::retain(m_root);
+                Nodes::release(old_root, m_shift);
+                m_shift -= ChunkBitsCount;
+            }
+            if (!m_root)
+                m_shift = 0;
+        }
+
+        // Number of upper levels of the tree whose subtrees are processed in
+        // parallel, so that there are at least as many tasks as cores
+        size_type parallel_levels() const
+        {
+            const auto cores_count =
+                std::max(std::thread::hardware_concurrency(), 1U);
+            size_type levels = 0;
+            for (std::uint64_t tasks_count = 1; tasks_count < cores_count;
+                 tasks_count *= ChunkSize)
+                ++levels;
+            return std::min(levels, this->levels());
+        }
+
+        std::pair<const Leaf*, size_type> get_leaf(size_type index) const
+        {
+            assert(index < m_size);
+            const auto tail_offset = this->tail_offset();
+            if (index >= tail_offset)
+                return {m_tail, index - tail_offset};
+            const Node* node = m_root;
+            for (auto shift = m_shift; shift > 0; shift -= ChunkBitsCount)
+            {
+                const auto inner = Nodes::as_inner(node);
+                const auto [child_index, index_in_child] =
+                    Nodes::find_child(*inner, shift, index);
+                node = inner->m_children[child_index];
+                index = index_in_child;
+            }
+            return {Nodes::as_leaf(node), index};
+        }
+
+        Node* m_root{};
+        Leaf* m_tail{};
+        size_type m_size{};
+        size_type m_shift{};
+    };
+
+    namespace detail {
+
+        template <typename T, TrieSize ChunkBitsCountV, typename RefCountPolicyT>
+        void TrieIterator<T, ChunkBitsCountV, RefCountPolicyT>::load_chunk()
+        {
+            assert(m_trie);
+            if (m_index >= m_trie->size())
+            {
+                m_current = m_chunk_end = nullptr;
+                return;
+            }
+            const auto [leaf, index_in_leaf] = m_trie->get_leaf(m_index);
+            m_current = leaf->values() + index_in_leaf;
+            m_chunk_end = leaf->values() + leaf->m_count;
+        }
+
+    } // namespace detail
+
+}} // namespace fp_in_cpp::v3
@@ -0,0 +1,549 @@
+
+#include "chapter8.hpp"
+#include "chapter8.v3.hpp"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace test_v3 {
+
+    template <typename ContainerT, typename T>
+    bool equal(const ContainerT& container, const std::vector<T>& vec)
+    {
+        return container.size() == vec.size() &&
+               std::equal(container.begin(), container.end(), vec.begin());
+    }
+
+    template <typename TrieT>
+    std::vector<typename TrieT::value_type> chunks_to_vector(const TrieT& trie)
+    {
+        std::vector<typename TrieT::value_type> vec;
+        trie.for_each_chunk([&](const auto* first, const auto* last) {
+            vec.insert(vec.end(), first, last);
+        });
+        return vec;
+    }
+
+    // Value counting its instances, whose assignment from a negative value
+    // throws
+    struct CountedValue
+    {
+        static inline int instances_count = 0;
+
+        CountedValue(int v) : value(v) { ++instances_count; }
+
+        CountedValue(const CountedValue& other) : value(other.value)
+        {
+            ++instances_count;
+        }
+
+        CountedValue& operator=(const CountedValue& other)
+        {
+            if (other.value < 0)
+                throw std::invalid_argument("negative value");
+            value = other.value;
+            return *this;
+        }
+
+        ~CountedValue() { --instances_count; }
+
+        bool operator==(const CountedValue& other) const
+        {
+            return value == other.value;
+        }
+
+        int value;
+    };
+
+    using ClockType = std::chrono::steady_clock;
+
+    template <typename FuncT>
+    auto measure_duration(FuncT func)
+    {
+        const auto start = ClockType::now();
+        func();
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            ClockType::now() - start);
+    }
+
+} // namespace test_v3
+
+TEST_CASE("chapter 8 v3", "")
+{
+    using namespace fp_in_cpp;
+
+    using IntTrie = v3::Trie<int, 2>;
+
+    SECTION("Trie")
+    {
+        SECTION("construct")
+        {
+            SECTION("default")
+            {
+                // ACT
+                IntTrie trie;
+
+                // ASSERT
+                REQUIRE(trie.empty());
+                REQUIRE(trie.size() == 0);
+                REQUIRE(trie.levels() == 0);
+                REQUIRE(test_v3::equal(trie, std::vector<int>{}));
+            }
+
+            SECTION("from a number of elements smaller than chunk")
+            {
+                // ACT
+                IntTrie trie{1, 2, 3, 4};
+
+                // ASSERT
+                REQUIRE(trie.size() == 4);
+                REQUIRE(trie.levels() == 0);
+                REQUIRE(test_v3::equal(trie, std::vector{1, 2, 3, 4}));
+            }
+
+            SECTION("from a number of elements greater than chunk")
+            {
+                // ACT
+                IntTrie trie{1, 2, 3, 4, 5};
+
+                // ASSERT
+                REQUIRE(trie.size() == 5);
+                REQUIRE(trie.levels() == 1);
+                REQUIRE(test_v3::equal(trie, std::vector{1, 2, 3, 4, 5}));
+            }
+
+            SECTION("when more than 3 levels")
+            {
+                for (int i = 1; i <= 300; ++i)
+                {
+                    // ARRANGE
+                    std::vector<int> vec(i);
+                    std::iota(vec.begin(), vec.end(), 1);
+
+                    // ACT
+                    IntTrie trie(vec.begin(), vec.end());
+
+                    // ASSERT
+                    REQUIRE(test_v3::equal(trie, vec));
+                    REQUIRE(test_v3::chunks_to_vector(trie) == vec);
+                    for (int j = 0; j < i; ++j)
+                        REQUIRE(trie.at(j) == vec[j]);
+                }
+            }
+        }
+
+        SECTION("push_back")
+        {
+            // ARRANGE
+            IntTrie trie;
+            std::vector<int> vec;
+            std::vector<IntTrie> tries;
+
+            for (int i = 1; i <= 300; ++i)
+            {
+                // ACT
+                const auto new_trie = trie.push_back(i);
+
+                // ASSERT
+                REQUIRE(test_v3::equal(trie, vec));
+                vec.push_back(i);
+                REQUIRE(test_v3::equal(new_trie, vec));
+                tries.push_back(trie);
+                trie = new_trie;
+            }
+
+            for (std::size_t i = 0; i < tries.size(); ++i)
+                REQUIRE(tries[i].size() == i);
+            REQUIRE(trie.levels() == 5);
+        }
+
+        SECTION("push_back in place")
+        {
+            // ARRANGE
+            IntTrie trie{1, 2};
+            const auto shared_trie = trie;
+
+            // ACT
+            trie = std::move(trie).push_back(3);
+
+            // ASSERT
+            REQUIRE(test_v3::equal(trie, std::vector{1, 2, 3}));
+            REQUIRE(test_v3::equal(shared_trie, std::vector{1, 2}));
+        }
+
+        SECTION("update")
+        {
+            std::random_device rd;
+            std::default_random_engine re(rd());
+            std::uniform_int_distribution<size_t> ui_size(1U, 300U);
+            std::vector<int> vec(ui_size(re));
+            std::iota(vec.begin(), vec.end(), 1);
+            IntTrie trie(vec.begin(), vec.end());
+            const auto max_index = vec.size() - 1;
+            for (int i = 1; i <= 50; ++i)
+            {
+                std::uniform_int_distribution<size_t> ui_index(0U, max_index);
+                const auto update_index = ui_index(re);
+                std::uniform_int_distribution<> ui_value(-100, 400);
+                const auto update_value = ui_value(re);
+                const auto old_vec = vec;
+                const auto old_trie = trie;
+                vec[update_index] = update_value;
+                trie =
+                    trie.update(static_cast<IntTrie::size_type>(update_index),
+                                update_value);
+                REQUIRE(test_v3::equal(trie, vec));
+                REQUIRE(test_v3::equal(old_trie, old_vec));
+            }
+        }
+
+        SECTION("update with a throwing assignment")
+        {
+            // ARRANGE
+            using CountedTrie = v3::Trie<test_v3::CountedValue, 2>;
+            std::vector<test_v3::CountedValue> vec;
+            for (int i = 0; i < 70; ++i)
+                vec.push_back(i);
+            const CountedTrie trie(vec.begin(), vec.end());
+            const auto instances_count =
+                test_v3::CountedValue::instances_count;
+
+            // ACT & ASSERT
+            for (const auto index : {0U, 20U, 65U})
+            {
+                REQUIRE_THROWS_AS(trie.update(index, -1),
+                                  std::invalid_argument);
+                REQUIRE(test_v3::CountedValue::instances_count ==
+                        instances_count);
+            }
+            REQUIRE(test_v3::equal(trie, vec));
+        }
+
+        SECTION("pop_back")
+        {
+            // ARRANGE
+            static constexpr auto InitialCount = 4U * 4U * 4U * 4U * 4U + 1U;
+            std::vector<int> vec(InitialCount);
+            std::iota(vec.begin(), vec.end(), 1);
+            IntTrie trie(vec.begin(), vec.end());
+
+            for (auto i = InitialCount; i > 0; --i)
+            {
+                // ACT
+                const auto new_trie = trie.pop_back();
+
+                // ASSERT
+                REQUIRE(test_v3::equal(trie, vec));
+                vec.pop_back();
+                REQUIRE(test_v3::equal(new_trie, vec));
+                trie = new_trie;
+            }
+
+            REQUIRE(trie.empty());
+            REQUIRE(trie.levels() == 0);
+        }
+
+        SECTION("push_back after pop_back")
+        {
+            // ARRANGE
+            std::vector<int> vec(70);
+            std::iota(vec.begin(), vec.end(), 1);
+            const IntTrie trie(vec.begin(), vec.end());
+            const auto popped_trie = trie.pop_back().pop_back().pop_back();
+
+            // ACT
+            auto new_trie = popped_trie.push_back(-1);
+            new_trie = std::move(new_trie).push_back(-2);
+
+            // ASSERT
+            REQUIRE(test_v3::equal(trie, vec));
+            vec.resize(67);
+            REQUIRE(test_v3::equal(popped_trie, vec));
+            vec.push_back(-1);
+            vec.push_back(-2);
+            REQUIRE(test_v3::equal(new_trie, vec));
+        }
+
+        SECTION("non trivial values")
+        {
+            // ARRANGE
+            using StringTrie = v3::Trie<std::string, 3>;
+            std::vector<std::string> vec;
+            StringTrie trie;
+
+            // ACT
+            for (int i = 0; i < 100; ++i)
+            {
+                vec.push_back(std::string(30, static_cast<char>('a' + i % 26)));
+                trie = trie.push_back(vec.back());
+            }
+            const auto updated_trie = trie.update(50, "updated");
+            const auto popped_trie = updated_trie.pop_back();
+
+            // ASSERT
+            REQUIRE(test_v3::equal(trie, vec));
+            vec[50] = "updated";
+            REQUIRE(test_v3::equal(updated_trie, vec));
+            vec.pop_back();
+            REQUIRE(test_v3::equal(popped_trie, vec));
+        }
+
+        SECTION("concat")
+        {
+            for (int left_count = 0; left_count <= 70; left_count += 7)
+            {
+                for (int right_count = 0; right_count <= 90; right_count += 9)
+                {
+                    // ARRANGE
+                    std::vector<int> left_vec(left_count);
+                    std::iota(left_vec.begin(), left_vec.end(), 1);
+                    std::vector<int> right_vec(right_count);
+                    std::iota(right_vec.begin(), right_vec.end(), 1000);
+                    const IntTrie left(left_vec.begin(), left_vec.end());
+                    const IntTrie right(right_vec.begin(), right_vec.end());
+
+                    // ACT
+                    const auto trie = left.concat(right);
+
+                    // ASSERT
+                    auto vec = left_vec;
+                    vec.insert(vec.end(), right_vec.begin(), right_vec.end());
+                    CAPTURE(left_count, right_count);
+                    REQUIRE(test_v3::equal(trie, vec));
+                    REQUIRE(test_v3::chunks_to_vector(trie) == vec);
+                    REQUIRE(test_v3::equal(left, left_vec));
+                    REQUIRE(test_v3::equal(right, right_vec));
+                }
+            }
+        }
+
+        SECTION("take and drop")
+        {
+            // ARRANGE
+            std::vector<int> vec(150);
+            std::iota(vec.begin(), vec.end(), 1);
+            const IntTrie trie(vec.begin(), vec.end());
+
+            for (int count = 0; count <= 150; ++count)
+            {
+                // ACT
+                const auto taken = trie.take(count);
+                const auto dropped = trie.drop(count);
+
+                // ASSERT
+                CAPTURE(count);
+                REQUIRE(test_v3::equal(
+                    taken, std::vector<int>(vec.begin(), vec.begin() + count)));
+                REQUIRE(test_v3::equal(
+                    dropped, std::vector<int>(vec.begin() + count, vec.end())));
+                REQUIRE(test_v3::equal(taken.concat(dropped), vec));
+            }
+        }
+
+        SECTION("random slicing and concatenation")
+        {
+            std::random_device rd;
+            const auto seed = rd();
+            CAPTURE(seed);
+            std::default_random_engine re(seed);
+            std::uniform_int_distribution<> ui_operation(0, 6);
+
+            std::vector<int> vec;
+            IntTrie trie;
+            for (int i = 0; i < 500; ++i)
+            {
+                const auto size = static_cast<int>(vec.size());
+                const auto index =
+                    std::uniform_int_distribution<>(0, size)(re);
+                switch (ui_operation(re))
+                {
+                case 0:
+                    trie = trie.concat(trie);
+                    vec.insert(vec.end(), vec.begin(), vec.end());
+                    break;
+                case 1:
+                    trie = trie.take(index);
+                    vec.resize(index);
+                    break;
+                case 2:
+                    trie = trie.drop(index);
+                    vec.erase(vec.begin(), vec.begin() + index);
+                    break;
+                case 3:
+                    trie = trie.insert_at(index, i);
+                    vec.insert(vec.begin() + index, i);
+                    break;
+                case 4:
+                    trie = trie.push_back(i).push_back(-i);
+                    vec.push_back(i);
+                    vec.push_back(-i);
+                    break;
+                case 5:
+                    if (size > 0)
+                    {
+                        trie = trie.pop_back();
+                        vec.pop_back();
+                    }
+                    break;
+                default:
+                    if (index < size)
+                    {
+                        trie = trie.update(index, -1);
+                        vec[index] = -1;
+                    }
+                    break;
+                }
+                if (vec.size() > 2000)
+                {
+                    trie = trie.drop(1500);
+                    vec.erase(vec.begin(), vec.begin() + 1500);
+                }
+
+                CAPTURE(i);
+                REQUIRE(test_v3::equal(trie, vec));
+                for (int j = 0; j < static_cast<int>(vec.size()); j += 7)
+                    REQUIRE(trie.at(j) == vec[j]);
+            }
+        }
+
+        SECTION("parallel transform and reduce")
+        {
+            // ARRANGE
+            std::vector<int> vec(5000);
+            std::iota(vec.begin(), vec.end(), 1);
+            const IntTrie trie =
+                IntTrie(vec.begin(), vec.end()).drop(3).concat(IntTrie{1, 2, 3});
+            std::rotate(vec.begin(), vec.begin() + 3, vec.end());
+
+            // ACT
+            const auto strings = trie.parallel_transform(
+                [](int value) { return std::to_string(value); });
+            const auto sum = trie.parallel_reduce(
+                0, [](int lhs, int rhs) { return lhs + rhs; });
+
+            // ASSERT
+            std::vector<std::string> expected_strings;
+            for (const auto value : vec)
+                expected_strings.push_back(std::to_string(value));
+            REQUIRE(test_v3::equal(strings, expected_strings));
+            REQUIRE(sum == std::accumulate(vec.begin(), vec.end(), 0));
+        }
+
+        SECTION("node pool")
+        {
+            using PooledTrie = v3::Trie<long long, 3>;
+            using Pool = v3::detail::NodePool<sizeof(
+                v3::detail::TrieLeaf<long long, 8, v3::SingleThreadRefCount>)>;
+
+            // ARRANGE
+            {
+                std::vector<long long> vec(100);
+                PooledTrie trie(vec.begin(), vec.end());
+            }
+            const auto free_blocks_count = Pool::free_blocks_count();
+
+            // ACT
+            {
+                std::vector<long long> vec(100);
+                PooledTrie trie(vec.begin(), vec.end());
+
+                // ASSERT
+                REQUIRE(Pool::free_blocks_count() < free_blocks_count);
+            }
+            REQUIRE(Pool::free_blocks_count() == free_blocks_count);
+        }
+
+        SECTION("thread safe reference counting")
+        {
+            // ARRANGE
+            using SharedTrie = v3::Trie<int, 2, v3::ThreadSafeRefCount>;
+            std::vector<int> vec(1000);
+            std::iota(vec.begin(), vec.end(), 0);
+            const SharedTrie trie(vec.begin(), vec.end());
+
+            // ACT
+            std::vector<std::thread> threads;
+            std::vector<int> results(4);
+            for (int t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([&, t] {
+                    auto local_trie = trie;
+                    for (int i = 0; i < 500; ++i)
+                        local_trie = local_trie.pop_back().push_back(t);
+                    results[t] = local_trie.at(999);
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+
+            // ASSERT
+            REQUIRE(test_v3::equal(trie, vec));
+            REQUIRE(results == std::vector{0, 1, 2, 3});
+        }
+    }
+}
+
+TEST_CASE("chapter 8 v3 benchmark", "[.][benchmark]")
+{
+    using namespace fp_in_cpp;
+
+    static constexpr int Count = 1000000;
+
+    v2::Trie<int, 5> trie_v2;
+    v3::Trie<int, 5> trie_v3;
+
+    const auto push_back_v2 = test_v3::measure_duration([&] {
+        for (int i = 0; i < Count; ++i)
+            trie_v2 = trie_v2.push_back(i);
+    });
+    const auto push_back_v3 = test_v3::measure_duration([&] {
+        for (int i = 0; i < Count; ++i)
+            trie_v3 = trie_v3.push_back(i);
+    });
+
+    long long sum_v2 = 0;
+    long long sum_v3 = 0;
+    const auto iterate_v2 = test_v3::measure_duration(
+        [&] { sum_v2 = std::accumulate(trie_v2.begin(), trie_v2.end(), 0LL); });
+    const auto iterate_v3 = test_v3::measure_duration(
+        [&] { sum_v3 = std::accumulate(trie_v3.begin(), trie_v3.end(), 0LL); });
+
+    REQUIRE(sum_v2 == sum_v3);
+
+    std::cout << "push_back of " << Count << " ints: v2 "
+              << push_back_v2.count() << " us, v3 " << push_back_v3.count()
+              << " us\n";
+    std::cout << "iteration of " << Count << " ints: v2 "
+              << iterate_v2.count() << " us, v3 " << iterate_v3.count()
+              << " us\n";
+
+    static constexpr int SliceCount = 1000;
+    std::size_t total_size = 0;
+    const auto slicing_v3 = test_v3::measure_duration([&] {
+        for (int i = 1; i <= SliceCount; ++i)
+        {
+            const auto index = static_cast<v3::TrieSize>(i * (Count / SliceCount - 1));
+            const auto edited =
+                trie_v3.take(index).push_back(-i).concat(trie_v3.drop(index));
+            total_size += edited.size();
+        }
+    });
+    const auto xor_op = [](int lhs, int rhs) { return lhs ^ rhs; };
+    int xor_v3 = 0;
+    const auto reduce_v3 = test_v3::measure_duration(
+        [&] { xor_v3 = trie_v3.parallel_reduce(0, xor_op); });
+
+    REQUIRE(xor_v3 == std::accumulate(trie_v2.begin(), trie_v2.end(), 0, xor_op));
+    REQUIRE(total_size == static_cast<std::size_t>(SliceCount) * (Count + 1));
+
+    std::cout << SliceCount << " insertions by take/push_back/concat/drop: v3 "
+              << slicing_v3.count() << " us\n";
+    std::cout << "parallel reduce of " << Count << " ints: v3 "
+              << reduce_v3.count() << " us\n";
+}
@@ -0,0 +1,164 @@
+
+#pragma once
+
+#include <platform/filesystem.hpp>
+#include <platform/platform.h>
+#include <platform/system_error.hpp>
+#if EXP_PLATFORM_CPL_IS_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#endif
+#if EXP_PLATFORM_CPL_IS_MSVC
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4267)
+#endif
+#include <boost/process.hpp>
+#if EXP_PLATFORM_CPL_IS_MSVC
+#pragma warning(pop)
+#endif
+#if EXP_PLATFORM_CPL_IS_CLANG
+#pragma clang diagnostic pop
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// A git command run in its own working directory, so that several can run at the same time
+struct GitJob
+{
+    std::string description;
+    std::vector<std::string> args;
+    stdnext::filesystem::path working_dir;
+    stdnext::filesystem::path removed_before_retry; // what a failed attempt may leave behind, like a partial clone
+};
+
+struct GitJobResult
+{
+    int exit_code{-1};
+    bool timed_out{false};
+    unsigned attempts{0};
+    std::string output;
+    std::chrono::steady_clock::duration duration{};
+
+    bool succeeded() const { return exit_code == 0 && !timed_out; }
+};
+
+// Directory of the logs of this run, named after the process and the time, so that concurrent runs do not share logs
+inline stdnext::filesystem::path make_git_logs_dir()
+{
+    const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return stdnext::filesystem::temp_directory_path() / "gitcloner_logs" /
+           ("run_" + std::to_string(boost::this_process::get_id()) + "_" + std::to_string(milliseconds));
+}
+
+struct GitJobsSettings
+{
+    unsigned concurrency{4};
+    std::chrono::seconds timeout{300};
+    unsigned retries{1};
+    stdnext::filesystem::path logs_dir{make_git_logs_dir()};
+    bool verbose{true};
+};
+
+// Runs one attempt of the job, its standard and error outputs going to log_file
+inline GitJobResult run_git_job_once(const GitJob& job, const stdnext::filesystem::path& log_file, std::chrono::seconds timeout)
+{
+    namespace bproc = boost::process;
+
+    GitJobResult result;
+    std::error_code ec;
+    auto env = boost::this_process::environment();
+    env["GIT_TERMINAL_PROMPT"] = "0"; // fail instead of waiting for credentials
+    // In a group of its own, so that a timeout also stops what git started, like hooks, helpers or aliases
+    bproc::group group;
+    bproc::child child(bproc::search_path("git"), bproc::args(job.args), bproc::start_dir(job.working_dir.string()),
+                       (bproc::std_out & bproc::std_err) > log_file.string(), bproc::std_in < bproc::null, env, group, ec);
+    if (ec)
+    {
+        result.output = "Could not start git: " + ec.message() + "\n";
+        return result;
+    }
+
+    // Polled rather than child.wait_for, which spins or hangs with some Boost versions
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (child.running(ec) && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (child.running(ec))
+    {
+        result.timed_out = true;
+        group.terminate(ec);
+        child.wait(ec);
+    }
+    else
+        result.exit_code = child.exit_code();
+
+    std::ifstream log_stream{log_file.string()};
+    result.output.assign(std::istreambuf_iterator<char>(log_stream), std::istreambuf_iterator<char>());
+    if (result.timed_out)
+        result.output += "Timed out after " + std::to_string(timeout.count()) + " s\n";
+    return result;
+}
+
+// Runs the jobs, up to settings.concurrency at a time, retrying the failed ones; results are in the order of the jobs
+inline std::vector<GitJobResult> run_git_jobs(const std::vector<GitJob>& jobs, const GitJobsSettings& settings)
+{
+    std::vector<GitJobResult> results(jobs.size());
+    stdnext::error_code ec;
+    stdnext::filesystem::create_directories(settings.logs_dir, ec);
+
+    std::atomic<std::size_t> next_job_index{0};
+    std::mutex output_mutex;
+    const auto run_jobs = [&](unsigned worker_index)
+    {
+        const auto log_file = settings.logs_dir / ("worker_" + std::to_string(worker_index) + ".log");
+        for (auto job_index = next_job_index++; job_index < jobs.size(); job_index = next_job_index++)
+        {
+            const auto& job = jobs[job_index];
+            const auto start = std::chrono::steady_clock::now();
+            GitJobResult result;
+            for (unsigned attempt = 1; attempt <= settings.retries + 1; ++attempt)
+            {
+                if (attempt > 1)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(500) * (attempt - 1));
+                    if (!job.removed_before_retry.empty())
+                        stdnext::filesystem::remove_all(job.removed_before_retry, ec);
+                }
+                result = run_git_job_once(job, log_file, settings.timeout);
+                result.attempts = attempt;
+                if (result.succeeded())
+                    break;
+            }
+            result.duration = std::chrono::steady_clock::now() - start;
+
+            if (settings.verbose || !result.succeeded())
+            {
+                std::lock_guard<std::mutex> lock(output_mutex);
+                std::cout << (result.succeeded() ? "[done] " : "[failed] ") << job.description << " - "
+                          << std::chrono::duration_cast<std::chrono::milliseconds>(result.duration).count() << " ms, "
+                          << result.attempts << " attempt(s)\n";
+                if (!result.succeeded())
+                    std::cout << result.output;
+            }
+            results[job_index] = std::move(result);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    const auto workers_count = std::max(1u, std::min(settings.concurrency, static_cast<unsigned>(jobs.size())));
+    for (unsigned worker_index = 0; worker_index < workers_count; ++worker_index)
+        workers.emplace_back(run_jobs, worker_index);
+    for (auto& worker : workers)
+        worker.join();
+
+    return results;
+}
@@ -1,8 +1,10 @@
 
+#include "git_jobs.hpp"
 #include <platform/filesystem.hpp>
 #include <platform/platform.h>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -24,14 +26,14 @@ struct GithubUser
         return result;
     }
 
-    std::string user_url() const
+    std::string user_url(const std::string& base_url = "https://github.com") const
     {
-        return "https://github.com/" + account;
+        return base_url + "/" + account;
     }
 
-    std::string repo_url(const std::string& repo_name) const
+    std::string repo_url(const std::string& repo_name, const std::string& base_url = "https://github.com") const
     {
-        return user_url() + "/" + repo_name + ".git";
+        return user_url(base_url) + "/" + repo_name + ".git";
     }
 
     stdnext::filesystem::path clone_dir(const stdnext::filesystem::path& root_dir) const
@@ -59,8 +61,8 @@ std::vector<GithubUser> load_users(const stdnext::filesystem::path& users_file_p
     return users;
 }
 
-void clone_users_repositories(const stdnext::filesystem::path& root_dir, const std::string& repo_name,
-                              const std::vector<GithubUser>& users)
+void write_code_workspace(const stdnext::filesystem::path& root_dir, const std::string& repo_name,
+                          const std::vector<stdnext::filesystem::path>& clone_dirs)
 {
     std::ofstream vscode_workspace_stream{(root_dir / (repo_name + ".code-workspace")).string()};
 
@@ -69,55 +71,160 @@ void clone_users_repositories(const stdnext::filesystem::path& root_dir, const s
 
     bool more_than_one = false;
 
+    for (const auto& clone_dir : clone_dirs)
+    {
+        if (!more_than_one)
+            more_than_one = true;
+        else
+            vscode_workspace_stream << ",";
+        vscode_workspace_stream << "\n\t\t{\n";
+        vscode_workspace_stream << "\t\t\t\"path\": \"" << clone_dir.filename().string() << "\"\n";
+        vscode_workspace_stream << "\t\t}";
+    }
+
+    vscode_workspace_stream << "\n\t]\n";
+    vscode_workspace_stream << "}\n";
+}
+
+// Clones the repositories not cloned yet and pulls the others, settings.concurrency at a time
+std::chrono::steady_clock::duration clone_users_repositories(const stdnext::filesystem::path& root_dir, const std::string& repo_name,
+                                                             const std::vector<GithubUser>& users, const std::string& base_url,
+                                                             const GitJobsSettings& settings)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<GitJob> jobs;
+    std::vector<stdnext::filesystem::path> clone_dirs;
     for (const auto& user : users)
     {
         if (user.account.empty())
         {
             std::cout << "Skipping " << user.name << "'s repo (no account yet)\n";
+            continue;
         }
+
+        const auto clone_dir = user.clone_dir(root_dir);
+        if (stdnext::filesystem::exists(clone_dir))
+            jobs.push_back({"Pulling " + user.name + "'s repo", {"pull", "--rebase"}, clone_dir, {}});
         else
-        {
-            const auto clone_dir = user.clone_dir(root_dir);
-            if (stdnext::filesystem::exists(clone_dir))
-            {
-                std::cout << "Pulling " << user.name << "'s repo - Executing: ";
-                std::stringstream ss;
-                ss << "git pull --rebase";
-                std::cout << ss.str() << "\n";
-                stdnext::filesystem::current_path(clone_dir);
-                std::system(ss.str().c_str());
-            }
-            else
-            {
-                std::cout << "Cloning " << user.name << "'s repo - Executing: ";
-                std::stringstream ss;
-                ss << "git clone \"" << user.repo_url(repo_name) << "\" \"" << clone_dir.string() << "\"";
-                std::cout << ss.str() << "\n";
-                std::system(ss.str().c_str());
-            }
-            if (!more_than_one)
-                more_than_one = true;
-            else
-                vscode_workspace_stream << ",";
-            vscode_workspace_stream << "\n\t\t{\n";
-            vscode_workspace_stream << "\t\t\t\"path\": \"" << clone_dir.filename().string() << "\"\n";
-            vscode_workspace_stream << "\t\t}";
-        }
+            jobs.push_back({"Cloning " + user.name + "'s repo", {"clone", user.repo_url(repo_name, base_url), clone_dir.string()}, root_dir, clone_dir});
+        clone_dirs.push_back(clone_dir);
     }
 
-    vscode_workspace_stream << "\n\t]\n";
-    vscode_workspace_stream << "}\n";
+    const auto results = run_git_jobs(jobs, settings);
+    const auto failures_count = std::count_if(results.begin(), results.end(), [](const auto& result) { return !result.succeeded(); });
+
+    write_code_workspace(root_dir, repo_name, clone_dirs);
+
+    const auto duration = std::chrono::steady_clock::now() - start;
+    std::cout << jobs.size() << " repos, " << failures_count << " failed, in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << " ms with " << settings.concurrency << " concurrent jobs\n";
+    return duration;
 }
 
+// Compares the serial and concurrent modes on local bare repositories, without network
+void run_offline_benchmark(unsigned users_count, const GitJobsSettings& settings)
+{
+    namespace fs = stdnext::filesystem;
+    const auto benchmark_dir = fs::temp_directory_path() / "gitcloner_benchmark";
+    const std::string repo_name = "bulls_and_cows_skeleton";
+    stdnext::error_code ec;
+    fs::remove_all(benchmark_dir, ec);
+    fs::create_directories(benchmark_dir / "seed");
+
+    std::cout << "Preparing " << users_count << " bare repositories in " << benchmark_dir << "\n";
+    for (int file_index = 0; file_index < 200; ++file_index)
+    {
+        std::ofstream file{(benchmark_dir / "seed" / ("file_" + std::to_string(file_index) + ".cpp")).string()};
+        for (int line_index = 0; line_index < 100; ++line_index)
+            file << "int function_" << file_index << "_" << line_index << "() { return " << line_index << "; }\n";
+    }
+    std::vector<GitJob> setup_jobs{
+        {"Initializing seed", {"init", "-q"}, benchmark_dir / "seed", {}},
+        {"Adding seed files", {"add", "."}, benchmark_dir / "seed", {}},
+        {"Committing seed", {"-c", "user.name=gitcloner", "-c", "user.email=gitcloner@localhost", "commit", "-q", "-m", "seed"}, benchmark_dir / "seed", {}},
+    };
+    std::vector<GithubUser> users;
+    for (unsigned user_index = 0; user_index < users_count; ++user_index)
+    {
+        GithubUser user{"Student " + std::to_string(user_index), "student" + std::to_string(user_index)};
+        fs::create_directories(benchmark_dir / "remotes" / user.account);
+        users.push_back(std::move(user));
+    }
+
+    auto quiet_settings = settings;
+    quiet_settings.verbose = false;
+    quiet_settings.concurrency = 1;
+    run_git_jobs(setup_jobs, quiet_settings);
+    std::vector<GitJob> bare_jobs;
+    for (const auto& user : users)
+        bare_jobs.push_back({"Creating " + user.account + "'s bare repo", {"clone", "-q", "--bare", (benchmark_dir / "seed").string(), user.repo_url(repo_name, (benchmark_dir / "remotes").string())}, benchmark_dir, {}});
+    quiet_settings.concurrency = settings.concurrency;
+    run_git_jobs(bare_jobs, quiet_settings);
+
+    const auto base_url = "file://" + (benchmark_dir / "remotes").generic_string();
+    quiet_settings.concurrency = 1;
+    fs::create_directories(benchmark_dir / "serial");
+    const auto serial_clone = clone_users_repositories(benchmark_dir / "serial", repo_name, users, base_url, quiet_settings);
+    const auto serial_pull = clone_users_repositories(benchmark_dir / "serial", repo_name, users, base_url, quiet_settings);
+    quiet_settings.concurrency = settings.concurrency;
+    fs::create_directories(benchmark_dir / "concurrent");
+    const auto concurrent_clone = clone_users_repositories(benchmark_dir / "concurrent", repo_name, users, base_url, quiet_settings);
+    const auto concurrent_pull = clone_users_repositories(benchmark_dir / "concurrent", repo_name, users, base_url, quiet_settings);
+
+    const auto ms = [](std::chrono::steady_clock::duration duration) { return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(); };
+    std::cout << "clone: serial " << ms(serial_clone) << " ms, " << settings.concurrency << " concurrent jobs " << ms(concurrent_clone) << " ms\n";
+    std::cout << "pull:  serial " << ms(serial_pull) << " ms, " << settings.concurrency << " concurrent jobs " << ms(concurrent_pull) << " ms\n";
+}
+
+// gitcloner [users_file [root_dir [repo_name]]] [--jobs N] [--timeout seconds] [--retries N] [--base_url url]
+// gitcloner --benchmark users_count [--jobs N]
 int main(int argc, char** argv)
 {
-    const char* users_file_path = (argc > 1) ? argv[1] : R"(D:\DEV\PERSO\TRAINING\EFREI\eleves\names_accounts.txt)";
-    const char* root_dir = (argc > 2) ? argv[2] : R"(D:\DEV\PERSO\TRAINING\EFREI\eleves)";
-    const char* repo_name = (argc > 3) ? argv[3] : "bulls_and_cows_skeleton";
+    std::vector<std::string> positional_args;
+    std::string base_url = "https://github.com";
+    GitJobsSettings settings;
+    settings.concurrency = std::max(4u, std::thread::hardware_concurrency());
+    unsigned benchmark_users_count = 0;
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        const std::string arg = argv[arg_index];
+        if (arg != "--jobs" && arg != "--timeout" && arg != "--retries" && arg != "--base_url" && arg != "--benchmark")
+        {
+            positional_args.push_back(arg);
+            continue;
+        }
+        if (arg_index + 1 == argc)
+        {
+            std::cerr << "Missing value of option " << arg << "\n";
+            return 1;
+        }
+        const std::string value = argv[++arg_index];
+        if (arg == "--jobs")
+            settings.concurrency = static_cast<unsigned>(std::stoul(value));
+        else if (arg == "--timeout")
+            settings.timeout = std::chrono::seconds(std::stoul(value));
+        else if (arg == "--retries")
+            settings.retries = static_cast<unsigned>(std::stoul(value));
+        else if (arg == "--base_url")
+            base_url = value;
+        else
+            benchmark_users_count = static_cast<unsigned>(std::stoul(value));
+    }
+
+    if (benchmark_users_count != 0)
+    {
+        run_offline_benchmark(benchmark_users_count, settings);
+        return 0;
+    }
+
+    const auto users_file_path = (positional_args.size() > 0) ? positional_args[0] : R"(D:\DEV\PERSO\TRAINING\EFREI\eleves\names_accounts.txt)";
+    const auto root_dir = (positional_args.size() > 1) ? positional_args[1] : R"(D:\DEV\PERSO\TRAINING\EFREI\eleves)";
+    const auto repo_name = (positional_args.size() > 2) ? positional_args[2] : "bulls_and_cows_skeleton";
 
     const auto users = load_users(users_file_path);
 
-    clone_users_repositories(root_dir, repo_name, users);
+    clone_users_repositories(root_dir, repo_name, users, base_url, settings);
 
     return 0;
 }
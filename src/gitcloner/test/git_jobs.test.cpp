@@ -0,0 +1,122 @@
+#include <catch2/catch.hpp>
+#include "../git_jobs.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = stdnext::filesystem;
+
+namespace {
+
+    // Local bare repository holding one commit, in a directory of its own
+    struct LocalRepository
+    {
+        LocalRepository()
+        {
+            stdnext::error_code ec;
+            fs::remove_all(root_dir, ec);
+            fs::create_directories(root_dir / "seed");
+            GitJobsSettings settings;
+            settings.concurrency = 1;
+            settings.retries = 0;
+            settings.logs_dir = root_dir / "setup_logs";
+            settings.verbose = false;
+            const auto results = run_git_jobs(
+                {
+                    {"Initializing seed", {"init", "-q"}, root_dir / "seed", {}},
+                    {"Committing seed", {"-c", "user.name=gitcloner", "-c", "user.email=gitcloner@localhost", "commit", "-q", "--allow-empty", "-m", "seed"}, root_dir / "seed", {}},
+                    {"Creating bare repo", {"clone", "-q", "--bare", (root_dir / "seed").string(), (root_dir / "origin.git").string()}, root_dir, {}},
+                },
+                settings);
+            for (const auto& result : results)
+                REQUIRE(result.succeeded());
+        }
+
+        ~LocalRepository()
+        {
+            stdnext::error_code ec;
+            fs::remove_all(root_dir, ec);
+        }
+
+        const fs::path root_dir{fs::temp_directory_path() / ("gitcloner_test_" + std::to_string(boost::this_process::get_id()))};
+    };
+
+} // namespace
+
+TEST_CASE("run_git_jobs")
+{
+    const LocalRepository repository;
+    const auto& root_dir = repository.root_dir;
+    GitJobsSettings settings;
+    settings.concurrency = 3;
+    settings.timeout = std::chrono::seconds(60);
+    settings.retries = 1;
+    settings.logs_dir = root_dir / "logs";
+    settings.verbose = false;
+
+    SECTION("When cloning then pulling")
+    {
+        std::vector<GitJob> jobs;
+        for (int clone_index = 0; clone_index < 5; ++clone_index)
+        {
+            const auto clone_dir = root_dir / ("clone_" + std::to_string(clone_index));
+            jobs.push_back({"Cloning " + std::to_string(clone_index), {"clone", "-q", (root_dir / "origin.git").string(), clone_dir.string()}, root_dir, clone_dir});
+        }
+        jobs.push_back({"Cloning missing", {"clone", "-q", (root_dir / "missing.git").string(), (root_dir / "missing").string()}, root_dir, root_dir / "missing"});
+
+        const auto clone_results = run_git_jobs(jobs, settings);
+
+        REQUIRE(clone_results.size() == jobs.size());
+        for (int clone_index = 0; clone_index < 5; ++clone_index)
+        {
+            INFO(clone_index);
+            REQUIRE(clone_results[clone_index].succeeded());
+            REQUIRE(clone_results[clone_index].attempts == 1);
+            REQUIRE(fs::exists(root_dir / ("clone_" + std::to_string(clone_index)) / ".git" / "HEAD"));
+        }
+        const auto& failed_result = clone_results.back();
+        REQUIRE(!failed_result.succeeded());
+        REQUIRE(!failed_result.timed_out);
+        REQUIRE(failed_result.exit_code != 0);
+        REQUIRE(failed_result.attempts == 2);
+        REQUIRE(failed_result.output.find("missing.git") != std::string::npos);
+        REQUIRE(!fs::exists(root_dir / "missing"));
+        REQUIRE(fs::exists(settings.logs_dir / "worker_0.log"));
+
+        const auto pull_results = run_git_jobs({{"Pulling 0", {"pull", "-q", "--rebase"}, root_dir / "clone_0", {}}}, settings);
+
+        REQUIRE(pull_results.size() == 1);
+        REQUIRE(pull_results[0].succeeded());
+    }
+
+    SECTION("When a job times out")
+    {
+        settings.timeout = std::chrono::seconds(1);
+        settings.retries = 0;
+
+        const auto ticks_file = root_dir / "ticks.txt";
+        const auto results = run_git_jobs({{"Ticking", {"-c", "alias.tick=!while true; do echo tick >> ticks.txt; sleep 0.1; done", "tick"}, root_dir, {}}}, settings);
+
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].timed_out);
+        REQUIRE(!results[0].succeeded());
+        REQUIRE(results[0].attempts == 1);
+        REQUIRE(results[0].duration < std::chrono::seconds(5));
+
+        // What git started is stopped along with it, and no longer writes into the working directory
+        REQUIRE(fs::exists(ticks_file));
+        const auto ticks_size = fs::file_size(ticks_file);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        REQUIRE(fs::file_size(ticks_file) == ticks_size);
+    }
+}
+
+TEST_CASE("make_git_logs_dir")
+{
+    const auto logs_dir = GitJobsSettings{}.logs_dir;
+
+    // A directory of its own for each process, so that concurrent runs do not overwrite each other's logs
+    REQUIRE(logs_dir.parent_path() == fs::temp_directory_path() / "gitcloner_logs");
+    REQUIRE(logs_dir.filename().string().find("_" + std::to_string(boost::this_process::get_id()) + "_") != std::string::npos);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <platform/filesystem.hpp>
+#include <platform/platform.h>
+#include <cstddef>
+#include <string_view>
+
+#if EXP_PLATFORM_OS_IS_WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace platform {
+
+    // How the mapped file is going to be read, to tune the read ahead
+    enum class mapped_file_access
+    {
+        sequential, // from its beginning to its end
+        whole,      // soon, in any order, as when parts of it are read by several threads
+    };
+
+    // Read-only view of a whole file, mapped in memory.
+    // An empty file is open, with an empty view.
+    class mapped_file
+    {
+    public:
+        explicit mapped_file(const stdnext::filesystem::path& path, mapped_file_access access = mapped_file_access::sequential)
+        {
+#if EXP_PLATFORM_OS_IS_WINDOWS
+            m_file = ::CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   access == mapped_file_access::sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+            LARGE_INTEGER size{};
+            if (m_file == INVALID_HANDLE_VALUE || !::GetFileSizeEx(m_file, &size))
+                return;
+            m_is_open = true;
+            if (size.QuadPart == 0)
+                return;
+            m_mapping = ::CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping)
+                m_data = static_cast<const char*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            m_size = m_data ? static_cast<std::size_t>(size.QuadPart) : 0;
+            m_is_open = m_data != nullptr;
+#else
+            m_descriptor = ::open(path.c_str(), O_RDONLY);
+            struct stat status{};
+            if (m_descriptor < 0 || ::fstat(m_descriptor, &status) != 0)
+                return;
+            m_is_open = true;
+            if (status.st_size == 0)
+                return;
+            const auto data = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, m_descriptor, 0);
+            if (data == MAP_FAILED)
+            {
+                m_is_open = false;
+                return;
+            }
+            ::madvise(data, static_cast<std::size_t>(status.st_size), access == mapped_file_access::sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+            m_data = static_cast<const char*>(data);
+            m_size = static_cast<std::size_t>(status.st_size);
+#endif
+        }
+
+        ~mapped_file()
+        {
+#if EXP_PLATFORM_OS_IS_WINDOWS
+            if (m_data)
+                ::UnmapViewOfFile(m_data);
+            if (m_mapping)
+                ::CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE)
+                ::CloseHandle(m_file);
+#else
+            if (m_data)
+                ::munmap(const_cast<char*>(m_data), m_size);
+            if (m_descriptor >= 0)
+                ::close(m_descriptor);
+#endif
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        bool is_open() const noexcept { return m_is_open; }
+
+        const char* data() const noexcept { return m_data; }
+
+        std::size_t size() const noexcept { return m_size; }
+
+        std::string_view view() const noexcept { return std::string_view(m_data, m_size); }
+
+    private:
+#if EXP_PLATFORM_OS_IS_WINDOWS
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#else
+        int m_descriptor = -1;
+#endif
+        const char* m_data = nullptr;
+        std::size_t m_size = 0;
+        bool m_is_open = false;
+    };
+
+} // namespace platform
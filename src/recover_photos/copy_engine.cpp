@@ -0,0 +1,315 @@
+
+#include "copy_engine.hpp"
+#include <platform/system_error.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fs = stdnext::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    struct CopyJob
+    {
+        fs::path source_file{};
+        fs::path target_file{};
+        std::uintmax_t size{};
+    };
+
+    struct CopyResult
+    {
+        std::size_t file_index{};
+        bool is_copied{};
+    };
+
+    // Shared with the workers, which outlive copy_files_concurrently when abandoned in a stalled read
+    struct EngineState
+    {
+        std::mutex mutex{};
+        std::condition_variable results_available{};
+        std::vector<CopyJob> jobs{};
+        std::vector<std::size_t> pending_files{};
+        std::size_t next_pending_file{};
+        std::vector<CopyResult> results{};
+        bool is_stopping{};
+        std::atomic<std::uint64_t> bytes_copied{};
+        BlockCopierFactory make_block_copier{};
+    };
+
+    // Start of the chunk of a worker given up by the engine
+    constexpr Clock::rep AbandonedChunkStart = -1;
+
+    struct WorkerSlot
+    {
+        // 0 when the worker is not copying a chunk. Only the engine sets AbandonedChunkStart, and only with a
+        // compare-exchange on the start it timed out, so it never gives up on a chunk that completed meanwhile
+        std::atomic<Clock::rep> chunk_start{};
+        std::size_t file_index{}; // guarded by EngineState::mutex
+        bool is_busy{};           // guarded by EngineState::mutex
+
+        bool is_abandoned() const { return chunk_start == AbandonedChunkStart; }
+
+        // Ends the current chunk and starts the next one, or none when 0;
+        // returns false when the engine gave up on the current chunk
+        bool start_chunk(Clock::rep next_chunk_start)
+        {
+            auto current_chunk_start = chunk_start.load();
+            return current_chunk_start != AbandonedChunkStart && chunk_start.compare_exchange_strong(current_chunk_start, next_chunk_start);
+        }
+    };
+
+    Clock::rep now_count()
+    {
+        return Clock::now().time_since_epoch().count();
+    }
+
+    class StreamBlockCopier : public BlockCopier
+    {
+    public:
+        StreamBlockCopier(const fs::path& source_file, const fs::path& target_file)
+            : m_ifs(source_file.string(), std::ios::binary)
+            , m_ofs(target_file.string(), std::ios::binary | std::ios::trunc)
+        {
+        }
+
+        bool is_open() const { return m_ifs && m_ofs; }
+
+        BlockStatus copy_block(std::uint64_t offset, std::size_t size) override
+        {
+            m_buffer.resize(std::max(m_buffer.size(), size));
+            if (!m_ifs.seekg(static_cast<std::streamoff>(offset)) || !m_ifs.read(m_buffer.data(), static_cast<std::streamsize>(size)))
+                return BlockStatus::Error;
+            if (!m_ofs.seekp(static_cast<std::streamoff>(offset)) || !m_ofs.write(m_buffer.data(), static_cast<std::streamsize>(size)))
+                return BlockStatus::Error;
+            return BlockStatus::Ok;
+        }
+
+    private:
+        std::ifstream m_ifs;
+        std::ofstream m_ofs;
+        std::vector<char> m_buffer;
+    };
+
+    bool copy_file_by_chunks(const CopyJob& job, std::size_t chunk_size, EngineState& state, WorkerSlot& slot)
+    {
+        // Opening a file on a damaged card may stall too
+        if (!slot.start_chunk(now_count()))
+            return false;
+        stdnext::error_code ec;
+        if (fs::exists(job.target_file, ec))
+            return slot.start_chunk(0);
+
+        // The target only gets its name once complete, so a damaged file leaves a .partial file behind
+        const auto partial_file = fs::path(job.target_file.string() + ".partial");
+        auto copier = state.make_block_copier(job.source_file, partial_file);
+        if (!copier)
+        {
+            slot.start_chunk(0);
+            return false;
+        }
+
+        for (std::uint64_t offset = 0; offset < job.size; offset += chunk_size)
+        {
+            if (!slot.start_chunk(now_count()))
+                return false;
+            const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(chunk_size, job.size - offset));
+            if (copier->copy_block(offset, size) != BlockStatus::Ok)
+            {
+                slot.start_chunk(0);
+                return false;
+            }
+            state.bytes_copied += size;
+        }
+        if (!slot.start_chunk(0))
+            return false;
+
+        // Flushes and closes the target before renaming it
+        copier.reset();
+        fs::rename(partial_file, job.target_file, ec);
+        return !ec;
+    }
+
+    void run_worker(std::shared_ptr<EngineState> state, std::shared_ptr<WorkerSlot> slot, std::size_t chunk_size)
+    {
+        for (;;)
+        {
+            CopyJob job;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (slot->is_abandoned() || state->is_stopping || state->next_pending_file == state->pending_files.size())
+                    return;
+                slot->file_index = state->pending_files[state->next_pending_file++];
+                slot->is_busy = true;
+                job = state->jobs[slot->file_index];
+            }
+
+            const auto is_copied = copy_file_by_chunks(job, chunk_size, *state, *slot);
+
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                slot->is_busy = false;
+                if (slot->is_abandoned())
+                    return;
+                state->results.push_back({ slot->file_index, is_copied });
+            }
+            state->results_available.notify_one();
+        }
+    }
+
+    double to_megabytes(std::uint64_t bytes)
+    {
+        return static_cast<double>(bytes) / (1024. * 1024.);
+    }
+
+} // namespace
+
+std::unique_ptr<BlockCopier> make_stream_block_copier(const fs::path& source_file, const fs::path& target_file)
+{
+    auto copier = std::make_unique<StreamBlockCopier>(source_file, target_file);
+    if (!copier->is_open())
+        return nullptr;
+    return copier;
+}
+
+void copy_files_concurrently(
+    const CopyEngineSettings& settings,
+    const fs::path& source_dir,
+    const fs::path& target_dir,
+    const fs::path& files_descriptions_file,
+    FilesDescriptions& files_descriptions,
+    const BlockCopierFactory& make_block_copier)
+{
+    std::cout << "Copying files concurrently based on collected files descriptions\n";
+
+    auto state = std::make_shared<EngineState>();
+    state->make_block_copier = make_block_copier;
+    for (std::size_t file_index = 0; file_index < files_descriptions.size(); ++file_index)
+    {
+        const auto& file_description = files_descriptions[file_index];
+        state->jobs.push_back({ source_dir / file_description.name, target_dir / file_description.name, file_description.size });
+        if (!file_description.is_damaged && !file_description.is_copied)
+            state->pending_files.push_back(file_index);
+    }
+    if (state->pending_files.empty())
+        return;
+
+    stdnext::error_code ec;
+    if (!fs::exists(target_dir))
+    {
+        std::cout << "Creating target directory: " << target_dir << "\n";
+        fs::create_directories(target_dir, ec);
+    }
+
+    std::vector<std::shared_ptr<WorkerSlot>> slots;
+    std::vector<std::thread> workers;
+    const auto start_worker = [&]
+    {
+        slots.push_back(std::make_shared<WorkerSlot>());
+        workers.emplace_back(run_worker, state, slots.back(), settings.chunk_size);
+    };
+    const auto workers_count = std::min<std::size_t>(std::max(settings.workers_count, 1U), state->pending_files.size());
+    for (std::size_t worker_index = 0; worker_index < workers_count; ++worker_index)
+        start_worker();
+
+    const auto start_time = Clock::now();
+    auto last_report_time = start_time;
+    auto last_checkpoint_time = start_time;
+    std::size_t done_count = 0;
+    unsigned int errors_count = 0;
+
+    const auto report = [&](Clock::time_point now)
+    {
+        const auto seconds = std::chrono::duration<double>(now - start_time).count();
+        const auto megabytes = to_megabytes(state->bytes_copied);
+        std::cout << "Copied " << done_count << "/" << state->pending_files.size() << " files, " << errors_count << " errors, "
+                  << std::fixed << std::setprecision(1) << megabytes << " MB, " << (seconds > 0 ? megabytes / seconds : 0.) << " MB/s\n"
+                  << std::defaultfloat;
+    };
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    for (;;)
+    {
+        state->results_available.wait_for(lock, std::chrono::milliseconds(100));
+        const auto now = Clock::now();
+
+        for (const auto& result : state->results)
+        {
+            auto& file_description = files_descriptions[result.file_index];
+            file_description.is_copied = result.is_copied;
+            file_description.is_damaged = !result.is_copied;
+            if (!result.is_copied)
+            {
+                std::cout << "Could not copy: " << state->jobs[result.file_index].source_file << "\n";
+                ++errors_count;
+            }
+            ++done_count;
+        }
+        state->results.clear();
+
+        bool is_any_worker_busy = false;
+        for (std::size_t worker_index = 0; worker_index < slots.size(); ++worker_index)
+        {
+            auto& slot = *slots[worker_index];
+            auto chunk_start = slot.chunk_start.load();
+            if (chunk_start == AbandonedChunkStart || !slot.is_busy)
+                continue;
+            // The worker may complete its chunk at any time, in which case the compare-exchange fails
+            if (chunk_start == 0 || now - Clock::time_point(Clock::duration(chunk_start)) < settings.chunk_timeout ||
+                !slot.chunk_start.compare_exchange_strong(chunk_start, AbandonedChunkStart))
+            {
+                is_any_worker_busy = true;
+                continue;
+            }
+
+            std::cout << "Could not copy: " << state->jobs[slot.file_index].source_file << " - No progress for " << settings.chunk_timeout.count() << " ms\n";
+            workers[worker_index].detach();
+            auto& file_description = files_descriptions[slot.file_index];
+            file_description.is_copied = false;
+            file_description.is_damaged = true;
+            ++errors_count;
+            ++done_count;
+            if (!state->is_stopping && state->next_pending_file < state->pending_files.size())
+                start_worker();
+        }
+
+        if (!state->is_stopping && errors_count >= settings.max_errors_count)
+        {
+            std::cout << "More than " << settings.max_errors_count << " errors - stopping\n";
+            state->is_stopping = true;
+        }
+        if ((state->is_stopping || done_count == state->pending_files.size()) && !is_any_worker_busy)
+            break;
+
+        if (now - last_report_time >= std::chrono::seconds(1))
+        {
+            report(now);
+            last_report_time = now;
+        }
+        if (now - last_checkpoint_time >= settings.checkpoint_period)
+        {
+            // Only this thread touches the files descriptions
+            lock.unlock();
+            save_files_descriptions(files_descriptions_file, files_descriptions);
+            lock.lock();
+            last_checkpoint_time = Clock::now();
+        }
+    }
+    state->is_stopping = true;
+    lock.unlock();
+
+    for (auto& worker : workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+    report(Clock::now());
+}
@@ -0,0 +1,41 @@
+
+#pragma once
+
+#include "photos.hpp"
+#include "salvage.hpp"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+struct CopyEngineSettings
+{
+    unsigned int workers_count{4};
+    std::size_t chunk_size{1024 * 1024};
+    std::chrono::milliseconds chunk_timeout{5000};
+    std::chrono::milliseconds checkpoint_period{5000};
+    unsigned int max_errors_count{50};
+};
+
+// Makes the copier of a source file to a target file, or returns nullptr when either cannot be opened
+using BlockCopierFactory = std::function<std::unique_ptr<BlockCopier>(
+    const stdnext::filesystem::path& source_file,
+    const stdnext::filesystem::path& target_file)>;
+
+// Copies the blocks with buffered streams, the blocks being requested in order
+std::unique_ptr<BlockCopier> make_stream_block_copier(
+    const stdnext::filesystem::path& source_file,
+    const stdnext::filesystem::path& target_file);
+
+// Copies the files neither copied nor damaged yet with several workers, each reading its file chunk by chunk.
+// A worker that does not finish a chunk within chunk_timeout is abandoned to its stalled read, its file is marked
+// damaged and a new worker takes over the remaining files. A file is copied in chunks of chunk_size bytes, by a
+// copier made by make_block_copier.
+// The files descriptions are saved to files_descriptions_file every checkpoint_period.
+void copy_files_concurrently(
+    const CopyEngineSettings& settings,
+    const stdnext::filesystem::path& source_dir,
+    const stdnext::filesystem::path& target_dir,
+    const stdnext::filesystem::path& files_descriptions_file,
+    FilesDescriptions& files_descriptions,
+    const BlockCopierFactory& make_block_copier = make_stream_block_copier);
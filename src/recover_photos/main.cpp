@@ -1,6 +1,8 @@
 
+#include "copy_engine.hpp"
 #include "options.hpp"
 #include "photos.hpp"
+#include "salvage.hpp"
 #include <iostream>
 
 int main(int argc, char* argv[])
@@ -14,9 +16,27 @@ int main(int argc, char* argv[])
             copy_file_in_this_thread(options.source_file, options.target_dir);
             return 0;
         }
+        if (options.mode == Mode::SalvageSlave)
+            return serve_block_copies(options.source_file, options.target_dir);
 
         auto files_descriptions = load_or_collect_files_descriptions(options.sorting, options.files_descriptions_file, options.source_dir);
-        copy_files(options.mode, options.max_errors_count, argv[0], options.source_dir, options.target_dir, files_descriptions);
+        if (options.mode == Mode::Concurrent)
+        {
+            CopyEngineSettings settings;
+            settings.workers_count = options.workers_count;
+            settings.chunk_timeout = std::chrono::milliseconds(options.chunk_timeout_ms);
+            settings.max_errors_count = options.max_errors_count;
+            copy_files_concurrently(settings, options.source_dir, options.target_dir, options.files_descriptions_file, files_descriptions);
+        }
+        else if (options.mode == Mode::Salvage)
+        {
+            SalvageSettings settings;
+            settings.block_size = std::size_t{options.block_size_kb} * 1024;
+            settings.block_timeout = std::chrono::milliseconds(options.block_timeout_ms);
+            salvage_files(settings, argv[0], options.source_dir, options.target_dir, options.salvage_map_file, options.files_descriptions_file, files_descriptions);
+        }
+        else
+            copy_files(options.mode, options.max_errors_count, argv[0], options.source_dir, options.target_dir, files_descriptions);
         save_files_descriptions(options.files_descriptions_file, files_descriptions);
     }
     catch (ParsingError& err)
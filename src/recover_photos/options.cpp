@@ -19,8 +19,14 @@ std::istream& operator>>(std::istream& in, Mode& mode)
         mode = Mode::Thread;
     else if (token == "process")
         mode = Mode::Process;
+    else if (token == "concurrent")
+        mode = Mode::Concurrent;
+    else if (token == "salvage")
+        mode = Mode::Salvage;
     else if (token == "slave")
         mode = Mode::Slave;
+    else if (token == "salvage_slave")
+        mode = Mode::SalvageSlave;
     else
         in.setstate(std::ios_base::failbit);
     return in;
@@ -87,13 +93,18 @@ Options parse_command_line(int argc, char* argv[])
     {
         desc.add_options()
             ("help", "Help screen")
-            ("mode", bpop::value<Mode>(&options.mode)->required(), "Can be direct, thread or process")
+            ("mode", bpop::value<Mode>(&options.mode)->required(), "Can be direct, thread, process, concurrent or salvage")
             ("sorting", bpop::value<Sorting>(&options.sorting)->default_value(Sorting::Default), "Can be default, name_desc, name_asc or random")
             ("source_dir", bpop::value<fs::path>(&options.source_dir), "Directory where to copy the photos from")
             ("source_file", bpop::value<fs::path>(&options.source_file), "Full path name of file to copy")
             ("target_dir", bpop::value<fs::path>(&options.target_dir), "Directory where to copy the photos to")
             ("files_descriptions_file", bpop::value<fs::path>(&options.files_descriptions_file)->default_value(fs::path(argv[0]).parent_path() / "files_descriptions.txt"), "Full path name of file containing the source files descriptions")
             ("max_errors_count", bpop::value<unsigned int>(&options.max_errors_count)->default_value(50U), "Maximum errors count before stopping")
+            ("workers_count", bpop::value<unsigned int>(&options.workers_count)->default_value(4U), "Number of files copied at the same time in concurrent mode")
+            ("block_size_kb", bpop::value<unsigned int>(&options.block_size_kb)->default_value(1024U), "Size of the blocks first read from a damaged file in salvage mode")
+            ("block_timeout_ms", bpop::value<unsigned int>(&options.block_timeout_ms)->default_value(2000U), "Time allowed to read each block of a damaged file in salvage mode")
+            ("salvage_map_file", bpop::value<fs::path>(&options.salvage_map_file)->default_value(fs::path(argv[0]).parent_path() / "salvage_map.txt"), "Full path name of file containing the unreadable ranges of the damaged files")
+            ("chunk_timeout_ms", bpop::value<unsigned int>(&options.chunk_timeout_ms)->default_value(5000U), "Time allowed to copy each chunk of a file in concurrent mode")
             ;
         store(parse_command_line(argc, argv, desc), vm);
         notify(vm);
@@ -102,12 +113,15 @@ Options parse_command_line(int argc, char* argv[])
         case Mode::Direct:
         case Mode::Thread:
         case Mode::Process:
+        case Mode::Concurrent:
+        case Mode::Salvage:
             if (vm.count("source_dir") == 0)
                 throw_parsing_error("missing source_dir");
             if (vm.count("target_dir") == 0)
                 throw_parsing_error("missing target_dir");
             break;
         case Mode::Slave:
+        case Mode::SalvageSlave:
             if (vm.count("source_file") == 0)
                 throw_parsing_error("missing source_file");
             if (vm.count("target_dir") == 0)
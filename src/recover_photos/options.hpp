@@ -9,7 +9,10 @@ enum class Mode
     Direct,
     Thread,
     Process,
+    Concurrent,
+    Salvage,
     Slave,
+    SalvageSlave,
 };
 
 enum class Sorting
@@ -28,7 +31,12 @@ struct Options
     stdnext::filesystem::path source_file{};
     stdnext::filesystem::path target_dir{};
     stdnext::filesystem::path files_descriptions_file{};
+    stdnext::filesystem::path salvage_map_file{};
     unsigned int max_errors_count{};
+    unsigned int workers_count{};
+    unsigned int chunk_timeout_ms{};
+    unsigned int block_size_kb{};
+    unsigned int block_timeout_ms{};
 };
 
 struct ParsingError : public std::runtime_error
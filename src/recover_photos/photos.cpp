@@ -277,7 +277,10 @@ void copy_files(
             return copy_file_in_separate_thread;
         case Mode::Process:
             return copy_file_in_separate_process;
+        case Mode::Concurrent:
+        case Mode::Salvage:
         case Mode::Slave:
+        case Mode::SalvageSlave:
             break;
         }
         return copy_file_in_this_thread_adapted;
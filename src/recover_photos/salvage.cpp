@@ -0,0 +1,455 @@
+
+#include "salvage.hpp"
+#if EXP_PLATFORM_CPL_IS_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable" // warning : unused variable 'cnt' [-Wunused-variable]
+#endif
+#if EXP_PLATFORM_CPL_IS_MSVC
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4267) // warning C4267: 'argument': conversion from 'size_t' to 'boost::winapi::ULONG_', possible loss of data
+#endif
+#include <boost/process.hpp>
+#if EXP_PLATFORM_CPL_IS_MSVC
+#pragma warning(pop)
+#endif
+#if EXP_PLATFORM_CPL_IS_CLANG
+#pragma clang diagnostic pop
+#endif
+#include <platform/system_error.hpp>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#if EXP_PLATFORM_OS_IS_WINDOWS
+#include <Windows.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = stdnext::filesystem;
+namespace bproc = boost::process;
+using Clock = std::chrono::steady_clock;
+
+SalvageMap load_salvage_map(const fs::path& salvage_map_file)
+{
+    SalvageMap salvage_map;
+
+    // name,begin,end,block_size where the name may contain commas
+    std::ifstream ifs(salvage_map_file.string());
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        const auto block_size_comma = line.rfind(',');
+        const auto end_comma = block_size_comma == std::string::npos || block_size_comma == 0 ? std::string::npos : line.rfind(',', block_size_comma - 1);
+        const auto begin_comma = end_comma == std::string::npos || end_comma == 0 ? std::string::npos : line.rfind(',', end_comma - 1);
+        if (begin_comma == std::string::npos)
+            continue;
+        PendingRange range;
+        range.begin = std::stoull(line.substr(begin_comma + 1, end_comma - begin_comma - 1));
+        range.end = std::stoull(line.substr(end_comma + 1, block_size_comma - end_comma - 1));
+        range.block_size = static_cast<std::size_t>(std::stoull(line.substr(block_size_comma + 1)));
+        salvage_map[line.substr(0, begin_comma)].push_back(range);
+    }
+
+    return salvage_map;
+}
+
+void save_salvage_map(const fs::path& salvage_map_file, const SalvageMap& salvage_map)
+{
+    std::ofstream ofs(salvage_map_file.string());
+    for (const auto& file_ranges : salvage_map)
+    {
+        for (const auto& range : file_ranges.second)
+            ofs << file_ranges.first << ',' << range.begin << ',' << range.end << ',' << range.block_size << "\n";
+    }
+}
+
+static void merge_ranges(std::vector<PendingRange>& ranges)
+{
+    std::sort(begin(ranges), end(ranges), [](const auto& range1, const auto& range2) { return range1.begin < range2.begin; });
+    std::vector<PendingRange> merged_ranges;
+    for (const auto& range : ranges)
+    {
+        if (!merged_ranges.empty() && merged_ranges.back().end == range.begin && merged_ranges.back().block_size == range.block_size)
+            merged_ranges.back().end = range.end;
+        else
+            merged_ranges.push_back(range);
+    }
+    ranges = std::move(merged_ranges);
+}
+
+static void salvage_range(BlockCopier& copier, const PendingRange& range, const SalvageSettings& settings, std::vector<PendingRange>& next_ranges)
+{
+    const auto smaller_block_size = range.block_size > settings.min_block_size ? std::max(range.block_size / settings.shrink_factor, settings.min_block_size) : 0;
+    std::uint64_t skip_size = 0;
+    auto offset = range.begin;
+    while (offset < range.end)
+    {
+        const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(range.block_size, range.end - offset));
+        const auto status = copier.copy_block(offset, size);
+        if (status != BlockStatus::Ok)
+            next_ranges.push_back({ offset, offset + size, smaller_block_size });
+        offset += size;
+
+        if (status != BlockStatus::Timeout)
+        {
+            skip_size = 0;
+            continue;
+        }
+
+        // Each timeout is expensive, so jump over what is probably a bad area and come back to it on the next pass
+        skip_size = std::min<std::uint64_t>(skip_size == 0 ? range.block_size : skip_size * 2, range.end - offset);
+        if (skip_size != 0)
+            next_ranges.push_back({ offset, offset + skip_size, range.block_size });
+        offset += skip_size;
+    }
+}
+
+void salvage_file(
+    BlockCopier& copier,
+    std::uint64_t file_size,
+    const SalvageSettings& settings,
+    std::vector<PendingRange>& ranges,
+    const std::function<void()>& checkpoint)
+{
+    if (ranges.empty() && file_size != 0)
+        ranges.push_back({ 0, file_size, settings.block_size });
+
+    for (;;)
+    {
+        bool is_any_range_pending = false;
+        std::vector<PendingRange> next_ranges;
+        for (const auto& range : ranges)
+        {
+            if (range.block_size == 0)
+            {
+                next_ranges.push_back(range);
+                continue;
+            }
+            is_any_range_pending = true;
+            salvage_range(copier, range, settings, next_ranges);
+        }
+        if (!is_any_range_pending)
+            return;
+
+        merge_ranges(next_ranges);
+        ranges = std::move(next_ranges);
+        if (checkpoint)
+            checkpoint();
+    }
+}
+
+namespace {
+
+    // Shared with the thread reading the answers of the child, which may be left blocked when the child hangs
+    struct ChildChannel
+    {
+        bproc::opstream requests{};
+        bproc::ipstream answers{};
+        std::mutex mutex{};
+        std::condition_variable answer_available{};
+        std::deque<std::string> answer_lines{};
+        bool is_closed{};
+    };
+
+    class ProcessBlockCopier : public BlockCopier
+    {
+    public:
+        ProcessBlockCopier(const fs::path& process_file, const fs::path& source_file, const fs::path& target_dir, std::chrono::milliseconds block_timeout)
+            : m_process_file(process_file)
+            , m_source_file(source_file)
+            , m_target_dir(target_dir)
+            , m_block_timeout(block_timeout)
+        {
+        }
+
+        ~ProcessBlockCopier() override
+        {
+            stop();
+        }
+
+        BlockStatus copy_block(std::uint64_t offset, std::size_t size) override
+        {
+            if (!m_child && !start())
+                return BlockStatus::Error;
+
+            m_channel->requests << offset << ' ' << size << std::endl;
+
+            std::unique_lock<std::mutex> lock(m_channel->mutex);
+            const auto is_answered = m_channel->answer_available.wait_for(lock, m_block_timeout, [&] { return !m_channel->answer_lines.empty() || m_channel->is_closed; });
+            if (!is_answered || m_channel->answer_lines.empty())
+            {
+                lock.unlock();
+                stop();
+                return is_answered ? BlockStatus::Error : BlockStatus::Timeout;
+            }
+            const auto answer = std::move(m_channel->answer_lines.front());
+            m_channel->answer_lines.pop_front();
+            return answer == "ok" ? BlockStatus::Ok : BlockStatus::Error;
+        }
+
+    private:
+        bool start()
+        {
+            auto channel = std::make_shared<ChildChannel>();
+            std::error_code ec;
+            m_child = std::make_unique<bproc::child>(
+                m_process_file.string(), "--mode", "salvage_slave", "--source_file", m_source_file.string(), "--target_dir", m_target_dir.string(),
+                bproc::std_in < channel->requests, bproc::std_out > channel->answers, ec);
+            if (ec)
+            {
+                std::cout << "Error " << ec.message() << " when spawning: " << m_process_file << "\n";
+                m_child.reset();
+                return false;
+            }
+
+            std::thread([channel]
+            {
+                std::string line;
+                while (std::getline(channel->answers, line))
+                {
+                    std::lock_guard<std::mutex> lock(channel->mutex);
+                    channel->answer_lines.push_back(line);
+                    channel->answer_available.notify_one();
+                }
+                std::lock_guard<std::mutex> lock(channel->mutex);
+                channel->is_closed = true;
+                channel->answer_available.notify_one();
+            }).detach();
+            m_channel = std::move(channel);
+            return true;
+        }
+
+        void stop()
+        {
+            if (!m_child)
+                return;
+            std::error_code ec;
+            if (m_child->running(ec))
+                m_child->terminate(ec);
+            m_child.reset();
+            m_channel.reset();
+        }
+
+        fs::path m_process_file;
+        fs::path m_source_file;
+        fs::path m_target_dir;
+        std::chrono::milliseconds m_block_timeout;
+        std::unique_ptr<bproc::child> m_child{};
+        std::shared_ptr<ChildChannel> m_channel{};
+    };
+
+    // Reads bypassing the system cache, so that a damaged sector is read from the card again at each retry
+    class UnbufferedFile
+    {
+    public:
+        static constexpr std::size_t alignment = 4096;
+
+        UnbufferedFile(const UnbufferedFile&) = delete;
+        UnbufferedFile& operator=(const UnbufferedFile&) = delete;
+
+        std::uint64_t size() const { return m_size; }
+
+#if EXP_PLATFORM_OS_IS_WINDOWS
+        UnbufferedFile(const fs::path& source_file)
+        {
+            m_handle = ::CreateFileW(source_file.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+            LARGE_INTEGER size{};
+            if (m_handle != INVALID_HANDLE_VALUE && ::GetFileSizeEx(m_handle, &size))
+                m_size = static_cast<std::uint64_t>(size.QuadPart);
+        }
+
+        ~UnbufferedFile()
+        {
+            if (m_handle != INVALID_HANDLE_VALUE)
+                ::CloseHandle(m_handle);
+        }
+
+        bool is_open() const { return m_handle != INVALID_HANDLE_VALUE; }
+
+        // buffer and offset are aligned, and buffer can hold size rounded up to the alignment
+        bool read_at(std::uint64_t offset, char* buffer, std::size_t size)
+        {
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD read_count = 0;
+            const auto aligned_size = static_cast<DWORD>((size + alignment - 1) / alignment * alignment);
+            if (!::ReadFile(m_handle, buffer, aligned_size, &read_count, &overlapped))
+                return false;
+            return read_count >= size || offset + read_count == m_size;
+        }
+
+    private:
+        HANDLE m_handle{INVALID_HANDLE_VALUE};
+#else
+        UnbufferedFile(const fs::path& source_file)
+        {
+#if defined(O_DIRECT)
+            m_descriptor = ::open(source_file.c_str(), O_RDONLY | O_DIRECT);
+            if (m_descriptor < 0) // some file systems, like tmpfs, do not support O_DIRECT
+#endif
+                m_descriptor = ::open(source_file.c_str(), O_RDONLY);
+#if defined(F_NOCACHE)
+            if (m_descriptor >= 0)
+                ::fcntl(m_descriptor, F_NOCACHE, 1);
+#endif
+            struct stat status{};
+            if (m_descriptor >= 0 && ::fstat(m_descriptor, &status) == 0)
+                m_size = static_cast<std::uint64_t>(status.st_size);
+        }
+
+        ~UnbufferedFile()
+        {
+            if (m_descriptor >= 0)
+                ::close(m_descriptor);
+        }
+
+        bool is_open() const { return m_descriptor >= 0; }
+
+        // buffer and offset are aligned, and buffer can hold size rounded up to the alignment
+        bool read_at(std::uint64_t offset, char* buffer, std::size_t size)
+        {
+            const auto aligned_size = (size + alignment - 1) / alignment * alignment;
+            std::size_t read_count = 0;
+            while (read_count < size)
+            {
+                const auto count = ::pread(m_descriptor, buffer + read_count, aligned_size - read_count, static_cast<off_t>(offset + read_count));
+                if (count < 0)
+                    return false;
+                if (count == 0)
+                    break;
+                read_count += static_cast<std::size_t>(count);
+            }
+            return read_count >= size || offset + read_count == m_size;
+        }
+
+    private:
+        int m_descriptor{-1};
+#endif
+        std::uint64_t m_size{};
+    };
+
+} // namespace
+
+std::unique_ptr<BlockCopier> make_process_block_copier(
+    const fs::path& process_file,
+    const fs::path& source_file,
+    const fs::path& target_dir,
+    std::chrono::milliseconds block_timeout)
+{
+    return std::make_unique<ProcessBlockCopier>(process_file, source_file, target_dir, block_timeout);
+}
+
+int serve_block_copies(
+    const fs::path& source_file,
+    const fs::path& target_dir)
+{
+    UnbufferedFile source(source_file);
+    std::fstream target((target_dir / source_file.filename()).string(), std::ios::binary | std::ios::in | std::ios::out);
+    if (!source.is_open() || !target)
+        return 1;
+
+    std::vector<char> storage;
+    std::uint64_t offset = 0;
+    std::size_t size = 0;
+    while (std::cin >> offset >> size)
+    {
+        const auto aligned_size = (size + UnbufferedFile::alignment - 1) / UnbufferedFile::alignment * UnbufferedFile::alignment;
+        if (storage.size() < aligned_size + UnbufferedFile::alignment)
+            storage.resize(aligned_size + UnbufferedFile::alignment);
+        const auto misalignment = reinterpret_cast<std::uintptr_t>(storage.data()) % UnbufferedFile::alignment;
+        const auto buffer = storage.data() + (misalignment == 0 ? 0 : UnbufferedFile::alignment - misalignment);
+
+        const auto is_read = offset % UnbufferedFile::alignment == 0 && source.read_at(offset, buffer, size);
+        const auto copy_size = static_cast<std::streamsize>(std::min<std::uint64_t>(size, source.size() > offset ? source.size() - offset : 0));
+        const auto is_written = is_read && target.seekp(static_cast<std::streamoff>(offset)).write(buffer, copy_size).flush();
+        std::cout << (is_written ? "ok" : "error") << std::endl;
+    }
+    return 0;
+}
+
+static void save_bad_ranges(const fs::path& bad_ranges_file, const std::vector<PendingRange>& ranges)
+{
+    std::ofstream ofs(bad_ranges_file.string());
+    for (const auto& range : ranges)
+        ofs << range.begin << '-' << range.end << "\n";
+}
+
+void salvage_files(
+    const SalvageSettings& settings,
+    const fs::path& process_file,
+    const fs::path& source_dir,
+    const fs::path& target_dir,
+    const fs::path& salvage_map_file,
+    const fs::path& files_descriptions_file,
+    FilesDescriptions& files_descriptions)
+{
+    std::cout << "Salvaging damaged files based on collected files descriptions\n";
+
+#if !EXP_PLATFORM_OS_IS_WINDOWS
+    // A child killed on a timeout must not kill us when we write the next request
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    stdnext::error_code ec;
+    if (!fs::exists(target_dir))
+    {
+        std::cout << "Creating target directory: " << target_dir << "\n";
+        fs::create_directories(target_dir, ec);
+    }
+
+    auto salvage_map = load_salvage_map(salvage_map_file);
+    for (auto& file_description : files_descriptions)
+    {
+        if (!file_description.is_damaged || file_description.is_copied)
+            continue;
+
+        const auto name = file_description.name.string();
+        auto& ranges = salvage_map[name];
+        if (!ranges.empty() && std::all_of(begin(ranges), end(ranges), [](const auto& range) { return range.block_size == 0; }))
+            continue;
+
+        const auto source_file = source_dir / file_description.name;
+        const auto target_file = target_dir / file_description.name;
+        if (ranges.empty() || !fs::exists(target_file))
+        {
+            // Unreadable ranges are left as zeros
+            ranges.clear();
+            std::ofstream(target_file.string(), std::ios::binary | std::ios::trunc);
+            fs::resize_file(target_file, file_description.size, ec);
+        }
+
+        std::cout << "Salvaging: " << source_file << "\n";
+        const auto start_time = Clock::now();
+        const auto copier = make_process_block_copier(process_file, source_file, target_dir, settings.block_timeout);
+        salvage_file(*copier, file_description.size, settings, ranges, [&] { save_salvage_map(salvage_map_file, salvage_map); });
+        save_salvage_map(salvage_map_file, salvage_map);
+
+        std::uint64_t bad_size = 0;
+        for (const auto& range : ranges)
+            bad_size += range.end - range.begin;
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start_time).count();
+        const auto megabytes = static_cast<double>(file_description.size) / (1024. * 1024.);
+        std::cout << "Salvaged: " << target_file << " - " << file_description.size - bad_size << "/" << file_description.size << " bytes, "
+                  << std::fixed << std::setprecision(1) << (seconds > 0 ? megabytes / seconds : 0.) << " MB/s\n" << std::defaultfloat;
+
+        const auto bad_ranges_file = fs::path(target_file.string() + ".bad_ranges");
+        if (ranges.empty())
+        {
+            fs::remove(bad_ranges_file, ec);
+            file_description.is_copied = true;
+            file_description.is_damaged = false;
+        }
+        else
+            save_bad_ranges(bad_ranges_file, ranges);
+        save_files_descriptions(files_descriptions_file, files_descriptions);
+    }
+}
@@ -0,0 +1,86 @@
+
+#pragma once
+
+#include "photos.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Part of a file still to be read with blocks of block_size bytes, or given up as unreadable when block_size is 0
+struct PendingRange
+{
+    std::uint64_t begin{};
+    std::uint64_t end{};
+    std::size_t block_size{};
+};
+
+// Pending ranges by file name, persisted between runs so that a salvage can be resumed
+using SalvageMap = std::map<std::string, std::vector<PendingRange>>;
+
+SalvageMap load_salvage_map(const stdnext::filesystem::path& salvage_map_file);
+
+void save_salvage_map(const stdnext::filesystem::path& salvage_map_file, const SalvageMap& salvage_map);
+
+enum class BlockStatus
+{
+    Ok,
+    Error,
+    Timeout,
+};
+
+// Copies blocks of a source file to the same offsets of a target file
+class BlockCopier
+{
+public:
+    virtual ~BlockCopier() = default;
+    virtual BlockStatus copy_block(std::uint64_t offset, std::size_t size) = 0;
+};
+
+struct SalvageSettings
+{
+    std::size_t block_size{1024 * 1024}; // power of two
+    std::size_t min_block_size{4096};    // power of two, alignment required by unbuffered reads
+    std::size_t shrink_factor{8};
+    std::chrono::milliseconds block_timeout{2000};
+};
+
+// Copies the readable parts of a file of file_size bytes.
+// ranges holds the ranges left by a previous run, or is empty to start from scratch; it is left with the unreadable ranges.
+// Each pass reads the pending ranges; a failed block is retried by the next pass with smaller blocks, down to
+// min_block_size, and after a timeout the following blocks are skipped, more at each timeout, and left to the next pass.
+// checkpoint is called after each pass.
+void salvage_file(
+    BlockCopier& copier,
+    std::uint64_t file_size,
+    const SalvageSettings& settings,
+    std::vector<PendingRange>& ranges,
+    const std::function<void()>& checkpoint = {});
+
+// Copies blocks through a child process running "--mode salvage_slave", killed and spawned again when a block times out
+std::unique_ptr<BlockCopier> make_process_block_copier(
+    const stdnext::filesystem::path& process_file,
+    const stdnext::filesystem::path& source_file,
+    const stdnext::filesystem::path& target_dir,
+    std::chrono::milliseconds block_timeout);
+
+// Child side of the process block copier: answers each "offset size" line of the standard input by "ok" or "error"
+// after copying the block to the target file with unbuffered reads
+int serve_block_copies(
+    const stdnext::filesystem::path& source_file,
+    const stdnext::filesystem::path& target_dir);
+
+// Salvages the damaged files not copied yet, writing next to each target file the list of its unreadable ranges
+void salvage_files(
+    const SalvageSettings& settings,
+    const stdnext::filesystem::path& process_file,
+    const stdnext::filesystem::path& source_dir,
+    const stdnext::filesystem::path& target_dir,
+    const stdnext::filesystem::path& salvage_map_file,
+    const stdnext::filesystem::path& files_descriptions_file,
+    FilesDescriptions& files_descriptions);
@@ -0,0 +1,197 @@
+#include <catch2/catch.hpp>
+#include "faulty_block_copier.hpp"
+#include "../copy_engine.hpp"
+#include <platform/system_error.hpp>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fs = stdnext::filesystem;
+
+namespace {
+
+    // Shares the stand-in with the test, which checks it once the engine has released it
+    class SharedBlockCopier : public BlockCopier
+    {
+    public:
+        explicit SharedBlockCopier(std::shared_ptr<FaultyBlockCopier> copier)
+            : m_copier(std::move(copier))
+        {
+        }
+
+        BlockStatus copy_block(std::uint64_t offset, std::size_t size) override
+        {
+            return m_copier->copy_block(offset, size);
+        }
+
+    private:
+        std::shared_ptr<FaultyBlockCopier> m_copier;
+    };
+
+    // Files of a card, as stand-ins reading from memory, copied to a target directory of their own
+    class FakeCard
+    {
+    public:
+        FakeCard()
+        {
+            fs::create_directories(m_target_dir);
+        }
+
+        ~FakeCard()
+        {
+            stdnext::error_code ec;
+            fs::remove_all(m_target_dir, ec);
+        }
+
+        void add_file(const std::string& name, std::size_t size, std::vector<FaultyBlockCopier::Fault> faults = {})
+        {
+            std::vector<char> source(size);
+            std::iota(source.begin(), source.end(), static_cast<char>(m_files_descriptions.size()));
+            m_files_descriptions.push_back({name, false, size, false});
+            m_faults[name] = std::move(faults);
+            m_sources[name] = std::move(source);
+        }
+
+        void copy(const CopyEngineSettings& settings)
+        {
+            copy_files_concurrently(settings, "card", m_target_dir, m_target_dir / "files_descriptions.csv", m_files_descriptions,
+                                    [this](const fs::path& source_file, const fs::path& target_file) {
+                                        // The engine renames the target file once all its blocks are copied
+                                        std::ofstream(target_file.string(), std::ios::binary);
+                                        const auto name = source_file.filename().string();
+                                        std::lock_guard<std::mutex> lock(m_mutex);
+                                        auto copier = std::make_shared<FaultyBlockCopier>(m_sources.at(name), m_faults.at(name));
+                                        m_copiers[name] = copier;
+                                        return std::make_unique<SharedBlockCopier>(copier);
+                                    });
+        }
+
+        const FileDescription& description(const std::string& name) const
+        {
+            return *std::find_if(m_files_descriptions.begin(), m_files_descriptions.end(), [&](const FileDescription& file_description) {
+                return file_description.name == name;
+            });
+        }
+
+        // Whether the file was copied whole to the target directory, and only once
+        bool is_copied(const std::string& name) const
+        {
+            const auto& file_description = description(name);
+            return file_description.is_copied && !file_description.is_damaged && fs::exists(m_target_dir / name) &&
+                   m_copiers.at(name)->target() == m_sources.at(name);
+        }
+
+        bool is_damaged(const std::string& name) const
+        {
+            const auto& file_description = description(name);
+            return file_description.is_damaged && !file_description.is_copied && !fs::exists(m_target_dir / name);
+        }
+
+        const FaultyBlockCopier& copier(const std::string& name) const { return *m_copiers.at(name); }
+
+        bool is_opened(const std::string& name) const { return m_copiers.count(name) != 0; }
+
+        FilesDescriptions& files_descriptions() { return m_files_descriptions; }
+
+    private:
+        const fs::path m_target_dir{fs::temp_directory_path() / ("recover_photos_copy_engine_" + std::to_string(std::random_device{}()))};
+        FilesDescriptions m_files_descriptions;
+        std::map<std::string, std::vector<char>> m_sources;
+        std::map<std::string, std::vector<FaultyBlockCopier::Fault>> m_faults;
+        std::mutex m_mutex;
+        std::map<std::string, std::shared_ptr<FaultyBlockCopier>> m_copiers;
+    };
+
+    CopyEngineSettings make_settings()
+    {
+        CopyEngineSettings settings;
+        settings.workers_count = 2;
+        settings.chunk_size = 64;
+        settings.chunk_timeout = std::chrono::milliseconds(200);
+        settings.checkpoint_period = std::chrono::hours(1);
+        return settings;
+    }
+
+} // namespace
+
+TEST_CASE("copy_files_concurrently")
+{
+    FakeCard card;
+    auto settings = make_settings();
+
+    SECTION("When the files are readable")
+    {
+        card.add_file("IMG_0001.JPG", 1000);
+        card.add_file("IMG_0002.JPG", 64);
+        card.add_file("IMG_0003.JPG", 0);
+        card.add_file("IMG_0004.JPG", 130);
+        card.add_file("IMG_0005.JPG", 1000);
+        card.files_descriptions()[4].is_copied = true;
+
+        card.copy(settings);
+
+        for (const auto name : {"IMG_0001.JPG", "IMG_0002.JPG", "IMG_0003.JPG", "IMG_0004.JPG"})
+        {
+            INFO(name);
+            REQUIRE(card.is_copied(name));
+        }
+        REQUIRE(card.copier("IMG_0001.JPG").blocks().size() == 16);
+        REQUIRE(card.copier("IMG_0001.JPG").blocks().back() == std::make_pair(std::uint64_t{960}, std::size_t{40}));
+        REQUIRE(card.copier("IMG_0003.JPG").blocks().empty());
+        REQUIRE(card.copier("IMG_0004.JPG").blocks().size() == 3);
+        REQUIRE(!card.is_opened("IMG_0005.JPG"));
+    }
+
+    SECTION("When a read fails")
+    {
+        card.add_file("IMG_0001.JPG", 1000);
+        card.add_file("IMG_0002.JPG", 1000, {{500, 501, BlockStatus::Error}});
+        card.add_file("IMG_0003.JPG", 1000);
+
+        card.copy(settings);
+
+        // The file is given up at its first failed chunk
+        REQUIRE(card.is_damaged("IMG_0002.JPG"));
+        REQUIRE(card.copier("IMG_0002.JPG").blocks().size() == 8);
+        REQUIRE(card.is_copied("IMG_0001.JPG"));
+        REQUIRE(card.is_copied("IMG_0003.JPG"));
+    }
+
+    SECTION("When a worker times out")
+    {
+        settings.workers_count = 1;
+        card.add_file("IMG_0001.JPG", 1000, {{300, 301, BlockStatus::Ok, 1, std::chrono::milliseconds(1000)}});
+        card.add_file("IMG_0002.JPG", 1000);
+        card.add_file("IMG_0003.JPG", 1000);
+
+        const auto start_time = std::chrono::steady_clock::now();
+        card.copy(settings);
+
+        // The stalled worker is abandoned, and a new worker copies the other files meanwhile
+        REQUIRE(std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(1000));
+        REQUIRE(card.is_damaged("IMG_0001.JPG"));
+        REQUIRE(card.is_copied("IMG_0002.JPG"));
+        REQUIRE(card.is_copied("IMG_0003.JPG"));
+    }
+
+    SECTION("When too many files are damaged")
+    {
+        settings.workers_count = 1;
+        settings.max_errors_count = 2;
+        for (const auto name : {"IMG_0001.JPG", "IMG_0002.JPG", "IMG_0003.JPG", "IMG_0004.JPG"})
+            card.add_file(name, 100, {{0, 1, BlockStatus::Error, 0, std::chrono::milliseconds(50)}});
+
+        card.copy(settings);
+
+        REQUIRE(card.is_damaged("IMG_0001.JPG"));
+        REQUIRE(card.is_damaged("IMG_0002.JPG"));
+        REQUIRE(!card.is_opened("IMG_0004.JPG"));
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "../salvage.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Stand-in of a damaged file: copies from memory to memory, and fails the blocks touching a fault range,
+// either always or only for the first failures_count blocks touching it, after stalling for delay;
+// a fault of status Ok only stalls
+class FaultyBlockCopier : public BlockCopier
+{
+public:
+    struct Fault
+    {
+        std::uint64_t begin{};
+        std::uint64_t end{};
+        BlockStatus status{BlockStatus::Error};
+        std::size_t failures_count{}; // 0 when permanent
+        std::chrono::milliseconds delay{};
+    };
+
+    FaultyBlockCopier(std::vector<char> source, std::vector<Fault> faults)
+        : m_source(std::move(source))
+        , m_target(m_source.size(), '\0')
+        , m_faults(std::move(faults))
+        , m_failures_counts(m_faults.size())
+    {
+    }
+
+    BlockStatus copy_block(std::uint64_t offset, std::size_t size) override
+    {
+        m_blocks.emplace_back(offset, size);
+        for (std::size_t fault_index = 0; fault_index < m_faults.size(); ++fault_index)
+        {
+            const auto& fault = m_faults[fault_index];
+            if (offset >= fault.end || fault.begin >= offset + size)
+                continue;
+            if (fault.failures_count != 0 && m_failures_counts[fault_index] >= fault.failures_count)
+                continue;
+            ++m_failures_counts[fault_index];
+            std::this_thread::sleep_for(fault.delay);
+            if (fault.status != BlockStatus::Ok)
+                return fault.status;
+        }
+        if (offset + size > m_source.size())
+            return BlockStatus::Error;
+        std::copy(m_source.begin() + static_cast<std::ptrdiff_t>(offset), m_source.begin() + static_cast<std::ptrdiff_t>(offset + size), m_target.begin() + static_cast<std::ptrdiff_t>(offset));
+        return BlockStatus::Ok;
+    }
+
+    const std::vector<char>& source() const { return m_source; }
+    const std::vector<char>& target() const { return m_target; }
+
+    // Offset and size of each block copy requested, in order
+    const std::vector<std::pair<std::uint64_t, std::size_t>>& blocks() const { return m_blocks; }
+
+private:
+    std::vector<char> m_source;
+    std::vector<char> m_target;
+    std::vector<Fault> m_faults;
+    std::vector<std::size_t> m_failures_counts;
+    std::vector<std::pair<std::uint64_t, std::size_t>> m_blocks;
+};
@@ -0,0 +1,146 @@
+#include <catch2/catch.hpp>
+#include "faulty_block_copier.hpp"
+#include "../salvage.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    constexpr std::uint64_t FileSize = 1000;
+
+    std::vector<char> make_source()
+    {
+        std::vector<char> source(FileSize);
+        std::iota(source.begin(), source.end(), '\1');
+        return source;
+    }
+
+    SalvageSettings make_settings()
+    {
+        SalvageSettings settings;
+        settings.block_size = 64;
+        settings.min_block_size = 4;
+        settings.shrink_factor = 4;
+        return settings;
+    }
+
+    // Whether the target holds the source bytes, except zeros in the given ranges
+    bool is_recovered(const FaultyBlockCopier& copier, const std::vector<PendingRange>& bad_ranges)
+    {
+        auto expected = copier.source();
+        for (const auto& range : bad_ranges)
+            std::fill(expected.begin() + static_cast<std::ptrdiff_t>(range.begin), expected.begin() + static_cast<std::ptrdiff_t>(range.end), '\0');
+        return copier.target() == expected;
+    }
+
+    bool is_requested(const FaultyBlockCopier& copier, std::uint64_t offset, std::size_t size)
+    {
+        const auto& blocks = copier.blocks();
+        return std::find(blocks.begin(), blocks.end(), std::make_pair(offset, size)) != blocks.end();
+    }
+
+} // namespace
+
+static bool operator==(const PendingRange& range1, const PendingRange& range2)
+{
+    return range1.begin == range2.begin && range1.end == range2.end && range1.block_size == range2.block_size;
+}
+
+TEST_CASE("salvage_file")
+{
+    const auto settings = make_settings();
+    std::vector<PendingRange> ranges;
+    int passes_count = 0;
+    const auto checkpoint = [&] { ++passes_count; };
+
+    SECTION("When the file is readable")
+    {
+        FaultyBlockCopier copier(make_source(), {});
+
+        salvage_file(copier, FileSize, settings, ranges, checkpoint);
+
+        REQUIRE(ranges.empty());
+        REQUIRE(is_recovered(copier, {}));
+        REQUIRE(copier.blocks().size() == 16);
+        REQUIRE(copier.blocks().back() == std::make_pair(std::uint64_t{960}, std::size_t{40}));
+        REQUIRE(passes_count == 1);
+    }
+
+    SECTION("When an error is permanent")
+    {
+        FaultyBlockCopier copier(make_source(), {{100, 110, BlockStatus::Error}});
+
+        salvage_file(copier, FileSize, settings, ranges, checkpoint);
+
+        // Split from 64 to 16 then to 4 bytes, the 4 bytes blocks touching the fault being given up
+        REQUIRE(ranges == std::vector<PendingRange>{{100, 112, 0}});
+        REQUIRE(is_recovered(copier, ranges));
+        REQUIRE(is_requested(copier, 64, 64));
+        REQUIRE(is_requested(copier, 96, 16));
+        REQUIRE(is_requested(copier, 108, 4));
+        REQUIRE(copier.blocks().size() == 16 + 4 + 4);
+        REQUIRE(passes_count == 3);
+    }
+
+    SECTION("When an error is transient")
+    {
+        FaultyBlockCopier copier(make_source(), {{300, 301, BlockStatus::Error, 2}});
+
+        salvage_file(copier, FileSize, settings, ranges, checkpoint);
+
+        // Retried with 16 bytes blocks then read with 4 bytes blocks, once the fault is gone
+        REQUIRE(ranges.empty());
+        REQUIRE(is_recovered(copier, {}));
+        REQUIRE(is_requested(copier, 256, 64));
+        REQUIRE(is_requested(copier, 288, 16));
+        REQUIRE(is_requested(copier, 300, 4));
+        REQUIRE(copier.blocks().size() == 16 + 4 + 4);
+        REQUIRE(passes_count == 3);
+    }
+
+    SECTION("When a block times out")
+    {
+        FaultyBlockCopier copier(make_source(), {{640, 641, BlockStatus::Timeout}});
+
+        salvage_file(copier, FileSize, settings, ranges, checkpoint);
+
+        // The block following a timeout is skipped, and read on the next pass
+        const auto& blocks = copier.blocks();
+        const auto timeout_block = std::find(blocks.begin(), blocks.end(), std::make_pair(std::uint64_t{640}, std::size_t{64}));
+        REQUIRE(timeout_block != blocks.end());
+        REQUIRE(timeout_block[1] == std::make_pair(std::uint64_t{768}, std::size_t{64}));
+        REQUIRE(is_requested(copier, 704, 64));
+        REQUIRE(ranges == std::vector<PendingRange>{{640, 644, 0}});
+        REQUIRE(is_recovered(copier, ranges));
+        REQUIRE(passes_count == 4);
+    }
+
+    SECTION("When resuming a previous salvage")
+    {
+        FaultyBlockCopier copier(make_source(), {{100, 110, BlockStatus::Error}});
+        ranges = {{96, 112, 4}, {500, 504, 0}};
+
+        salvage_file(copier, FileSize, settings, ranges, checkpoint);
+
+        // Only the pending ranges are read, the given up ones being kept
+        REQUIRE(copier.blocks().size() == 4);
+        REQUIRE(ranges == std::vector<PendingRange>{{100, 112, 0}, {500, 504, 0}});
+        REQUIRE(passes_count == 1);
+    }
+}
+
+TEST_CASE("salvage map")
+{
+    const auto salvage_map_file = stdnext::filesystem::temp_directory_path() / "recover_photos_salvage_map.csv";
+    const SalvageMap salvage_map{{"DCIM/IMG,0001.JPG", {{100, 112, 0}, {4096, 8192, 512}}}, {"IMG_0002.JPG", {{0, 4, 4}}}};
+
+    save_salvage_map(salvage_map_file, salvage_map);
+    const auto loaded_salvage_map = load_salvage_map(salvage_map_file);
+    stdnext::filesystem::remove(salvage_map_file);
+
+    REQUIRE(loaded_salvage_map == salvage_map);
+}
@@ -7,6 +7,7 @@
 #include <cmath>
 #include <numeric>
 #include <optional>
+#include <string_view>
 #include <tuple>
 
 namespace sc = std::chrono;
@@ -42,34 +43,30 @@ static TimeOfDay degrees_to_time(double time_in_degrees) noexcept
     return {h, m, s};
 }
 
-static std::optional<TimeOfDay> parse_time_of_day(std::string time_of_day)
+// Second of the day of the HH:MM:SS time at text, or -1
+static int parse_seconds_of_day(const char* text) noexcept
 {
-    try
-    {
-        std::size_t pos{};
-
-        const auto h = sc::hours{std::stoi(time_of_day, &pos)};
-        if (time_of_day[pos] != ':')
-            return std::nullopt;
-
-        time_of_day = time_of_day.substr(pos + 1);
-
-        const auto m = sc::minutes{std::stoi(time_of_day, &pos)};
-        if (time_of_day[pos] != ':')
-            return std::nullopt;
-
-        time_of_day = time_of_day.substr(pos + 1);
-
-        const auto s = sc::seconds{std::stoi(time_of_day, &pos)};
-        if (time_of_day[pos] != 0)
-            return std::nullopt;
+    const auto digit = [&](int index) { return static_cast<unsigned int>(text[index] - '0'); };
+    if (text[2] != ':' || text[5] != ':' || digit(0) > 2 || digit(1) > 9 || digit(3) > 5 ||
+        digit(4) > 9 || digit(6) > 5 || digit(7) > 9)
+        return -1;
+    const auto h = digit(0) * 10 + digit(1);
+    if (h >= 24)
+        return -1;
+    return static_cast<int>(h * 3600 + (digit(3) * 10 + digit(4)) * 60 + digit(6) * 10 + digit(7));
+}
 
-        return TimeOfDay{h, m, s};
-    }
-    catch (std::exception&)
-    {
+static std::optional<TimeOfDay> parse_time_of_day(std::string_view time_of_day) noexcept
+{
+    if (time_of_day.size() != 8)
+        return std::nullopt;
+    const auto second_of_day = parse_seconds_of_day(time_of_day.data());
+    if (second_of_day < 0)
         return std::nullopt;
-    }
+    const auto time_in_seconds = sc::seconds{second_of_day};
+    const auto h = sc::duration_cast<sc::hours>(time_in_seconds);
+    const auto m = sc::duration_cast<sc::minutes>(time_in_seconds - h);
+    return TimeOfDay{h, m, time_in_seconds - h - m};
 }
 
 static std::string to_string(const TimeOfDay& time_of_day)
@@ -103,7 +100,7 @@ static auto mean_angle(InputIter angles_begin, InputIter angles_end)
     return mean_angle_in_degrees;
 }
 
-static auto mean_angle(std::initializer_list<double> angles_in_degrees)
+inline auto mean_angle(std::initializer_list<double> angles_in_degrees)
 {
     return mean_angle(begin(angles_in_degrees), end(angles_in_degrees));
 }
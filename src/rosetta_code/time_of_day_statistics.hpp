@@ -0,0 +1,195 @@
+#pragma once
+
+#include "mean_time_of_day.hpp"
+#include <platform/filesystem.hpp>
+#include <platform/mapped_file.hpp>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+constexpr int SecondsInOneDayCount = 24 * 60 * 60;
+constexpr int HoursInOneDayCount = 24;
+
+// Sums of the cosines and sines of angles, which merge by addition
+struct CircularSums
+{
+    double cos_sum{};
+    double sin_sum{};
+    std::uint64_t count{};
+
+    CircularSums& operator+=(const CircularSums& other) noexcept
+    {
+        cos_sum += other.cos_sum;
+        sin_sum += other.sin_sum;
+        count += other.count;
+        return *this;
+    }
+
+    // Same conventions as mean_angle: in (-180, 180], 0 when nearly 0
+    double mean_in_degrees() const noexcept
+    {
+        assert(count > 0);
+        const auto mean_angle_in_degrees = std::atan2(sin_sum, cos_sum) * DegreesInHalfCircle / Pi;
+        if (std::fabs(mean_angle_in_degrees) < 0.000001)
+            return 0.;
+        return mean_angle_in_degrees;
+    }
+
+    // Length of the mean of the unit vectors, 1 when all the angles are the same
+    double resultant_length() const noexcept
+    {
+        return count == 0 ? 0. : std::hypot(cos_sum, sin_sum) / static_cast<double>(count);
+    }
+
+    double variance() const noexcept { return 1. - resultant_length(); }
+};
+
+// Events counted by second of the day: counting is a single increment, the
+// sines and cosines being summed once per second of the day by to_circular_sums,
+// and counts of different threads or files merge by addition
+struct TimesOfDayCounts
+{
+    std::vector<std::uint64_t> seconds = std::vector<std::uint64_t>(SecondsInOneDayCount);
+    std::uint64_t count{};
+    std::uint64_t skipped_lines_count{};
+
+    void add(int second_of_day) noexcept
+    {
+        ++seconds[static_cast<std::size_t>(second_of_day)];
+        ++count;
+    }
+
+    TimesOfDayCounts& operator+=(const TimesOfDayCounts& other) noexcept
+    {
+        for (std::size_t second = 0; second < seconds.size(); ++second)
+            seconds[second] += other.seconds[second];
+        count += other.count;
+        skipped_lines_count += other.skipped_lines_count;
+        return *this;
+    }
+
+    std::array<std::uint64_t, HoursInOneDayCount> hours() const noexcept
+    {
+        std::array<std::uint64_t, HoursInOneDayCount> hours_counts{};
+        for (std::size_t second = 0; second < seconds.size(); ++second)
+            hours_counts[second / 3600] += seconds[second];
+        return hours_counts;
+    }
+};
+
+// Cosines and sines of the angles of the seconds of the day
+static const std::vector<double>& seconds_cosines_and_sines()
+{
+    static const auto table = [] {
+        std::vector<double> cosines_and_sines(2 * SecondsInOneDayCount);
+        for (int second = 0; second < SecondsInOneDayCount; ++second)
+        {
+            const auto angle_in_radians = second * 2. * Pi / SecondsInOneDay;
+            cosines_and_sines[second] = std::cos(angle_in_radians);
+            cosines_and_sines[SecondsInOneDayCount + second] = std::sin(angle_in_radians);
+        }
+        return cosines_and_sines;
+    }();
+    return table;
+}
+
+static CircularSums to_circular_sums(const TimesOfDayCounts& counts) noexcept
+{
+    // Independent sums for chunks of 4 seconds, which vectorize without
+    // reordering the additions of a sum
+    constexpr int LanesCount = 4;
+    static_assert(SecondsInOneDayCount % LanesCount == 0);
+    const auto& table = seconds_cosines_and_sines();
+    const auto* cosines = table.data();
+    const auto* sines = cosines + SecondsInOneDayCount;
+    double cos_sums[LanesCount]{};
+    double sin_sums[LanesCount]{};
+    for (int second = 0; second < SecondsInOneDayCount; second += LanesCount)
+    {
+        for (int lane = 0; lane < LanesCount; ++lane)
+        {
+            const auto count = static_cast<double>(counts.seconds[second + lane]);
+            cos_sums[lane] += count * cosines[second + lane];
+            sin_sums[lane] += count * sines[second + lane];
+        }
+    }
+    return {cos_sums[0] + cos_sums[1] + cos_sums[2] + cos_sums[3],
+            sin_sums[0] + sin_sums[1] + sin_sums[2] + sin_sums[3], counts.count};
+}
+
+// Counts the first HH:MM:SS time of each line, the lines without one being
+// counted as skipped; the last line does not need a line feed
+static void count_log_times(std::string_view text, TimesOfDayCounts& counts) noexcept
+{
+    const auto* line = text.data();
+    const auto* text_end = line + text.size();
+    while (line != text_end)
+    {
+        const auto* line_end = static_cast<const char*>(
+            std::memchr(line, '\n', static_cast<std::size_t>(text_end - line)));
+        if (!line_end)
+            line_end = text_end;
+        auto second_of_day = -1;
+        // Each colon may be the first one of a time, preceded by two digits
+        for (auto colon = line + 2; line_end - line >= 8 && colon < line_end - 5 && second_of_day < 0; ++colon)
+        {
+            colon = static_cast<const char*>(
+                std::memchr(colon, ':', static_cast<std::size_t>(line_end - 5 - colon)));
+            if (!colon)
+                break;
+            if (colon - line == 2 || static_cast<unsigned int>(colon[-3] - '0') > 9)
+                second_of_day = parse_seconds_of_day(colon - 2);
+        }
+        if (second_of_day >= 0)
+            counts.add(second_of_day);
+        else
+            ++counts.skipped_lines_count;
+        line = line_end == text_end ? text_end : line_end + 1;
+    }
+}
+
+// Splits the text at line feeds between threads_count threads, then merges their counts
+static TimesOfDayCounts count_log_times(std::string_view text, unsigned int threads_count)
+{
+    threads_count = std::max(threads_count, 1u);
+    std::vector<std::string_view> parts;
+    std::size_t part_begin = 0;
+    for (unsigned int part_index = 1; part_index <= threads_count; ++part_index)
+    {
+        auto part_end = text.size() * part_index / threads_count;
+        if (part_index < threads_count)
+        {
+            part_end = std::max(part_end, part_begin);
+            const auto line_feed = text.find('\n', part_end);
+            part_end = line_feed == std::string_view::npos ? text.size() : line_feed + 1;
+        }
+        parts.push_back(text.substr(part_begin, part_end - part_begin));
+        part_begin = part_end;
+    }
+
+    std::vector<TimesOfDayCounts> parts_counts(parts.size());
+    std::vector<std::thread> threads;
+    for (std::size_t part_index = 1; part_index < parts.size(); ++part_index)
+        threads.emplace_back([&, part_index] { count_log_times(parts[part_index], parts_counts[part_index]); });
+    count_log_times(parts[0], parts_counts[0]);
+    for (auto& thread : threads)
+        thread.join();
+    for (std::size_t part_index = 1; part_index < parts_counts.size(); ++part_index)
+        parts_counts[0] += parts_counts[part_index];
+    return std::move(parts_counts[0]);
+}
+
+static std::optional<TimesOfDayCounts>
+count_log_file_times(const stdnext::filesystem::path& path,
+                     unsigned int threads_count = std::max(std::thread::hardware_concurrency(), 1u))
+{
+    // Each thread reads its part of the file once, sequentially
+    const platform::mapped_file file(path, platform::mapped_file_access::sequential);
+    if (!file.is_open())
+        return std::nullopt;
+    return count_log_times(file.view(), threads_count);
+}
@@ -0,0 +1,189 @@
+#include <catch2/catch.hpp>
+#include "time_of_day_statistics.hpp"
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+    std::string make_log(std::size_t lines_count, std::uint32_t seed)
+    {
+        std::mt19937 generator(seed);
+        const auto random = [&](unsigned int bound) { return static_cast<unsigned int>(generator() % bound); };
+        std::string log;
+        char line[128];
+        for (std::size_t line_index = 0; line_index < lines_count; ++line_index)
+        {
+            // Events mostly in the evening, around 22:00
+            const auto second = static_cast<int>(std::normal_distribution<double>(22. * 3600., 2. * 3600.)(generator));
+            const auto second_of_day = (second % SecondsInOneDayCount + SecondsInOneDayCount) % SecondsInOneDayCount;
+            std::snprintf(line, sizeof(line), "2019-03-%02u %02d:%02d:%02d.%03u [worker-%u] INFO request %u served in %u ms\n",
+                          1 + random(28), second_of_day / 3600, second_of_day / 60 % 60, second_of_day % 60,
+                          random(1000), random(16), random(1000000), random(500));
+            log += line;
+        }
+        return log;
+    }
+
+} // namespace
+
+TEST_CASE("parse_time_of_day")
+{
+    REQUIRE(parse_seconds_of_day("00:00:00") == 0);
+    REQUIRE(parse_seconds_of_day("23:59:59") == SecondsInOneDayCount - 1);
+    REQUIRE(parse_seconds_of_day("12:34:56") == 12 * 3600 + 34 * 60 + 56);
+    REQUIRE(parse_seconds_of_day("24:00:00") == -1);
+    REQUIRE(parse_seconds_of_day("12:60:00") == -1);
+    REQUIRE(parse_seconds_of_day("12:00:60") == -1);
+    REQUIRE(parse_seconds_of_day("12-34-56") == -1);
+    REQUIRE(parse_seconds_of_day("1a:34:56") == -1);
+
+    const auto time_of_day = parse_time_of_day("23:47:43");
+    REQUIRE(time_of_day);
+    REQUIRE(to_string(*time_of_day) == "23:47:43");
+    REQUIRE(!parse_time_of_day("1:2:3"));
+    REQUIRE(!parse_time_of_day("23:47:43 "));
+    REQUIRE(!parse_time_of_day(""));
+}
+
+TEST_CASE("count_log_times")
+{
+    SECTION("first time of each line")
+    {
+        TimesOfDayCounts counts;
+        count_log_times("2019-03-01 23:00:17 first\n"
+                        "23:40:20\n"
+                        "[00:12:45.123] third 01:00:00\r\n"
+                        "no time in this line\n"
+                        "ratio 123:45:67 then 00:17:19",
+                        counts);
+        REQUIRE(counts.count == 4);
+        REQUIRE(counts.skipped_lines_count == 1);
+        REQUIRE(counts.seconds[23 * 3600 + 17] == 1);
+        REQUIRE(counts.seconds[23 * 3600 + 40 * 60 + 20] == 1);
+        REQUIRE(counts.seconds[12 * 60 + 45] == 1);
+        REQUIRE(counts.seconds[17 * 60 + 19] == 1);
+        REQUIRE(counts.seconds[3600] == 0);
+
+        const auto hours = counts.hours();
+        REQUIRE(hours[23] == 2);
+        REQUIRE(hours[0] == 2);
+        REQUIRE(hours[1] == 0);
+
+        const auto sums = to_circular_sums(counts);
+        REQUIRE(to_string(degrees_to_time(sums.mean_in_degrees())) ==
+                mean_time_of_day({"23:00:17", "23:40:20", "00:12:45", "00:17:19"}));
+    }
+
+    SECTION("short lines")
+    {
+        TimesOfDayCounts counts;
+        count_log_times("\n:\n12:34\n12:34:5\n\n", counts);
+        REQUIRE(counts.count == 0);
+        REQUIRE(counts.skipped_lines_count == 5);
+    }
+
+    SECTION("threads merge into the same counts")
+    {
+        const auto log = make_log(10000, 1);
+        TimesOfDayCounts serial_counts;
+        count_log_times(log, serial_counts);
+        REQUIRE(serial_counts.count == 10000);
+        for (const auto threads_count : {1u, 2u, 3u, 7u, 64u})
+        {
+            const auto counts = count_log_times(log, threads_count);
+            REQUIRE(counts.count == serial_counts.count);
+            REQUIRE(counts.skipped_lines_count == serial_counts.skipped_lines_count);
+            REQUIRE(counts.seconds == serial_counts.seconds);
+        }
+    }
+
+    SECTION("mapped file")
+    {
+        const auto path = stdnext::filesystem::temp_directory_path() / "rosetta_code_times.log";
+        const auto log = make_log(1000, 2);
+        std::ofstream(path.string(), std::ios::binary) << log;
+        const auto counts = count_log_file_times(path, 4);
+        stdnext::filesystem::remove(path);
+        REQUIRE(counts);
+        REQUIRE(counts->count == 1000);
+        REQUIRE(!count_log_file_times(path));
+    }
+}
+
+TEST_CASE("circular statistics")
+{
+    SECTION("same as mean_angle")
+    {
+        TimesOfDayCounts counts;
+        std::vector<double> degrees;
+        std::mt19937 generator(3);
+        for (int index = 0; index < 1000; ++index)
+        {
+            const auto second_of_day = static_cast<int>(generator() % SecondsInOneDayCount);
+            counts.add(second_of_day);
+            degrees.push_back(second_of_day * DegreesInOneCircle / SecondsInOneDay);
+        }
+        REQUIRE(to_circular_sums(counts).mean_in_degrees() == Approx(mean_angle(degrees.begin(), degrees.end())));
+    }
+
+    SECTION("variance")
+    {
+        TimesOfDayCounts same_times;
+        same_times.add(3600);
+        same_times.add(3600);
+        REQUIRE(to_circular_sums(same_times).variance() == Approx(0.).margin(1e-12));
+
+        TimesOfDayCounts spread_times;
+        for (const auto second_of_day : {0, 6 * 3600, 12 * 3600, 18 * 3600})
+            spread_times.add(second_of_day);
+        REQUIRE(to_circular_sums(spread_times).variance() == Approx(1.));
+    }
+
+    SECTION("partial sums merge")
+    {
+        TimesOfDayCounts morning;
+        morning.add(8 * 3600);
+        TimesOfDayCounts evening;
+        evening.add(20 * 3600);
+        auto sums = to_circular_sums(morning);
+        sums += to_circular_sums(evening);
+        morning += evening;
+        REQUIRE(sums.count == 2);
+        REQUIRE(sums.cos_sum == Approx(to_circular_sums(morning).cos_sum).margin(1e-12));
+        REQUIRE(sums.sin_sum == Approx(to_circular_sums(morning).sin_sum).margin(1e-12));
+    }
+}
+
+TEST_CASE("time of day statistics benchmark", "[.][benchmark]")
+{
+    const auto log = make_log(2000000, 4);
+    const auto measure_seconds = [](auto&& function) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    TimesOfDayCounts counts;
+    const auto count_seconds = measure_seconds([&] { count_log_times(log, counts); });
+    CircularSums sums;
+    const auto sums_seconds = measure_seconds([&] { sums = to_circular_sums(counts); });
+
+    // mean_time_of_day, which computes a sine and a cosine per time, given the times already cut out of the lines
+    std::vector<std::string> times;
+    for (std::size_t line = 0; line < log.size(); line = log.find('\n', line) + 1)
+        times.push_back(log.substr(line + 11, 8));
+    std::string mean_time;
+    const auto former_seconds = measure_seconds([&] { mean_time = mean_time_of_day(times.begin(), times.end()); });
+
+    REQUIRE(counts.count == 2000000);
+    REQUIRE(to_string(degrees_to_time(sums.mean_in_degrees())) == mean_time);
+    const auto gigabytes = static_cast<double>(log.size()) / 1e9;
+    std::cout << "count_log_times: " << gigabytes / count_seconds << " GB/s, "
+              << counts.count / count_seconds / 1e6 << " M lines/s\n";
+    std::cout << "to_circular_sums: " << sums_seconds * 1e3 << " ms\n";
+    std::cout << "mean_time_of_day: " << counts.count / former_seconds / 1e6
+              << " M times/s, without reading the lines\n";
+    std::cout << "mean " << mean_time << ", variance " << sums.variance() << "\n";
+}
@@ -0,0 +1,303 @@
+
+#pragma once
+
+#include "graphics.hpp"
+#include "sdl_disabled_warnings.h"
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <platform/filesystem.hpp>
+#include <string>
+#include <vector>
+
+namespace sdlxx {
+
+    // Image packed in a page of a texture atlas, valid as long as the atlas
+    class AtlasRegion
+    {
+    public:
+        AtlasRegion(const Texture& texture, const Rectangle& zone) noexcept
+            : m_texture(&texture), m_zone(zone)
+        {
+        }
+
+        const Texture& texture() const noexcept { return *m_texture; }
+
+        const Rectangle& zone() const noexcept { return m_zone; }
+
+        const Size& size() const noexcept { return m_zone.size(); }
+
+    private:
+        const Texture* m_texture;
+        Rectangle m_zone;
+    };
+
+    struct AtlasSurfaces;
+
+    // Images loaded together and packed into a few large textures, so that
+    // drawing them does not switch between many textures
+    class TextureAtlas
+    {
+    public:
+        friend result<TextureAtlas>
+        create_texture_atlas(const Renderer& renderer,
+                             const AtlasSurfaces& atlas_surfaces) noexcept;
+
+        const AtlasRegion* find_region(const std::string& image_name) const
+        {
+            const auto iter_region = m_regions.find(image_name);
+            if (iter_region == m_regions.end())
+                return nullptr;
+            return &iter_region->second;
+        }
+
+        std::size_t pages_count() const noexcept { return m_pages.size(); }
+
+    private:
+        TextureAtlas() = default;
+
+        std::vector<Texture> m_pages;
+        std::map<std::string, AtlasRegion> m_regions;
+    };
+
+    namespace detail {
+
+        struct PackedRectangle
+        {
+            std::size_t page_index;
+            Point origin;
+        };
+
+        // Places the rectangles on rows of pages of page_size, the highest
+        // first, leaving padding pixels around each one; returns the used size
+        // of each page, or nothing when a rectangle is larger than a page
+        inline std::vector<Size>
+        pack_rectangles(const std::vector<Size>& sizes, Size page_size,
+                        int padding, std::vector<PackedRectangle>& packed)
+        {
+            std::vector<std::size_t> order(sizes.size());
+            std::iota(order.begin(), order.end(), std::size_t{0});
+            std::stable_sort(order.begin(), order.end(),
+                             [&](std::size_t left, std::size_t right) {
+                                 return sizes[left].h() > sizes[right].h();
+                             });
+
+            std::vector<Size> pages_sizes;
+            packed.assign(sizes.size(), PackedRectangle{0, Point{0, 0}});
+            Point position{padding, padding};
+            int row_height = 0;
+            for (const auto index : order)
+            {
+                const auto& size = sizes[index];
+                if (size.w() + 2 * padding > page_size.w() ||
+                    size.h() + 2 * padding > page_size.h())
+                    return {};
+                if (pages_sizes.empty())
+                    pages_sizes.push_back(Size{0, 0});
+                if (position.x() + size.w() + padding > page_size.w())
+                {
+                    position = Point{padding, position.y() + row_height};
+                    row_height = 0;
+                }
+                if (position.y() + size.h() + padding > page_size.h())
+                {
+                    pages_sizes.push_back(Size{0, 0});
+                    position = Point{padding, padding};
+                    row_height = 0;
+                }
+                packed[index] =
+                    PackedRectangle{pages_sizes.size() - 1, position};
+                auto& page_used_size = pages_sizes.back();
+                page_used_size =
+                    Size{std::max(page_used_size.w(),
+                                  position.x() + size.w() + padding),
+                         std::max(page_used_size.h(),
+                                  position.y() + size.h() + padding)};
+                position = Point{position.x() + size.w() + padding,
+                                 position.y()};
+                row_height = std::max(row_height, size.h() + padding);
+            }
+            return pages_sizes;
+        }
+
+    } // namespace detail
+
+    // Images packed into the surfaces of the pages of an atlas, which can be
+    // done without a renderer, away from the render thread
+    struct AtlasSurfaces
+    {
+        struct Image
+        {
+            std::string name;
+            std::size_t page_index;
+            Rectangle zone;
+        };
+
+        std::vector<Surface> pages;
+        std::vector<Image> images;
+    };
+
+    // Paths of the images_extension images of images_path, sorted by name
+    inline result<std::vector<stdnext::filesystem::path>>
+    find_images(const stdnext::filesystem::path& images_path,
+                const char* images_extension) noexcept
+    {
+        try
+        {
+            std::vector<stdnext::filesystem::path> images_paths;
+            for (const auto& entry :
+                 stdnext::filesystem::directory_iterator(images_path))
+            {
+                const auto& entry_path = entry.path();
+                if (stdnext::filesystem::is_regular_file(entry_path) &&
+                    entry_path.extension() == images_extension)
+                    images_paths.push_back(entry_path);
+            }
+            std::sort(images_paths.begin(), images_paths.end());
+            return images_paths;
+        }
+        catch (...)
+        {
+            return stdnext::make_error_code(stdnext::errc::bad_file_descriptor);
+        }
+    }
+
+    // Loads an image of an atlas, whose pixels having the color of color_keys
+    // for its name become transparent
+    inline result<Surface>
+    load_atlas_image(const stdnext::filesystem::path& image_path,
+                     const std::map<std::string, Color>& color_keys) noexcept
+    {
+        try
+        {
+            const auto iter_color_key =
+                color_keys.find(image_path.stem().string());
+            return iter_color_key == color_keys.end()
+                       ? load_surface(image_path)
+                       : load_surface(image_path, iter_color_key->second);
+        }
+        catch (...)
+        {
+            return stdnext::make_error_code(stdnext::errc::not_enough_memory);
+        }
+    }
+
+    // Packs the images into pages of at most page_size, naming each image
+    // after the stem of its path
+    inline result<AtlasSurfaces> pack_atlas_surfaces(
+        const std::vector<stdnext::filesystem::path>& images_paths,
+        const std::vector<Surface>& images_surfaces, Size page_size) noexcept
+    {
+        try
+        {
+            std::vector<Size> images_sizes;
+            for (const auto& image_surface : images_surfaces)
+            {
+                const auto sdl_surface = to_sdl(image_surface);
+                images_sizes.push_back(Size{sdl_surface->w, sdl_surface->h});
+            }
+
+            std::vector<detail::PackedRectangle> packed;
+            const auto pages_sizes =
+                detail::pack_rectangles(images_sizes, page_size, 1, packed);
+            if (pages_sizes.empty() && !images_sizes.empty())
+                return stdnext::make_error_code(
+                    stdnext::errc::file_too_large);
+
+            AtlasSurfaces atlas_surfaces;
+            for (const auto& page_size_used : pages_sizes)
+            {
+                const auto sdl_surface = SDL_CreateRGBSurfaceWithFormat(
+                    0, page_size_used.w(), page_size_used.h(), 32,
+                    SDL_PIXELFORMAT_RGBA32);
+                if (!sdl_surface)
+                    return stdnext::make_error_code(
+                        stdnext::errc::not_enough_memory);
+                atlas_surfaces.pages.push_back(Surface{*sdl_surface});
+            }
+            for (std::size_t image_index = 0;
+                 image_index < images_surfaces.size(); ++image_index)
+            {
+                // Copies the image with its transparency instead of blending it
+                const auto& image_surface = images_surfaces[image_index];
+                SDL_SetSurfaceBlendMode(to_sdl(image_surface),
+                                        SDL_BLENDMODE_NONE);
+                const Rectangle zone{packed[image_index].origin,
+                                     images_sizes[image_index]};
+                auto sdl_dst_zone = to_sdl(zone);
+                SDL_BlitSurface(
+                    to_sdl(image_surface), nullptr,
+                    to_sdl(atlas_surfaces.pages[packed[image_index].page_index]),
+                    &sdl_dst_zone);
+                atlas_surfaces.images.push_back(AtlasSurfaces::Image{
+                    images_paths[image_index].stem().string(),
+                    packed[image_index].page_index, zone});
+            }
+            return atlas_surfaces;
+        }
+        catch (...)
+        {
+            return stdnext::make_error_code(stdnext::errc::not_enough_memory);
+        }
+    }
+
+    // Uploads the pages of the atlas, on the render thread
+    inline result<TextureAtlas>
+    create_texture_atlas(const Renderer& renderer,
+                         const AtlasSurfaces& atlas_surfaces) noexcept
+    {
+        try
+        {
+            TextureAtlas atlas;
+            for (const auto& page_surface : atlas_surfaces.pages)
+            {
+                BOOST_OUTCOME_TRY(page, create_texture(renderer, page_surface));
+                SDL_SetTextureBlendMode(to_sdl(page), SDL_BLENDMODE_BLEND);
+                atlas.m_pages.push_back(std::move(page));
+            }
+            // Regions point to the pages, which do not move any more
+            for (const auto& image : atlas_surfaces.images)
+                atlas.m_regions.emplace(
+                    image.name, AtlasRegion{atlas.m_pages[image.page_index],
+                                            image.zone});
+            return atlas;
+        }
+        catch (...)
+        {
+            return stdnext::make_error_code(stdnext::errc::not_enough_memory);
+        }
+    }
+
+    // Packs the images_extension images of images_path into pages of at most
+    // page_size, naming each image after its file stem; the pixels of an image
+    // having the color of color_keys for its name become transparent
+    inline result<TextureAtlas>
+    load_texture_atlas(const Renderer& renderer,
+                       const stdnext::filesystem::path& images_path,
+                       const char* images_extension,
+                       const std::map<std::string, Color>& color_keys = {},
+                       Size page_size = Size{2048, 2048}) noexcept
+    {
+        try
+        {
+            BOOST_OUTCOME_TRY(images_paths,
+                              find_images(images_path, images_extension));
+            std::vector<Surface> images_surfaces;
+            for (const auto& image_path : images_paths)
+            {
+                BOOST_OUTCOME_TRY(image_surface,
+                                  load_atlas_image(image_path, color_keys));
+                images_surfaces.push_back(std::move(image_surface));
+            }
+            BOOST_OUTCOME_TRY(atlas_surfaces,
+                              pack_atlas_surfaces(images_paths, images_surfaces,
+                                                  page_size));
+            return create_texture_atlas(renderer, atlas_surfaces);
+        }
+        catch (...)
+        {
+            return stdnext::make_error_code(stdnext::errc::bad_file_descriptor);
+        }
+    }
+
+} // namespace sdlxx
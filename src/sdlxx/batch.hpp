@@ -0,0 +1,190 @@
+
+#pragma once
+
+#include "atlas.hpp"
+#include "graphics.hpp"
+#include "sdl_disabled_warnings.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace sdlxx {
+
+    // Sprites to draw, grouped by layer and texture, and sent with a single
+    // SDL_RenderGeometry call per group when available, else with an
+    // SDL_RenderCopy per sprite.
+    // Layers are drawn by increasing number, the sprites of a layer and a
+    // texture in the order of the draws, but the textures of a layer in any
+    // order: sprites which must cover each other need different layers.
+    class SpriteBatch
+    {
+    public:
+        void draw(const Texture& texture, const Rectangle& src_zone,
+                  const Rectangle& dst_zone, int layer = 0,
+                  ColorAlpha color = {255, 255, 255, 255}) noexcept
+        {
+            try
+            {
+                group(to_sdl(texture), layer)
+                    .sprites.push_back(Sprite{to_sdl(src_zone),
+                                              to_sdl(dst_zone), to_sdl(color)});
+                ++m_sprites_count;
+            }
+            catch (...)
+            {
+            }
+        }
+
+        void draw(const AtlasRegion& region, Point dst_origin,
+                  int layer = 0) noexcept
+        {
+            draw(region.texture(), region.zone(),
+                 Rectangle{dst_origin, region.size()}, layer);
+        }
+
+        void draw(const AtlasRegion& region, const Rectangle& dst_zone,
+                  int layer = 0) noexcept
+        {
+            draw(region.texture(), region.zone(), dst_zone, layer);
+        }
+
+        std::size_t sprites_count() const noexcept { return m_sprites_count; }
+
+        // Draws the sprites, then forgets them, keeping the memory for the
+        // next frame
+        void submit(const Renderer& renderer) noexcept
+        {
+            std::stable_sort(m_groups.begin(), m_groups.end(),
+                             [](const Group& left, const Group& right) {
+                                 return left.layer < right.layer;
+                             });
+            for (const auto& group : m_groups)
+            {
+                if (!group.sprites.empty())
+                    submit(renderer, group);
+            }
+            // Forgets the groups of the textures not drawn by this frame
+            m_groups.erase(std::remove_if(m_groups.begin(), m_groups.end(),
+                                          [](const Group& group) {
+                                              return group.sprites.empty();
+                                          }),
+                           m_groups.end());
+            for (auto& group : m_groups)
+                group.sprites.clear();
+            m_sprites_count = 0;
+            m_last_group_index = 0;
+        }
+
+    private:
+        struct Sprite
+        {
+            SDL_Rect src_zone;
+            SDL_Rect dst_zone;
+            SDL_Color color;
+        };
+
+        struct Group
+        {
+            SDL_Texture* texture;
+            int layer;
+            std::vector<Sprite> sprites;
+        };
+
+        Group& group(SDL_Texture* texture, int layer)
+        {
+            // Consecutive draws mostly use the same group
+            if (m_last_group_index < m_groups.size())
+            {
+                auto& last_group = m_groups[m_last_group_index];
+                if (last_group.texture == texture && last_group.layer == layer)
+                    return last_group;
+            }
+            const auto iter_group = std::find_if(
+                m_groups.begin(), m_groups.end(), [&](const Group& group) {
+                    return group.texture == texture && group.layer == layer;
+                });
+            if (iter_group != m_groups.end())
+            {
+                m_last_group_index =
+                    static_cast<std::size_t>(iter_group - m_groups.begin());
+                return *iter_group;
+            }
+            m_groups.push_back(Group{texture, layer, {}});
+            m_last_group_index = m_groups.size() - 1;
+            return m_groups.back();
+        }
+
+        void submit(const Renderer& renderer, const Group& group) noexcept
+        {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+            int texture_w = 0;
+            int texture_h = 0;
+            SDL_QueryTexture(group.texture, nullptr, nullptr, &texture_w,
+                             &texture_h);
+            const auto u_scale = 1.f / static_cast<float>(texture_w);
+            const auto v_scale = 1.f / static_cast<float>(texture_h);
+            try
+            {
+                m_vertices.resize(group.sprites.size() * 4);
+                m_indices.resize(group.sprites.size() * 6);
+            }
+            catch (...)
+            {
+                return;
+            }
+            auto vertex = m_vertices.data();
+            auto index = m_indices.data();
+            int first_vertex = 0;
+            for (const auto& sprite : group.sprites)
+            {
+                const auto left = static_cast<float>(sprite.dst_zone.x);
+                const auto top = static_cast<float>(sprite.dst_zone.y);
+                const auto right = left + sprite.dst_zone.w;
+                const auto bottom = top + sprite.dst_zone.h;
+                const auto u0 = sprite.src_zone.x * u_scale;
+                const auto v0 = sprite.src_zone.y * v_scale;
+                const auto u1 = (sprite.src_zone.x + sprite.src_zone.w) * u_scale;
+                const auto v1 = (sprite.src_zone.y + sprite.src_zone.h) * v_scale;
+                *vertex++ = SDL_Vertex{{left, top}, sprite.color, {u0, v0}};
+                *vertex++ = SDL_Vertex{{right, top}, sprite.color, {u1, v0}};
+                *vertex++ = SDL_Vertex{{right, bottom}, sprite.color, {u1, v1}};
+                *vertex++ = SDL_Vertex{{left, bottom}, sprite.color, {u0, v1}};
+                for (const auto corner : {0, 1, 2, 0, 2, 3})
+                    *index++ = first_vertex + corner;
+                first_vertex += 4;
+            }
+            SDL_RenderGeometry(to_sdl(renderer), group.texture,
+                               m_vertices.data(),
+                               static_cast<int>(m_vertices.size()),
+                               m_indices.data(),
+                               static_cast<int>(m_indices.size()));
+#else
+            SDL_Color color{255, 255, 255, 255};
+            SDL_SetTextureColorMod(group.texture, color.r, color.g, color.b);
+            SDL_SetTextureAlphaMod(group.texture, color.a);
+            for (const auto& sprite : group.sprites)
+            {
+                if (sprite.color.r != color.r || sprite.color.g != color.g ||
+                    sprite.color.b != color.b || sprite.color.a != color.a)
+                {
+                    color = sprite.color;
+                    SDL_SetTextureColorMod(group.texture, color.r, color.g,
+                                           color.b);
+                    SDL_SetTextureAlphaMod(group.texture, color.a);
+                }
+                SDL_RenderCopy(to_sdl(renderer), group.texture,
+                               &sprite.src_zone, &sprite.dst_zone);
+            }
+#endif
+        }
+
+        std::vector<Group> m_groups;
+        std::size_t m_last_group_index{0};
+        std::size_t m_sprites_count{0};
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        std::vector<SDL_Vertex> m_vertices;
+        std::vector<int> m_indices;
+#endif
+    };
+
+} // namespace sdlxx
@@ -169,4 +169,12 @@ namespace sdlxx {
         SDL_RenderDrawRect(to_sdl(renderer), &sdl_rect);
     }
 
+    inline void fill_rectangle(const Renderer& renderer, const Rectangle& rectangle, ColorAlpha color) noexcept
+    {
+        SDL_SetRenderDrawColor(to_sdl(renderer), color.r(), color.g(), color.b(),
+                               color.a());
+        const auto sdl_rect = to_sdl(rectangle);
+        SDL_RenderFillRect(to_sdl(renderer), &sdl_rect);
+    }
+
 } // namespace sdlxx
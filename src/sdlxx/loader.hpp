@@ -0,0 +1,561 @@
+
+#pragma once
+
+#include "atlas.hpp"
+#include "error_handling.hpp"
+#include "graphics.hpp"
+#include "sdl_disabled_warnings.h"
+#include "sounds.hpp"
+#include "texts.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <platform/filesystem.hpp>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace sdlxx {
+
+    namespace detail {
+
+        enum class AssetState
+        {
+            Loading,
+            Loaded,
+            Failed,
+        };
+
+        template <typename AssetT>
+        struct AssetSlot
+        {
+            std::atomic<AssetState> state{AssetState::Loading};
+            std::optional<AssetT> asset{};
+            Error error{};
+        };
+
+    } // namespace detail
+
+    // Asset requested to an AssetLoader, to use from the render thread once
+    // loaded
+    template <typename AssetT>
+    class AssetHandle
+    {
+    public:
+        // Handle of an asset whose loading could not even start
+        AssetHandle() noexcept = default;
+
+        explicit AssetHandle(
+            std::shared_ptr<detail::AssetSlot<AssetT>> slot) noexcept
+            : m_slot(std::move(slot))
+        {
+        }
+
+        // Loaded or failed
+        bool is_ready() const noexcept
+        {
+            return state() != detail::AssetState::Loading;
+        }
+
+        bool is_loaded() const noexcept
+        {
+            return state() == detail::AssetState::Loaded;
+        }
+
+        // The asset, or nothing while it is loading or when it failed to load
+        AssetT* get() const noexcept
+        {
+            return is_loaded() ? &*m_slot->asset : nullptr;
+        }
+
+        // Moves the asset out of the handle, which becomes empty, or returns
+        // why there is no asset
+        result<AssetT> take() noexcept
+        {
+            switch (state())
+            {
+            case detail::AssetState::Loaded:
+            {
+                result<AssetT> asset{std::move(*m_slot->asset)};
+                m_slot.reset();
+                return asset;
+            }
+            case detail::AssetState::Failed:
+                if (m_slot)
+                    return m_slot->error;
+                return Error{
+                    stdnext::make_error_code(stdnext::errc::not_enough_memory)};
+            default:
+                return Error{stdnext::make_error_code(
+                    stdnext::errc::resource_unavailable_try_again)};
+            }
+        }
+
+    private:
+        detail::AssetState state() const noexcept
+        {
+            if (!m_slot)
+                return detail::AssetState::Failed;
+            return m_slot->state.load(std::memory_order_acquire);
+        }
+
+        std::shared_ptr<detail::AssetSlot<AssetT>> m_slot{};
+    };
+
+    // Loads assets in the background: a pool of workers reads and decodes the
+    // files into surfaces, then update creates their textures on the render
+    // thread, within a time budget, so that a game keeps drawing frames while
+    // its assets arrive one after the other.
+    // Without workers, the assets are decoded as soon as they are requested,
+    // which is the serial loading of load_texture and the like.
+    // Requests still waiting for a worker are abandoned by the destructor.
+    class AssetLoader
+    {
+    public:
+        using Duration = std::chrono::steady_clock::duration;
+
+        // All the cores but the one of the render thread
+        static std::size_t default_workers_count() noexcept
+        {
+            const auto cores_count = std::thread::hardware_concurrency();
+            return cores_count > 1 ? cores_count - 1 : 1;
+        }
+
+        explicit AssetLoader(
+            std::size_t workers_count = default_workers_count()) noexcept
+        {
+            // Runs with the workers which could be created, if any
+            try
+            {
+                for (std::size_t worker_index = 0;
+                     worker_index < workers_count; ++worker_index)
+                    m_workers.emplace_back([this] { work(); });
+            }
+            catch (...)
+            {
+            }
+        }
+
+        AssetLoader(const AssetLoader&) = delete;
+        AssetLoader& operator=(const AssetLoader&) = delete;
+
+        ~AssetLoader() noexcept
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_jobs_mutex);
+                m_stopping = true;
+            }
+            m_jobs_available.notify_all();
+            for (auto& worker : m_workers)
+                worker.join();
+        }
+
+        std::size_t workers_count() const noexcept { return m_workers.size(); }
+
+        std::size_t requested_count() const noexcept
+        {
+            return m_requested_count.load();
+        }
+
+        // Assets loaded or failed
+        std::size_t ready_count() const noexcept { return m_ready_count.load(); }
+
+        bool is_done() const noexcept
+        {
+            return ready_count() == requested_count();
+        }
+
+        AssetHandle<Texture>
+        load_texture(const stdnext::filesystem::path& image_path) noexcept
+        {
+            return load<Texture>(
+                [image_path] { return load_surface(image_path); },
+                [](const Renderer& renderer, const Surface& surface) {
+                    return create_texture(renderer, surface);
+                });
+        }
+
+        AssetHandle<Texture>
+        load_texture(const stdnext::filesystem::path& image_path,
+                     Color color_key) noexcept
+        {
+            return load<Texture>(
+                [image_path, color_key] {
+                    return load_surface(image_path, color_key);
+                },
+                [](const Renderer& renderer, const Surface& surface) {
+                    return create_texture(renderer, surface);
+                });
+        }
+
+        // Decodes the images with all the workers, packs them with the last
+        // one, then uploads the pages, as sdlxx::load_texture_atlas
+        AssetHandle<TextureAtlas> load_texture_atlas(
+            const stdnext::filesystem::path& images_path,
+            const char* images_extension,
+            const std::map<std::string, Color>& color_keys = {},
+            Size page_size = Size{2048, 2048}) noexcept
+        {
+            try
+            {
+                auto atlas_build = std::make_shared<AtlasBuild>();
+                atlas_build->color_keys = color_keys;
+                atlas_build->page_size = page_size;
+                return start<TextureAtlas>(
+                    [this, images_path,
+                     images_extension = std::string(images_extension),
+                     atlas_build](const auto& slot) {
+                        auto images_paths_or_error = find_images(
+                            images_path, images_extension.c_str());
+                        if (!images_paths_or_error)
+                        {
+                            finish(*slot, result<TextureAtlas>{
+                                              images_paths_or_error.error()});
+                            return;
+                        }
+                        decode_atlas_images(
+                            slot, atlas_build,
+                            std::move(images_paths_or_error.value()));
+                    });
+            }
+            catch (...)
+            {
+                return AssetHandle<TextureAtlas>{};
+            }
+        }
+
+        AssetHandle<Font> load_font(const stdnext::filesystem::path& font_path,
+                                    int font_size) noexcept
+        {
+            return load<Font>([this, font_path, font_size] {
+                std::lock_guard<std::mutex> lock(m_fonts_mutex);
+                return sdlxx::load_font(font_path, font_size);
+            });
+        }
+
+        // Renders the glyphs with a worker, then uploads them, as
+        // create_glyph_atlas
+        AssetHandle<GlyphAtlas> load_glyph_atlas(
+            const stdnext::filesystem::path& font_path, int font_size,
+            std::string_view characters = printable_ascii_characters) noexcept
+        {
+            try
+            {
+                return load<GlyphAtlas>(
+                    [this, font_path, font_size,
+                     characters = std::string(characters)]()
+                        -> result<GlyphsSurface> {
+                        // The font is closed before the lock is released
+                        std::unique_lock<std::mutex> lock(m_fonts_mutex);
+                        BOOST_OUTCOME_TRY(
+                            font, sdlxx::load_font(font_path, font_size));
+                        lock.unlock();
+                        auto glyphs_surface = render_glyphs(font, characters);
+                        lock.lock();
+                        return glyphs_surface;
+                    },
+                    [](const Renderer& renderer,
+                       const GlyphsSurface& glyphs_surface) {
+                        return create_glyph_atlas(renderer, glyphs_surface);
+                    });
+            }
+            catch (...)
+            {
+                return AssetHandle<GlyphAtlas>{};
+            }
+        }
+
+        AssetHandle<Chunk>
+        load_wav(const stdnext::filesystem::path& sound_path) noexcept
+        {
+            return load<Chunk>(
+                [sound_path] { return sdlxx::load_wav(sound_path); });
+        }
+
+        // Creates the textures of the decoded assets, on the render thread,
+        // until budget is spent; creates one at least, so that the loading
+        // goes on with any budget
+        void update(const Renderer& renderer, Duration budget) noexcept
+        {
+            const auto start_time = std::chrono::steady_clock::now();
+            do
+            {
+                RenderJob render_job;
+                {
+                    std::lock_guard<std::mutex> lock(m_render_jobs_mutex);
+                    if (m_render_jobs.empty())
+                        return;
+                    render_job = std::move(m_render_jobs.front());
+                    m_render_jobs.pop_front();
+                }
+                try
+                {
+                    render_job(renderer);
+                }
+                catch (...)
+                {
+                }
+            } while (std::chrono::steady_clock::now() - start_time < budget);
+        }
+
+    private:
+        using Job = std::function<void()>;
+        using RenderJob = std::function<void(const Renderer&)>;
+
+        // Images of an atlas being decoded by several workers
+        struct AtlasBuild
+        {
+            std::map<std::string, Color> color_keys;
+            Size page_size{0, 0};
+            std::vector<stdnext::filesystem::path> images_paths;
+            std::vector<std::optional<result<Surface>>> images_surfaces;
+            std::atomic<std::size_t> remaining_count{0};
+        };
+
+        template <typename AssetT>
+        using SlotPtr = std::shared_ptr<detail::AssetSlot<AssetT>>;
+
+        // Runs job with the slot of a new asset, in the background
+        template <typename AssetT, typename JobT>
+        AssetHandle<AssetT> start(JobT job) noexcept
+        {
+            try
+            {
+                auto slot = std::make_shared<detail::AssetSlot<AssetT>>();
+                ++m_requested_count;
+                try
+                {
+                    run_in_background([job, slot] { job(slot); });
+                }
+                catch (...)
+                {
+                    --m_requested_count;
+                    throw;
+                }
+                return AssetHandle<AssetT>{std::move(slot)};
+            }
+            catch (...)
+            {
+                return AssetHandle<AssetT>{};
+            }
+        }
+
+        // Asset ready once decoded
+        template <typename AssetT, typename DecodeF>
+        AssetHandle<AssetT> load(DecodeF decode) noexcept
+        {
+            return start<AssetT>(
+                [this, decode](const SlotPtr<AssetT>& slot) {
+                    finish(*slot, decode());
+                });
+        }
+
+        // Asset decoded in the background, then created on the render thread
+        template <typename AssetT, typename DecodeF, typename CreateF>
+        AssetHandle<AssetT> load(DecodeF decode, CreateF create) noexcept
+        {
+            return start<AssetT>(
+                [this, decode, create](const SlotPtr<AssetT>& slot) {
+                    create_on_render_thread(slot, decode(), create);
+                });
+        }
+
+        template <typename AssetT, typename DecodedT, typename CreateF>
+        void create_on_render_thread(const SlotPtr<AssetT>& slot,
+                                     result<DecodedT>&& decoded_or_error,
+                                     CreateF create) noexcept
+        {
+            if (!decoded_or_error)
+            {
+                finish(*slot, result<AssetT>{decoded_or_error.error()});
+                return;
+            }
+            try
+            {
+                auto decoded = std::make_shared<DecodedT>(
+                    std::move(decoded_or_error.value()));
+                run_on_render_thread(
+                    [this, slot, decoded, create](const Renderer& renderer) {
+                        finish(*slot, create(renderer, *decoded));
+                    });
+            }
+            catch (...)
+            {
+                finish(*slot, result<AssetT>{Error{stdnext::make_error_code(
+                                  stdnext::errc::not_enough_memory)}});
+            }
+        }
+
+        void decode_atlas_images(
+            const SlotPtr<TextureAtlas>& slot,
+            const std::shared_ptr<AtlasBuild>& atlas_build,
+            std::vector<stdnext::filesystem::path>&& images_paths) noexcept
+        {
+            const auto images_count = images_paths.size();
+            try
+            {
+                atlas_build->images_paths = std::move(images_paths);
+                atlas_build->images_surfaces.resize(images_count);
+            }
+            catch (...)
+            {
+                finish(*slot, result<TextureAtlas>{Error{stdnext::make_error_code(
+                                  stdnext::errc::not_enough_memory)}});
+                return;
+            }
+            if (images_count == 0)
+            {
+                pack_atlas(slot, *atlas_build);
+                return;
+            }
+            atlas_build->remaining_count = images_count;
+            for (std::size_t image_index = 0; image_index < images_count;
+                 ++image_index)
+            {
+                const auto decode_image = [this, slot, atlas_build,
+                                           image_index] {
+                    auto& build = *atlas_build;
+                    build.images_surfaces[image_index].emplace(load_atlas_image(
+                        build.images_paths[image_index], build.color_keys));
+                    if (--build.remaining_count == 0)
+                        pack_atlas(slot, build);
+                };
+                // Decodes here the images which cannot be queued
+                try
+                {
+                    run_in_background(decode_image);
+                }
+                catch (...)
+                {
+                    decode_image();
+                }
+            }
+        }
+
+        void pack_atlas(const SlotPtr<TextureAtlas>& slot,
+                        AtlasBuild& atlas_build) noexcept
+        {
+            try
+            {
+                std::vector<Surface> images_surfaces;
+                for (auto& image_surface : atlas_build.images_surfaces)
+                {
+                    if (!*image_surface)
+                    {
+                        finish(*slot,
+                               result<TextureAtlas>{image_surface->error()});
+                        return;
+                    }
+                    images_surfaces.push_back(
+                        std::move(image_surface->value()));
+                }
+                create_on_render_thread(
+                    slot,
+                    pack_atlas_surfaces(atlas_build.images_paths,
+                                        images_surfaces, atlas_build.page_size),
+                    [](const Renderer& renderer,
+                       const AtlasSurfaces& atlas_surfaces) {
+                        return create_texture_atlas(renderer, atlas_surfaces);
+                    });
+            }
+            catch (...)
+            {
+                finish(*slot, result<TextureAtlas>{Error{stdnext::make_error_code(
+                                  stdnext::errc::not_enough_memory)}});
+            }
+        }
+
+        template <typename AssetT>
+        void finish(detail::AssetSlot<AssetT>& slot,
+                    result<AssetT>&& asset_or_error) noexcept
+        {
+            try
+            {
+                if (asset_or_error)
+                {
+                    slot.asset.emplace(std::move(asset_or_error.value()));
+                    slot.state.store(detail::AssetState::Loaded,
+                                     std::memory_order_release);
+                }
+                else
+                {
+                    slot.error = asset_or_error.error();
+                    slot.state.store(detail::AssetState::Failed,
+                                     std::memory_order_release);
+                }
+            }
+            catch (...)
+            {
+                slot.state.store(detail::AssetState::Failed,
+                                 std::memory_order_release);
+            }
+            ++m_ready_count;
+        }
+
+        void run_in_background(Job job)
+        {
+            if (m_workers.empty())
+            {
+                job();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_jobs_mutex);
+                m_jobs.push_back(std::move(job));
+            }
+            m_jobs_available.notify_one();
+        }
+
+        void run_on_render_thread(RenderJob render_job)
+        {
+            std::lock_guard<std::mutex> lock(m_render_jobs_mutex);
+            m_render_jobs.push_back(std::move(render_job));
+        }
+
+        void work() noexcept
+        {
+            for (;;)
+            {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(m_jobs_mutex);
+                    m_jobs_available.wait(lock, [this] {
+                        return m_stopping || !m_jobs.empty();
+                    });
+                    if (m_stopping)
+                        return;
+                    job = std::move(m_jobs.front());
+                    m_jobs.pop_front();
+                }
+                try
+                {
+                    job();
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+
+        std::atomic<std::size_t> m_requested_count{0};
+        std::atomic<std::size_t> m_ready_count{0};
+        std::mutex m_jobs_mutex;
+        std::condition_variable m_jobs_available;
+        std::deque<Job> m_jobs;
+        bool m_stopping{false};
+        std::mutex m_render_jobs_mutex;
+        std::deque<RenderJob> m_render_jobs;
+        // FreeType creates and destroys its faces one at a time
+        std::mutex m_fonts_mutex;
+        std::vector<std::thread> m_workers;
+    };
+
+} // namespace sdlxx
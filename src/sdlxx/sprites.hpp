@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include "atlas.hpp"
+#include "batch.hpp"
 #include "graphics.hpp"
 
 namespace sdlxx {
@@ -85,6 +87,59 @@ namespace sdlxx {
         render_texture(renderer, sprite_sheet.texture(), src_zone, dst_zone);
     }
 
+    // Sprite sheet packed in a texture atlas
+    class AtlasSpriteSheet
+    {
+    public:
+        AtlasSpriteSheet(const AtlasRegion& region, Size sprite_size) noexcept
+            : m_region(region), m_sprite_size(sprite_size),
+              m_grid_size(region.size().w() / std::max(1, sprite_size.w()),
+                          region.size().h() / std::max(1, sprite_size.h()))
+        {
+        }
+
+        const AtlasRegion& region() const noexcept { return m_region; }
+
+        const Size& sprite_size() const noexcept { return m_sprite_size; }
+
+        const Size& grid_size() const noexcept { return m_grid_size; }
+
+    private:
+        AtlasRegion m_region;
+        Size m_sprite_size;
+        Size m_grid_size;
+    };
+
+    inline SpriteIndex next(const AtlasSpriteSheet& sprite_sheet,
+                            SpriteIndex sprite_index) noexcept
+    {
+        const auto grid_size = sprite_sheet.grid_size();
+        auto x = sprite_index.x() + 1;
+        auto y = sprite_index.y();
+        if (x >= grid_size.w())
+        {
+            x = 0;
+            ++y;
+        }
+        if (y >= grid_size.h())
+            y = 0;
+        return SpriteIndex{x, y};
+    }
+
+    inline void draw_sprite(SpriteBatch& sprite_batch,
+                            const AtlasSpriteSheet& sprite_sheet,
+                            SpriteIndex sprite_index, Point dst_origin,
+                            int layer = 0) noexcept
+    {
+        const auto& region = sprite_sheet.region();
+        const auto sprite_size = sprite_sheet.sprite_size();
+        const Point src_origin(
+            region.zone().origin().x() + sprite_index.x() * sprite_size.w(),
+            region.zone().origin().y() + sprite_index.y() * sprite_size.h());
+        sprite_batch.draw(region.texture(), Rectangle{src_origin, sprite_size},
+                          Rectangle{dst_origin, sprite_size}, layer);
+    }
+
     inline result<SpriteSheet>
     load_spritesheet(const Renderer& renderer,
                      const stdnext::filesystem::path& image_path, Color color_key,
@@ -1,11 +1,16 @@
 
 #pragma once
 
+#include "batch.hpp"
 #include "graphics.hpp"
 #include "raii.hpp"
 #include "sdl_disabled_warnings.h"
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <platform/filesystem.hpp>
+#include <string_view>
+#include <vector>
 
 namespace sdlxx {
 
@@ -40,4 +45,269 @@ namespace sdlxx {
         return create_texture(renderer, surface);
     }
 
+    struct GlyphsSurface;
+
+    // Glyphs of a font rendered once, in white, into a single texture, so that
+    // texts are drawn from it without rendering nor uploading anything.
+    // Each character is drawn with its own advance, without kerning.
+    class GlyphAtlas
+    {
+    public:
+        struct Glyph
+        {
+            Rectangle zone{Point{0, 0}, Size{0, 0}}; // in the texture
+            int advance{0};
+        };
+
+        friend result<GlyphAtlas>
+        create_glyph_atlas(const Renderer& renderer,
+                           const GlyphsSurface& glyphs_surface) noexcept;
+
+        const Texture& texture() const noexcept { return m_texture; }
+
+        int height() const noexcept { return m_height; }
+
+        // Empty glyph for the characters which are not in the atlas
+        const Glyph& glyph(char character) const noexcept
+        {
+            const auto index = static_cast<unsigned char>(character);
+            return index < m_glyphs.size() ? m_glyphs[index] : m_glyphs[0];
+        }
+
+    private:
+        friend void render_text(const Renderer& renderer,
+                                const GlyphAtlas& glyph_atlas,
+                                std::string_view text, Point origin,
+                                ColorAlpha color) noexcept;
+
+        GlyphAtlas(Texture&& texture, int height,
+                   const std::array<Glyph, 128>& glyphs)
+            : m_texture(std::move(texture)), m_height(height), m_glyphs(glyphs)
+        {
+        }
+
+        Texture m_texture;
+        int m_height;
+        std::array<Glyph, 128> m_glyphs;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        // Quads of the last text drawn, kept to avoid allocating at each draw
+        mutable std::vector<SDL_Vertex> m_vertices;
+        mutable std::vector<int> m_indices;
+#endif
+    };
+
+    constexpr std::string_view printable_ascii_characters =
+        " !\"#$%&'()*+,-./0123456789:;<=>?@"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
+        "abcdefghijklmnopqrstuvwxyz{|}~";
+
+    // Glyphs of a glyph atlas rendered into a surface, which needs no renderer
+    struct GlyphsSurface
+    {
+        Surface surface;
+        int height;
+        std::array<GlyphAtlas::Glyph, 128> glyphs;
+    };
+
+    // Renders the ASCII characters found in characters, packed in rows
+    inline result<GlyphsSurface>
+    render_glyphs(const Font& font,
+                  std::string_view characters =
+                      printable_ascii_characters) noexcept
+    {
+        constexpr int atlas_width = 512;
+        const SDL_Color white{255, 255, 255, 255};
+
+        try
+        {
+            std::vector<std::pair<char, Surface>> glyphs_surfaces;
+            std::array<GlyphAtlas::Glyph, 128> glyphs{};
+            Point position{0, 0};
+            int row_height = 0;
+            for (const auto character : characters)
+            {
+                const auto index = static_cast<unsigned char>(character);
+                if (index >= glyphs.size() || glyphs[index].advance != 0)
+                    continue;
+                int advance = 0;
+                if (TTF_GlyphMetrics(to_sdl(font), index, nullptr, nullptr,
+                                     nullptr, nullptr, &advance) != 0)
+                    return stdnext::make_error_code(
+                        stdnext::errc::invalid_argument);
+                const auto sdl_surface =
+                    TTF_RenderGlyph_Blended(to_sdl(font), index, white);
+                if (!sdl_surface)
+                    return stdnext::make_error_code(
+                        stdnext::errc::invalid_argument);
+                Surface glyph_surface{*sdl_surface};
+                const Size glyph_size{sdl_surface->w, sdl_surface->h};
+                if (position.x() + glyph_size.w() > atlas_width)
+                {
+                    position = Point{0, position.y() + row_height};
+                    row_height = 0;
+                }
+                glyphs[index] = GlyphAtlas::Glyph{
+                    Rectangle{position, glyph_size}, std::max(advance, 1)};
+                position = Point{position.x() + glyph_size.w(), position.y()};
+                row_height = std::max(row_height, glyph_size.h());
+                glyphs_surfaces.emplace_back(character,
+                                             std::move(glyph_surface));
+            }
+
+            const auto atlas_height = std::max(1, position.y() + row_height);
+            const auto sdl_atlas_surface = SDL_CreateRGBSurfaceWithFormat(
+                0, atlas_width, atlas_height, 32, SDL_PIXELFORMAT_RGBA32);
+            if (!sdl_atlas_surface)
+                return stdnext::make_error_code(
+                    stdnext::errc::not_enough_memory);
+            Surface atlas_surface{*sdl_atlas_surface};
+            for (const auto& [character, glyph_surface] : glyphs_surfaces)
+            {
+                // Copies the glyph with its transparency instead of blending it
+                SDL_SetSurfaceBlendMode(to_sdl(glyph_surface),
+                                        SDL_BLENDMODE_NONE);
+                auto sdl_dst_zone =
+                    to_sdl(glyphs[static_cast<unsigned char>(character)].zone);
+                SDL_BlitSurface(to_sdl(glyph_surface), nullptr,
+                                to_sdl(atlas_surface), &sdl_dst_zone);
+            }
+            return GlyphsSurface{std::move(atlas_surface),
+                                 TTF_FontHeight(to_sdl(font)), glyphs};
+        }
+        catch (...)
+        {
+            return stdnext::make_error_code(stdnext::errc::not_enough_memory);
+        }
+    }
+
+    // Uploads the rendered glyphs, on the render thread
+    inline result<GlyphAtlas>
+    create_glyph_atlas(const Renderer& renderer,
+                       const GlyphsSurface& glyphs_surface) noexcept
+    {
+        BOOST_OUTCOME_TRY(texture,
+                          create_texture(renderer, glyphs_surface.surface));
+        SDL_SetTextureBlendMode(to_sdl(texture), SDL_BLENDMODE_BLEND);
+        return GlyphAtlas{std::move(texture), glyphs_surface.height,
+                          glyphs_surface.glyphs};
+    }
+
+    // Atlas of the ASCII characters found in characters, packed in rows
+    inline result<GlyphAtlas>
+    create_glyph_atlas(const Renderer& renderer, const Font& font,
+                       std::string_view characters =
+                           printable_ascii_characters) noexcept
+    {
+        BOOST_OUTCOME_TRY(glyphs_surface, render_glyphs(font, characters));
+        return create_glyph_atlas(renderer, glyphs_surface);
+    }
+
+    inline Size get_text_size(const GlyphAtlas& glyph_atlas,
+                              std::string_view text) noexcept
+    {
+        int w = 0;
+        for (const auto character : text)
+            w += glyph_atlas.glyph(character).advance;
+        return Size{w, glyph_atlas.height()};
+    }
+
+    // Draws the text with a single call to SDL_RenderGeometry when available,
+    // else with a copy of each glyph from the atlas
+    inline void render_text(const Renderer& renderer,
+                            const GlyphAtlas& glyph_atlas, std::string_view text,
+                            Point origin,
+                            ColorAlpha color = {255, 255, 255, 255}) noexcept
+    {
+        const auto& texture = glyph_atlas.texture();
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        const auto texture_size = get_size(texture);
+        const auto sdl_color = to_sdl(color);
+        auto& vertices = glyph_atlas.m_vertices;
+        auto& indices = glyph_atlas.m_indices;
+        vertices.clear();
+        indices.clear();
+        auto x = origin.x();
+        for (const auto character : text)
+        {
+            const auto& glyph = glyph_atlas.glyph(character);
+            const auto& zone = glyph.zone;
+            if (zone.size().w() > 0)
+            {
+                const auto left = static_cast<float>(x);
+                const auto top = static_cast<float>(origin.y());
+                const auto right = left + zone.size().w();
+                const auto bottom = top + zone.size().h();
+                const auto u0 = static_cast<float>(zone.origin().x()) /
+                                texture_size.w();
+                const auto v0 = static_cast<float>(zone.origin().y()) /
+                                texture_size.h();
+                const auto u1 =
+                    static_cast<float>(zone.origin().x() + zone.size().w()) /
+                    texture_size.w();
+                const auto v1 =
+                    static_cast<float>(zone.origin().y() + zone.size().h()) /
+                    texture_size.h();
+                const auto first_vertex = static_cast<int>(vertices.size());
+                try
+                {
+                    vertices.push_back(
+                        SDL_Vertex{{left, top}, sdl_color, {u0, v0}});
+                    vertices.push_back(
+                        SDL_Vertex{{right, top}, sdl_color, {u1, v0}});
+                    vertices.push_back(
+                        SDL_Vertex{{right, bottom}, sdl_color, {u1, v1}});
+                    vertices.push_back(
+                        SDL_Vertex{{left, bottom}, sdl_color, {u0, v1}});
+                    for (const auto corner : {0, 1, 2, 0, 2, 3})
+                        indices.push_back(first_vertex + corner);
+                }
+                catch (...)
+                {
+                    return;
+                }
+            }
+            x += glyph.advance;
+        }
+        if (!indices.empty())
+            SDL_RenderGeometry(to_sdl(renderer), to_sdl(texture),
+                               vertices.data(),
+                               static_cast<int>(vertices.size()),
+                               indices.data(),
+                               static_cast<int>(indices.size()));
+#else
+        SDL_SetTextureColorMod(to_sdl(texture), color.r(), color.g(),
+                               color.b());
+        SDL_SetTextureAlphaMod(to_sdl(texture), color.a());
+        auto x = origin.x();
+        for (const auto character : text)
+        {
+            const auto& glyph = glyph_atlas.glyph(character);
+            if (glyph.zone.size().w() > 0)
+                render_texture(renderer, texture, glyph.zone,
+                               Rectangle{Point{x, origin.y()},
+                                         glyph.zone.size()});
+            x += glyph.advance;
+        }
+#endif
+    }
+
+    // Adds the glyphs of the text to a batch, to draw it with other sprites
+    inline void draw_text(SpriteBatch& sprite_batch,
+                          const GlyphAtlas& glyph_atlas, std::string_view text,
+                          Point origin, int layer = 0,
+                          ColorAlpha color = {255, 255, 255, 255}) noexcept
+    {
+        auto x = origin.x();
+        for (const auto character : text)
+        {
+            const auto& glyph = glyph_atlas.glyph(character);
+            if (glyph.zone.size().w() > 0)
+                sprite_batch.draw(
+                    glyph_atlas.texture(), glyph.zone,
+                    Rectangle{Point{x, origin.y()}, glyph.zone.size()}, layer,
+                    color);
+            x += glyph.advance;
+        }
+    }
+
 } // namespace sdlxx
@@ -1,27 +1,568 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cstddef>
 #include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+// All the strings below convert to std::string_view (the rope through its pieces), compare with it and share
+// length(), substr() and operator+.
+
+// Heap string: one allocation per non empty string
 class String
 {
 public:
 
+    String() = default;
+
     String(const char* data)
-        : m_length{std::strlen(data)}
+        : String(std::string_view(data))
+    {
+    }
+
+    explicit String(std::string_view text)
+        : m_length{text.length()}
     {
+        if (m_length == 0)
+            return;
         m_data = new char[m_length + 1];
-        std::memcpy(m_data, data, m_length);
+        std::memcpy(m_data, text.data(), m_length);
         m_data[m_length] = 0;
     }
 
-    const char* c_str() const { return m_data; }
+    String(const String& other)
+        : String(other.view())
+    {
+    }
+
+    String(String&& other) noexcept
+        : m_data{std::exchange(other.m_data, nullptr)}
+        , m_length{std::exchange(other.m_length, 0)}
+    {
+    }
+
+    ~String()
+    {
+        delete[] m_data;
+    }
+
+    String& operator=(const String& other)
+    {
+        if (&other != this)
+            String(other).swap(*this);
+        return *this;
+    }
+
+    String& operator=(String&& other) noexcept
+    {
+        String(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(String& other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_length, other.m_length);
+    }
+
+    const char* c_str() const { return m_data ? m_data : ""; }
 
     std::size_t length() const { return m_length; }
 
+    std::string_view view() const { return std::string_view(c_str(), m_length); }
+
+    operator std::string_view() const { return view(); }
+
+    String substr(std::size_t pos, std::size_t count = std::string_view::npos) const { return String(view().substr(pos, count)); }
+
+    friend String operator+(const String& left, const String& right)
+    {
+        String result;
+        result.m_length = left.m_length + right.m_length;
+        if (result.m_length == 0)
+            return result;
+        result.m_data = new char[result.m_length + 1];
+        std::memcpy(result.m_data, left.c_str(), left.m_length);
+        std::memcpy(result.m_data + left.m_length, right.c_str(), right.m_length + 1);
+        return result;
+    }
+
 private:
 
     char* m_data = nullptr;
     std::size_t m_length = 0;
 };
+
+// Small-string-optimised string: up to inline_capacity characters live in the object itself, longer ones on the heap
+class SsoString
+{
+public:
+
+    static constexpr std::size_t inline_capacity = 23;
+
+    SsoString()
+        : m_length{0}
+        , m_is_heap{0}
+    {
+        m_inline[0] = 0;
+    }
+
+    SsoString(const char* data)
+        : SsoString(std::string_view(data))
+    {
+    }
+
+    explicit SsoString(std::string_view text)
+        : SsoString()
+    {
+        char* data = reserve_uninitialized(text.length());
+        std::memcpy(data, text.data(), text.length());
+        data[text.length()] = 0;
+        m_length = text.length();
+    }
+
+    SsoString(const SsoString& other)
+        : SsoString(other.view())
+    {
+    }
+
+    SsoString(SsoString&& other) noexcept
+        : m_length{other.m_length}
+        , m_is_heap{other.m_is_heap}
+    {
+        if (other.is_inline())
+        {
+            std::memcpy(m_inline, other.m_inline, m_length + 1);
+            return;
+        }
+        m_heap = other.m_heap;
+        other.m_length = 0;
+        other.m_is_heap = 0;
+        other.m_inline[0] = 0;
+    }
+
+    ~SsoString()
+    {
+        if (!is_inline())
+            delete[] m_heap.data;
+    }
+
+    SsoString& operator=(const SsoString& other)
+    {
+        if (&other != this)
+            assign(other.view());
+        return *this;
+    }
+
+    SsoString& operator=(SsoString&& other) noexcept
+    {
+        if (&other != this)
+        {
+            this->~SsoString();
+            new (this) SsoString(std::move(other));
+        }
+        return *this;
+    }
+
+    SsoString& assign(std::string_view text)
+    {
+        // A heap buffer large enough is kept, unless the text fits inline
+        if (text.length() <= inline_capacity || text.length() > capacity())
+        {
+            SsoString(text).swap(*this);
+            return *this;
+        }
+        std::memmove(m_heap.data, text.data(), text.length());
+        m_heap.data[text.length()] = 0;
+        m_length = text.length();
+        return *this;
+    }
+
+    SsoString& operator+=(std::string_view text)
+    {
+        const auto new_length = m_length + text.length();
+        if (new_length > capacity())
+        {
+            SsoString grown;
+            char* data = grown.reserve_uninitialized(std::max(new_length, 2 * capacity()));
+            std::memcpy(data, c_str(), m_length);
+            // text may view this string, so it is copied before the old storage is released
+            std::memcpy(data + m_length, text.data(), text.length());
+            data[new_length] = 0;
+            grown.m_length = new_length;
+            swap(grown);
+            return *this;
+        }
+        char* data = is_inline() ? m_inline : m_heap.data;
+        std::memmove(data + m_length, text.data(), text.length());
+        data[new_length] = 0;
+        m_length = new_length;
+        return *this;
+    }
+
+    void swap(SsoString& other) noexcept
+    {
+        SsoString temp(std::move(other));
+        other.~SsoString();
+        new (&other) SsoString(std::move(*this));
+        this->~SsoString();
+        new (this) SsoString(std::move(temp));
+    }
+
+    const char* c_str() const { return is_inline() ? m_inline : m_heap.data; }
+
+    std::size_t length() const { return m_length; }
+
+    std::size_t capacity() const { return is_inline() ? inline_capacity : m_heap.capacity; }
+
+    bool is_inline() const { return !m_is_heap; }
+
+    std::string_view view() const { return std::string_view(c_str(), m_length); }
+
+    operator std::string_view() const { return view(); }
+
+    SsoString substr(std::size_t pos, std::size_t count = std::string_view::npos) const { return SsoString(view().substr(pos, count)); }
+
+    friend SsoString operator+(const SsoString& left, std::string_view right)
+    {
+        SsoString result;
+        char* data = result.reserve_uninitialized(left.m_length + right.length());
+        std::memcpy(data, left.c_str(), left.m_length);
+        std::memcpy(data + left.m_length, right.data(), right.length());
+        result.m_length = left.m_length + right.length();
+        data[result.m_length] = 0;
+        return result;
+    }
+
+private:
+
+    // Makes room for count characters and the terminator, on an empty string
+    char* reserve_uninitialized(std::size_t count)
+    {
+        assert(m_length == 0 && is_inline());
+        if (count <= inline_capacity)
+            return m_inline;
+        m_heap.data = new char[count + 1];
+        m_heap.capacity = count;
+        m_is_heap = true;
+        return m_heap.data;
+    }
+
+    struct Heap
+    {
+        char* data;
+        std::size_t capacity;
+    };
+
+    union
+    {
+        char m_inline[inline_capacity + 1];
+        Heap m_heap;
+    };
+    // Bit-fields keep the object at 32 bytes
+    std::size_t m_length : sizeof(std::size_t) * 8 - 1;
+    std::size_t m_is_heap : 1;
+};
+
+// Immutable string shared by reference counting, safe to copy across threads; substrings share the buffer of the whole
+class SharedString
+{
+public:
+
+    SharedString() = default;
+
+    SharedString(const char* data)
+        : SharedString(std::string_view(data))
+    {
+    }
+
+    explicit SharedString(std::string_view text)
+    {
+        if (text.empty())
+            return;
+        m_block = allocate(text.length());
+        std::memcpy(m_block->characters(), text.data(), text.length());
+        m_data = m_block->characters();
+        m_length = text.length();
+    }
+
+    SharedString(const SharedString& other) noexcept
+        : m_block{other.m_block}
+        , m_data{other.m_data}
+        , m_length{other.m_length}
+    {
+        if (m_block)
+            m_block->references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    SharedString(SharedString&& other) noexcept
+        : m_block{std::exchange(other.m_block, nullptr)}
+        , m_data{std::exchange(other.m_data, nullptr)}
+        , m_length{std::exchange(other.m_length, 0)}
+    {
+    }
+
+    ~SharedString()
+    {
+        if (m_block && m_block->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            m_block->~Block();
+            ::operator delete(m_block);
+        }
+    }
+
+    SharedString& operator=(SharedString other) noexcept
+    {
+        std::swap(m_block, other.m_block);
+        std::swap(m_data, other.m_data);
+        std::swap(m_length, other.m_length);
+        return *this;
+    }
+
+    std::size_t length() const { return m_length; }
+
+    std::string_view view() const { return std::string_view(m_data ? m_data : "", m_length); }
+
+    operator std::string_view() const { return view(); }
+
+    std::size_t use_count() const { return m_block ? m_block->references.load(std::memory_order_relaxed) : 0; }
+
+    SharedString substr(std::size_t pos, std::size_t count = std::string_view::npos) const
+    {
+        const auto text = view().substr(pos, count);
+        SharedString result(*this);
+        result.m_data = text.data();
+        result.m_length = text.length();
+        return result;
+    }
+
+    friend SharedString operator+(const SharedString& left, std::string_view right)
+    {
+        if (right.empty())
+            return left;
+        SharedString result;
+        result.m_block = allocate(left.m_length + right.length());
+        result.m_data = result.m_block->characters();
+        result.m_length = left.m_length + right.length();
+        std::memcpy(result.m_block->characters(), left.view().data(), left.m_length);
+        std::memcpy(result.m_block->characters() + left.m_length, right.data(), right.length());
+        return result;
+    }
+
+private:
+
+    // Reference count followed by the characters, in a single allocation
+    struct Block
+    {
+        std::atomic<std::size_t> references{1};
+
+        char* characters() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    static Block* allocate(std::size_t length)
+    {
+        return new (::operator new(sizeof(Block) + length)) Block;
+    }
+
+    Block* m_block = nullptr;
+    const char* m_data = nullptr;
+    std::size_t m_length = 0;
+};
+
+// Immutable rope for large documents built by concatenation: concatenating and taking substrings only create tree
+// nodes sharing the existing text, short pieces being merged to keep the leaves dense
+class Rope
+{
+public:
+
+    static constexpr std::size_t short_leaf_length = 64;
+    static constexpr std::size_t max_depth = 48;
+
+    Rope() = default;
+
+    Rope(const char* data)
+        : Rope(std::string_view(data))
+    {
+    }
+
+    explicit Rope(std::string_view text)
+        : Rope(SharedString(text))
+    {
+    }
+
+    explicit Rope(SharedString text)
+    {
+        if (text.length() != 0)
+            m_root = std::make_shared<const Node>(Node{text.length(), 0, std::move(text), nullptr, nullptr});
+    }
+
+    std::size_t length() const { return m_root ? m_root->length : 0; }
+
+    std::size_t depth() const { return m_root ? m_root->depth : 0; }
+
+    char operator[](std::size_t pos) const
+    {
+        assert(pos < length());
+        const Node* node = m_root.get();
+        while (node->left)
+        {
+            if (pos < node->left->length)
+                node = node->left.get();
+            else
+            {
+                pos -= node->left->length;
+                node = node->right.get();
+            }
+        }
+        return node->leaf.view()[pos];
+    }
+
+    // Calls visit with the successive pieces of the text, as std::string_view
+    template <typename VisitorT>
+    void for_each_piece(VisitorT&& visit) const
+    {
+        if (m_root)
+            for_each_piece(*m_root, visit);
+    }
+
+    std::string str() const
+    {
+        std::string text;
+        text.reserve(length());
+        for_each_piece([&](std::string_view piece) { text.append(piece.data(), piece.length()); });
+        return text;
+    }
+
+    Rope substr(std::size_t pos, std::size_t count = std::string_view::npos) const
+    {
+        assert(pos <= length());
+        count = std::min(count, length() - pos);
+        Rope result;
+        if (count != 0)
+            result.m_root = substr(m_root, pos, count);
+        return result;
+    }
+
+    friend Rope operator+(const Rope& left, const Rope& right)
+    {
+        if (!left.m_root)
+            return right;
+        if (!right.m_root)
+            return left;
+        Rope result;
+        result.m_root = concat(left.m_root, right.m_root);
+        if (result.m_root->depth > max_depth)
+            result.rebalance();
+        return result;
+    }
+
+    friend bool operator==(const Rope& left, std::string_view right)
+    {
+        if (left.length() != right.length())
+            return false;
+        bool is_equal = true;
+        left.for_each_piece([&](std::string_view piece) {
+            is_equal = is_equal && right.substr(0, piece.length()) == piece;
+            right.remove_prefix(piece.length());
+        });
+        return is_equal;
+    }
+
+private:
+
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    // A leaf has text and no children
+    struct Node
+    {
+        std::size_t length;
+        std::size_t depth;
+        SharedString leaf;
+        NodePtr left;
+        NodePtr right;
+    };
+
+    template <typename VisitorT>
+    static void for_each_piece(const Node& node, VisitorT& visit)
+    {
+        if (!node.left)
+        {
+            visit(node.leaf.view());
+            return;
+        }
+        for_each_piece(*node.left, visit);
+        for_each_piece(*node.right, visit);
+    }
+
+    static NodePtr concat(const NodePtr& left, const NodePtr& right)
+    {
+        if (left->length + right->length <= short_leaf_length)
+        {
+            std::string text;
+            text.reserve(left->length + right->length);
+            const auto append = [&](std::string_view piece) { text.append(piece.data(), piece.length()); };
+            for_each_piece(*left, append);
+            for_each_piece(*right, append);
+            return std::make_shared<const Node>(Node{text.length(), 0, SharedString(text), nullptr, nullptr});
+        }
+        return std::make_shared<const Node>(Node{left->length + right->length, std::max(left->depth, right->depth) + 1, {}, left, right});
+    }
+
+    static NodePtr substr(const NodePtr& node, std::size_t pos, std::size_t count)
+    {
+        if (pos == 0 && count == node->length)
+            return node;
+        if (!node->left)
+            return std::make_shared<const Node>(Node{count, 0, node->leaf.substr(pos, count), nullptr, nullptr});
+        const auto left_length = node->left->length;
+        if (pos + count <= left_length)
+            return substr(node->left, pos, count);
+        if (pos >= left_length)
+            return substr(node->right, pos - left_length, count);
+        return concat(substr(node->left, pos, left_length - pos), substr(node->right, 0, pos + count - left_length));
+    }
+
+    // Rebuilds a balanced tree over the same leaves
+    void rebalance()
+    {
+        std::vector<NodePtr> leaves;
+        collect_leaves(m_root, leaves);
+        m_root = build_balanced(leaves, 0, leaves.size());
+    }
+
+    static void collect_leaves(const NodePtr& node, std::vector<NodePtr>& leaves)
+    {
+        if (!node->left)
+        {
+            leaves.push_back(node);
+            return;
+        }
+        collect_leaves(node->left, leaves);
+        collect_leaves(node->right, leaves);
+    }
+
+    static NodePtr build_balanced(const std::vector<NodePtr>& leaves, std::size_t begin, std::size_t end)
+    {
+        if (end - begin == 1)
+            return leaves[begin];
+        const auto middle = begin + (end - begin) / 2;
+        const auto left = build_balanced(leaves, begin, middle);
+        const auto right = build_balanced(leaves, middle, end);
+        return std::make_shared<const Node>(Node{left->length + right->length, std::max(left->depth, right->depth) + 1, {}, left, right});
+    }
+
+    NodePtr m_root;
+};
+
+inline bool operator==(const String& left, std::string_view right) { return left.view() == right; }
+inline bool operator==(const SsoString& left, std::string_view right) { return left.view() == right; }
+inline bool operator==(const SharedString& left, std::string_view right) { return left.view() == right; }
@@ -1,6 +1,80 @@
 
 #include "string.hpp"
 #include <catch2/catch.hpp>
+#include <platform/platform.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counts the allocations of the whole program, to check what the strings allocate
+static std::atomic<std::size_t> allocations_count{0};
+
+// GCC warns about free once it inlines the replaced operator new into the replaced operator delete
+#if EXP_PLATFORM_CPL_IS_GCC
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+    ++allocations_count;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    ++allocations_count;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+#if EXP_PLATFORM_CPL_IS_GCC
+#pragma GCC diagnostic pop
+#endif
+
+template <typename FunctionT>
+static std::size_t count_allocations(FunctionT&& function)
+{
+    const auto before = allocations_count.load();
+    function();
+    return allocations_count.load() - before;
+}
 
 #if 0
 template <typename T>
@@ -161,11 +235,9 @@ TEST_CASE("String", "[]")
     {
         SECTION("Default")
         {
-            #if 0
             String s;
             REQUIRE(std::strcmp(s.c_str(), "") == 0);
             REQUIRE(s.length() == 0);
-            #endif
         }
 
         SECTION("const char*")
@@ -195,25 +267,221 @@ TEST_CASE("String", "[]")
     {
         SECTION("copy")
         {
-            #if 0
             String s0("hello");
             String s;
             s = s0;
             REQUIRE(std::strcmp(s.c_str(), "hello") == 0);
             REQUIRE(s.length() == std::strlen("hello"));
-            #endif
         }
 
         SECTION("from function")
         {
-            #if 0
             String s;
             s = create_string("hello");
             REQUIRE(std::strcmp(s.c_str(), "hello") == 0);
             REQUIRE(s.length() == std::strlen("hello"));
-            #endif
         }
     }
+
+    SECTION("Concatenation and substring")
+    {
+        String s = String("hello") + String(" world");
+        REQUIRE(s == "hello world");
+        REQUIRE(s.substr(6) == "world");
+        REQUIRE(std::strcmp(s.c_str(), "hello world") == 0);
+    }
+}
+
+TEST_CASE("SsoString", "[]")
+{
+    SECTION("Short strings are stored inline, without allocation")
+    {
+        const std::string text(SsoString::inline_capacity, 'a');
+        const auto allocations = count_allocations([&] {
+            SsoString s(text);
+            SsoString copy(s);
+            SsoString moved(std::move(copy));
+            REQUIRE(s == text);
+            REQUIRE(moved == text);
+            REQUIRE(s.is_inline());
+        });
+        REQUIRE(allocations == 0);
+        REQUIRE(sizeof(SsoString) == 32);
+    }
+
+    SECTION("Long strings are stored on the heap and moved without allocation")
+    {
+        const std::string text(SsoString::inline_capacity + 1, 'b');
+        SsoString s(text);
+        REQUIRE(!s.is_inline());
+        SsoString moved;
+        REQUIRE(count_allocations([&] { moved = std::move(s); }) == 0);
+        REQUIRE(moved == text);
+        REQUIRE(s.length() == 0);
+        REQUIRE(std::strcmp(s.c_str(), "") == 0);
+    }
+
+    SECTION("Appending grows from inline to heap storage")
+    {
+        SsoString s("hello");
+        s += ", ";
+        s += "world";
+        REQUIRE(s == "hello, world");
+        REQUIRE(s.is_inline());
+        s += std::string(30, '!');
+        REQUIRE(s == "hello, world" + std::string(30, '!'));
+        REQUIRE(!s.is_inline());
+        REQUIRE(s.substr(7, 5) == "world");
+        REQUIRE((SsoString("abc") + "def") == "abcdef");
+    }
+
+    SECTION("Appending a string to itself grows from inline to heap storage")
+    {
+        const std::string text(20, 'e');
+        SsoString s(text);
+        REQUIRE(s.is_inline());
+        s += s.view();
+        REQUIRE(s == text + text);
+        REQUIRE(!s.is_inline());
+    }
+
+    SECTION("Appending a string to itself grows the heap storage")
+    {
+        const std::string text(30, 'f');
+        SsoString s(text);
+        REQUIRE(!s.is_inline());
+        REQUIRE(s.capacity() == text.length());
+        s += s.view();
+        REQUIRE(s == text + text);
+        s += s.view().substr(10, 5);
+        REQUIRE(s == text + text + std::string(5, 'f'));
+    }
+
+    SECTION("Assigning reuses a heap buffer large enough")
+    {
+        SsoString s(std::string(100, 'c'));
+        const std::string text(50, 'd');
+        REQUIRE(count_allocations([&] { s.assign(text); }) == 0);
+        REQUIRE(s == text);
+        s = SsoString("short");
+        REQUIRE(s == "short");
+        REQUIRE(s.is_inline());
+    }
+}
+
+TEST_CASE("SharedString", "[]")
+{
+    SECTION("Copies and substrings share the buffer")
+    {
+        SharedString s("hello shared world");
+        const auto allocations = count_allocations([&] {
+            SharedString copy(s);
+            const auto sub = copy.substr(6, 6);
+            REQUIRE(sub == "shared");
+            REQUIRE(s.use_count() == 3);
+        });
+        REQUIRE(allocations == 0);
+        REQUIRE(s.use_count() == 1);
+        REQUIRE((s + "!") == "hello shared world!");
+    }
+
+    SECTION("Copies can be released from several threads")
+    {
+        SharedString s(std::string(1000, 'x'));
+        std::atomic<int> wrong_lengths_count{0};
+        std::vector<std::thread> threads;
+        for (int thread_index = 0; thread_index < 4; ++thread_index)
+        {
+            threads.emplace_back([s, &wrong_lengths_count] {
+                for (int copy_index = 0; copy_index < 10000; ++copy_index)
+                {
+                    SharedString copy(s);
+                    if (copy.length() != 1000)
+                        ++wrong_lengths_count;
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        REQUIRE(wrong_lengths_count == 0);
+        REQUIRE(s.use_count() == 1);
+    }
+}
+
+TEST_CASE("Rope", "[]")
+{
+    SECTION("Concatenation and substring")
+    {
+        const std::string long_text(200, 'x');
+        Rope rope = Rope("hello ") + Rope(long_text) + Rope(" world");
+        REQUIRE(rope.length() == 6 + 200 + 6);
+        REQUIRE(rope == "hello " + long_text + " world");
+        REQUIRE(rope[0] == 'h');
+        REQUIRE(rope[6 + 200 + 5] == 'd');
+        REQUIRE(rope.substr(3, 6) == "lo xxx");
+        REQUIRE(rope.substr(200, 12).str() == "xxxxxx world");
+        REQUIRE(Rope().length() == 0);
+    }
+
+    SECTION("Short pieces are merged into one leaf")
+    {
+        Rope rope = Rope("a") + Rope("b") + Rope("c");
+        REQUIRE(rope.depth() == 0);
+        REQUIRE(rope == "abc");
+    }
+
+    SECTION("Many concatenations keep the tree balanced")
+    {
+        const std::string piece(100, 'p');
+        std::string expected;
+        Rope rope;
+        for (int piece_index = 0; piece_index < 10000; ++piece_index)
+        {
+            rope = rope + Rope(piece);
+            expected += piece;
+        }
+        REQUIRE(rope.depth() <= Rope::max_depth);
+        REQUIRE(rope == expected);
+        REQUIRE(rope.substr(12345, 1000) == std::string_view(expected).substr(12345, 1000));
+    }
+}
+
+template <typename StringT>
+static void benchmark_string(const char* name, const std::string& text)
+{
+    const int repeat_count = 100000;
+    const StringT source(text);
+    std::size_t total_length = 0;
+    std::cout << "  " << name << ":";
+
+    const auto measure = [&](const char* operation_name, auto&& operation) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto allocations = count_allocations([&] {
+            for (int repeat_index = 0; repeat_index < repeat_count; ++repeat_index)
+                operation();
+        });
+        const auto duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << " " << operation_name << " " << static_cast<double>(allocations) / repeat_count << " alloc " << duration / repeat_count << " ns,";
+    };
+    measure("construct", [&] { const StringT s(text); total_length += s.length(); });
+    measure("copy", [&] { const StringT s(source); total_length += s.length(); });
+    measure("concat", [&] { const StringT s = source + source; total_length += s.length(); });
+    measure("substr", [&] { const StringT s = source.substr(1, text.length() / 2); total_length += s.length(); });
+    std::cout << " (" << total_length << ")\n";
+}
+
+TEST_CASE("String benchmark", "[.][benchmark]")
+{
+    for (const std::size_t length : {8, 22, 64, 1024, 65536})
+    {
+        const std::string text(length, 's');
+        std::cout << "length " << length << "\n";
+        benchmark_string<std::string>("std::string ", text);
+        benchmark_string<String>("String      ", text);
+        benchmark_string<SsoString>("SsoString   ", text);
+        benchmark_string<SharedString>("SharedString", text);
+        benchmark_string<Rope>("Rope        ", text);
+    }
 }
 
 // Are there some compilation errors?